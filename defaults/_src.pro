@@ -15,8 +15,10 @@ QMAKE_CLEAN = *.cpp *.moc *.o source.list
 tmake.target = source.list
 tmake.commands = tmake -f ../../config/application.ini -v .. -d . -P
 tmake.depends = qmake_all
-QMAKE_EXTRA_TARGETS = tmake
-POST_TARGETDEPS = source.list
+precompress.commands = tmake -f ../../config/application.ini -z ../../public
+precompress.depends = qmake_all
+QMAKE_EXTRA_TARGETS = tmake precompress
+POST_TARGETDEPS = source.list precompress
 
 include(../../appbase.pri)
 !exists(source.list) {
@@ -21,6 +21,7 @@ HEADER_CLASSES += ../include/TGlobal
 HEADER_CLASSES += ../include/THtmlAttribute
 HEADER_CLASSES += ../include/THtmlParser
 HEADER_CLASSES += ../include/THttpHeader
+HEADER_CLASSES += ../include/THttpCompressor
 HEADER_CLASSES += ../include/THttpRequest
 HEADER_CLASSES += ../include/THttpRequestHeader
 HEADER_CLASSES += ../include/THttpResponse
@@ -38,6 +39,8 @@ HEADER_CLASSES += ../include/TOption
 HEADER_CLASSES += ../include/TSession
 HEADER_CLASSES += ../include/TSessionStore
 HEADER_CLASSES += ../include/TSessionStorePlugin
+HEADER_CLASSES += ../include/TStaticFileCache
+HEADER_CLASSES += ../include/TPublisherBackplane
 HEADER_CLASSES += ../include/TSharedMemoryLogStream
 HEADER_CLASSES += ../include/TSmtpMailer
 HEADER_CLASSES += ../include/TSqlORMapper
@@ -67,9 +70,16 @@ HEADER_CLASSES += ../include/TModelObject
 HEADER_CLASSES += ../include/TPopMailer
 HEADER_CLASSES += ../include/TMultiplexingServer
 HEADER_CLASSES += ../include/TAccessLog
+HEADER_CLASSES += ../include/TLogLayout
+HEADER_CLASSES += ../include/TMetrics
+HEADER_CLASSES += ../include/THistogram
+HEADER_CLASSES += ../include/TQueryTracer
+HEADER_CLASSES += ../include/TTracer
+HEADER_CLASSES += ../include/TIntrospector
 HEADER_CLASSES += ../include/TActionWorker
 HEADER_CLASSES += ../include/TAtomicQueue
 HEADER_CLASSES += ../include/TJsonUtil
+HEADER_CLASSES += ../include/TJsonWriter
 HEADER_CLASSES += ../include/TScheduler
 HEADER_CLASSES += ../include/TApplicationScheduler
 HEADER_CLASSES += ../include/TCommandLineInterface
@@ -115,12 +125,14 @@ HEADER_FILES += tcriteriaconverter.h
 HEADER_FILES += tcryptmac.h
 HEADER_FILES += tdirectview.h
 HEADER_FILES += tdispatcher.h
+HEADER_FILES += tdispatchtable.h
 HEADER_FILES += tfcore.h
 HEADER_FILES += tfexception.h
 HEADER_FILES += tfnamespace.h
 HEADER_FILES += tglobal.h
 HEADER_FILES += thtmlattribute.h
 HEADER_FILES += thtmlparser.h
+HEADER_FILES += thttpcompressor.h
 HEADER_FILES += thttpheader.h
 HEADER_FILES += thttprequest.h
 HEADER_FILES += thttprequestheader.h
@@ -141,6 +153,7 @@ HEADER_FILES += tsessionstore.h
 HEADER_FILES += tsessionstoreplugin.h
 HEADER_FILES += tsharedmemorylogstream.h
 HEADER_FILES += tsmtpmailer.h
+HEADER_FILES += tstaticfilecache.h
 HEADER_FILES += tsqlobject.h
 HEADER_FILES += tsqlormapper.h
 HEADER_FILES += tsqlormapperiterator.h
@@ -163,9 +176,16 @@ HEADER_FILES += tmodelobject.h
 HEADER_FILES += tpopmailer.h
 HEADER_FILES += tmultiplexingserver.h
 HEADER_FILES += taccesslog.h
+HEADER_FILES += tloglayout.h
+HEADER_FILES += tmetrics.h
+HEADER_FILES += thistogram.h
+HEADER_FILES += tquerytracer.h
+HEADER_FILES += ttracer.h
+HEADER_FILES += tintrospector.h
 HEADER_FILES += tactionworker.h
 HEADER_FILES += tatomicqueue.h
 HEADER_FILES += tjsonutil.h
+HEADER_FILES += tjsonwriter.h
 HEADER_FILES += tscheduler.h
 HEADER_FILES += tapplicationscheduler.h
 HEADER_FILES += tcommandlineinterface.h
@@ -199,10 +219,15 @@ HEADER_FILES += tkvsdatabasepool.h
 HEADER_FILES += tstack.h
 HEADER_FILES += thazardobject.h
 HEADER_FILES += thazardptr.h
+HEADER_FILES += tpublisher.h
+HEADER_FILES += tpublisherbackplane.h
 
 unix {
   HEADER_FILES += tfcore_unix.h
 }
+linux-* {
+  HEADER_FILES += tsystembusring.h
+}
 windows {
   HEADER_FILES += tfcore_win.h
 }
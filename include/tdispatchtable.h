@@ -0,0 +1 @@
+#include "../src/tdispatchtable.h"
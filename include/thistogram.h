@@ -0,0 +1 @@
+#include "../src/thistogram.h"
@@ -0,0 +1 @@
+#include "../src/thttpcompressor.h"
@@ -0,0 +1 @@
+#include "../src/tintrospector.h"
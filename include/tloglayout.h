@@ -0,0 +1 @@
+#include "../src/tloglayout.h"
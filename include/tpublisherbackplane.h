@@ -0,0 +1 @@
+#include "../src/tpublisherbackplane.h"
@@ -0,0 +1 @@
+#include "../src/tquerytracer.h"
@@ -0,0 +1 @@
+#include "../src/tstaticfilecache.h"
@@ -0,0 +1 @@
+#include "../src/ttracer.h"
@@ -200,6 +200,20 @@ HEADERS += tlog.h
 SOURCES += tlog.cpp
 HEADERS += tlogger.h
 SOURCES += tlogger.cpp
+HEADERS += tloglayout.h
+SOURCES += tloglayout.cpp
+HEADERS += taccesslogsampler.h
+SOURCES += taccesslogsampler.cpp
+HEADERS += thistogram.h
+SOURCES += thistogram.cpp
+HEADERS += tmetrics.h
+SOURCES += tmetrics.cpp
+HEADERS += tquerytracer.h
+SOURCES += tquerytracer.cpp
+HEADERS += ttracer.h
+SOURCES += ttracer.cpp
+HEADERS += tintrospector.h
+SOURCES += tintrospector.cpp
 HEADERS += tloggerfactory.h
 SOURCES += tloggerfactory.cpp
 HEADERS += tfilelogger.h
@@ -228,6 +242,12 @@ HEADERS += thttpheader.h
 SOURCES += thttpheader.cpp
 HEADERS += turlroute.h
 SOURCES += turlroute.cpp
+HEADERS += tdispatchtable.h
+SOURCES += tdispatchtable.cpp
+HEADERS += thttpcompressor.h
+SOURCES += thttpcompressor.cpp
+HEADERS += tstaticfilecache.h
+SOURCES += tstaticfilecache.cpp
 HEADERS += tabstractuser.h
 SOURCES += tabstractuser.cpp
 HEADERS += tformvalidator.h
@@ -270,6 +290,10 @@ HEADERS += twebsocketsession.h
 SOURCES += twebsocketsession.cpp
 HEADERS += tpublisher.h
 SOURCES += tpublisher.cpp
+HEADERS += tpublisherbackplane.h
+SOURCES += tpublisherbackplane.cpp
+HEADERS += tredisbackplane.h
+SOURCES += tredisbackplane.cpp
 HEADERS += tsystembus.h
 SOURCES += tsystembus.cpp
 HEADERS += tprocessinfo.h
@@ -304,6 +328,8 @@ HEADERS += tdebug.h
 SOURCES += tdebug.cpp
 HEADERS += tjsonutil.h
 SOURCES += tjsonutil.cpp
+HEADERS += tjsonwriter.h
+SOURCES += tjsonwriter.cpp
 HEADERS += tjsloader.h
 SOURCES += tjsloader.cpp
 HEADERS += tjsmodule.h
@@ -358,6 +384,8 @@ unix {
   SOURCES += twebapplication_unix.cpp
   SOURCES += tapplicationserverbase_unix.cpp
   SOURCES += tfileaiowriter_unix.cpp
+  HEADERS += tlogwriter.h
+  SOURCES += tlogwriter.cpp
   SOURCES += tredisdriver_unix.cpp
 }
 linux-* {
@@ -373,6 +401,9 @@ linux-* {
   SOURCES += tepollhttpsocket.cpp
   HEADERS += tepollwebsocket.h
   SOURCES += tepollwebsocket.cpp
+  HEADERS += tsystembusring.h
+  SOURCES += tsystembusring_linux.cpp
+  LIBS += -lrt
   SOURCES += tprocessinfo_linux.cpp
   SOURCES += tthreadapplicationserver_linux.cpp
 }
@@ -418,6 +449,21 @@ windows {
 
 HEADERS += tmongodriver.h
 SOURCES += tmongodriver.cpp
+
+# Libraries for HTTP compression
+windows {
+  QT += zlib-private
+} else {
+  LIBS += -lz
+}
+!isEmpty( use_brotli ) {
+  DEFINES += TF_HAVE_BROTLI
+  LIBS += -lbrotlienc
+}
+!isEmpty( use_zstd ) {
+  DEFINES += TF_HAVE_ZSTD
+  LIBS += -lzstd
+}
 HEADERS += tmongoquery.h
 SOURCES += tmongoquery.cpp
 HEADERS += tmongocursor.h
@@ -29,5 +29,7 @@ public:
 protected:
     virtual TModelObject *modelData() { return nullptr; }
     virtual const TModelObject *modelData() const { return nullptr; }
+
+    friend class TJsonWriter;
 };
 
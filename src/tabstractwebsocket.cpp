@@ -16,6 +16,7 @@
 #include <QObject>
 #include <THttpRequestHeader>
 #include <THttpUtility>
+#include <TMetrics>
 #include <TWebApplication>
 #ifdef Q_OS_LINUX
 #include "tepollwebsocket.h"
@@ -23,12 +24,26 @@
 
 const QByteArray saltToken = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
 
+static TMetricGauge &webSocketConnections()
+{
+    static TMetricGauge &gauge = TMetrics::gauge("tf_websocket_connections", QByteArray(), "Number of open WebSocket connections");
+    return gauge;
+}
+
+
+static TMetricCounter &sentMessages()
+{
+    static TMetricCounter &counter = TMetrics::counter("tf_websocket_messages_sent_total", QByteArray(), "Number of WebSocket messages sent");
+    return counter;
+}
+
 
 TAbstractWebSocket::TAbstractWebSocket(const THttpRequestHeader &header) :
     reqHeader(header),
     mutexData(QMutex::NonRecursive),
     sessionStore()
 {
+    webSocketConnections().add();
 }
 
 
@@ -39,6 +54,7 @@ TAbstractWebSocket::~TAbstractWebSocket()
     }
 
     delete keepAliveTimer;
+    webSocketConnections().sub();
 }
 
 
@@ -48,6 +64,7 @@ void TAbstractWebSocket::sendText(const QString &message)
     frame.setOpCode(TWebSocketFrame::TextFrame);
     frame.setPayload(message.toUtf8());
     writeRawData(frame.toByteArray());
+    sentMessages().add();
 
     renewKeepAlive();  // Renew Keep-Alive interval
 }
@@ -59,6 +76,7 @@ void TAbstractWebSocket::sendBinary(const QByteArray &data)
     frame.setOpCode(TWebSocketFrame::BinaryFrame);
     frame.setPayload(data);
     writeRawData(frame.toByteArray());
+    sentMessages().add();
 
     renewKeepAlive();  // Renew Keep-Alive interval
 }
@@ -97,6 +115,35 @@ void TAbstractWebSocket::sendClose(int code)
 }
 
 
+qint64 TAbstractWebSocket::writeRawDataForPublish(const QByteArray &data, const QString &topic)
+{
+    Q_UNUSED(topic);
+    return writeRawData(data);
+}
+
+
+/*
+  Writes the \a frame published to the \a topic, counting it as a sent
+  message as sendText() and sendBinary() do.
+*/
+void TAbstractWebSocket::sendPublishedFrame(const QByteArray &frame, const QString &topic)
+{
+    writeRawDataForPublish(frame, topic);
+    sentMessages().add();
+
+    renewKeepAlive();  // Renew Keep-Alive interval
+}
+
+
+void TAbstractWebSocket::setSendQueueLimits(qint64 maxBytes, int maxMessages, Tf::SendQueuePolicy policy)
+{
+    // Not supported by default
+    Q_UNUSED(maxBytes);
+    Q_UNUSED(maxMessages);
+    Q_UNUSED(policy);
+}
+
+
 void TAbstractWebSocket::startKeepAlive(int interval)
 {
     tSystemDebug("startKeepAlive");
@@ -38,6 +38,9 @@ protected:
     void sendHandshakeResponse();
     virtual QObject *thisObject() = 0;
     virtual qint64 writeRawData(const QByteArray &data) = 0;
+    virtual qint64 writeRawDataForPublish(const QByteArray &data, const QString &topic);
+    void sendPublishedFrame(const QByteArray &frame, const QString &topic);
+    virtual void setSendQueueLimits(qint64 maxBytes, int maxMessages, Tf::SendQueuePolicy policy);
     virtual QList<TWebSocketFrame> &websocketFrames() = 0;
     int parse(QByteArray &recvData);
 
@@ -49,6 +52,7 @@ protected:
     TBasicTimer *keepAliveTimer {nullptr};
 
     friend class TWebSocketWorker;
+    friend class TPublisher;
     T_DISABLE_COPY(TAbstractWebSocket)
     T_DISABLE_MOVE(TAbstractWebSocket)
 };
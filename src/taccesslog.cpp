@@ -5,8 +5,33 @@
  * the New BSD License, which is incorporated herein by reference.
  */
 
+#include "tfcore.h"
+#include "thistogram.h"
+#include "tloglayout.h"
 #include "tsystemglobal.h"
+#include <QThread>
 #include <TAccessLog>
+#include <algorithm>
+#include <chrono>
+#include <iterator>
+
+namespace {
+const char *const PHASE_NAMES[] = {
+    "wait",
+    "receive",
+    "route",
+    "filter",
+    "action",
+    "render",
+    "db",
+    "session",
+    "send",
+    "total",
+};
+
+THistogram phaseHistograms[TAccessLog::PhaseCount + 1];  // the last one is for the total
+thread_local TAccessLog *currentAccessLog = nullptr;
+}
 
 /*!
   \class TAccessLog
@@ -26,81 +51,47 @@ TAccessLog::TAccessLog(const QByteArray &host, const QByteArray &req) :
 }
 
 
-QByteArray TAccessLog::toByteArray(const QByteArray &layout, const QByteArray &dateTimeFormat) const
+/*!
+  Returns the name of the phase \a phase, or "total" for PhaseCount.
+*/
+const char *TAccessLog::phaseName(int phase)
 {
-    QByteArray message;
-    int pos = 0;
-    QByteArray dig;
-    message.reserve(127);
+    return (phase >= 0 && phase <= PhaseCount) ? PHASE_NAMES[phase] : "";
+}
 
-    while (pos < layout.length()) {
-        char c = layout.at(pos++);
-        if (c != '%') {
-            message.append(c);
-            continue;
+/*!
+  Returns the phase named \a name, PhaseCount for "total", or -1 if
+  no such phase.
+*/
+int TAccessLog::phaseFromName(const QByteArray &name)
+{
+    for (int i = 0; i <= PhaseCount; ++i) {
+        if (name == PHASE_NAMES[i]) {
+            return i;
         }
+    }
+    return -1;
+}
 
-        dig.clear();
-        for (;;) {
-            if (pos >= layout.length()) {
-                message.append('%').append(dig);
-                break;
-            }
-
-            c = layout.at(pos++);
-            if (c >= '0' && c <= '9') {
-                dig += c;
-                continue;
-            }
-
-            switch (c) {
-            case 'h':
-                message.append(remoteHost);
-                break;
-
-            case 'd':  // %d : timestamp
-                if (!dateTimeFormat.isEmpty()) {
-                    message.append(timestamp.toString(dateTimeFormat).toLocal8Bit());
-                } else {
-                    message.append(timestamp.toString(Qt::ISODate).toLatin1());
-                }
-                break;
-
-            case 'r':
-                message.append(request);
-                break;
-
-            case 's':
-                message.append(QString::number(statusCode));
-                break;
-
-            case 'O':
-                if (dig.isEmpty()) {
-                    message.append(QString::number(responseBytes));
-                } else {
-                    const QChar fillChar = (dig[0] == '0') ? QLatin1Char('0') : QLatin1Char(' ');
-                    message.append(QString("%1").arg(responseBytes, dig.toInt(), 10, fillChar).toLatin1());
-                }
-                break;
-
-            case 'n':  // %n : newline
-                message.append('\n');
-                break;
+/*!
+  Returns the histogram of the durations of the phase \a phase in
+  nanoseconds, aggregated over the requests of this process. PhaseCount
+  returns the one of the total latency.
+*/
+const THistogram &TAccessLog::histogram(int phase)
+{
+    return phaseHistograms[qBound(0, phase, (int)PhaseCount)];
+}
 
-            case '%':
-                message.append('%').append(dig);
-                dig.clear();
-                continue;
-                break;
 
-            default:
-                message.append('%').append(dig).append(c);
-                break;
-            }
-            break;
-        }
-    }
-    return message;
+/*!
+  Converts the log to text according to the \a layout and the
+  \a dateTimeFormat. The layout is parsed each call; use
+  TLogLayout::format() to convert logs with a compiled layout.
+*/
+QByteArray TAccessLog::toByteArray(const QByteArray &layout, const QByteArray &dateTimeFormat) const
+{
+    return TLogLayout(layout, dateTimeFormat).format(*this);
 }
 
 
@@ -142,16 +133,117 @@ void TAccessLogger::open()
 }
 
 
+/*!
+  Sets the timestamp and the thread ID at the beginning of the request,
+  and starts measuring the latency from \a firstByteTicks, the monotonic
+  time the first byte of the request arrived, or from now if 0. The phases
+  measured in this thread are added to this log until write() or close().
+*/
+void TAccessLogger::start(qint64 firstByteTicks)
+{
+    open();
+    auto now = std::chrono::system_clock::now().time_since_epoch();
+    accessLog->timestampNsecs = std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+    accessLog->timestamp = QDateTime::fromMSecsSinceEpoch(accessLog->timestampNsecs / 1000000);
+    accessLog->startTicks = (firstByteTicks > 0) ? firstByteTicks : Tf::getMonotonicNSecs();
+    accessLog->latencyNsecs = -1;
+    std::fill(std::begin(accessLog->phaseNsecs), std::end(accessLog->phaseNsecs), 0);
+    accessLog->sendStartTicks = 0;
+#ifdef Q_OS_UNIX
+    accessLog->threadId = tf_gettid();
+#else
+    accessLog->threadId = (qulonglong)QThread::currentThreadId();
+#endif
+    currentAccessLog = accessLog;
+}
+
+/*!
+  Marks the beginning of sending the response.
+*/
+void TAccessLogger::startSend()
+{
+    if (accessLog) {
+        accessLog->sendStartTicks = Tf::getMonotonicNSecs();
+    }
+    if (currentAccessLog == accessLog) {
+        currentAccessLog = nullptr;  // the log may be handed to another object
+    }
+}
+
+/*!
+  Marks the end of sending the response, when the last byte has been
+  written to the socket.
+*/
+void TAccessLogger::finishSend()
+{
+    if (accessLog && accessLog->sendStartTicks > 0 && accessLog->phaseNsecs[TAccessLog::Send] == 0) {
+        accessLog->phaseNsecs[TAccessLog::Send] = Tf::getMonotonicNSecs() - accessLog->sendStartTicks;
+    }
+}
+
+/*!
+  Adds \a nsecs nanoseconds to the phase \a phase of the request which
+  is being processed in the current thread.
+*/
+void TAccessLogger::addPhaseTime(TAccessLog::Phase phase, qint64 nsecs)
+{
+    if (currentAccessLog) {
+        currentAccessLog->phaseNsecs[phase] += nsecs;
+    }
+}
+
+
 void TAccessLogger::write()
 {
+    if (currentAccessLog == accessLog) {
+        currentAccessLog = nullptr;
+    }
+
     if (accessLog) {
-        Tf::writeAccessLog(*accessLog);
+        finishSend();
+        if (accessLog->startTicks > 0 && accessLog->latencyNsecs < 0) {
+            accessLog->latencyNsecs = Tf::getMonotonicNSecs() - accessLog->startTicks;
+
+            for (int i = 0; i < TAccessLog::PhaseCount; ++i) {
+                if (accessLog->phaseNsecs[i] > 0) {
+                    phaseHistograms[i].record(accessLog->phaseNsecs[i]);
+                }
+            }
+            phaseHistograms[TAccessLog::PhaseCount].record(accessLog->latencyNsecs);
+        }
+        if (Tf::isAccessLoggerAvailable()) {
+            Tf::writeAccessLog(*accessLog);
+        }
     }
 }
 
 
 void TAccessLogger::close()
 {
+    if (currentAccessLog == accessLog) {
+        currentAccessLog = nullptr;
+    }
     delete accessLog;
     accessLog = nullptr;
 }
+
+
+/*!
+  \class TAccessLogger::PhaseTimer
+  \brief The PhaseTimer class adds the time elapsed in its scope to a phase
+  of the request processed in the current thread.
+*/
+
+TAccessLogger::PhaseTimer::PhaseTimer(TAccessLog::Phase phase) :
+    _phase(phase),
+    _start(currentAccessLog ? Tf::getMonotonicNSecs() : 0)
+{
+}
+
+
+TAccessLogger::PhaseTimer::~PhaseTimer()
+{
+    if (_start > 0) {
+        TAccessLogger::addPhaseTime(_phase, Tf::getMonotonicNSecs() - _start);
+    }
+}
@@ -3,9 +3,25 @@
 #include <QDateTime>
 #include <TGlobal>
 
+class THistogram;
+
 
 class T_CORE_EXPORT TAccessLog {
 public:
+    // Phases of a request; Render and Database overlap with Action
+    enum Phase {
+        Wait = 0,  // accept to the first byte, first request of a connection
+        Receive,  // first byte to the end of the request
+        Route,
+        Filter,  // preFilter() and postFilter()
+        Action,
+        Render,
+        Database,
+        Session,  // session store
+        Send,  // start of the response to the last byte sent
+        PhaseCount,
+    };
+
     TAccessLog();
     TAccessLog(const QByteArray &remoteHost, const QByteArray &request);
     QByteArray toByteArray(const QByteArray &layout, const QByteArray &dateTimeFormat) const;
@@ -15,6 +31,20 @@ public:
     QByteArray request;
     int statusCode {0};
     int responseBytes {0};
+    // Typed fields for structured output
+    QByteArray method;
+    QByteArray path;
+    qint64 timestampNsecs {0};  // since the epoch
+    qint64 latencyNsecs {-1};
+    qint64 startTicks {0};  // monotonic clock
+    int socketId {-1};
+    qulonglong threadId {0};
+    qint64 phaseNsecs[PhaseCount] {};
+    qint64 sendStartTicks {0};
+
+    static const char *phaseName(int phase);
+    static int phaseFromName(const QByteArray &name);
+    static const THistogram &histogram(int phase);
 };
 
 
@@ -25,14 +55,48 @@ public:
     ~TAccessLogger();
     TAccessLogger &operator=(const TAccessLogger &other);
 
+    class T_CORE_EXPORT PhaseTimer {
+    public:
+        PhaseTimer(TAccessLog::Phase phase);
+        ~PhaseTimer();
+
+    private:
+        TAccessLog::Phase _phase;
+        qint64 _start;
+    };
+
     void open();
+    void start(qint64 firstByteTicks = 0);
     void write();
     void close();
+    void startSend();
+    void finishSend();
+    void setPhaseTime(TAccessLog::Phase phase, qint64 nsecs)
+    {
+        if (accessLog)
+            accessLog->phaseNsecs[phase] = nsecs;
+    }
+    static void addPhaseTime(TAccessLog::Phase phase, qint64 nsecs);
     void setTimestamp(const QDateTime &timestamp)
     {
         if (accessLog)
             accessLog->timestamp = timestamp;
     }
+    void setMethod(const QByteArray &method)
+    {
+        if (accessLog)
+            accessLog->method = method;
+    }
+    void setPath(const QByteArray &path)
+    {
+        if (accessLog)
+            accessLog->path = path;
+    }
+    void setSocketId(int socketId)
+    {
+        if (accessLog)
+            accessLog->socketId = socketId;
+    }
     void setRemoteHost(const QByteArray &host)
     {
         if (accessLog)
@@ -0,0 +1,134 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "taccesslogsampler.h"
+#include <QStringList>
+#include <TSystemGlobal>
+#include <algorithm>
+#include <iterator>
+
+/*!
+  \class TAccessLogSampler
+  \brief The TAccessLogSampler class decides whether to write an access
+  log by the status code of the response.
+
+  The rules are a space-separated list of "pattern:rate", such as
+  "2xx:0.01 5xx:1". A pattern is a status code, a class of status codes
+  like "4xx", or "*" for all. A more specific pattern takes precedence
+  regardless of the order; status codes matching no pattern are always
+  logged.
+*/
+
+namespace {
+constexpr quint64 ALWAYS = Q_UINT64_C(0x100000000);
+
+inline quint32 fastRand()
+{
+    // xorshift per thread; it takes no lock unlike Tf::rand32_r()
+    thread_local quint64 state = Tf::rand64_r() | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (quint32)(state >> 32);
+}
+}
+
+
+TAccessLogSampler::TAccessLogSampler()
+{
+    std::fill(std::begin(thresholds), std::end(thresholds), ALWAYS);
+}
+
+/*!
+  Sets the sampling \a rules. Returns false if any rule is invalid;
+  the invalid rules are ignored.
+*/
+bool TAccessLogSampler::setRules(const QString &rules)
+{
+    struct Rule {
+        int from;
+        int to;
+        quint64 threshold;
+    };
+
+    QList<Rule> ruleList[3];  // any, class, code
+    bool ret = true;
+
+    std::fill(std::begin(thresholds), std::end(thresholds), ALWAYS);
+    sampling = false;
+
+    for (auto &str : rules.simplified().split(' ', QString::SkipEmptyParts)) {
+        QStringList pair = str.split(':');
+        QString pattern = pair.value(0).toLower();
+        bool ok = false;
+        double rate = (pair.count() == 2) ? pair.value(1).toDouble(&ok) : -1;
+
+        if (!ok || rate < 0 || rate > 1) {
+            tSystemWarn("Invalid access log sampling rule: %s", qPrintable(str));
+            ret = false;
+            continue;
+        }
+
+        Rule rule;
+        rule.threshold = (quint64)(rate * ALWAYS);
+        if (pattern == QLatin1String("*")) {
+            rule.from = 0;
+            rule.to = MaxStatusCode;
+            ruleList[0] << rule;
+        } else if (pattern.length() == 3 && pattern.endsWith(QLatin1String("xx")) && pattern[0] >= '1' && pattern[0] <= '5') {
+            rule.from = pattern[0].digitValue() * 100;
+            rule.to = rule.from + 99;
+            ruleList[1] << rule;
+        } else {
+            int code = pattern.toInt(&ok);
+            if (!ok || code < 100 || code > MaxStatusCode) {
+                tSystemWarn("Invalid access log sampling rule: %s", qPrintable(str));
+                ret = false;
+                continue;
+            }
+            rule.from = rule.to = code;
+            ruleList[2] << rule;
+        }
+    }
+
+    for (auto &list : ruleList) {
+        for (auto &rule : list) {
+            for (int i = rule.from; i <= rule.to; ++i) {
+                thresholds[i] = rule.threshold;
+            }
+            sampling |= (rule.threshold < ALWAYS);
+        }
+    }
+    return ret;
+}
+
+/*!
+  Returns true if the access log with the \a statusCode should be written.
+*/
+bool TAccessLogSampler::sample(int statusCode) const
+{
+    if (!sampling || statusCode < 0 || statusCode > MaxStatusCode) {
+        return true;
+    }
+
+    quint64 threshold = thresholds[statusCode];
+    if (threshold >= ALWAYS) {
+        return true;
+    }
+    return threshold > 0 && fastRand() < threshold;
+}
+
+/*!
+  Returns the rate of access logs written for the \a statusCode.
+*/
+double TAccessLogSampler::rate(int statusCode) const
+{
+    if (statusCode < 0 || statusCode > MaxStatusCode) {
+        return 1.0;
+    }
+    return (double)thresholds[statusCode] / ALWAYS;
+}
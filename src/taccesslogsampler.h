@@ -0,0 +1,26 @@
+#pragma once
+#include <QString>
+#include <TGlobal>
+
+
+class T_CORE_EXPORT TAccessLogSampler {
+public:
+    TAccessLogSampler();
+
+    bool setRules(const QString &rules);
+    bool isSampling() const { return sampling; }
+    bool sample(int statusCode) const;
+    double rate(int statusCode) const;
+
+private:
+    enum {
+        MaxStatusCode = 599,
+    };
+
+    quint64 thresholds[MaxStatusCode + 1];  // out of 2^32
+    bool sampling {false};
+
+    T_DISABLE_COPY(TAccessLogSampler)
+    T_DISABLE_MOVE(TAccessLogSampler)
+};
+
@@ -6,6 +6,7 @@
  */
 
 #include "tabstractwebsocket.h"
+#include "thttpcompressor.h"
 #include "thttpsocket.h"
 #include "tpublisher.h"
 #include "tsessionmanager.h"
@@ -19,10 +20,15 @@
 #include <TAppSettings>
 #include <TCache>
 #include <TDispatcher>
+#include <TMetrics>
+#include <TIntrospector>
+#include <TQueryTracer>
+#include <TTracer>
 #include <THttpRequest>
 #include <THttpResponse>
 #include <THttpUtility>
 #include <TSessionStore>
+#include <TStaticFileCache>
 #include <TWebApplication>
 
 /*!
@@ -52,6 +58,145 @@ static bool directViewRenderMode()
     return (bool)mode;
 }
 
+namespace {
+constexpr qint64 MAX_IN_MEMORY_ENCODING_SIZE = 4 * 1024 * 1024;
+
+struct CompressionSettings {
+    QList<THttpCompressor::Encoding> encodings;
+    qint64 minimumSize {0};
+    int level {-1};
+    QList<QByteArray> contentTypes;
+    bool precompressed {false};
+};
+
+QStringList settingValues(Tf::AppAttribute attr)  // delimiter: comma or space
+{
+    QStringList values;
+    for (auto &s : Tf::appSettings()->value(attr).toStringList()) {
+        values << s.simplified().split(QLatin1Char(' '), QString::SkipEmptyParts);
+    }
+    return values;
+}
+
+const CompressionSettings &compressionSettings()
+{
+    static const CompressionSettings settings = []() {
+        CompressionSettings cs;
+        for (auto &s : settingValues(Tf::HttpCompressionEncodings)) {
+            auto encoding = THttpCompressor::fromName(s.toLatin1().toLower());
+            if (encoding == THttpCompressor::Identity) {
+                tSystemWarn("Invalid content coding: %s", qPrintable(s));
+            } else if (!THttpCompressor::isSupported(encoding)) {
+                tSystemWarn("Content coding not supported in this build: %s", qPrintable(s));
+            } else if (!cs.encodings.contains(encoding)) {
+                cs.encodings << encoding;
+            }
+        }
+        for (auto &s : settingValues(Tf::HttpCompressionContentTypes)) {
+            cs.contentTypes << s.toLatin1().toLower();
+        }
+        cs.minimumSize = Tf::appSettings()->value(Tf::HttpCompressionMinimumSize, 1024).toLongLong();
+        cs.level = Tf::appSettings()->value(Tf::HttpCompressionLevel, -1).toInt();
+        cs.precompressed = Tf::appSettings()->value(Tf::HttpCompressionPrecompressed, true).toBool();
+        return cs;
+    }();
+    return settings;
+}
+
+
+bool isCompressibleType(const QByteArray &contentType)
+{
+    int idx = contentType.indexOf(';');
+    QByteArray type = ((idx < 0) ? contentType : contentType.left(idx)).trimmed().toLower();
+    if (type.isEmpty()) {
+        return false;
+    }
+
+    for (auto &t : compressionSettings().contentTypes) {
+        if (t.endsWith('/') ? type.startsWith(t) : (type == t)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void addVaryAcceptEncoding(THttpResponseHeader &header)
+{
+    QByteArray vary = header.rawHeader(QByteArrayLiteral("Vary"));
+    if (vary.isEmpty()) {
+        header.setRawHeader(QByteArrayLiteral("Vary"), QByteArrayLiteral("Accept-Encoding"));
+    } else if (!vary.toLower().contains("accept-encoding") && vary.trimmed() != "*") {
+        header.setRawHeader(QByteArrayLiteral("Vary"), vary + QByteArrayLiteral(", Accept-Encoding"));
+    }
+}
+
+// The representation compressed on the fly is not byte-for-byte identical
+// with the one the strong entity tag was generated for
+void weakenEntityTag(THttpResponseHeader &header)
+{
+    QByteArray etag = header.rawHeader(QByteArrayLiteral("ETag"));
+    if (etag.startsWith('"')) {
+        header.setRawHeader(QByteArrayLiteral("ETag"), QByteArrayLiteral("W/") + etag);
+    }
+}
+
+// Returns the content coding to compress the response with
+THttpCompressor::Encoding negotiateEncoding(const THttpRequest *request, THttpResponseHeader &header, qint64 length)
+{
+    const auto &settings = compressionSettings();
+    if (settings.encodings.isEmpty() || !request || length < qMax(settings.minimumSize, (qint64)1)) {
+        return THttpCompressor::Identity;
+    }
+
+    int status = header.statusCode();
+    if (status < 200 || status == Tf::NoContent || status == Tf::PartialContent || status == Tf::NotModified) {
+        return THttpCompressor::Identity;
+    }
+
+    if (header.hasRawHeader(QByteArrayLiteral("Content-Encoding")) || header.hasRawHeader(QByteArrayLiteral("Content-Range"))
+        || !isCompressibleType(header.contentType())) {
+        return THttpCompressor::Identity;
+    }
+
+    addVaryAcceptEncoding(header);
+    return THttpCompressor::negotiate(request->header().rawHeader(QByteArrayLiteral("Accept-Encoding")), settings.encodings);
+}
+
+// Returns the sibling of the file compressed in advance with a content
+// coding the client accepts
+TStaticFileCache::EntryPtr precompressedFile(const THttpRequest *request, const TStaticFileCache::Entry &file, THttpCompressor::Encoding &encoding)
+{
+    const auto &settings = compressionSettings();
+    if (!settings.precompressed || settings.encodings.isEmpty()) {
+        return TStaticFileCache::EntryPtr();
+    }
+
+    QByteArray acceptEncoding = request->header().rawHeader(QByteArrayLiteral("Accept-Encoding"));
+    if (acceptEncoding.isEmpty()) {
+        return TStaticFileCache::EntryPtr();
+    }
+
+    QList<THttpCompressor::Encoding> candidates = settings.encodings;
+    while (!candidates.isEmpty()) {
+        encoding = THttpCompressor::negotiate(acceptEncoding, candidates);
+        if (encoding == THttpCompressor::Identity) {
+            break;
+        }
+
+        QByteArray suffix = THttpCompressor::fileSuffix(encoding);
+        if (!suffix.isEmpty()) {
+            auto sibling = TStaticFileCache::lookup(file.filePath + QLatin1String(suffix));
+            if (sibling && sibling->lastModified >= file.lastModified) {
+                return sibling;
+            }
+        }
+        candidates.removeAll(encoding);
+    }
+    return TStaticFileCache::EntryPtr();
+}
+}
+
 
 void TActionContext::execute(THttpRequest &request, int sid)
 {
@@ -63,13 +208,30 @@ void TActionContext::execute(THttpRequest &request, int sid)
     static const QString SessionCookiePath = Tf::appSettings()->value(Tf::SessionCookiePath).toString().trimmed();
     static const QString SessionCookieDomain = Tf::appSettings()->value(Tf::SessionCookieDomain).toString().trimmed();
     static const QByteArray SessionCookieSameSite = Tf::appSettings()->value(Tf::SessionCookieSameSite).toByteArray().trimmed();
+    static const bool MetricsEnabled = TMetrics::isEnabled();
+    static const QString MetricsPath = QString::fromLatin1(TMetrics::path());
+    static const bool TracingEnabled = TTracer::isEnabled();
+    static TMetricGauge &inFlightRequests = TMetrics::gauge("tf_http_requests_in_flight", QByteArray(), "Number of HTTP requests being processed");
 
     THttpResponseHeader responseHeader;
+    QByteArray routeLabel = QByteArrayLiteral("-");
+    responseStatus = 0;
+    inFlightRequests.add();
 
     try {
         httpReq = &request;
         const THttpRequestHeader &reqHeader = httpReq->header();
 
+        // Latency breakdown
+        accessLogger.start(firstByteTicks);
+        if (acceptedTicks > 0 && firstByteTicks > acceptedTicks) {
+            accessLogger.setPhaseTime(TAccessLog::Wait, firstByteTicks - acceptedTicks);
+        }
+        if (firstByteTicks > 0 && receivedTicks >= firstByteTicks) {
+            accessLogger.setPhaseTime(TAccessLog::Receive, receivedTicks - firstByteTicks);
+        }
+        acceptedTicks = firstByteTicks = receivedTicks = 0;  // for the first request of a pipeline only
+
         // Access log
         if (Tf::isAccessLoggerAvailable()) {
             QByteArray firstLine;
@@ -78,8 +240,10 @@ void TActionContext::execute(THttpRequest &request, int sid)
             firstLine += ' ';
             firstLine += reqHeader.path();
             firstLine += QStringLiteral(" HTTP/%1.%2").arg(reqHeader.majorVersion()).arg(reqHeader.minorVersion()).toLatin1();
-            accessLogger.setTimestamp(QDateTime::currentDateTime());
             accessLogger.setRequest(firstLine);
+            accessLogger.setMethod(reqHeader.method());
+            accessLogger.setPath(reqHeader.path());
+            accessLogger.setSocketId(sid);
             accessLogger.setRemoteHost((ListenPort > 0) ? originatingClientAddress().toString().toLatin1() : QByteArrayLiteral("(unix)"));
         }
 
@@ -88,21 +252,45 @@ void TActionContext::execute(THttpRequest &request, int sid)
 
         // HTTP method
         Tf::HttpMethod method = httpReq->method();
-        QString path = THttpUtility::fromUrlEncoding(reqHeader.path().mid(0, reqHeader.path().indexOf('?')));
+        // Decoded only when needed; the router works on the raw path
+        auto decodedPath = [&reqHeader]() {
+            return THttpUtility::fromUrlEncoding(reqHeader.path().mid(0, reqHeader.path().indexOf('?')));
+        };
 
         if (LimitRequestBodyBytes > 0 && reqHeader.contentLength() > (uint)LimitRequestBodyBytes) {
             throw ClientErrorException(Tf::RequestEntityTooLarge, __FILE__, __LINE__);  // Request Entity Too Large
         }
 
+        // Metrics
+        if (Q_UNLIKELY(MetricsEnabled && method == Tf::Get && decodedPath() == MetricsPath)) {
+            QByteArray body = TMetrics::exposition();
+            QBuffer buf(&body);
+            int bytes = writeResponse(Tf::OK, responseHeader, TMetrics::ContentType, &buf, body.length());
+            accessLogger.setResponseBytes(bytes);
+            accessLogger.setStatusCode(Tf::OK);
+            accessLogger.write();
+            inFlightRequests.sub();
+            return;
+        }
+
+        // Traces the queries issued by this request
+        TQueryTracer::beginRequest(reqHeader.method(), reqHeader.path());
+        TIntrospector::beginRequest(reqHeader.method(), reqHeader.path());
+        if (TracingEnabled) {
+            TTracer::beginRequest(reqHeader.method(), reqHeader.path(), reqHeader.rawHeader("traceparent"), reqHeader.rawHeader("tracestate"));
+        }
+
         // Routing info exists?
-        QStringList components = TUrlRoute::splitPath(path);
-        TRouting route = TUrlRoute::instance().findRouting(method, components);
+        qint64 routeTicks = Tf::getMonotonicNSecs();
+        TRouting route = TUrlRoute::instance().findRouting(method, reqHeader.path());
+        accessLogger.setPhaseTime(TAccessLog::Route, Tf::getMonotonicNSecs() - routeTicks);
 
         tSystemDebug("Routing: controller:%s  action:%s", route.controller.data(),
             route.action.data());
 
         if (!route.exists) {
             // Default URL routing
+            QStringList components = TUrlRoute::splitPath(decodedPath());
             if (Q_UNLIKELY(directViewRenderMode())) {  // Direct view render mode?
                 // Direct view setting
                 route.setRouting(QByteArrayLiteral("directcontroller"), QByteArrayLiteral("show"), components);
@@ -126,6 +314,7 @@ void TActionContext::execute(THttpRequest &request, int sid)
             currController->setActionName(route.action);
             currController->setArguments(route.params);
             currController->setSocketId(sid);
+            TIntrospector::setAction(route.controller, route.action);
 
             // Session
             if (currController->sessionEnabled()) {
@@ -168,15 +357,28 @@ void TActionContext::execute(THttpRequest &request, int sid)
 
             // Do filters
             bool dispatched = false;
-            if (Q_LIKELY(currController->preFilter())) {
+            bool filtered;
+            {
+                TAccessLogger::PhaseTimer timer(TAccessLog::Filter);
+                filtered = currController->preFilter();
+            }
+            if (Q_LIKELY(filtered)) {
 
                 // Dispatches
-                dispatched = ctlrDispatcher.invoke(route.action, route.params);
+                {
+                    TAccessLogger::PhaseTimer timer(TAccessLog::Action);
+                    TTraceSpan span("action " + route.controller + '#' + route.action);
+                    dispatched = ctlrDispatcher.invoke(route.action, route.params);
+                }
                 if (Q_LIKELY(dispatched)) {
                     autoRemoveFiles << currController->autoRemoveFiles;  // Adds auto-remove files
+                    routeLabel = route.controller + '#' + route.action;
 
                     // Post filter
-                    currController->postFilter();
+                    {
+                        TAccessLogger::PhaseTimer timer(TAccessLog::Filter);
+                        currController->postFilter();
+                    }
 
                     if (Q_UNLIKELY(currController->rollbackRequested())) {
                         rollbackTransactions();
@@ -187,7 +389,11 @@ void TActionContext::execute(THttpRequest &request, int sid)
 
                     // Session store
                     if (currController->sessionEnabled()) {
-                        bool stored = TSessionManager::instance().store(currController->session());
+                        bool stored;
+                        {
+                            TAccessLogger::PhaseTimer timer(TAccessLog::Session);
+                            stored = TSessionManager::instance().store(currController->session());
+                        }
                         if (Q_LIKELY(stored)) {
                             static const int SessionCookieMaxAge = ([]() -> int {
                                 QString maxagestr = Tf::appSettings()->value(Tf::SessionCookieMaxAge).toString().trimmed();
@@ -298,39 +504,17 @@ void TActionContext::execute(THttpRequest &request, int sid)
 
         } else {
             accessLogger.setStatusCode(Tf::BadRequest);  // Set a default status code
-            if (route.controller.startsWith('/')) {
-                path = route.controller;
-            }
+            routeLabel = QByteArrayLiteral("static");
+            QString path = (route.controller.startsWith('/')) ? QString::fromUtf8(route.controller) : decodedPath();
 
             if (Q_LIKELY(method == Tf::Get)) {  // GET Method
                 QString canonicalPath = QUrl(QStringLiteral(".")).resolved(QUrl(path)).toString().mid(1);
-                QFile reqPath(Tf::app()->publicPath() + canonicalPath);
-                QFileInfo fi(reqPath);
+                auto file = TStaticFileCache::lookup(Tf::app()->publicPath() + canonicalPath);
                 tSystemDebug("canonicalPath : %s", qPrintable(canonicalPath));
 
-                if (fi.isFile() && fi.isReadable()) {
-                    // Check "If-Modified-Since" header for caching
-                    bool sendfile = true;
-                    QByteArray ifModifiedSince = reqHeader.rawHeader(QByteArrayLiteral("If-Modified-Since"));
-
-                    if (!ifModifiedSince.isEmpty()) {
-                        QDateTime dt = THttpUtility::fromHttpDateTimeString(ifModifiedSince);
-                        if (dt.isValid()) {
-                            sendfile = (dt.toMSecsSinceEpoch() / 1000 != fi.lastModified().toMSecsSinceEpoch() / 1000);
-                        }
-                    }
-
-                    if (sendfile) {
-                        // Sends a request file
-                        responseHeader.setRawHeader(QByteArrayLiteral("Last-Modified"), THttpUtility::toHttpDateTimeString(fi.lastModified()));
-                        QByteArray type = Tf::app()->internetMediaType(fi.suffix());
-                        int bytes = writeResponse(Tf::OK, responseHeader, type, &reqPath, reqPath.size());
-                        accessLogger.setResponseBytes(bytes);
-                    } else {
-                        // Not send the data
-                        int bytes = writeResponse(Tf::NotModified, responseHeader);
-                        accessLogger.setResponseBytes(bytes);
-                    }
+                if (file) {
+                    int bytes = writeStaticFileResponse(*file, responseHeader);
+                    accessLogger.setResponseBytes(bytes);
                 } else {
                     if (!route.exists) {
                         int bytes = writeResponse(Tf::NotFound, responseHeader);
@@ -364,14 +548,28 @@ void TActionContext::execute(THttpRequest &request, int sid)
         closeHttpSocket();
         accessLogger.setResponseBytes(0);
         accessLogger.setStatusCode(Tf::InternalServerError);
+        responseStatus = Tf::InternalServerError;
     } catch (std::exception &e) {
         tError("Caught Exception: %s", e.what());
         tSystemError("Caught Exception: %s", e.what());
         closeHttpSocket();
         accessLogger.setResponseBytes(0);
         accessLogger.setStatusCode(Tf::InternalServerError);
+        responseStatus = Tf::InternalServerError;
     }
 
+    if (MetricsEnabled) {
+        QByteArray labels = TMetrics::label("status", QByteArray::number(responseStatus));
+        labels += ',';
+        labels += TMetrics::label("route", routeLabel);
+        TMetrics::counter("tf_http_requests_total", labels, "Number of HTTP requests by status code and route").add();
+    }
+    inFlightRequests.sub();
+    TQueryTracer::endRequest();
+    TIntrospector::endRequest();
+    if (TracingEnabled) {
+        TTracer::endRequest(responseStatus, (routeLabel != "-") ? routeLabel : QByteArray());
+    }
     accessLogger.write();  // Writes access log
 }
 
@@ -392,6 +590,92 @@ void TActionContext::release()
 }
 
 
+/*!
+  Sends the static file \a file, answering the conditional request by
+  If-None-Match or If-Modified-Since, and the range request of a single
+  byte range.
+*/
+qint64 TActionContext::writeStaticFileResponse(const TStaticFileCache::Entry &file, THttpResponseHeader &header)
+{
+    const THttpRequestHeader &reqHeader = httpReq->header();
+    const QByteArray range = reqHeader.rawHeader(QByteArrayLiteral("Range"));
+    const TStaticFileCache::Entry *target = &file;
+    TStaticFileCache::EntryPtr precompressed;
+
+    if (range.isEmpty()) {
+        THttpCompressor::Encoding encoding;
+        precompressed = precompressedFile(httpReq, file, encoding);
+        if (precompressed) {
+            target = precompressed.data();
+            header.setRawHeader(QByteArrayLiteral("Content-Encoding"), THttpCompressor::name(encoding));
+            addVaryAcceptEncoding(header);
+        }
+    }
+
+    header.setRawHeader(QByteArrayLiteral("Last-Modified"), file.lastModifiedString);
+    header.setRawHeader(QByteArrayLiteral("ETag"), target->etag);
+    header.setRawHeader(QByteArrayLiteral("Accept-Ranges"), QByteArrayLiteral("bytes"));
+
+    // Conditional request
+    bool modified = true;
+    QByteArray ifNoneMatch = reqHeader.rawHeader(QByteArrayLiteral("If-None-Match"));
+    if (!ifNoneMatch.isEmpty()) {
+        modified = !TStaticFileCache::matchesEntityTag(ifNoneMatch, target->etag);
+    } else {
+        QByteArray ifModifiedSince = reqHeader.rawHeader(QByteArrayLiteral("If-Modified-Since"));
+        if (!ifModifiedSince.isEmpty()) {
+            QDateTime dt = THttpUtility::fromHttpDateTimeString(ifModifiedSince);
+            if (dt.isValid()) {
+                modified = (dt.toMSecsSinceEpoch() / 1000 != file.lastModified.toMSecsSinceEpoch() / 1000);
+            }
+        }
+    }
+
+    if (!modified) {
+        header.removeRawHeader(QByteArrayLiteral("Content-Encoding"));
+        return writeResponse(Tf::NotModified, header);
+    }
+
+    // Range request
+    int statusCode = Tf::OK;
+    qint64 offset = 0;
+    qint64 length = target->size;
+
+    if (!range.isEmpty()) {
+        QByteArray ifRange = reqHeader.rawHeader(QByteArrayLiteral("If-Range"));
+        if (TStaticFileCache::matchesIfRange(ifRange, target->etag, file.lastModifiedString)) {
+            int res = TStaticFileCache::parseByteRange(range, target->size, offset, length);
+            if (res < 0) {
+                header.setRawHeader(QByteArrayLiteral("Content-Range"), QByteArrayLiteral("bytes */") + QByteArray::number(target->size));
+                return writeResponse(Tf::RequestedRangeNotSatisfiable, header);
+            }
+
+            if (res > 0) {
+                statusCode = Tf::PartialContent;
+                QByteArray contentRange = QByteArrayLiteral("bytes ") + QByteArray::number(offset) + '-' + QByteArray::number(offset + length - 1)
+                    + '/' + QByteArray::number(target->size);
+                header.setRawHeader(QByteArrayLiteral("Content-Range"), contentRange);
+            }
+        }
+    }
+
+    QByteArray type = Tf::app()->internetMediaType(QFileInfo(file.filePath).suffix());
+    if (target->hasContent) {
+        QBuffer buffer;
+        buffer.setData((statusCode == Tf::PartialContent) ? target->content.mid(offset, length) : target->content);
+        return writeResponse(statusCode, header, type, &buffer, length);
+    }
+
+    // Sends the part of the file from the current position
+    QFile body(target->filePath);
+    if (offset > 0 && (!body.open(QIODevice::ReadOnly) || !body.seek(offset))) {
+        tSystemError("file seek failed: %s", qPrintable(target->filePath));
+        return writeResponse(Tf::InternalServerError, header);
+    }
+    return writeResponse(statusCode, header, type, &body, length);
+}
+
+
 qint64 TActionContext::writeResponse(int statusCode, THttpResponseHeader &header)
 {
     QByteArray body;
@@ -434,16 +718,68 @@ qint64 TActionContext::writeResponse(int statusCode, THttpResponseHeader &header
 
 qint64 TActionContext::writeResponse(THttpResponseHeader &header, QIODevice *body, qint64 length)
 {
+    QBuffer encodedBody;
+    streamEncoding = THttpCompressor::Identity;
+
+    // Content coding
+    auto encoding = (body) ? negotiateEncoding(httpReq, header, length) : THttpCompressor::Identity;
+    if (encoding != THttpCompressor::Identity) {
+        auto *buffer = qobject_cast<QBuffer *>(body);
+
+        if (buffer || length <= MAX_IN_MEMORY_ENCODING_SIZE) {
+            QByteArray data;
+            if (buffer) {
+                data = buffer->data();
+            } else if (body->isOpen() || body->open(QIODevice::ReadOnly)) {
+                data = body->readAll();
+                body->seek(0);
+            }
 
-    header.setContentLength(length);
+            QByteArray encoded = THttpCompressor::compress(encoding, data.constData(), data.length(), compressionSettings().level);
+            if (!encoded.isEmpty() && encoded.length() < data.length()) {
+                encodedBody.setData(encoded);
+                body = &encodedBody;
+                length = encoded.length();
+                header.setRawHeader(QByteArrayLiteral("Content-Encoding"), THttpCompressor::name(encoding));
+                weakenEntityTag(header);
+            }
+        } else if (streamEncodingSupported() && httpReq->header().majorVersion() == 1 && httpReq->header().minorVersion() >= 1) {
+            // Compresses the file while sending it in chunked transfer coding
+            streamEncoding = encoding;
+            header.setRawHeader(QByteArrayLiteral("Content-Encoding"), THttpCompressor::name(encoding));
+            header.setRawHeader(QByteArrayLiteral("Transfer-Encoding"), QByteArrayLiteral("chunked"));
+            header.removeRawHeader(QByteArrayLiteral("Content-Length"));
+            weakenEntityTag(header);
+        }
+    }
+
+    if (streamEncoding == THttpCompressor::Identity) {
+        header.setContentLength(length);
+    }
     header.setRawHeader(QByteArrayLiteral("Server"), QByteArrayLiteral("TreeFrog server"));
     header.setCurrentDate();
 
     // Write data
+    responseStatus = header.statusCode();
+    accessLogger.startSend();
     return writeResponse(header, body);
 }
 
 
+/*!
+  Sets the monotonic times when the connection was \a accepted, the
+  \a firstByte of the request arrived and the whole request was
+  \a received, in nanoseconds. They are consumed by the next request
+  executed.
+*/
+void TActionContext::setRequestTicks(qint64 accepted, qint64 firstByte, qint64 received)
+{
+    acceptedTicks = accepted;
+    firstByteTicks = firstByte;
+    receivedTicks = received;
+}
+
+
 void TActionContext::emitError(int)
 {
 }
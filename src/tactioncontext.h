@@ -1,6 +1,7 @@
 #pragma once
 #include "tatomic.h"
 #include "tdatabasecontext.h"
+#include "tstaticfilecache.h"
 #include <QMap>
 #include <QStringList>
 #include <TAccessLog>
@@ -38,17 +39,25 @@ protected:
     qint64 writeResponse(int statusCode, THttpResponseHeader &header);
     qint64 writeResponse(int statusCode, THttpResponseHeader &header, const QByteArray &contentType, QIODevice *body, qint64 length);
     qint64 writeResponse(THttpResponseHeader &header, QIODevice *body, qint64 length);
+    qint64 writeStaticFileResponse(const TStaticFileCache::Entry &file, THttpResponseHeader &header);
 
     virtual qint64 writeResponse(THttpResponseHeader &, QIODevice *) { return 0; }
     virtual void closeHttpSocket() { }
+    virtual bool streamEncodingSupported() const { return false; }
     virtual void emitError(int socketError);
+    void setRequestTicks(qint64 accepted, qint64 firstByte, qint64 received);
 
     TAtomic<bool> stopped {false};
     QStringList autoRemoveFiles;
     int socketDesc {0};
     TAccessLogger accessLogger;
+    int streamEncoding {0};  // content coding applied while sending the body
 
 private:
+    qint64 acceptedTicks {0};  // monotonic nsecs; 0 unless the first request of the connection
+    qint64 firstByteTicks {0};
+    qint64 receivedTicks {0};
+    int responseStatus {0};
     TActionController *currController {nullptr};
     QList<TTemporaryFile *> tempFiles;
     THttpRequest *httpReq {nullptr};
@@ -17,6 +17,7 @@
 #include <QTextCodec>
 #include <QTextStream>
 #include <TAbstractUser>
+#include <TAccessLog>
 #include <TActionContext>
 #include <TActionController>
 #include <TActionView>
@@ -486,6 +487,20 @@ QString TActionController::getRenderingData(const QString &templateName, const Q
     return view->toString();
 }
 
+// Renders the view into a UTF-8 buffer; transcodes it only when the
+// HTTP output codec is not UTF-8
+static QByteArray renderToHttpOutput(TActionView *view)
+{
+    QByteArray body;
+    view->renderTo(body);
+
+    QTextCodec *codec = Tf::app()->codecForHttpOutput();
+    if (codec && codec->mibEnum() != 106) {  // 106: UTF-8
+        body = codec->fromUnicode(QString::fromUtf8(body));
+    }
+    return body;
+}
+
 /*!
   Renders the \a view view.
 */
@@ -495,13 +510,14 @@ QByteArray TActionController::renderView(TActionView *view)
         tSystemError("view null pointer.  action:%s", qPrintable(activeAction()));
         return QByteArray();
     }
+    TAccessLogger::PhaseTimer timer(TAccessLog::Render);
     view->setController(this);
     view->setVariantMap(allVariants());
 
     if (!layoutEnabled()) {
         // Renders without layout
         tSystemDebug("Renders without layout");
-        return Tf::app()->codecForHttpOutput()->fromUnicode(view->toString());
+        return renderToHttpOutput(view);
     }
 
     // Displays with layout
@@ -519,7 +535,7 @@ QByteArray TActionController::renderView(TActionView *view)
             layoutView = defLayoutDispatcher.object();
             if (!layoutView) {
                 tSystemDebug("Not found default layout. Renders without layout.");
-                return Tf::app()->codecForHttpOutput()->fromUnicode(view->toString());
+                return renderToHttpOutput(view);
             }
         }
     }
@@ -528,7 +544,7 @@ QByteArray TActionController::renderView(TActionView *view)
     layoutView->setVariantMap(allVariants());
     layoutView->setController(this);
     layoutView->setSubActionView(view);
-    return Tf::app()->codecForHttpOutput()->fromUnicode(layoutView->toString());
+    return renderToHttpOutput(layoutView);
 }
 
 /*!
@@ -9,6 +9,7 @@
 #include <TGlobal>
 #include <THttpRequest>
 #include <THttpResponse>
+#include <TJsonWriter>
 #include <TSession>
 
 class TActionView;
@@ -77,6 +78,9 @@ protected:
     bool renderJson(const QVariantMap &map);
     bool renderJson(const QVariantList &list);
     bool renderJson(const QStringList &list);
+    bool renderJson(const TAbstractModel &model);
+    template <class T>
+    bool renderJson(const QList<T> &models);
     bool renderAndCache(const QByteArray &key, int seconds, const QString &action = QString(), const QString &layout = QString());
     bool renderOnCache(const QByteArray &key);
     void removeCache(const QByteArray &key);
@@ -154,6 +158,12 @@ private:
 };
 
 
+template <class T>
+inline bool TActionController::renderJson(const QList<T> &models)
+{
+    return sendData(TJsonWriter::toJson(models), "application/json; charset=utf-8");
+}
+
 inline QString TActionController::className() const
 {
     return QString(metaObject()->className());
@@ -10,6 +10,7 @@
 #include <QJsonObject>
 #include <QtCore>
 #include <TActionController>
+#include <TJsonWriter>
 
 /*!
   Renders the JSON document \a document as HTTP response.
@@ -44,7 +45,7 @@ bool TActionController::renderJson(const QJsonArray &array)
 */
 bool TActionController::renderJson(const QVariantMap &map)
 {
-    return renderJson(QJsonObject::fromVariantMap(map));
+    return sendData(TJsonWriter::toJson(map), "application/json; charset=utf-8");
 }
 
 /*!
@@ -53,7 +54,7 @@ bool TActionController::renderJson(const QVariantMap &map)
 */
 bool TActionController::renderJson(const QVariantList &list)
 {
-    return renderJson(QJsonArray::fromVariantList(list));
+    return sendData(TJsonWriter::toJson(list), "application/json; charset=utf-8");
 }
 
 /*!
@@ -62,9 +63,28 @@ bool TActionController::renderJson(const QVariantList &list)
 */
 bool TActionController::renderJson(const QStringList &list)
 {
-    return renderJson(QJsonArray::fromStringList(list));
+    return sendData(TJsonWriter::toJson(list), "application/json; charset=utf-8");
 }
 
+/*!
+  Renders the \a model as a JSON object of the map returned by
+  TAbstractModel::toVariantMap(). A model reimplementing only
+  TAbstractModel::toJsonObject() should be rendered by
+  renderJson(model.toJsonObject()) instead.
+  This is available on Qt 5.
+*/
+bool TActionController::renderJson(const TAbstractModel &model)
+{
+    return sendData(TJsonWriter::toJson(model), "application/json; charset=utf-8");
+}
+
+/*!
+  \fn bool TActionController::renderJson(const QList<T> &models)
+  Renders the list of the models \a models as a JSON array of the maps
+  returned by TAbstractModel::toVariantMap() of the models.
+  This is available on Qt 5.
+*/
+
 #if QT_VERSION >= 0x050c00  // 5.12.0
 
 /*!
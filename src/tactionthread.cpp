@@ -141,6 +141,10 @@ void TActionThread::run()
                 goto socket_cleanup;
             }
 
+            qint64 acceptedTicks, firstByteTicks, receivedTicks;
+            _httpSocket->takeRequestTicks(acceptedTicks, firstByteTicks, receivedTicks);
+            TActionContext::setRequestTicks(acceptedTicks, firstByteTicks, receivedTicks);
+
             for (auto &req : requests) {
                 TActionContext::execute(req, _httpSocket->socketId());
             }
@@ -229,7 +233,9 @@ qint64 TActionThread::writeResponse(THttpResponseHeader &header, QIODevice *body
     if (keepAliveTimeout() > 0) {
         header.setRawHeader(QByteArrayLiteral("Connection"), QByteArrayLiteral("Keep-Alive"));
     }
-    return _httpSocket->write(static_cast<THttpHeader *>(&header), body);
+    qint64 bytes = _httpSocket->write(static_cast<THttpHeader *>(&header), body);
+    accessLogger.finishSend();
+    return bytes;
 }
 
 
@@ -11,6 +11,7 @@
 #include <QMutexLocker>
 #include <TActionController>
 #include <TActionView>
+#include <TCache>
 #include <THtmlAttribute>
 #include <THttpUtility>
 #include <TReactComponent>
@@ -20,6 +21,11 @@
   \class TActionView
   \brief The TActionView class is the abstract base class of views,
   providing functionality common to view.
+
+  A view generated by tmake reimplements render() and writes its output
+  as UTF-8 bytes into the buffer passed to renderTo(); the layout and the
+  view of the action share one buffer. A view written by hand may
+  reimplement toString() instead.
 */
 
 
@@ -34,11 +40,69 @@ TActionView::TActionView() :
 }
 
 /*!
-  Returns a content processed by a action.
+  Returns the string of the view. The default implementation renders
+  the view into a UTF-8 buffer by render() and decodes it.
+*/
+QString TActionView::toString()
+{
+    if (Q_UNLIKELY(defaultRendering)) {
+        // Called back from the default render()
+        tSystemError("View reimplements neither render() nor toString(): %s", metaObject()->className());
+        return QString();
+    }
+
+    QByteArray buffer;
+    renderTo(buffer);
+    return QString::fromUtf8(buffer);
+}
+
+/*!
+  Renders the view, appending its output to \a buffer in UTF-8.
+*/
+void TActionView::renderTo(QByteArray &buffer)
+{
+    QByteArray *prev = outputBuffer;
+    outputBuffer = &buffer;
+    render();
+    flushResponseBody();
+    outputBuffer = prev;
+}
+
+/*!
+  This function is reimplemented in subclasses to write the output
+  of the view by echo() and eh(). The default implementation writes
+  the string returned by toString() for views reimplementing it; a view
+  must reimplement either of them.
+*/
+void TActionView::render()
+{
+    QByteArray *buffer = outputBuffer;
+    outputBuffer = nullptr;  // echo() appends to responsebody in toString()
+    defaultRendering = true;
+    QString str = toString();
+    defaultRendering = false;
+    responsebody.clear();  // returned by toString() as str
+    outputBuffer = buffer;
+    writeOutput(str, false);
+}
+
+/*!
+  Returns a content processed by a action. While the view renders
+  into a UTF-8 buffer, the content is written to the buffer directly
+  and an empty string is returned.
 */
 QString TActionView::yield() const
 {
-    return (subView) ? subView->toString() : QString();
+    if (!subView) {
+        return QString();
+    }
+
+    if (outputBuffer) {
+        const_cast<TActionView *>(this)->flushResponseBody();
+        subView->renderTo(*outputBuffer);
+        return QString();
+    }
+    return subView->toString();
 }
 
 /*!
@@ -78,8 +142,7 @@ QString TActionView::authenticityToken() const
 */
 QString TActionView::echo(const THtmlAttribute &attr)
 {
-    responsebody += attr.toString().trimmed();
-    return QString();
+    return echo(attr.toString().trimmed());
 }
 
 /*!
@@ -89,11 +152,10 @@ QString TActionView::echo(const THtmlAttribute &attr)
 QString TActionView::echo(const QVariant &var)
 {
     if (var.userType() == QMetaType::QUrl) {
-        responsebody += var.toUrl().toString(QUrl::FullyEncoded);
+        return echo(var.toUrl().toEncoded(QUrl::FullyEncoded));
     } else {
-        responsebody += var.toString();
+        return echo(var.toString());
     }
-    return QString();
 }
 
 /*!
@@ -102,7 +164,7 @@ QString TActionView::echo(const QVariant &var)
 */
 QString TActionView::eh(const THtmlAttribute &attr)
 {
-    return echo(THttpUtility::htmlEscape(attr.toString().trimmed()));
+    return eh(attr.toString().trimmed());
 }
 
 /*!
@@ -113,12 +175,123 @@ QString TActionView::eh(const THtmlAttribute &attr)
 QString TActionView::eh(const QVariant &var)
 {
     if (var.userType() == QMetaType::QUrl) {
-        return echo(var.toUrl().toString(QUrl::FullyEncoded));
+        return eh(var.toUrl().toEncoded(QUrl::FullyEncoded));
     } else {
-        return echo(THttpUtility::htmlEscape(var.toString()));
+        return eh(var.toString());
+    }
+}
+
+/*!
+  Reserves \a size more bytes in the buffer being rendered into.
+*/
+void TActionView::reserveOutput(int size)
+{
+    if (outputBuffer) {
+        outputBuffer->reserve(outputBuffer->size() + size);
     }
 }
 
+/*!
+  Begins a fragment cached with the \a key for \a seconds, as the
+  <%# cache "key", seconds %> directive of ERB does. If the fragment is
+  found in the cache, writes it out and returns false; the code of the
+  fragment is skipped then. Otherwise returns true, and endCache()
+  stores the output rendered up to it.
+*/
+bool TActionView::beginCache(const QByteArray &key, int seconds)
+{
+    if (!outputBuffer) {
+        return true;  // renders without caching
+    }
+
+    flushResponseBody();
+    QByteArray fragment = Tf::cache()->get(key);
+    if (!fragment.isEmpty()) {
+        outputBuffer->append(fragment);
+        return false;
+    }
+
+    cacheFragments.append(CacheFragment {key, seconds, outputBuffer->size()});
+    return true;
+}
+
+/*!
+  Ends the fragment begun by beginCache() and stores it in the cache.
+*/
+void TActionView::endCache()
+{
+    if (!outputBuffer || cacheFragments.isEmpty()) {
+        return;
+    }
+
+    flushResponseBody();
+    CacheFragment fragment = cacheFragments.takeLast();
+    Tf::cache()->set(fragment.key, outputBuffer->mid(fragment.offset), fragment.seconds);
+}
+
+
+/*
+  Writes out the string which the template code has appended to
+  responsebody directly, keeping it in order with the output of echo()
+  and eh().
+*/
+void TActionView::flushResponseBody()
+{
+    if (outputBuffer && Q_UNLIKELY(!responsebody.isEmpty())) {
+        outputBuffer->append(responsebody.toUtf8());
+        responsebody.clear();
+    }
+}
+
+
+void TActionView::writeOutput(const QString &str, bool escape)
+{
+    if (outputBuffer) {
+        flushResponseBody();
+        if (escape) {
+            THttpUtility::appendHtmlEscaped(*outputBuffer, str.constData(), str.length());
+        } else {
+            outputBuffer->append(str.toUtf8());
+        }
+    } else if (escape) {
+        THttpUtility::appendHtmlEscaped(responsebody, str.constData(), str.length());
+    } else {
+        responsebody += str;
+    }
+}
+
+
+void TActionView::writeOutput(const char *data, int length, bool escape)
+{
+    if (outputBuffer) {
+        flushResponseBody();
+        if (escape) {
+            THttpUtility::appendHtmlEscaped(*outputBuffer, data, length);
+        } else {
+            outputBuffer->append(data, length);
+        }
+    } else {
+        writeOutput(QString::fromUtf8(data, length), escape);
+    }
+}
+
+/*!
+  \fn const T &TActionView::variantRef(const QString &name) const
+  Returns a reference to the value associated with the \a name in the
+  QVariantMap variable for a view, without copying it. If the stored
+  value is not of type T, a converted copy is kept by the view and a
+  reference to it is returned. The reference is valid as long as the
+  view exists.
+  \sa variant()
+*/
+
+
+const QVariant &TActionView::keepVariant(const QVariant &var) const
+{
+    convertedVars.push_back(var);
+    return convertedVars.back();
+}
+
 /*!
   Returns the requested HTTP message.
 */
@@ -184,12 +357,6 @@ const THttpRequest &TActionView::httpRequest() const
   an item with the \a name; otherwise returns false.
 */
 
-/*!
-  \fn virtual QString TActionView::toString()
-  This function is reimplemented in subclasses to return a
-  string to render a view.
-*/
-
 /*!
   \fn QVariant TActionView::variant(const QString &name) const
   Returns the value associated with the \a name in the QVariantMap
@@ -8,6 +8,7 @@
 #include <THttpUtility>
 #include <TPrototypeAjaxHelper>
 #include <TViewHelper>
+#include <list>
 
 class TActionController;
 
@@ -17,11 +18,14 @@ public:
     TActionView();
     virtual ~TActionView() { }
 
-    virtual QString toString() = 0;
+    virtual QString toString();
+    void renderTo(QByteArray &buffer);
     QString yield() const;
     QString renderPartial(const QString &templateName, const QVariantMap &vars = QVariantMap()) const;
     QString authenticityToken() const;
     QVariant variant(const QString &name) const;
+    template <typename T>
+    const T &variantRef(const QString &name) const;
     bool hasVariant(const QString &name) const;
     const QVariantMap &allVariants() const;
     const TActionController *controller() const;
@@ -32,6 +36,7 @@ protected:
     QString echo(const char *str);
     QString echo(const QByteArray &str);
     QString echo(int n, int base = 10);
+    QString echo(uint n, int base = 10);
     QString echo(long n, int base = 10);
     QString echo(ulong n, int base = 10);
     QString echo(qlonglong n, int base = 10);
@@ -46,6 +51,7 @@ protected:
     QString eh(const char *str);
     QString eh(const QByteArray &str);
     QString eh(int n, int base = 10);
+    QString eh(uint n, int base = 10);
     QString eh(long n, int base = 10);
     QString eh(ulong n, int base = 10);
     QString eh(qlonglong n, int base = 10);
@@ -57,13 +63,25 @@ protected:
     QString eh(const THtmlAttribute &attr);
     QString eh(const QVariant &var);
     QString renderReact(const QString &component);
-    QString responsebody;
+    virtual void render();
+    void reserveOutput(int size);
+    bool beginCache(const QByteArray &key, int seconds);
+    bool beginCache(const QString &key, int seconds) { return beginCache(key.toUtf8(), seconds); }
+    bool beginCache(const char *key, int seconds) { return beginCache(QByteArray(key), seconds); }
+    void endCache();
+    QString responsebody;  // for views reimplementing toString(), or appended by template code
 
 private:
     T_DISABLE_COPY(TActionView)
     T_DISABLE_MOVE(TActionView)
 
+    void flushResponseBody();
+    void writeOutput(const QString &str, bool escape);
+    void writeOutput(const char *data, int length, bool escape);
+
     void setVariantMap(const QVariantMap &vars);
+    const QVariant *findVariant(const QString &name) const;
+    const QVariant &keepVariant(const QVariant &var) const;
     void setController(TActionController *controller);
     void setSubActionView(TActionView *actionView);
     virtual const TActionView *actionView() const { return this; }
@@ -71,6 +89,15 @@ private:
     TActionController *actionController {nullptr};
     TActionView *subView {nullptr};
     QVariantMap variantMap;
+    mutable std::list<QVariant> convertedVars;  // values converted by variantRef()
+    struct CacheFragment {
+        QByteArray key;
+        int seconds;
+        int offset;
+    };
+    QList<CacheFragment> cacheFragments;  // fragments being rendered
+    QByteArray *outputBuffer {nullptr};  // UTF-8 buffer while rendering
+    bool defaultRendering {false};  // in the default render()
 
     friend class TActionController;
     friend class TActionMailer;
@@ -98,6 +125,30 @@ inline QVariant TActionView::variant(const QString &name) const
     return variantMap.value(name);
 }
 
+inline const QVariant *TActionView::findVariant(const QString &name) const
+{
+    auto it = variantMap.constFind(name);
+    return (it != variantMap.constEnd()) ? &it.value() : nullptr;
+}
+
+template <typename T>
+inline const T &TActionView::variantRef(const QString &name) const
+{
+    const QVariant *var = findVariant(name);
+    if (var && var->userType() == qMetaTypeId<T>()) {
+        return *reinterpret_cast<const T *>(var->constData());
+    }
+    // Converted or default-constructed value
+    return *reinterpret_cast<const T *>(keepVariant(QVariant::fromValue((var) ? var->value<T>() : T())).constData());
+}
+
+template <>
+inline const QVariant &TActionView::variantRef<QVariant>(const QString &name) const
+{
+    const QVariant *var = findVariant(name);
+    return (var) ? *var : keepVariant(QVariant());
+}
+
 inline bool TActionView::hasVariant(const QString &name) const
 {
     return variantMap.contains(name);
@@ -110,56 +161,55 @@ inline const QVariantMap &TActionView::allVariants() const
 
 inline QString TActionView::echo(const QString &str)
 {
-    responsebody += str;
+    writeOutput(str, false);
     return QString();
 }
 
 inline QString TActionView::echo(const char *str)
 {
-    responsebody += QString(str);  // using codecForCStrings()
+    writeOutput(str, qstrlen(str), false);  // as UTF-8
     return QString();
 }
 
 inline QString TActionView::echo(const QByteArray &str)
 {
-    responsebody += QString(str);  // using codecForCStrings()
+    writeOutput(str.constData(), str.length(), false);  // as UTF-8
     return QString();
 }
 
 inline QString TActionView::echo(int n, int base)
 {
-    responsebody += QString::number(n, base);
-    return QString();
+    return echo(QByteArray::number(n, base));
+}
+
+inline QString TActionView::echo(uint n, int base)
+{
+    return echo(QByteArray::number(n, base));
 }
 
 inline QString TActionView::echo(long n, int base)
 {
-    responsebody += QString::number(n, base);
-    return QString();
+    return echo(QByteArray::number((qlonglong)n, base));
 }
 
 inline QString TActionView::echo(ulong n, int base)
 {
-    responsebody += QString::number(n, base);
-    return QString();
+    return echo(QByteArray::number((qulonglong)n, base));
 }
 
 inline QString TActionView::echo(qlonglong n, int base)
 {
-    responsebody += QString::number(n, base);
-    return QString();
+    return echo(QByteArray::number(n, base));
 }
 
 inline QString TActionView::echo(qulonglong n, int base)
 {
-    responsebody += QString::number(n, base);
-    return QString();
+    return echo(QByteArray::number(n, base));
 }
 
 inline QString TActionView::echo(double d, char format, int precision)
 {
-    responsebody += QString::number(d, format, precision);
-    return QString();
+    return echo(QByteArray::number(d, format, precision));
 }
 
 inline QString TActionView::echo(const QJsonObject &object)
@@ -174,53 +224,61 @@ inline QString TActionView::echo(const QJsonArray &array)
 
 inline QString TActionView::echo(const QJsonDocument &doc)
 {
-    responsebody += doc.toJson(QJsonDocument::Compact);
-    return QString();
+    return echo(doc.toJson(QJsonDocument::Compact));
 }
 
 inline QString TActionView::eh(const QString &str)
 {
-    return echo(THttpUtility::htmlEscape(str));
+    writeOutput(str, true);
+    return QString();
 }
 
 inline QString TActionView::eh(const char *str)
 {
-    return echo(THttpUtility::htmlEscape(str));
+    writeOutput(str, qstrlen(str), true);
+    return QString();
 }
 
 inline QString TActionView::eh(const QByteArray &str)
 {
-    return echo(THttpUtility::htmlEscape(str));
+    writeOutput(str.constData(), str.length(), true);
+    return QString();
 }
 
+// Numbers contain no characters to escape
 inline QString TActionView::eh(int n, int base)
 {
-    return echo(THttpUtility::htmlEscape(QString::number(n, base)));
+    return echo(n, base);
+}
+
+inline QString TActionView::eh(uint n, int base)
+{
+    return echo(n, base);
 }
 
 inline QString TActionView::eh(long n, int base)
 {
-    return echo(THttpUtility::htmlEscape(QString::number(n, base)));
+    return echo(n, base);
 }
 
 inline QString TActionView::eh(ulong n, int base)
 {
-    return echo(THttpUtility::htmlEscape(QString::number(n, base)));
+    return echo(n, base);
 }
 
 inline QString TActionView::eh(qlonglong n, int base)
 {
-    return echo(THttpUtility::htmlEscape(QString::number(n, base)));
+    return echo(n, base);
 }
 
 inline QString TActionView::eh(qulonglong n, int base)
 {
-    return echo(THttpUtility::htmlEscape(QString::number(n, base)));
+    return echo(n, base);
 }
 
 inline QString TActionView::eh(double d, char format, int precision)
 {
-    return echo(THttpUtility::htmlEscape(QString::number(d, format, precision)));
+    return echo(d, format, precision);
 }
 
 inline QString TActionView::eh(const QJsonObject &object)
@@ -235,7 +293,7 @@ inline QString TActionView::eh(const QJsonArray &array)
 
 inline QString TActionView::eh(const QJsonDocument &doc)
 {
-    return echo(THttpUtility::htmlEscape(doc.toJson(QJsonDocument::Compact)));
+    return eh(doc.toJson(QJsonDocument::Compact));
 }
 
 inline void TActionView::setController(TActionController *controller)
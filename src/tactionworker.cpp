@@ -53,7 +53,8 @@ qint64 TActionWorker::writeResponse(THttpResponseHeader &header, QIODevice *body
     }
 
     if (!TActionContext::stopped.load()) {
-        _socket->sendData(header.toByteArray(), body, autoRemove, accessLogger);
+        qint64 bodyLength = (!TActionContext::streamEncoding && header.hasRawHeader("Content-Length")) ? header.contentLength() : -1;
+        _socket->sendData(header.toByteArray(), body, autoRemove, accessLogger, TActionContext::streamEncoding, bodyLength);
     }
     accessLogger.close();  // not write in this thread
     return 0;
@@ -74,6 +75,11 @@ void TActionWorker::start(TEpollHttpSocket *sock)
     _socket = sock;
     _httpRequest += _socket->readRequest();
     _clientAddr = _socket->peerAddress();
+
+    qint64 acceptedTicks, firstByteTicks, receivedTicks;
+    _socket->takeRequestTicks(acceptedTicks, firstByteTicks, receivedTicks);
+    TActionContext::setRequestTicks(acceptedTicks, firstByteTicks, receivedTicks);
+
     QList<THttpRequest> requests = THttpRequest::generate(_httpRequest, _clientAddr);
 
     // Loop for HTTP-pipeline requests
@@ -22,6 +22,7 @@ protected:
     void run();
     qint64 writeResponse(THttpResponseHeader &header, QIODevice *body) override;
     void closeHttpSocket() override;
+    bool streamEncodingSupported() const override { return true; }
 
 private:
     TActionWorker() { }
@@ -74,6 +74,7 @@ bool TApplicationServerBase::loadLibraries()
 
         if (ret) {
             loadedTimestamp = latestLibraryTimestamp();
+            TDispatchTable::build();
         }
     }
     QDir::setCurrent(Tf::app()->webRootPath());
@@ -84,6 +85,7 @@ bool TApplicationServerBase::loadLibraries()
 
 void TApplicationServerBase::unloadLibraries()
 {
+    TDispatchTable::clear();
     for (auto lib : libsLoaded) {
         lib->unload();
         tSystemDebug("Library unloaded: %s", qPrintable(lib->fileName()));
@@ -60,12 +60,39 @@ public:
         insert(Tf::MPMThreadMaxAppServers, "MPM.thread.MaxAppServers");
         insert(Tf::MPMThreadMaxThreadsPerAppServer, "MPM.thread.MaxThreadsPerAppServer");
         insert(Tf::MPMEpollMaxAppServers, "MPM.epoll.MaxAppServers");
+        insert(Tf::MPMEpollSendQueueLimitBytes, "MPM.epoll.SendQueueLimitBytes");
+        insert(Tf::MPMEpollSendQueueLimitMessages, "MPM.epoll.SendQueueLimitMessages");
+        insert(Tf::WebSocketBackplane, "WebSocket.Backplane");
         insert(Tf::SystemLogFilePath, "SystemLog.FilePath");
         insert(Tf::SystemLogLayout, "SystemLog.Layout");
         insert(Tf::SystemLogDateTimeFormat, "SystemLog.DateTimeFormat");
+        insert(Tf::SystemLogFormat, "SystemLog.Format");
         insert(Tf::AccessLogFilePath, "AccessLog.FilePath");
         insert(Tf::AccessLogLayout, "AccessLog.Layout");
         insert(Tf::AccessLogDateTimeFormat, "AccessLog.DateTimeFormat");
+        insert(Tf::AccessLogFormat, "AccessLog.Format");
+        insert(Tf::AccessLogSamplingRules, "AccessLog.SamplingRules");
+        insert(Tf::LogWriterBufferSize, "LogWriter.BufferSize");
+        insert(Tf::LogWriterOverflowPolicy, "LogWriter.OverflowPolicy");
+        insert(Tf::MetricsPath, "Metrics.Path");
+        insert(Tf::MetricsPort, "Metrics.Port");
+        insert(Tf::SlowQueryLogFilePath, "SlowQueryLog.FilePath");
+        insert(Tf::SlowQueryLogThreshold, "SlowQueryLog.Threshold");
+        insert(Tf::SlowQueryLogRequestThreshold, "SlowQueryLog.RequestThreshold");
+        insert(Tf::SlowQueryLogRepeatThreshold, "SlowQueryLog.RepeatThreshold");
+        insert(Tf::SlowQueryLogExplain, "SlowQueryLog.Explain");
+        insert(Tf::TracingExport, "Tracing.Export");
+        insert(Tf::TracingSampleRate, "Tracing.SampleRate");
+        insert(Tf::TracingServiceName, "Tracing.ServiceName");
+        insert(Tf::SystemLogLevel, "SystemLog.Level");
+        insert(Tf::HttpCompressionEncodings, "HttpCompression.Encodings");
+        insert(Tf::HttpCompressionMinimumSize, "HttpCompression.MinimumSize");
+        insert(Tf::HttpCompressionLevel, "HttpCompression.Level");
+        insert(Tf::HttpCompressionContentTypes, "HttpCompression.ContentTypes");
+        insert(Tf::HttpCompressionPrecompressed, "HttpCompression.Precompressed");
+        insert(Tf::StaticFileCacheEnable, "StaticFileCache.Enable");
+        insert(Tf::StaticFileCacheMaxFileSize, "StaticFileCache.MaxFileSize");
+        insert(Tf::StaticFileCacheMaxMemory, "StaticFileCache.MaxMemory");
         insert(Tf::ActionMailerDeliveryMethod, "ActionMailer.DeliveryMethod");
         insert(Tf::ActionMailerCharacterSet, "ActionMailer.CharacterSet");
         insert(Tf::ActionMailerDelayedDelivery, "ActionMailer.DelayedDelivery");
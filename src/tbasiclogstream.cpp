@@ -6,69 +6,83 @@
  */
 
 #include "tbasiclogstream.h"
-#include <QMutexLocker>
 #include <QThread>
 #include <TSystemGlobal>
 
 /*!
   \class TBasicLogStream
   \brief The TBasicLogStream class provides a basic stream for logs.
+
+  Logs are queued without locking and passed to the loggers on the thread
+  of this stream periodically. Logs of the error and fatal levels are
+  passed at once.
 */
 
+constexpr int FLUSH_INTERVAL_MSECS = 200;
+
 
 TBasicLogStream::TBasicLogStream(const QList<TLogger *> loggers, QObject *parent) :
     TAbstractLogStream(loggers, parent)
 {
     loggerOpen();
+    timer.start(FLUSH_INTERVAL_MSECS, this);
 }
 
 
 TBasicLogStream::~TBasicLogStream()
 {
+    timer.stop();
+    // Waits for another thread flushing, so as not to lose the logs on exit
+    while (flushing.load()) {
+        QThread::yieldCurrentThread();
+    }
     flush();
 }
 
 
 void TBasicLogStream::writeLog(const TLog &log)
 {
-    QMutexLocker locker(&mutex);
-    loggerWrite(log);
-
-    if (!isNonBufferingMode()) {
-        if (thread() == QThread::currentThread()) {
-            if (!timer.isActive()) {
-                timer.start(200, this);
-            }
-        } else {
-            // timers cannot be started from another thread
-            loggerFlush();
-        }
+    queue.enqueue(log);
+
+    if (log.priority <= Tf::ErrorLevel) {
+        // The app may abort right after an error
+        flush();
+    } else if (isNonBufferingMode() && thread() == QThread::currentThread()) {
+        flush();
     }
 }
 
-
+/*!
+  Passes the queued logs to the loggers and flushes them. If another
+  thread is flushing, returns immediately; that thread passes the logs
+  queued meanwhile as well.
+*/
 void TBasicLogStream::flush()
 {
-    QMutexLocker locker(&mutex);
-    loggerFlush();
-}
-
+    do {
+        bool expected = false;
+        if (!flushing.compareExchangeStrong(expected, true)) {
+            return;
+        }
 
-void TBasicLogStream::setNonBufferingMode()
-{
-    QMutexLocker locker(&mutex);
-    TAbstractLogStream::setNonBufferingMode();
+        TLog log;
+        while (queue.dequeue(log)) {
+            loggerWrite(log);
+        }
+        loggerFlush();
+        flushing.store(false);
+    } while (queue.count() > 0);  // queued while flushing
 }
 
 
 void TBasicLogStream::timerEvent(QTimerEvent *event)
 {
-    QMutexLocker locker(&mutex);
     if (event->timerId() != timer.timerId()) {
         QObject::timerEvent(event);
         return;
     }
 
-    timer.stop();
-    loggerFlush();  // Flush logger
+    if (queue.count() > 0) {
+        flush();
+    }
 }
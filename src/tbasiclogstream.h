@@ -1,7 +1,8 @@
 #pragma once
 #include "tabstractlogstream.h"
+#include "tatomic.h"
+#include "tqueue.h"
 #include <QBasicTimer>
-#include <QMutex>
 
 
 class T_CORE_EXPORT TBasicLogStream : public TAbstractLogStream {
@@ -11,13 +12,13 @@ public:
 
     void writeLog(const TLog &log);
     void flush();
-    void setNonBufferingMode();
 
 protected:
     void timerEvent(QTimerEvent *event);
 
 private:
-    QMutex mutex;
+    TQueue<TLog> queue;
+    TAtomic<bool> flushing {false};
     QBasicTimer timer;
 
     T_DISABLE_COPY(TBasicLogStream)
@@ -9,6 +9,7 @@
 #include "tcachestore.h"
 #include <TAppSettings>
 #include <TCache>
+#include <TMetrics>
 #include <TWebApplication>
 
 /*!
@@ -72,10 +73,17 @@ bool TCache::set(const QByteArray &key, const QByteArray &value, int seconds)
  */
 QByteArray TCache::get(const QByteArray &key)
 {
+    static TMetricCounter &hits = TMetrics::counter("tf_cache_requests_total", TMetrics::label("result", "hit"), "Number of cache lookups by result");
+    static TMetricCounter &misses = TMetrics::counter("tf_cache_requests_total", TMetrics::label("result", "miss"));
     QByteArray value;
 
     if (_cache) {
         value = _cache->get(key);
+        if (value.isNull()) {
+            misses.add();
+        } else {
+            hits.add();
+        }
         if (compressionEnabled()) {
             value = Tf::lz4Uncompress(value);
         }
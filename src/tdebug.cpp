@@ -12,6 +12,7 @@
 #include <TDebug>
 #include <TLog>
 #include <TLogger>
+#include <atomic>
 
 #undef tFatal
 #undef tError
@@ -28,6 +29,7 @@
 namespace {
 TAbstractLogStream *stream = nullptr;
 QList<TLogger *> loggers;
+std::atomic<int> logLevel {-1};  // the lowest threshold of the loggers
 }
 
 /*!
@@ -37,14 +39,17 @@ QList<TLogger *> loggers;
 void Tf::setupAppLoggers()
 {
     const QStringList loggerList = Tf::app()->loggerSettings().value("Loggers").toString().split(' ', QString::SkipEmptyParts);
+    int level = -1;
 
     for (auto &lg : loggerList) {
         TLogger *lgr = TLoggerFactory::create(lg);
         if (lgr) {
             loggers << lgr;
+            level = qMax(level, (int)lgr->threshold());
             tSystemDebug("Logger added: %s", qPrintable(lgr->key()));
         }
     }
+    logLevel.store(level);
 
     if (!stream) {
         stream = new TBasicLogStream(loggers, qApp);
@@ -57,6 +62,7 @@ void Tf::setupAppLoggers()
 */
 void Tf::releaseAppLoggers()
 {
+    logLevel.store(-1);
     delete stream;
     stream = nullptr;
 
@@ -67,10 +73,20 @@ void Tf::releaseAppLoggers()
 }
 
 
+/*!
+  Returns true if any logger writes the messages of the \a priority;
+  the arguments of tDebug() and so on are not evaluated otherwise.
+*/
+bool Tf::isLogEnabled(int priority) noexcept
+{
+    return priority <= logLevel.load(std::memory_order_relaxed);
+}
+
+
 static void tMessage(int priority, const char *msg, va_list ap)
 {
-    if (stream) {
-        TLog log(priority, QString().vsprintf(msg, ap).toLocal8Bit());
+    if (stream && Tf::isLogEnabled(priority)) {
+        TLog log(priority, Tf::formatLogMessage(msg, ap));
         stream->writeLog(log);
     }
 }
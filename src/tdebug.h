@@ -7,6 +7,7 @@
 namespace Tf {
 T_CORE_EXPORT void setupAppLoggers();  // internal use
 T_CORE_EXPORT void releaseAppLoggers();  // internal use
+T_CORE_EXPORT bool isLogEnabled(int priority) noexcept;
 }
 
 
@@ -1,9 +1,11 @@
 #pragma once
+#include "tdispatchtable.h"
 #include "tsystemglobal.h"
 #include <QMetaMethod>
 #include <QMetaObject>
 #include <QMetaType>
 #include <QStringList>
+#include <QThread>
 #include <TGlobal>
 
 constexpr int NUM_METHOD_PARAMS = 11;
@@ -25,6 +27,7 @@ private:
     QString _metaType;
     int _typeId {0};
     T *_ptr {nullptr};
+    const TDispatchTable::Entry *_entry {nullptr};
 
     T_DISABLE_COPY(TDispatcher)
     T_DISABLE_MOVE(TDispatcher)
@@ -72,6 +75,16 @@ inline QMetaMethod TDispatcher<T>::method(const QByteArray &methodName, int argC
         return QMetaMethod();
     }
 
+    if (Q_LIKELY(_entry && _entry->metaObject)) {
+        // Resolved in advance
+        int idx = _entry->methodIndex(methodName, argCount);
+        if (Q_UNLIKELY(idx < 0)) {
+            tSystemDebug("No such method: %s", qPrintable(methodName));
+            return QMetaMethod();
+        }
+        return _entry->metaObject->method(idx);
+    }
+
     int idx = -1;
     int narg = qMin(argCount, NUM_METHOD_PARAMS - 1);
     for (int i = narg; i >= 0; i--) {
@@ -127,6 +140,21 @@ inline bool TDispatcher<T>::invoke(const QByteArray &method, const QStringList &
 
     if (Q_UNLIKELY(!mm.isValid())) {
         tSystemDebug("No such method: %s", qPrintable(method));
+    } else if (Q_LIKELY(connectionType == Qt::DirectConnection || (connectionType == Qt::AutoConnection && _ptr->thread() == QThread::currentThread()))) {
+        // Calls the slot directly, skipping the type name checks of QMetaMethod::invoke()
+        int argc = mm.parameterCount();
+        if (Q_UNLIKELY(argc > qMin(args.count(), NUM_METHOD_PARAMS - 1))) {
+            tSystemDebug("Too few arguments: %s", qPrintable(method));
+            return false;
+        }
+
+        void *argv[NUM_METHOD_PARAMS] = {nullptr};
+        for (int i = 0; i < argc; i++) {
+            argv[i + 1] = const_cast<QString *>(&args.at(i));
+        }
+        tSystemDebug("Invoke method: %s", qPrintable(_metaType + "." + method));
+        QMetaObject::metacall(_ptr, QMetaObject::InvokeMetaMethod, mm.methodIndex(), argv);
+        ret = true;
     } else {
         tSystemDebug("Invoke method: %s", qPrintable(_metaType + "." + method));
         switch (args.count()) {
@@ -193,11 +221,14 @@ template <class T>
 inline T *TDispatcher<T>::object()
 {
     if (!_ptr) {
-        auto factory = Tf::objectFactories()->value(_metaType.toLatin1().toLower());
+        _entry = TDispatchTable::find(_metaType);
+        auto factory = (_entry) ? _entry->factory : Tf::objectFactories()->value(_metaType.toLatin1().toLower());
         if (Q_LIKELY(factory)) {
             _ptr = dynamic_cast<T *>(factory());
             if (_ptr) {
                 _typeId = 0;
+            } else {
+                _entry = nullptr;
             }
         }
     }
@@ -0,0 +1,150 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tdispatchtable.h"
+#include "tdispatcher.h"
+#include "tsystemglobal.h"
+#include <QMetaMethod>
+#include <QMetaObject>
+
+/*!
+  \class TDispatchTable
+  \brief The TDispatchTable class holds the factories and the action slots
+  of all the controllers, views and endpoints, resolved once after the
+  application libraries are loaded.
+
+  TDispatcher looks up a class here instead of converting its name and
+  searching the meta-object system with signature strings on every
+  request. A class missing in the table is still dispatched in the
+  ordinary way.
+*/
+
+namespace {
+
+// Class name compared case-insensitively without a lowercase copy
+struct ClassName {
+    QString name;
+};
+
+inline bool operator==(const ClassName &a, const ClassName &b)
+{
+    return a.name.compare(b.name, Qt::CaseInsensitive) == 0;
+}
+
+inline uint qHash(const ClassName &key, uint seed = 0)
+{
+    uint h = seed;
+    for (const QChar &c : key.name) {
+        h = 31 * h + c.toLower().unicode();
+    }
+    return h;
+}
+
+using Table = QHash<ClassName, TDispatchTable::Entry>;
+
+Table &dispatchTable()
+{
+    static Table table;
+    return table;
+}
+
+}
+
+/*!
+  Returns the index of the slot named \a methodName for the argument count
+  \a argCount, or -1 if not found. Just as TDispatcher::method() does, a
+  slot taking fewer QString arguments is preferred to one taking more.
+*/
+int TDispatchTable::Entry::methodIndex(const QByteArray &methodName, int argCount) const
+{
+    auto it = slotIndexes.constFind(methodName);
+    if (it == slotIndexes.constEnd()) {
+        return -1;
+    }
+
+    const QVector<int> &indexes = it.value();
+    int narg = qMin(argCount, NUM_METHOD_PARAMS - 1);
+    for (int i = narg; i >= 0; i--) {
+        if (indexes[i] >= 0) {
+            return indexes[i];
+        }
+    }
+    for (int i = narg + 1; i < NUM_METHOD_PARAMS - 1; i++) {
+        if (indexes[i] >= 0) {
+            return indexes[i];
+        }
+    }
+    return -1;
+}
+
+/*!
+  Builds the table from the classes defined by T_DEFINE_CONTROLLER and
+  T_DEFINE_VIEW. It must be called before the worker threads start, as the
+  table is read without locking.
+*/
+void TDispatchTable::build()
+{
+    Table &table = dispatchTable();
+    table.clear();
+
+    const auto *factories = Tf::objectFactories();
+    const auto *metaObjects = Tf::objectMetaObjects();
+
+    for (auto it = factories->cbegin(); it != factories->cend(); ++it) {
+        Entry entry;
+        entry.factory = it.value();
+        entry.metaObject = metaObjects->value(it.key());
+
+        if (entry.metaObject) {
+            // Slots of subclasses come later and take precedence
+            for (int i = 0; i < entry.metaObject->methodCount(); ++i) {
+                QMetaMethod mm = entry.metaObject->method(i);
+                int argc = mm.parameterCount();
+                if (mm.methodType() != QMetaMethod::Slot || argc >= NUM_METHOD_PARAMS) {
+                    continue;
+                }
+
+                bool stringArgs = true;
+                for (int j = 0; j < argc; ++j) {
+                    if (mm.parameterType(j) != QMetaType::QString) {
+                        stringArgs = false;
+                        break;
+                    }
+                }
+
+                if (stringArgs) {
+                    QVector<int> &indexes = entry.slotIndexes[mm.name()];
+                    if (indexes.isEmpty()) {
+                        indexes.fill(-1, NUM_METHOD_PARAMS);
+                    }
+                    indexes[argc] = i;
+                }
+            }
+        }
+        table.insert(ClassName {QString::fromLatin1(it.key())}, entry);
+    }
+    tSystemDebug("Dispatch table built: %d classes", table.count());
+}
+
+/*!
+  Clears the table, e.g. before the application libraries are unloaded.
+*/
+void TDispatchTable::clear()
+{
+    dispatchTable().clear();
+}
+
+/*!
+  Returns the entry of the class named \a className, compared
+  case-insensitively, or nullptr if not found.
+*/
+const TDispatchTable::Entry *TDispatchTable::find(const QString &className)
+{
+    const Table &table = dispatchTable();
+    auto it = table.constFind(ClassName {className});
+    return (it != table.constEnd()) ? &it.value() : nullptr;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <TGlobal>
+#include <functional>
+
+
+class T_CORE_EXPORT TDispatchTable {
+public:
+    class Entry {
+    public:
+        std::function<QObject *()> factory;
+        const QMetaObject *metaObject {nullptr};
+
+        int methodIndex(const QByteArray &methodName, int argCount) const;
+
+    private:
+        QHash<QByteArray, QVector<int>> slotIndexes;  // method indexes by argument count
+
+        friend class TDispatchTable;
+    };
+
+    static void build();
+    static void clear();
+    static const Entry *find(const QString &className);
+};
@@ -257,31 +257,40 @@ void TEpoll::releaseAllPollingSockets()
 }
 
 
-void TEpoll::setSendData(TEpollSocket *socket, const QByteArray &header, QIODevice *body, bool autoRemove, const TAccessLogger &accessLogger)
+void TEpoll::setSendData(TEpollSocket *socket, const QByteArray &header, QIODevice *body, bool autoRemove, const TAccessLogger &accessLogger, int contentEncoding, qint64 bodyLength)
 {
     QByteArray response = header;
     QFileInfo fi;
+    qint64 offset = 0;
 
     if (Q_LIKELY(body)) {
         QBuffer *buffer = qobject_cast<QBuffer *>(body);
         if (buffer) {
             response += buffer->data();
         } else {
-            fi.setFile(*qobject_cast<QFile *>(body));
+            QFile *file = qobject_cast<QFile *>(body);
+            fi.setFile(*file);
+            offset = (file->isOpen()) ? file->pos() : 0;  // sends from the current position
         }
     }
 
-    TSendBuffer *sendbuf = TEpollSocket::createSendBuffer(response, fi, autoRemove, accessLogger);
-    socket->enqueueSendData(sendbuf);
-    modifyPoll(socket, (EPOLLIN | EPOLLOUT | EPOLLET));  // reset
+    if (fi.filePath().isEmpty()) {
+        contentEncoding = 0;
+    }
+    TSendBuffer *sendbuf = TEpollSocket::createSendBuffer(response, fi, autoRemove, accessLogger, contentEncoding, offset, bodyLength);
+    if (socket->enqueueSendData(sendbuf)) {
+        modifyPoll(socket, (EPOLLIN | EPOLLOUT | EPOLLET));  // reset
+    }
 }
 
 
-void TEpoll::setSendData(TEpollSocket *socket, const QByteArray &data)
+void TEpoll::setSendData(TEpollSocket *socket, const QByteArray &data, const QString &topic)
 {
     TSendBuffer *sendbuf = TEpollSocket::createSendBuffer(data);
-    socket->enqueueSendData(sendbuf);
-    modifyPoll(socket, (EPOLLIN | EPOLLOUT | EPOLLET));  // reset
+    sendbuf->setTopic(topic);
+    if (socket->enqueueSendData(sendbuf)) {
+        modifyPoll(socket, (EPOLLIN | EPOLLOUT | EPOLLET));  // reset
+    }
 }
 
 
@@ -6,6 +6,7 @@
 
 class QIODevice;
 class QByteArray;
+class QString;
 class TEpollSocket;
 class TAccessLogger;
 class TSendData;
@@ -33,8 +34,8 @@ public:
     void releaseAllPollingSockets();
 
     // For action workers
-    void setSendData(TEpollSocket *socket, const QByteArray &header, QIODevice *body, bool autoRemove, const TAccessLogger &accessLogger);
-    void setSendData(TEpollSocket *socket, const QByteArray &data);
+    void setSendData(TEpollSocket *socket, const QByteArray &header, QIODevice *body, bool autoRemove, const TAccessLogger &accessLogger, int contentEncoding = 0, qint64 bodyLength = -1);
+    void setSendData(TEpollSocket *socket, const QByteArray &data, const QString &topic = QString());
     void setDisconnect(TEpollSocket *socket);
     void setSwitchToWebSocket(TEpollSocket *socket, const THttpRequestHeader &header);
 
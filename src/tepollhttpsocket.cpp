@@ -21,6 +21,8 @@ constexpr int BUFFER_RESERVE_SIZE = 1023;
 
 namespace {
 qint64 systemLimitBodyBytes = -1;
+qint64 sendQueueLimitBytes = -1;
+int sendQueueLimitMessages = -1;
 }
 
 
@@ -30,6 +32,17 @@ TEpollHttpSocket::TEpollHttpSocket(int socketDescriptor, const QHostAddress &add
 {
     httpBuffer.reserve(BUFFER_RESERVE_SIZE);
     idleElapsed = std::time(nullptr);
+    acceptedTicks = Tf::getMonotonicNSecs();
+
+    if (Q_UNLIKELY(sendQueueLimitBytes < 0)) {
+        sendQueueLimitBytes = Tf::appSettings()->value(Tf::MPMEpollSendQueueLimitBytes, "0").toLongLong();
+        sendQueueLimitMessages = Tf::appSettings()->value(Tf::MPMEpollSendQueueLimitMessages, "0").toInt();
+    }
+
+    if (sendQueueLimitBytes > 0 || sendQueueLimitMessages > 0) {
+        // Responses must not be dropped; closes a connection not reading them
+        setSendQueueLimits(sendQueueLimitBytes, sendQueueLimitMessages, Tf::DisconnectSocket);
+    }
 }
 
 
@@ -56,6 +69,20 @@ QByteArray TEpollHttpSocket::readRequest()
 }
 
 
+/*!
+  Returns the monotonic times when this connection was \a accepted,
+  the \a firstByte of the request arrived and the request was
+  \a received entirely, and resets them for the next request.
+*/
+void TEpollHttpSocket::takeRequestTicks(qint64 &accepted, qint64 &firstByte, qint64 &received)
+{
+    accepted = acceptedTicks;
+    firstByte = firstByteTicks;
+    received = receivedTicks;
+    acceptedTicks = firstByteTicks = receivedTicks = 0;
+}
+
+
 int TEpollHttpSocket::send()
 {
     int ret = TEpollSocket::send();
@@ -91,6 +118,9 @@ bool TEpollHttpSocket::seekRecvBuffer(int pos)
         return false;
     }
 
+    if (firstByteTicks == 0) {
+        firstByteTicks = Tf::getMonotonicNSecs();
+    }
     len += pos;
     httpBuffer.resize(len);
 
@@ -107,6 +137,8 @@ bool TEpollHttpSocket::seekRecvBuffer(int pos)
 
     // WebSocket?
     if (lengthToRead == 0) {
+        receivedTicks = Tf::getMonotonicNSecs();
+
         // Check connection header
         THttpRequestHeader header(httpBuffer);
         QByteArray connectionHeader = header.rawHeader("Connection").toLower();
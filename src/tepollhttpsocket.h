@@ -12,6 +12,7 @@ public:
 
     virtual bool canReadRequest();
     QByteArray readRequest();
+    void takeRequestTicks(qint64 &accepted, qint64 &firstByte, qint64 &received);
     int idleTime() const;
     virtual void startWorker();
     void releaseWorker();
@@ -30,6 +31,9 @@ private:
     QByteArray httpBuffer;
     qint64 lengthToRead {0};
     uint idleElapsed {0};
+    qint64 acceptedTicks {0};
+    qint64 firstByteTicks {0};
+    qint64 receivedTicks {0};
 
     TEpollHttpSocket(int socketDescriptor, const QHostAddress &address);
 
@@ -12,9 +12,13 @@
 #include "tfcore.h"
 #include "tsendbuffer.h"
 #include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QThread>
 #include <THttpHeader>
 #include <TSystemGlobal>
 #include <TWebApplication>
+#include <algorithm>
 #include <atomic>
 #include <sys/types.h>
 
@@ -26,6 +30,7 @@ int recvBufSize = 0;
 std::atomic<int> socketCounter {0};
 TAtomicPtr<TEpollSocket> socketManager[USHRT_MAX + 1];
 std::atomic<ushort> point {0};
+std::atomic<int> introspectors {0};  // keeps sockets alive while reading them
 }
 
 
@@ -60,9 +65,9 @@ TEpollSocket *TEpollSocket::create(int socketDescriptor, const QHostAddress &add
 }
 
 
-TSendBuffer *TEpollSocket::createSendBuffer(const QByteArray &header, const QFileInfo &file, bool autoRemove, const TAccessLogger &logger)
+TSendBuffer *TEpollSocket::createSendBuffer(const QByteArray &header, const QFileInfo &file, bool autoRemove, const TAccessLogger &logger, int contentEncoding, qint64 offset, qint64 length)
 {
-    return new TSendBuffer(header, file, autoRemove, logger);
+    return new TSendBuffer(header, file, autoRemove, logger, contentEncoding, offset, length);
 }
 
 
@@ -97,7 +102,9 @@ void TEpollSocket::initBuffer(int socketDescriptor)
 
 TEpollSocket::TEpollSocket(int socketDescriptor, const QHostAddress &address) :
     sd(socketDescriptor),
-    clientAddr(address)
+    clientAddr(address),
+    openedNsecs(Tf::getMonotonicNSecs()),
+    activeNsecs(openedNsecs)
 {
     do {
         sid = point.fetch_add(1);
@@ -113,13 +120,23 @@ TEpollSocket::~TEpollSocket()
 
     close();
 
+    QMutexLocker locker(&sendMutex);
+    takeIncomingData();
     while (!sendBuf.isEmpty()) {
         TSendBuffer *buf = sendBuf.dequeue();
         delete buf;
     }
+    sendBufBytes = 0;
+    sendBufCount = 0;
 
     socketManager[sid].compareExchangeStrong(this, nullptr);  //clear
     socketCounter--;
+
+    // Waits for introspect() which may be reading this socket
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    while (introspectors.load() > 0) {
+        QThread::yieldCurrentThread();
+    }
 }
 
 
@@ -145,6 +162,7 @@ int TEpollSocket::recv()
 
         // Read successfully
         seekRecvBuffer(len);
+        activeNsecs.store(Tf::getMonotonicNSecs());
     }
 
     if (!len && !err) {
@@ -179,14 +197,22 @@ int TEpollSocket::send()
 {
     int ret = 0;
 
-    if (sendBuf.isEmpty()) {
+    // Only the epoll thread dequeues, so the head stays valid while sending.
+    // The mutex is contended only by a producer applying the overflow policy.
+    auto headBuffer = [this]() -> TSendBuffer * {
+        QMutexLocker locker(&sendMutex);
+        takeIncomingData();
+        return (sendBuf.isEmpty()) ? nullptr : sendBuf.head();
+    };
+
+    TSendBuffer *buf = headBuffer();
+    if (!buf) {
         pollOut = true;
         return ret;
     }
     pollOut = false;
 
-    while (!sendBuf.isEmpty()) {
-        TSendBuffer *buf = sendBuf.head();
+    for (; buf; buf = headBuffer()) {
         TAccessLogger &logger = buf->accessLogger();
 
         int len = 0;
@@ -208,12 +234,14 @@ int TEpollSocket::send()
 
             // Sent successfully
             buf->seekData(len);
+            activeNsecs.store(Tf::getMonotonicNSecs());
             logger.setResponseBytes(logger.responseBytes() + len);
         }
 
         if (buf->atEnd()) {
             logger.write();  // Writes access log
-            delete sendBuf.dequeue();  // delete send-buffer obj
+            QMutexLocker locker(&sendMutex);
+            removeSendBuffer(0);  // delete send-buffer obj
         }
 
         if (len < 0) {
@@ -241,10 +269,134 @@ int TEpollSocket::send()
     return ret;
 }
 
-
-void TEpollSocket::enqueueSendData(TSendBuffer *buffer)
+/*!
+  Enqueues the \a buffer onto the send queue, applying the policy set by
+  setSendQueueLimits() if the queue exceeds its limits.
+  Returns false if the buffer was not queued; the buffer is deleted then.
+
+  Within the limits, the buffer is put into a lock-free queue which the
+  epoll thread moves to the send queue. Over them, the policy may remove
+  buffers from the middle of the send queue, which the lock-free queue
+  does not allow, so the send mutex is taken. Concurrent producers may
+  exceed the limits by a few messages.
+*/
+bool TEpollSocket::enqueueSendData(TSendBuffer *buffer)
 {
+    if (Q_LIKELY(!exceedsSendQueueLimits(buffer->size()))) {
+        sendBufBytes.fetchAdd(buffer->size());
+        sendBufCount++;
+        incomingBuf.enqueue(buffer);
+        return true;
+    }
+
+    QMutexLocker locker(&sendMutex);
+    takeIncomingData();  // keeps the order of the buffers
+
+    if (exceedsSendQueueLimits(buffer->size())) {
+        switch (queuePolicy.load()) {
+        case Tf::DropNewest:
+            break;
+
+        case Tf::CoalesceLatest:
+            if (!buffer->topic().isEmpty()) {
+                // The head may be in the middle of sending
+                for (int i = sendBuf.count() - 1; i > 0; --i) {
+                    if (sendBuf[i]->topic() == buffer->topic()) {
+                        removeSendBuffer(i);
+                    }
+                }
+            }
+            // FALLTHRU
+        case Tf::DropOldest:
+            while (sendBuf.count() > 1 && exceedsSendQueueLimits(buffer->size())) {
+                removeSendBuffer(1);
+            }
+            break;
+
+        case Tf::DisconnectSocket:
+            if (!overflowed.exchange(true)) {
+                tSystemWarn("Send queue overflow, disconnecting : sid:%d  bytes:%lld  messages:%d", sid, (qint64)sendBufBytes, (int)sendBufCount);
+                TEpoll::instance()->setDisconnect(this);
+            }
+            break;
+
+        default:
+            break;
+        }
+
+        if (exceedsSendQueueLimits(buffer->size())) {
+            dropSendBuffer(buffer);
+            return false;
+        }
+    }
+
+    sendBufBytes.fetchAdd(buffer->size());
+    sendBufCount++;
     sendBuf.enqueue(buffer);
+    return true;
+}
+
+
+bool TEpollSocket::exceedsSendQueueLimits(qint64 additionalBytes) const
+{
+    qint64 maxBytes = limitBytes.load();
+    int maxMessages = limitMessages.load();
+    return (maxBytes > 0 && sendBufBytes + additionalBytes > maxBytes)
+        || (maxMessages > 0 && sendBufCount + 1 > maxMessages);
+}
+
+/*!
+  Moves the buffers in the lock-free queue to the send queue.
+  The send mutex must be locked.
+*/
+void TEpollSocket::takeIncomingData()
+{
+    TSendBuffer *buf;
+    while (incomingBuf.dequeue(buf)) {
+        sendBuf.enqueue(buf);
+    }
+}
+
+/*!
+  Removes the send-buffer at the \a index. The send mutex must be locked.
+  If the buffer has not been sent completely, it is dropped.
+*/
+void TEpollSocket::removeSendBuffer(int index)
+{
+    TSendBuffer *buf = sendBuf.takeAt(index);
+    sendBufBytes.fetchSub(buf->size());
+    sendBufCount--;
+
+    if (buf->atEnd()) {
+        delete buf;
+    } else {
+        dropSendBuffer(buf);
+    }
+}
+
+/*!
+  Deletes the \a buffer not sent for the send queue overflow, writing its
+  access log as failed.
+*/
+void TEpollSocket::dropSendBuffer(TSendBuffer *buffer)
+{
+    TAccessLogger &logger = buffer->accessLogger();
+    logger.setResponseBytes(-1);
+    logger.write();
+    dropCounter++;
+    delete buffer;
+}
+
+/*!
+  Sets the limits of the send queue to \a maxBytes bytes and \a maxMessages
+  messages; the zero value means unlimited. The \a policy is applied to
+  the queue when a new message would exceed the limits.
+*/
+void TEpollSocket::setSendQueueLimits(qint64 maxBytes, int maxMessages, Tf::SendQueuePolicy policy)
+{
+    limitBytes = qMax(maxBytes, 0LL);
+    limitMessages = qMax(maxMessages, 0);
+    queuePolicy = policy;
 }
 
 
@@ -263,15 +415,15 @@ void TEpollSocket::close()
 }
 
 
-void TEpollSocket::sendData(const QByteArray &header, QIODevice *body, bool autoRemove, const TAccessLogger &accessLogger)
+void TEpollSocket::sendData(const QByteArray &header, QIODevice *body, bool autoRemove, const TAccessLogger &accessLogger, int contentEncoding, qint64 bodyLength)
 {
-    TEpoll::instance()->setSendData(this, header, body, autoRemove, accessLogger);
+    TEpoll::instance()->setSendData(this, header, body, autoRemove, accessLogger, contentEncoding, bodyLength);
 }
 
 
-void TEpollSocket::sendData(const QByteArray &data)
+void TEpollSocket::sendData(const QByteArray &data, const QString &topic)
 {
-    TEpoll::instance()->setSendData(this, data);
+    TEpoll::instance()->setSendData(this, data, topic);
 }
 
 
@@ -287,22 +439,20 @@ void TEpollSocket::switchToWebSocket(const THttpRequestHeader &header)
 }
 
 
-// qint64 TEpollSocket::bufferedBytes() const
-// {
-//     qint64 ret = 0;
-//     for (auto &d : sendBuf) {
-//         ret += d->arrayBuffer.size();
-//         if (d->bodyFile) {
-//             ret += d->bodyFile->size();
-//         }
-//     }
-//     return ret;
-// }
-
+/*!
+  Returns the number of bytes held in memory by the send queue.
+*/
+qint64 TEpollSocket::bufferedBytes() const
+{
+    return sendBufBytes.load();
+}
 
+/*!
+  Returns the number of messages in the send queue.
+*/
 int TEpollSocket::bufferedListCount() const
 {
-    return sendBuf.count();
+    return sendBufCount.load();
 }
 
 
@@ -312,6 +462,15 @@ TEpollSocket *TEpollSocket::searchSocket(int sid)
 }
 
 
+/*!
+  Returns the number of sockets currently open.
+*/
+int TEpollSocket::socketCount()
+{
+    return socketCounter.load(std::memory_order_acquire);
+}
+
+
 QList<TEpollSocket *> TEpollSocket::allSockets()
 {
     QList<TEpollSocket *> lst;
@@ -327,3 +486,39 @@ QList<TEpollSocket *> TEpollSocket::allSockets()
     }
     return lst;
 }
+
+/*!
+  Returns the list of the open sockets with their idle time and the bytes
+  in their send queues, for TIntrospector. It is callable on any thread;
+  the sockets being read are not deleted until it returns. Only the members
+  of TEpollSocket are read as the derived part may be being destroyed.
+*/
+QJsonValue TEpollSocket::introspect()
+{
+    const qint64 now = Tf::getMonotonicNSecs();
+    QJsonArray sockets;
+
+    introspectors++;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    int count = socketCounter.load(std::memory_order_acquire);
+    for (int i = 0; i <= USHRT_MAX && sockets.count() < count; i++) {
+        TEpollSocket *sock = socketManager[i].load();
+        if (!sock) {
+            continue;
+        }
+
+        QJsonObject obj;
+        obj.insert(QStringLiteral("sid"), sock->sid);
+        obj.insert(QStringLiteral("sd"), sock->sd);
+        obj.insert(QStringLiteral("peer"), sock->clientAddr.toString());
+        obj.insert(QStringLiteral("age_ms"), (double)((now - sock->openedNsecs) / 1000000));
+        obj.insert(QStringLiteral("idle_ms"), (double)(std::max(now - sock->activeNsecs.load(), (qint64)0) / 1000000));
+        obj.insert(QStringLiteral("send_queue_bytes"), (double)sock->sendBufBytes.load());
+        obj.insert(QStringLiteral("dropped"), (double)sock->dropCounter.load());
+        sockets.append(obj);
+    }
+
+    introspectors--;
+    return sockets;
+}
@@ -1,7 +1,9 @@
 #pragma once
 #include "tatomic.h"
+#include "tqueue.h"
 #include <QByteArray>
 #include <QHostAddress>
+#include <QMutex>
 #include <QObject>
 #include <QQueue>
 #include <TGlobal>
@@ -13,6 +15,7 @@ class THttpRequestHeader;
 class QHostAddress;
 class QThread;
 class QFileInfo;
+class QJsonValue;
 
 
 class T_CORE_EXPORT TEpollSocket {
@@ -24,29 +27,34 @@ public:
     int socketDescriptor() const { return sd; }
     QHostAddress peerAddress() const { return clientAddr; }
     int socketId() const { return sid; }
-    void sendData(const QByteArray &header, QIODevice *body, bool autoRemove, const TAccessLogger &accessLogger);
-    void sendData(const QByteArray &data);
+    void sendData(const QByteArray &header, QIODevice *body, bool autoRemove, const TAccessLogger &accessLogger, int contentEncoding = 0, qint64 bodyLength = -1);
+    void sendData(const QByteArray &data, const QString &topic = QString());
     void disconnect();
     void switchToWebSocket(const THttpRequestHeader &header);
     int bufferedListCount() const;
+    qint64 bufferedBytes() const;
+    quint64 droppedCount() const { return dropCounter.load(); }
+    void setSendQueueLimits(qint64 maxBytes, int maxMessages, Tf::SendQueuePolicy policy);
 
     virtual bool canReadRequest() { return false; }
     virtual void startWorker() { }
 
     static TEpollSocket *accept(int listeningSocket);
     static TEpollSocket *create(int socketDescriptor, const QHostAddress &address);
-    static TSendBuffer *createSendBuffer(const QByteArray &header, const QFileInfo &file, bool autoRemove, const TAccessLogger &logger);
+    static TSendBuffer *createSendBuffer(const QByteArray &header, const QFileInfo &file, bool autoRemove, const TAccessLogger &logger, int contentEncoding = 0, qint64 offset = 0, qint64 length = -1);
     static TSendBuffer *createSendBuffer(const QByteArray &data);
+    static QJsonValue introspect();
 
 protected:
     virtual int send();
     virtual int recv();
-    void enqueueSendData(TSendBuffer *buffer);
+    bool enqueueSendData(TSendBuffer *buffer);
     void setSocketDescpriter(int socketDescriptor);
     virtual void *getRecvBuffer(int size) = 0;
     virtual bool seekRecvBuffer(int pos) = 0;
     static TEpollSocket *searchSocket(int sid);
     static QList<TEpollSocket *> allSockets();
+    static int socketCount();
 
     TAtomic<bool> pollIn {false};
     TAtomic<bool> pollOut {false};
@@ -55,7 +63,23 @@ private:
     int sd {0};  // socket descriptor
     int sid {0};
     QHostAddress clientAddr;
-    QQueue<TSendBuffer *> sendBuf;
+    TQueue<TSendBuffer *> incomingBuf;  // multi-producer, lock-free
+    QQueue<TSendBuffer *> sendBuf;  // the head is being sent by the epoll thread
+    mutable QMutex sendMutex;  // guards sendBuf
+    TAtomic<qint64> sendBufBytes {0};  // in both queues
+    TAtomic<int> sendBufCount {0};  // in both queues
+    const qint64 openedNsecs {0};
+    TAtomic<qint64> activeNsecs {0};  // last time of sending or receiving
+    TAtomic<qint64> limitBytes {0};  // 0: unlimited
+    TAtomic<int> limitMessages {0};  // 0: unlimited
+    TAtomic<int> queuePolicy {Tf::DropOldest};
+    TAtomic<quint64> dropCounter {0};
+    TAtomic<bool> overflowed {false};
+
+    bool exceedsSendQueueLimits(qint64 additionalBytes) const;
+    void takeIncomingData();
+    void removeSendBuffer(int index);
+    void dropSendBuffer(TSendBuffer *buffer);
 
     static void initBuffer(int socketDescriptor);
 
@@ -8,6 +8,7 @@
 #include "tepollwebsocket.h"
 #include "tdispatcher.h"
 #include "tepoll.h"
+#include "tpublisher.h"
 #include "turlroute.h"
 #include "twebsocketframe.h"
 #include "twebsocketworker.h"
@@ -29,12 +30,17 @@ TEpollWebSocket::TEpollWebSocket(int socketDescriptor, const QHostAddress &addre
 {
     tSystemDebug("TEpollWebSocket  [%p]", this);
     recvBuffer.reserve(BUFFER_RESERVE_SIZE);
+    worker = new TWebSocketWorker(this, reqHeader.path(), this);
 }
 
 
 TEpollWebSocket::~TEpollWebSocket()
 {
     tSystemDebug("~TEpollWebSocket  [%p]", this);
+    // Not to publish to this socket ID any more, e.g. disconnected by
+    // the send queue policy without a closing handshake; waits for the
+    // publishers writing to this socket
+    TPublisher::instance()->unsubscribeFromAll(this);
 }
 
 
@@ -69,24 +75,6 @@ bool TEpollWebSocket::isBinaryRequest() const
 }
 
 
-void TEpollWebSocket::sendTextForPublish(const QString &text, const QObject *except)
-{
-    tSystemDebug("sendText  text len:%d  (pid:%d)", text.length(), (int)QCoreApplication::applicationPid());
-    if (except != this) {
-        TAbstractWebSocket::sendText(text);
-    }
-}
-
-
-void TEpollWebSocket::sendBinaryForPublish(const QByteArray &binary, const QObject *except)
-{
-    tSystemDebug("sendBinary  binary len:%d  (pid:%d)", binary.length(), (int)QCoreApplication::applicationPid());
-    if (except != this) {
-        TAbstractWebSocket::sendBinary(binary);
-    }
-}
-
-
 void TEpollWebSocket::sendPong(const QByteArray &data)
 {
     tSystemDebug("sendPong  data len:%d  (pid:%d)", data.length(), (int)QCoreApplication::applicationPid());
@@ -151,25 +139,17 @@ void TEpollWebSocket::startWorker()
     tSystemDebug("TEpollWebSocket::startWorker");
     Q_ASSERT(canReadRequest());
 
+    // All the messages received at once are processed in one run
     auto payloads = readAllBinaryRequest();
     if (!payloads.isEmpty()) {
-        TWebSocketWorker *worker = new TWebSocketWorker(TWebSocketWorker::Receiving, this, reqHeader.path());
-        worker->setPayloads(payloads);
-        startWorker(worker);
+        if (worker->enqueue(TWebSocketWorker::Receiving, payloads)) {
+            worker->run();
+        }
         releaseWorker();
-        delete worker;
     }
 }
 
 
-void TEpollWebSocket::startWorker(TWebSocketWorker *worker)
-{
-    worker->moveToThread(thread());
-    worker->start();
-    worker->wait();
-}
-
-
 void TEpollWebSocket::releaseWorker()
 {
     tSystemDebug("TEpollWebSocket::releaseWorker");
@@ -182,23 +162,20 @@ void TEpollWebSocket::releaseWorker()
 
 void TEpollWebSocket::startWorkerForOpening(const TSession &session)
 {
-    TWebSocketWorker *worker = new TWebSocketWorker(TWebSocketWorker::Opening, this, reqHeader.path());
-    worker->setSession(session);
-    startWorker(worker);
-
+    if (worker->enqueue(TWebSocketWorker::Opening, QList<QPair<int, QByteArray>>(), session)) {
+        worker->run();
+    }
     releaseWorker();
-    delete worker;
 }
 
 
 void TEpollWebSocket::startWorkerForClosing()
 {
     if (!closing.load()) {
-        TWebSocketWorker *worker = new TWebSocketWorker(TWebSocketWorker::Closing, this, reqHeader.path());
-        startWorker(worker);
-
+        if (worker->enqueue(TWebSocketWorker::Closing)) {
+            worker->run();
+        }
         releaseWorker();
-        delete worker;
     }
 }
 
@@ -219,6 +196,19 @@ qint64 TEpollWebSocket::writeRawData(const QByteArray &data)
 }
 
 
+qint64 TEpollWebSocket::writeRawDataForPublish(const QByteArray &data, const QString &topic)
+{
+    sendData(data, topic);
+    return data.length();
+}
+
+
+void TEpollWebSocket::setSendQueueLimits(qint64 maxBytes, int maxMessages, Tf::SendQueuePolicy policy)
+{
+    TEpollSocket::setSendQueueLimits(maxBytes, maxMessages, policy);
+}
+
+
 void TEpollWebSocket::disconnect()
 {
     TEpollSocket::disconnect();
@@ -33,8 +33,6 @@ public:
 
 public slots:
     void releaseWorker();
-    void sendTextForPublish(const QString &text, const QObject *except);
-    void sendBinaryForPublish(const QByteArray &binary, const QObject *except);
     void sendPong(const QByteArray &data = QByteArray());
 
 protected:
@@ -42,15 +40,16 @@ protected:
     virtual bool seekRecvBuffer(int pos) override;
     virtual QObject *thisObject() override { return this; }
     virtual qint64 writeRawData(const QByteArray &data) override;
+    virtual qint64 writeRawDataForPublish(const QByteArray &data, const QString &topic) override;
+    virtual void setSendQueueLimits(qint64 maxBytes, int maxMessages, Tf::SendQueuePolicy policy) override;
     virtual QList<TWebSocketFrame> &websocketFrames() override { return frames; }
     void timerEvent(QTimerEvent *event) override;
     void clear();
 
 private:
-    void startWorker(TWebSocketWorker *worker);
-
     QByteArray recvBuffer;
     QList<TWebSocketFrame> frames;
+    TWebSocketWorker *worker {nullptr};
 
     TEpollWebSocket(int socketDescriptor, const QHostAddress &address, const THttpRequestHeader &header);
 
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = actionview
+SOURCES = main.cpp
@@ -0,0 +1,74 @@
+#include <TfTest/TfTest>
+#include <TActionView>
+#include <QUrl>
+
+
+class UrlView : public TActionView {
+protected:
+    void render() override
+    {
+        echo("<a href=\"");
+        eh(QVariant(QUrl("http://example.com/search?q=a&lang='en'")));
+        echo("\">");
+        responsebody += QStringLiteral("café");  // appended by template code
+        echo("</a>");
+    }
+};
+
+
+class StringView : public TActionView {
+public:
+    QString toString() override
+    {
+        echo("<p>");
+        eh("a < b");
+        echo("</p>");
+        return responsebody;
+    }
+};
+
+
+class EmptyView : public TActionView {
+};
+
+
+class TestActionView : public QObject {
+    Q_OBJECT
+private slots:
+    void renderTo();
+    void toStringView();
+    void noRendering();
+};
+
+
+void TestActionView::renderTo()
+{
+    UrlView view;
+    QByteArray buffer;
+    view.renderTo(buffer);
+    QCOMPARE(buffer, QByteArray("<a href=\"http://example.com/search?q=a&amp;lang=&#039;en&#039;\">caf\xc3\xa9</a>"));
+    QCOMPARE(view.toString(), QString::fromUtf8(buffer));
+}
+
+
+void TestActionView::toStringView()
+{
+    StringView view;
+    QByteArray buffer;
+    view.renderTo(buffer);
+    QCOMPARE(buffer, QByteArray("<p>a &lt; b</p>"));
+}
+
+
+void TestActionView::noRendering()
+{
+    EmptyView view;
+    QByteArray buffer;
+    view.renderTo(buffer);  // must not recurse
+    QVERIFY(buffer.isEmpty());
+    QVERIFY(view.toString().isEmpty());
+}
+
+
+TF_TEST_MAIN(TestActionView)
+#include "main.moc"
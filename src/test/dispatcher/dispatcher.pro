@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = dispatcher
+SOURCES = main.cpp
@@ -0,0 +1,113 @@
+#include <TfTest/TfTest>
+#include <TDispatcher>
+
+
+class SampleController : public QObject {
+    Q_OBJECT
+public:
+    QStringList called;
+
+public slots:
+    void index() { called = QStringList("index"); }
+    void show(const QString &id) { called = QStringList({"show", id}); }
+    void edit(const QString &id) { called = QStringList({"edit1", id}); }
+    void edit(const QString &id, const QString &mode) { called = QStringList({"edit2", id, mode}); }
+    void list(int) { called = QStringList("list"); }
+};
+
+T_DEFINE_TYPE(SampleController)
+
+
+class TestDispatcher : public QObject {
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void findClass();
+    void invoke_data();
+    void invoke();
+    void invokeWithoutTable_data() { invoke_data(); }
+    void invokeWithoutTable();
+    void benchDispatch();
+    void benchDispatchWithoutTable();
+};
+
+
+void TestDispatcher::initTestCase()
+{
+    TDispatchTable::build();
+}
+
+
+void TestDispatcher::findClass()
+{
+    QVERIFY(TDispatchTable::find("samplecontroller"));
+    QVERIFY(TDispatchTable::find("SampleController"));
+    QCOMPARE(TDispatchTable::find("SampleController"), TDispatchTable::find("samplecontroller"));
+    QVERIFY(!TDispatchTable::find("samplecontrollers"));
+}
+
+
+void TestDispatcher::invoke_data()
+{
+    QTest::addColumn<QByteArray>("action");
+    QTest::addColumn<QStringList>("args");
+    QTest::addColumn<bool>("dispatched");
+    QTest::addColumn<QStringList>("called");
+
+    QTest::newRow("1") << QByteArray("index") << QStringList() << true << QStringList("index");
+    QTest::newRow("2") << QByteArray("show") << QStringList("1") << true << QStringList({"show", "1"});
+    QTest::newRow("3") << QByteArray("show") << QStringList({"1", "2"}) << true << QStringList({"show", "1"});
+    QTest::newRow("4") << QByteArray("edit") << QStringList("1") << true << QStringList({"edit1", "1"});
+    QTest::newRow("5") << QByteArray("edit") << QStringList({"1", "a"}) << true << QStringList({"edit2", "1", "a"});
+    QTest::newRow("6") << QByteArray("show") << QStringList() << false << QStringList();
+    QTest::newRow("7") << QByteArray("list") << QStringList("1") << false << QStringList();
+    QTest::newRow("8") << QByteArray("destroy") << QStringList() << false << QStringList();
+}
+
+
+void TestDispatcher::invoke()
+{
+    QFETCH(QByteArray, action);
+    QFETCH(QStringList, args);
+    QFETCH(bool, dispatched);
+    QFETCH(QStringList, called);
+
+    TDispatcher<QObject> dispatcher("SampleController");
+    QVERIFY(dispatcher.object());
+    QCOMPARE(dispatcher.invoke(action, args), dispatched);
+    QCOMPARE(static_cast<SampleController *>(dispatcher.object())->called, called);
+}
+
+
+void TestDispatcher::invokeWithoutTable()
+{
+    TDispatchTable::clear();
+    invoke();
+    TDispatchTable::build();
+}
+
+
+void TestDispatcher::benchDispatch()
+{
+    const QStringList args = {"1", "a"};
+    QBENCHMARK {
+        TDispatcher<QObject> dispatcher("samplecontroller");
+        dispatcher.invoke("edit", args);
+    }
+}
+
+
+void TestDispatcher::benchDispatchWithoutTable()
+{
+    const QStringList args = {"1", "a"};
+    TDispatchTable::clear();
+    QBENCHMARK {
+        TDispatcher<QObject> dispatcher("samplecontroller");
+        dispatcher.invoke("edit", args);
+    }
+    TDispatchTable::build();
+}
+
+
+TF_TEST_MAIN(TestDispatcher)
+#include "main.moc"
@@ -13,9 +13,68 @@ private slots:
     void escapeQuotes();
     void escapeNoQuotes_data();
     void escapeNoQuotes();
+    void escapeUtf8_data();
+    void escapeUtf8();
+    void escapeUtf16ToUtf8_data();
+    void escapeUtf16ToUtf8();
+    void escapeJson_data();
+    void escapeJson();
+    void benchHtmlEscape_data();
+    void benchHtmlEscape();
+    void benchHtmlEscapeUtf8_data();
+    void benchHtmlEscapeUtf8();
 };
 
 
+// Character-by-character escaping, as a baseline of the benchmarks
+static QString naiveHtmlEscape(const QString &input)
+{
+    QString escaped;
+    escaped.reserve(int(input.length() * 1.1));
+    for (int i = 0; i < input.length(); ++i) {
+        const QChar c = input.at(i);
+        if (c == QLatin1Char('&')) {
+            escaped += QLatin1String("&amp;");
+        } else if (c == QLatin1Char('<')) {
+            escaped += QLatin1String("&lt;");
+        } else if (c == QLatin1Char('>')) {
+            escaped += QLatin1String("&gt;");
+        } else if (c == QLatin1Char('"')) {
+            escaped += QLatin1String("&quot;");
+        } else if (c == QLatin1Char('\'')) {
+            escaped += QLatin1String("&#039;");
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+
+// Table cells of a listing page
+static QStringList listingCells()
+{
+    QStringList cells;
+    for (int i = 0; i < 5000; ++i) {
+        switch (i % 4) {
+        case 0:
+            cells << QString::number(i * 7919);
+            break;
+        case 1:
+            cells << QStringLiteral("Product name #%1 with a fairly long description").arg(i);
+            break;
+        case 2:
+            cells << QStringLiteral("Tom & Jerry <tom@example.com> \"quoted\" %1").arg(i);
+            break;
+        default:
+            cells << QString::fromUtf8(u8"東京都千代田区 %1 番地").arg(i);
+            break;
+        }
+    }
+    return cells;
+}
+
+
 void HtmlParser::escapeCompat_data()
 {
      QTest::addColumn<QString>("string");
@@ -85,5 +144,127 @@ void HtmlParser::escapeNoQuotes()
     QCOMPARE(actualStr, correct);
 }
 
+void HtmlParser::escapeUtf8_data()
+{
+    QTest::addColumn<QByteArray>("string");
+    QTest::addColumn<QByteArray>("correct");
+
+    QTest::newRow("1") << QByteArray(u8"こんにちは")
+                       << QByteArray(u8"こんにちは");
+    QTest::newRow("2") << QByteArray("<a href=\"hoge\">a & b</a>")
+                       << QByteArray("&lt;a href=&quot;hoge&quot;&gt;a &amp; b&lt;/a&gt;");
+    QTest::newRow("3") << QByteArray(u8"A 'quote' is <b>bold</b>, 太字です。0123456789abcdefghijklmnopqrstuvwxyz&")
+                       << QByteArray(u8"A &#039;quote&#039; is &lt;b&gt;bold&lt;/b&gt;, 太字です。0123456789abcdefghijklmnopqrstuvwxyz&amp;");
+    QTest::newRow("4") << QByteArray()
+                       << QByteArray();
+}
+
+void HtmlParser::escapeUtf8()
+{
+    QFETCH(QByteArray, string);
+    QFETCH(QByteArray, correct);
+
+    QByteArray actual("<p>");
+    THttpUtility::appendHtmlEscaped(actual, string.constData(), string.length());
+    QCOMPARE(actual, QByteArray("<p>") + correct);
+    QCOMPARE(THttpUtility::htmlEscape(string), QString::fromUtf8(correct));
+}
+
+void HtmlParser::escapeUtf16ToUtf8_data()
+{
+    QTest::addColumn<QString>("string");
+
+    QTest::newRow("1") << QString::fromUtf8(u8"こんにちは");
+    QTest::newRow("2") << QString("<a href=\"hoge\">a & b</a>");
+    QTest::newRow("3") << QString::fromUtf8(u8"0123456789abcdefghijklmnopqrstuvwxyz <é> 😀 'x' 0123456789abcdef");
+    QTest::newRow("4") << (QString("a") + QChar(0xD800) + QString("b"));  // unpaired surrogate
+    QTest::newRow("5") << QString();
+}
+
+void HtmlParser::escapeUtf16ToUtf8()
+{
+    QFETCH(QString, string);
+
+    QByteArray actual;
+    THttpUtility::appendHtmlEscaped(actual, string.constData(), string.length(), Tf::Compatible);
+    QCOMPARE(actual, THttpUtility::htmlEscape(string, Tf::Compatible).toUtf8());
+}
+
+void HtmlParser::escapeJson_data()
+{
+    QTest::addColumn<QString>("string");
+    QTest::addColumn<QString>("correct");
+
+    QTest::newRow("1") << QString::fromUtf8(u8"こんにちは")
+                       << QString::fromUtf8(u8"こんにちは");
+    QTest::newRow("2") << QString("</script><script>alert('a & b')</script>")
+                       << QString("\\u003C/script\\u003E\\u003Cscript\\u003Ealert('a \\u0026 b')\\u003C/script\\u003E");
+    QTest::newRow("3") << QString("{\"key\": \"value\"}")
+                       << QString("{\"key\": \"value\"}");
+}
+
+void HtmlParser::escapeJson()
+{
+    QFETCH(QString, string);
+    QFETCH(QString, correct);
+
+    QCOMPARE(THttpUtility::jsonEscape(string), correct);
+    QCOMPARE(THttpUtility::jsonEscape(string.toUtf8()), correct);
+}
+
+void HtmlParser::benchHtmlEscape_data()
+{
+    QTest::addColumn<bool>("naive");
+
+    QTest::newRow("naive") << true;
+    QTest::newRow("htmlEscape") << false;
+}
+
+void HtmlParser::benchHtmlEscape()
+{
+    QFETCH(bool, naive);
+    const QStringList cells = listingCells();
+
+    QBENCHMARK {
+        int length = 0;
+        for (auto &cell : cells) {
+            length += (naive) ? naiveHtmlEscape(cell).length() : THttpUtility::htmlEscape(cell).length();
+        }
+        QVERIFY(length > 0);
+    }
+}
+
+void HtmlParser::benchHtmlEscapeUtf8_data()
+{
+    QTest::addColumn<bool>("utf16");
+
+    QTest::newRow("utf16 to utf8") << true;
+    QTest::newRow("utf8 to utf8") << false;
+}
+
+void HtmlParser::benchHtmlEscapeUtf8()
+{
+    QFETCH(bool, utf16);
+    const QStringList cells = listingCells();
+    QByteArrayList utf8Cells;
+    for (auto &cell : cells) {
+        utf8Cells << cell.toUtf8();
+    }
+
+    QBENCHMARK {
+        QByteArray page;
+        if (utf16) {
+            for (auto &cell : cells) {
+                THttpUtility::appendHtmlEscaped(page, cell.constData(), cell.length());
+            }
+        } else {
+            for (auto &cell : utf8Cells) {
+                THttpUtility::appendHtmlEscaped(page, cell.constData(), cell.length());
+            }
+        }
+        QVERIFY(!page.isEmpty());
+    }
+}
+
 QTEST_MAIN(HtmlParser)
 #include "main.moc"
@@ -0,0 +1,5 @@
+include(../test.pri)
+TARGET = httpcompressor
+SOURCES = main.cpp
+unix:LIBS += -lz
+windows:QT += zlib-private
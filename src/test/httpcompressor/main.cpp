@@ -0,0 +1,208 @@
+#include <TfTest/TfTest>
+#include <THttpCompressor>
+#include <cstring>
+#if defined(Q_OS_WIN)
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+Q_DECLARE_METATYPE(THttpCompressor::Encoding)
+Q_DECLARE_METATYPE(QList<THttpCompressor::Encoding>)
+
+
+static QByteArray inflateData(const QByteArray &data)
+{
+    QByteArray output;
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 32) != Z_OK) {  // detects gzip or zlib header
+        return output;
+    }
+
+    char buf[4096];
+    zs.next_in = (Bytef *)data.constData();
+    zs.avail_in = data.length();
+    int ret;
+    do {
+        zs.next_out = (Bytef *)buf;
+        zs.avail_out = sizeof(buf);
+        ret = inflate(&zs, Z_NO_FLUSH);
+        output.append(buf, sizeof(buf) - zs.avail_out);
+    } while (ret == Z_OK);
+    inflateEnd(&zs);
+    return (ret == Z_STREAM_END) ? output : QByteArray();
+}
+
+
+static QByteArray sampleText(int length)
+{
+    QByteArray text;
+    text.reserve(length + 64);
+    for (int i = 0; text.length() < length; ++i) {
+        text += "<li class=\"item\"><a href=\"/blog/show/";
+        text += QByteArray::number(i * 7919 % 100003);
+        text += "\">Entry</a></li>\n";
+    }
+    text.resize(length);
+    return text;
+}
+
+
+class TestHttpCompressor : public QObject {
+    Q_OBJECT
+private slots:
+    void negotiate_data();
+    void negotiate();
+    void names();
+    void compress_data();
+    void compress();
+    void compressInPieces_data() { compress_data(); }
+    void compressInPieces();
+    void reuse();
+    void benchGzip_data();
+    void benchGzip();
+};
+
+
+void TestHttpCompressor::negotiate_data()
+{
+    const QList<THttpCompressor::Encoding> gzipDeflate = {THttpCompressor::Gzip, THttpCompressor::Deflate};
+    const QList<THttpCompressor::Encoding> deflateGzip = {THttpCompressor::Deflate, THttpCompressor::Gzip};
+
+    QTest::addColumn<QByteArray>("acceptEncoding");
+    QTest::addColumn<QList<THttpCompressor::Encoding>>("available");
+    QTest::addColumn<THttpCompressor::Encoding>("expected");
+
+    QTest::newRow("1") << QByteArray("") << gzipDeflate << THttpCompressor::Identity;
+    QTest::newRow("2") << QByteArray("gzip") << gzipDeflate << THttpCompressor::Gzip;
+    QTest::newRow("3") << QByteArray("deflate, gzip") << gzipDeflate << THttpCompressor::Gzip;
+    QTest::newRow("4") << QByteArray("deflate, gzip") << deflateGzip << THttpCompressor::Deflate;
+    QTest::newRow("5") << QByteArray("gzip;q=0.5, deflate") << gzipDeflate << THttpCompressor::Deflate;
+    QTest::newRow("6") << QByteArray("gzip; q=0, deflate;q=0.1") << gzipDeflate << THttpCompressor::Deflate;
+    QTest::newRow("7") << QByteArray("gzip;q=0") << gzipDeflate << THttpCompressor::Identity;
+    QTest::newRow("8") << QByteArray("*") << deflateGzip << THttpCompressor::Deflate;
+    QTest::newRow("9") << QByteArray("*;q=0.3, deflate;q=0.2") << deflateGzip << THttpCompressor::Gzip;
+    QTest::newRow("10") << QByteArray("*;q=0, gzip") << deflateGzip << THttpCompressor::Gzip;
+    QTest::newRow("11") << QByteArray("identity, compress") << gzipDeflate << THttpCompressor::Identity;
+    QTest::newRow("12") << QByteArray("GZIP;Q=1.0") << gzipDeflate << THttpCompressor::Gzip;
+    QTest::newRow("13") << QByteArray("gzip") << QList<THttpCompressor::Encoding>() << THttpCompressor::Identity;
+    QTest::newRow("14") << QByteArray(" ,gzip ;q=0.8 ,") << gzipDeflate << THttpCompressor::Gzip;
+}
+
+
+void TestHttpCompressor::negotiate()
+{
+    QFETCH(QByteArray, acceptEncoding);
+    QFETCH(QList<THttpCompressor::Encoding>, available);
+    QFETCH(THttpCompressor::Encoding, expected);
+
+    QCOMPARE(THttpCompressor::negotiate(acceptEncoding, available), expected);
+}
+
+
+void TestHttpCompressor::names()
+{
+    QCOMPARE(THttpCompressor::fromName("gzip"), THttpCompressor::Gzip);
+    QCOMPARE(THttpCompressor::fromName("deflate"), THttpCompressor::Deflate);
+    QCOMPARE(THttpCompressor::fromName("br"), THttpCompressor::Brotli);
+    QCOMPARE(THttpCompressor::fromName("zstd"), THttpCompressor::Zstd);
+    QCOMPARE(THttpCompressor::fromName("lzma"), THttpCompressor::Identity);
+    QCOMPARE(THttpCompressor::name(THttpCompressor::Brotli), QByteArray("br"));
+    QCOMPARE(THttpCompressor::fileSuffix(THttpCompressor::Gzip), QByteArray(".gz"));
+    QCOMPARE(THttpCompressor::fileSuffix(THttpCompressor::Deflate), QByteArray());
+    QVERIFY(THttpCompressor::isSupported(THttpCompressor::Gzip));
+    QVERIFY(THttpCompressor::isSupported(THttpCompressor::Deflate));
+}
+
+
+void TestHttpCompressor::compress_data()
+{
+    QTest::addColumn<THttpCompressor::Encoding>("encoding");
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("gzip-empty") << THttpCompressor::Gzip << QByteArray("");
+    QTest::newRow("gzip-short") << THttpCompressor::Gzip << QByteArray("hello");
+    QTest::newRow("gzip-64k") << THttpCompressor::Gzip << sampleText(64 * 1024);
+    QTest::newRow("gzip-1m") << THttpCompressor::Gzip << sampleText(1024 * 1024 + 3);
+    QTest::newRow("deflate-short") << THttpCompressor::Deflate << QByteArray("hello");
+    QTest::newRow("deflate-64k") << THttpCompressor::Deflate << sampleText(64 * 1024);
+}
+
+
+void TestHttpCompressor::compress()
+{
+    QFETCH(THttpCompressor::Encoding, encoding);
+    QFETCH(QByteArray, data);
+
+    QByteArray compressed = THttpCompressor::compress(encoding, data.constData(), data.length());
+    QVERIFY(!compressed.isEmpty());
+    if (encoding == THttpCompressor::Gzip) {
+        QCOMPARE((uchar)compressed[0], (uchar)0x1f);  // gzip magic
+        QCOMPARE((uchar)compressed[1], (uchar)0x8b);
+    }
+    QCOMPARE(inflateData(compressed), data);
+}
+
+
+void TestHttpCompressor::compressInPieces()
+{
+    QFETCH(THttpCompressor::Encoding, encoding);
+    QFETCH(QByteArray, data);
+
+    THttpCompressor compressor(encoding);
+    QVERIFY(compressor.isValid());
+
+    QByteArray compressed;
+    for (int pos = 0; pos < data.length(); pos += 1000) {
+        QVERIFY(compressor.compress(data.constData() + pos, qMin(1000, data.length() - pos), compressed));
+    }
+    QVERIFY(compressor.finish(compressed));
+    QCOMPARE(inflateData(compressed), data);
+}
+
+
+void TestHttpCompressor::reuse()
+{
+    const QByteArray data1 = sampleText(5000);
+    const QByteArray data2 = sampleText(300);
+
+    THttpCompressor *compressor = THttpCompressor::acquire(THttpCompressor::Gzip);
+    QVERIFY(compressor);
+    QByteArray compressed;
+    compressor->compress(data1.constData(), data1.length(), compressed);
+    THttpCompressor::release(compressor);  // released without finishing
+
+    compressor = THttpCompressor::acquire(THttpCompressor::Gzip);
+    QVERIFY(compressor);
+    compressed.clear();
+    compressor->compress(data2.constData(), data2.length(), compressed);
+    compressor->finish(compressed);
+    THttpCompressor::release(compressor);
+    QCOMPARE(inflateData(compressed), data2);
+}
+
+
+void TestHttpCompressor::benchGzip_data()
+{
+    QTest::addColumn<int>("length");
+
+    QTest::newRow("4k") << 4 * 1024;
+    QTest::newRow("128k") << 128 * 1024;
+}
+
+
+void TestHttpCompressor::benchGzip()
+{
+    QFETCH(int, length);
+    const QByteArray data = sampleText(length);
+
+    QBENCHMARK {
+        QByteArray compressed = THttpCompressor::compress(THttpCompressor::Gzip, data.constData(), data.length());
+        Q_UNUSED(compressed);
+    }
+}
+
+
+TF_TEST_MAIN(TestHttpCompressor)
+#include "main.moc"
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = introspector
+SOURCES = main.cpp
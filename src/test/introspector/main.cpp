@@ -0,0 +1,68 @@
+#include <QtTest/QtTest>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <TIntrospector>
+#include <atomic>
+#include <thread>
+
+
+class TestIntrospector : public QObject
+{
+    Q_OBJECT
+private slots:
+    void requestsInFlight();
+    void registerSection();
+};
+
+
+void TestIntrospector::requestsInFlight()
+{
+    std::atomic<int> step {0};
+    std::thread thread([&]() {
+        TIntrospector::beginRequest("GET", "/blog/show/1?x=2");
+        TIntrospector::setAction("blogcontroller", "show");
+        step = 1;
+        while (step.load() == 1) {
+            QThread::msleep(1);
+        }
+        TIntrospector::endRequest();
+        step = 3;
+        while (step.load() == 3) {
+            QThread::msleep(1);
+        }
+    });
+
+    while (step.load() != 1) {
+        QThread::msleep(1);
+    }
+    QJsonArray requests = TIntrospector::snapshot()["requests"].toArray();
+    QCOMPARE(requests.count(), 1);
+    QJsonObject req = requests[0].toObject();
+    QCOMPARE(req["method"].toString(), QString("GET"));
+    QCOMPARE(req["path"].toString(), QString("/blog/show/1"));
+    QCOMPARE(req["action"].toString(), QString("blogcontroller#show"));
+    QVERIFY(req["elapsed_ms"].toDouble() >= 0);
+
+    step = 2;
+    while (step.load() != 3) {
+        QThread::msleep(1);
+    }
+    QCOMPARE(TIntrospector::snapshot()["requests"].toArray().count(), 0);
+
+    step = 4;
+    thread.join();
+}
+
+
+void TestIntrospector::registerSection()
+{
+    TIntrospector::registerSection("test", []() { return QJsonValue(1); });
+    TIntrospector::registerSection("test", []() { return QJsonValue(2); });  // replaces
+    QJsonObject snapshot = TIntrospector::snapshot();
+    QCOMPARE(snapshot["test"].toInt(), 2);
+    QVERIFY(snapshot.contains("pid"));
+}
+
+
+QTEST_APPLESS_MAIN(TestIntrospector)
+#include "main.moc"
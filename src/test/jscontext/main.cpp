@@ -5,6 +5,7 @@
 #include "../../tjsinstance.h"
 #include "../../tjsloader.h"
 #include "../../treactcomponent.h"
+#include <thread>
 
 
 class JSContext : public QObject
@@ -40,7 +41,10 @@ private slots:
 # if QT_VERSION > 0x050600
     void reactComponent_data();
     void reactComponent();
+    void reactComponentConcurrent();
+    void benchReactComponent();
 # endif
+    void acquire();
     void benchmark();
 #endif
 };
@@ -438,7 +442,64 @@ void JSContext::reactComponent()
     QCOMPARE(output, result);
 }
 
+
+void JSContext::reactComponentConcurrent()
+{
+    const QString expected = TReactComponent("js/react_samlple.jsx").renderToString("<MyComponent/>");
+    QVERIFY(!expected.isEmpty());
+
+    QAtomicInt failures = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&]() {
+            for (int j = 0; j < 20; ++j) {
+                if (TReactComponent("js/react_samlple.jsx").renderToString("<MyComponent/>") != expected) {
+                    failures.fetchAndAddRelaxed(1);
+                }
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    QCOMPARE(failures.load(), 0);
+}
+
+
+void JSContext::benchReactComponent()
+{
+    TReactComponent comp("js/react_samlple.jsx");
+    comp.renderToString("<MyComponent/>");
+
+    QBENCHMARK {
+        comp.renderToString("<MyComponent/>");
+    }
+}
+
 #endif
+
+
+void JSContext::acquire()
+{
+    TJSLoader loader("JSXTransformer", "JSXTransformer");
+    TJSModule *js1 = loader.acquire();
+    TJSModule *js2 = loader.acquire();
+    QVERIFY(js1 && js2);
+    QVERIFY(js1 != js2);  // for exclusive use
+    QCOMPARE(js1->call("JSXTransformer.transform", QString("<hello/>")).property("code").toString(),
+        QString("React.createElement(\"hello\", null)"));
+
+    TJSLoader::release(js1);
+    TJSModule *js3 = loader.acquire();
+    QCOMPARE(js3, js1);  // reused
+    TJSLoader::release(js2);
+    TJSLoader::release(js3);
+
+    // Compiled once
+    QCOMPARE(TJSLoader::compileJsx("<HelloWorld />"), QString("React.createElement(HelloWorld, null)"));
+    QCOMPARE(TJSLoader::compileJsx("<HelloWorld />"), QString("React.createElement(HelloWorld, null)"));
+}
+
 #endif
 
 QString JSContext::jsxTransform(const QString &jsx)
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = jsonwriter
+SOURCES = main.cpp
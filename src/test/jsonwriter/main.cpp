@@ -0,0 +1,342 @@
+#include <TfTest/TfTest>
+#include <TAbstractModel>
+#include <TJsonWriter>
+#include <TModelObject>
+#include <TModelUtil>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+
+class BlogObject : public TModelObject {
+public:
+    int id {0};
+    QString title;
+    QString body;
+    double score {0};
+    QDateTime created_at;
+
+    bool isNull() const override { return id <= 0; }
+    bool create() override { return true; }
+    bool update() override { return true; }
+    bool save() override { return true; }
+    bool remove() override { return true; }
+
+private:
+    Q_OBJECT
+    Q_PROPERTY(int id READ getid WRITE setid)
+    T_DEFINE_PROPERTY(int, id)
+    Q_PROPERTY(QString title READ gettitle WRITE settitle)
+    T_DEFINE_PROPERTY(QString, title)
+    Q_PROPERTY(QString body READ getbody WRITE setbody)
+    T_DEFINE_PROPERTY(QString, body)
+    Q_PROPERTY(double score READ getscore WRITE setscore)
+    T_DEFINE_PROPERTY(double, score)
+    Q_PROPERTY(QDateTime created_at READ getcreated_at WRITE setcreated_at)
+    T_DEFINE_PROPERTY(QDateTime, created_at)
+};
+
+
+class Blog : public TAbstractModel {
+public:
+    Blog() :
+        d(new BlogObject) { }
+
+    int id() const { return d->id; }
+    void setId(int id) { d->id = id; }
+    void setTitle(const QString &title) { d->title = title; }
+    void setBody(const QString &body) { d->body = body; }
+    void setScore(double score) { d->score = score; }
+    void setCreatedAt(const QDateTime &createdAt) { d->created_at = createdAt; }
+
+private:
+    QSharedPointer<BlogObject> d;
+
+    TModelObject *modelData() override { return d.data(); }
+    const TModelObject *modelData() const override { return d.data(); }
+};
+
+
+// Hides the body of the blog
+class BlogSummary : public Blog {
+public:
+    QVariantMap toVariantMap() const override
+    {
+        QVariantMap map = Blog::toVariantMap();
+        map.remove("body");
+        return map;
+    }
+};
+
+
+static QList<Blog> blogList(int count)
+{
+    QList<Blog> blogs;
+    QDateTime createdAt(QDate(2019, 4, 1), QTime(10, 30, 15));
+    for (int i = 1; i <= count; ++i) {
+        Blog blog;
+        blog.setId(i);
+        blog.setTitle(QStringLiteral("Entry #%1 \"quoted\"").arg(i));
+        blog.setBody(QStringLiteral("Line 1\nLine 2\tTabbed \\ backslash, caf\u00e9 \u65e5\u672c\u8a9e"));
+        blog.setScore(i + 0.25);
+        blog.setCreatedAt(createdAt.addSecs(i));
+        blogs << blog;
+    }
+    return blogs;
+}
+
+
+static QVariantMap variantTree(int count)
+{
+    QVariantList items;
+    for (int i = 0; i < count; ++i) {
+        QVariantMap item;
+        item.insert("id", i);
+        item.insert("name", QStringLiteral("item-%1 <b>&</b>").arg(i));
+        item.insert("price", i * 1.5);
+        item.insert("active", (i % 2) == 0);
+        item.insert("tags", QStringList {"a", "b\"c", "d\\e"});
+        item.insert("parent", QVariant());
+        items << item;
+    }
+
+    QVariantMap tree;
+    tree.insert("count", count);
+    tree.insert("items", items);
+    return tree;
+}
+
+
+class TestJsonWriter : public QObject {
+    Q_OBJECT
+private slots:
+    void variant_data();
+    void variant();
+    void escape_data();
+    void escape();
+    void hash();
+    void writer();
+    void model();
+    void modelList();
+    void modelOverride();
+    void benchVariantTree_data();
+    void benchVariantTree();
+    void benchModelList_data();
+    void benchModelList();
+};
+
+
+void TestJsonWriter::variant_data()
+{
+    QTest::addColumn<QVariant>("value");
+
+    QTest::newRow("null") << QVariant();
+    QTest::newRow("bool") << QVariant(true);
+    QTest::newRow("int") << QVariant(-123);
+    QTest::newRow("uint") << QVariant(4000000000u);
+    QTest::newRow("longlong") << QVariant(Q_INT64_C(9007199254740992));
+    QTest::newRow("double") << QVariant(3.14159);
+    QTest::newRow("integral double") << QVariant(1e15);
+    QTest::newRow("small double") << QVariant(1.5e-7);
+    QTest::newRow("string") << QVariant(QStringLiteral("hello"));
+    QTest::newRow("empty string") << QVariant(QString(""));
+    QTest::newRow("datetime") << QVariant(QDateTime(QDate(2019, 4, 1), QTime(10, 30)));
+    QTest::newRow("stringlist") << QVariant(QStringList {"a", "b", ""});
+    QTest::newRow("tree") << QVariant(variantTree(3));
+    QTest::newRow("empty map") << QVariant(QVariantMap());
+    QTest::newRow("empty list") << QVariant(QVariantList());
+}
+
+
+void TestJsonWriter::variant()
+{
+    QFETCH(QVariant, value);
+
+    QVariantList list {value};
+    QByteArray expected = QJsonDocument(QJsonArray::fromVariantList(list)).toJson(QJsonDocument::Compact);
+    QCOMPARE(TJsonWriter::toJson(list), expected);
+}
+
+
+void TestJsonWriter::escape_data()
+{
+    QTest::addColumn<QString>("string");
+
+    QTest::newRow("plain") << QStringLiteral("The quick brown fox jumps over the lazy dog");
+    QTest::newRow("quotes") << QStringLiteral("say \"hello\" and 'bye'");
+    QTest::newRow("backslash") << QStringLiteral("C:\\Program Files\\TreeFrog\\");
+    QTest::newRow("controls") << QString::fromLatin1("a\bb\fc\nd\re\tf\x01g\x1fh");
+    QTest::newRow("html") << QStringLiteral("<script>alert('&');</script>");
+    QTest::newRow("unicode") << QStringLiteral("caf\u00e9 \u65e5\u672c\u8a9e \U0001F600");
+    QTest::newRow("long") << QString(QStringLiteral("0123456789abcdef\"\n")).repeated(20);
+}
+
+
+void TestJsonWriter::escape()
+{
+    QFETCH(QString, string);
+
+    QVariantMap map {{string, string}};
+    QByteArray expected = QJsonDocument(QJsonObject::fromVariantMap(map)).toJson(QJsonDocument::Compact);
+    QCOMPARE(TJsonWriter::toJson(map), expected);
+
+    QByteArray utf8 = string.toUtf8();
+    TJsonWriter writer;
+    writer.writeUtf8String(utf8.constData(), utf8.length());
+    QCOMPARE(writer.data(), TJsonWriter::toJson(QVariant(string)));
+}
+
+
+void TestJsonWriter::hash()
+{
+    QVariantHash hash;
+    for (int i = 0; i < 50; ++i) {
+        hash.insert(QString::number(i * 7919), i);
+    }
+    QByteArray expected = QJsonDocument(QJsonObject::fromVariantHash(hash)).toJson(QJsonDocument::Compact);
+    QCOMPARE(TJsonWriter::toJson(QVariant(hash)), expected);
+}
+
+
+void TestJsonWriter::writer()
+{
+    TJsonWriter writer;
+    writer.beginObject();
+    writer.writeName("count");
+    writer.writeNumber(2);
+    writer.writeName("names");
+    writer.beginArray();
+    writer.writeString("foo");
+    writer.writeNull();
+    writer.writeBool(false);
+    writer.endArray();
+    writer.writeName("empty");
+    writer.beginObject();
+    writer.endObject();
+    writer.writeName("ratio");
+    writer.writeNumber(0.5);
+    writer.endObject();
+    QCOMPARE(writer.data(), QByteArray("{\"count\":2,\"names\":[\"foo\",null,false],\"empty\":{},\"ratio\":0.5}"));
+
+    QByteArray data = writer.takeData();
+    QVERIFY(!data.isEmpty());
+    QVERIFY(writer.data().isEmpty());
+    writer.writeNumber(Q_INT64_C(-9223372036854775807) - 1);
+    writer.writeNumber(Q_UINT64_C(18446744073709551615));
+    QCOMPARE(writer.data(), QByteArray("-9223372036854775808,18446744073709551615"));
+}
+
+
+void TestJsonWriter::model()
+{
+    Blog blog = blogList(1).first();
+    QByteArray expected = QJsonDocument(blog.toJsonObject()).toJson(QJsonDocument::Compact);
+    QCOMPARE(TJsonWriter::toJson(blog), expected);
+    QVERIFY(expected.contains("\"createdAt\":"));
+
+    TJsonWriter writer;
+    writer.writeModelProperties(blog);
+    QCOMPARE(writer.data(), expected);
+}
+
+
+void TestJsonWriter::modelList()
+{
+    QList<Blog> blogs = blogList(20);
+    QByteArray expected = QJsonDocument(tfConvertToJsonArray(blogs)).toJson(QJsonDocument::Compact);
+    QCOMPARE(TJsonWriter::toJson(blogs), expected);
+    QCOMPARE(TJsonWriter::toJson(QList<Blog>()), QByteArray("[]"));
+}
+
+
+void TestJsonWriter::modelOverride()
+{
+    BlogSummary summary;
+    summary.setId(1);
+    summary.setTitle("title");
+    summary.setBody("secret");
+
+    QByteArray json = TJsonWriter::toJson(summary);
+    QCOMPARE(json, QJsonDocument(summary.toJsonObject()).toJson(QJsonDocument::Compact));
+    QVERIFY(!json.contains("secret"));
+
+    QList<BlogSummary> summaries {summary, summary};
+    json = TJsonWriter::toJson(summaries);
+    QCOMPARE(json, QJsonDocument(tfConvertToJsonArray(summaries)).toJson(QJsonDocument::Compact));
+    QVERIFY(!json.contains("secret"));
+}
+
+
+void TestJsonWriter::benchVariantTree_data()
+{
+    QTest::addColumn<bool>("document");
+    QTest::newRow("QJsonDocument") << true;
+    QTest::newRow("TJsonWriter") << false;
+}
+
+
+void TestJsonWriter::benchVariantTree()
+{
+    QFETCH(bool, document);
+    const QVariantMap tree = variantTree(200);
+    QByteArray json;
+
+    if (document) {
+        QBENCHMARK {
+            json = QJsonDocument(QJsonObject::fromVariantMap(tree)).toJson(QJsonDocument::Compact);
+        }
+    } else {
+        QBENCHMARK {
+            json = TJsonWriter::toJson(tree);
+        }
+    }
+    QVERIFY(!json.isEmpty());
+}
+
+
+void TestJsonWriter::benchModelList_data()
+{
+    QTest::addColumn<int>("method");
+    QTest::newRow("QJsonDocument") << 0;
+    QTest::newRow("TJsonWriter") << 1;
+    QTest::newRow("TJsonWriter properties") << 2;
+}
+
+
+void TestJsonWriter::benchModelList()
+{
+    QFETCH(int, method);
+    const QList<Blog> blogs = blogList(200);
+    QByteArray json;
+
+    switch (method) {
+    case 0:
+        QBENCHMARK {
+            json = QJsonDocument(tfConvertToJsonArray(blogs)).toJson(QJsonDocument::Compact);
+        }
+        break;
+
+    case 1:
+        QBENCHMARK {
+            json = TJsonWriter::toJson(blogs);
+        }
+        break;
+
+    default:
+        QBENCHMARK {
+            TJsonWriter writer(blogs.count() * 128);
+            writer.beginArray();
+            for (auto &blog : blogs) {
+                writer.writeModelProperties(blog);
+            }
+            writer.endArray();
+            json = writer.takeData();
+        }
+        break;
+    }
+    QVERIFY(!json.isEmpty());
+}
+
+
+TF_TEST_MAIN(TestJsonWriter)
+#include "main.moc"
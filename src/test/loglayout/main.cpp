@@ -0,0 +1,271 @@
+#include <QtTest/QtTest>
+#include <TAccessLog>
+#include <TLog>
+#include "../../taccesslogsampler.h"
+#include "../../thistogram.h"
+#include "../../tloglayout.h"
+
+
+class TestLogLayout : public QObject
+{
+    Q_OBJECT
+private slots:
+    void formatLog_data();
+    void formatLog();
+    void formatAccessLog_data();
+    void formatAccessLog();
+    void appendNumber_data();
+    void appendNumber();
+    void timestampCache();
+    void jsonAccessLog();
+    void binaryRoundTrip();
+    void samplingRules();
+    void histogram();
+};
+
+
+void TestLogLayout::formatLog_data()
+{
+    QTest::addColumn<QByteArray>("layout");
+    QTest::addColumn<QByteArray>("correct");
+
+    QTest::newRow("1") << QByteArray("%d %5P %m%n")
+                       << QByteArray("2019-03-04 05:06:07 WARN  hello\n");
+    QTest::newRow("2") << QByteArray("%p|%P|%t|%T|%i|%I")
+                       << QByteArray("warn|WARN|4660|1234|255|ff");
+    QTest::newRow("3") << QByteArray("[%08t] [%6i]")
+                       << QByteArray("[00004660] [   255]");
+    QTest::newRow("4") << QByteArray("100% %x %")
+                       << QByteArray("100% %x %");
+    QTest::newRow("5") << QByteArray("%%m")
+                       << QByteArray("%hello");
+}
+
+
+void TestLogLayout::formatLog()
+{
+    QFETCH(QByteArray, layout);
+    QFETCH(QByteArray, correct);
+
+    TLog log;
+    log.timestamp = QDateTime(QDate(2019, 3, 4), QTime(5, 6, 7));
+    log.priority = Tf::WarnLevel;
+    log.pid = 255;
+    log.threadId = 0x1234;
+    log.message = "hello";
+
+    TLogLayout compiled(layout, "yyyy-MM-dd hh:mm:ss");
+    QCOMPARE(compiled.format(log), correct);
+}
+
+
+void TestLogLayout::formatAccessLog_data()
+{
+    QTest::addColumn<QByteArray>("layout");
+    QTest::addColumn<QByteArray>("correct");
+
+    QTest::newRow("1") << QByteArray("%h %d \"%r\" %s %O%n")
+                       << QByteArray("127.0.0.1 2019-03-04T05:06:07 \"GET / HTTP/1.1\" 200 1024\n");
+    QTest::newRow("2") << QByteArray("%8O|%08O")
+                       << QByteArray("    1024|00001024");
+    QTest::newRow("3") << QByteArray("%D %{route}L %{db}L %6{send}L %{total}L")
+                       << QByteArray("2500 12 300    700 2500");
+    QTest::newRow("4") << QByteArray("%{foo}L %{route")
+                       << QByteArray("%{foo}L %{route");
+}
+
+
+void TestLogLayout::formatAccessLog()
+{
+    QFETCH(QByteArray, layout);
+    QFETCH(QByteArray, correct);
+
+    TAccessLog log("127.0.0.1", "GET / HTTP/1.1");
+    log.timestamp = QDateTime(QDate(2019, 3, 4), QTime(5, 6, 7));
+    log.statusCode = 200;
+    log.responseBytes = 1024;
+    log.latencyNsecs = 2500999;
+    log.phaseNsecs[TAccessLog::Route] = 12345;
+    log.phaseNsecs[TAccessLog::Database] = 300000;
+    log.phaseNsecs[TAccessLog::Send] = 700100;
+
+    TLogLayout compiled(layout, QByteArray());
+    QCOMPARE(compiled.format(log), correct);
+    QCOMPARE(log.toByteArray(layout, QByteArray()), correct);
+}
+
+
+void TestLogLayout::appendNumber_data()
+{
+    QTest::addColumn<qint64>("value");
+    QTest::addColumn<int>("base");
+    QTest::addColumn<int>("width");
+    QTest::addColumn<char>("fill");
+
+    QTest::newRow("1") << (qint64)0 << 10 << 0 << ' ';
+    QTest::newRow("2") << (qint64)1234567890123LL << 10 << 0 << ' ';
+    QTest::newRow("3") << (qint64)-42 << 10 << 6 << ' ';
+    QTest::newRow("4") << (qint64)-42 << 10 << 6 << '0';
+    QTest::newRow("5") << (qint64)0xbeef << 16 << 8 << '0';
+    QTest::newRow("6") << std::numeric_limits<qint64>::min() << 10 << 0 << ' ';
+}
+
+
+void TestLogLayout::appendNumber()
+{
+    QFETCH(qint64, value);
+    QFETCH(int, base);
+    QFETCH(int, width);
+    QFETCH(char, fill);
+
+    QByteArray buffer("x");
+    TLogLayout::appendNumber(buffer, value, base, width, fill);
+    QByteArray correct = QString("%1").arg(value, width, base, QLatin1Char(fill)).toLatin1();
+    QCOMPARE(buffer, QByteArray("x") + correct);
+}
+
+
+void TestLogLayout::timestampCache()
+{
+    TLog log;
+    log.priority = Tf::InfoLevel;
+    log.timestamp = QDateTime(QDate(2019, 3, 4), QTime(5, 6, 7, 100));
+
+    TLogLayout seconds("%d", "hh:mm:ss");
+    TLogLayout millis("%d", "hh:mm:ss.zzz");
+    QCOMPARE(seconds.format(log), QByteArray("05:06:07"));
+    QCOMPARE(millis.format(log), QByteArray("05:06:07.100"));
+
+    log.timestamp = log.timestamp.addMSecs(500);
+    QCOMPARE(seconds.format(log), QByteArray("05:06:07"));
+    QCOMPARE(millis.format(log), QByteArray("05:06:07.600"));
+
+    log.timestamp = log.timestamp.addMSecs(500);
+    QCOMPARE(seconds.format(log), QByteArray("05:06:08"));
+}
+
+
+void TestLogLayout::jsonAccessLog()
+{
+    TAccessLog log("127.0.0.1", "GET /a\"b HTTP/1.1");
+    log.method = "GET";
+    log.path = "/a\"b\\c\n";
+    log.timestampNsecs = 1551675967123456789LL;
+    log.latencyNsecs = 1500000;
+    log.statusCode = 200;
+    log.responseBytes = 1024;
+    log.socketId = 12;
+    log.threadId = 4660;
+    log.phaseNsecs[TAccessLog::Action] = 900000;
+
+    TLogLayout layout("%h %d", QByteArray());
+    layout.setOutputFormat(TLogLayout::Json);
+    QCOMPARE(layout.format(log), QByteArray("{\"ts\":1551675967123456789,\"remote_host\":\"127.0.0.1\",\"method\":\"GET\","
+                                            "\"path\":\"/a\\\"b\\\\c\\n\",\"status\":200,\"bytes\":1024,"
+                                            "\"latency_ns\":1500000,\"socket_id\":12,\"thread_id\":4660,"
+                                            "\"phases_ns\":{\"wait\":0,\"receive\":0,\"route\":0,\"filter\":0,\"action\":900000,"
+                                            "\"render\":0,\"db\":0,\"session\":0,\"send\":0}}\n"));
+}
+
+
+void TestLogLayout::binaryRoundTrip()
+{
+    TAccessLog alog("10.0.0.1", "POST /x HTTP/1.1");
+    alog.method = "POST";
+    alog.path = "/x";
+    alog.timestampNsecs = 1551675967000000001LL;
+    alog.latencyNsecs = 42;
+    alog.statusCode = 503;
+    alog.responseBytes = 7;
+    alog.socketId = 3;
+    alog.threadId = 99;
+    alog.phaseNsecs[TAccessLog::Receive] = 11;
+    alog.phaseNsecs[TAccessLog::Send] = 22;
+
+    TLog log;
+    log.timestamp = QDateTime::fromMSecsSinceEpoch(1551675967123);
+    log.priority = Tf::ErrorLevel;
+    log.pid = 255;
+    log.threadId = 0x1234;
+    log.message = "hello\tworld";
+
+    TLogLayout json;
+    json.setOutputFormat(TLogLayout::Json);
+    TLogLayout binary;
+    binary.setOutputFormat(TLogLayout::Binary);
+
+    QByteArray data = binary.format(alog) + binary.format(log);
+    QByteArray decoded;
+    int len = TLogLayout::decodeBinary(data.constData(), data.length(), decoded);
+    QVERIFY(len > 0);
+    QCOMPARE(decoded, json.format(alog));
+
+    // Incomplete and invalid records
+    QCOMPARE(TLogLayout::decodeBinary(data.constData() + len, data.length() - len - 1, decoded), 0);
+    QCOMPARE(TLogLayout::decodeBinary(data.constData() + 1, data.length() - 1, decoded), -1);
+
+    QCOMPARE(TLogLayout::decodeBinary(data.constData() + len, data.length() - len, decoded), data.length() - len);
+    QCOMPARE(decoded, json.format(log));
+}
+
+
+void TestLogLayout::samplingRules()
+{
+    TAccessLogSampler sampler;
+    QVERIFY(!sampler.isSampling());
+    QVERIFY(sampler.sample(200));
+
+    QVERIFY(sampler.setRules("5xx:1 2xx:0.01 204:0 *:0.5"));
+    QVERIFY(sampler.isSampling());
+    QVERIFY(qAbs(sampler.rate(200) - 0.01) < 1e-6);
+    QVERIFY(sampler.rate(204) == 0);
+    QCOMPARE(sampler.rate(302), 0.5);
+    QCOMPARE(sampler.rate(500), 1.0);
+
+    int count = 0;
+    for (int i = 0; i < 10000; ++i) {
+        QVERIFY(sampler.sample(503));
+        QVERIFY(!sampler.sample(204));
+        count += sampler.sample(200);
+    }
+    QVERIFY(count > 20 && count < 300);
+
+    QVERIFY(!sampler.setRules("2xx:2 abc:1 404:0"));
+    QCOMPARE(sampler.rate(200), 1.0);
+    QVERIFY(sampler.rate(404) == 0);
+}
+
+
+void TestLogLayout::histogram()
+{
+    THistogram hist;
+    QCOMPARE(hist.count(), (quint64)0);
+    QCOMPARE(hist.percentile(50), (qint64)0);
+
+    for (int i = 1; i <= 1000; ++i) {
+        hist.record(i * 1000);
+    }
+    QCOMPARE(hist.count(), (quint64)1000);
+    QCOMPARE(hist.max(), (qint64)1000000);
+    QCOMPARE(hist.sum(), (qint64)500500000);
+
+    // Relative error within the width of a sub-bucket
+    qint64 p50 = hist.percentile(50);
+    qint64 p99 = hist.percentile(99);
+    QVERIFY(qAbs(p50 - 500000) <= 500000 / 8);
+    QVERIFY(qAbs(p99 - 990000) <= 990000 / 8);
+    QVERIFY(hist.percentile(100) <= hist.max());
+
+    for (qint64 v : {0LL, 1LL, 7LL, 8LL, 9LL, 1000LL, 123456789LL}) {
+        int idx = THistogram::bucketIndex(v);
+        QVERIFY(THistogram::bucketLowerBound(idx) <= v);
+        QVERIFY(THistogram::bucketUpperBound(idx) >= v);
+    }
+
+    hist.reset();
+    QCOMPARE(hist.count(), (quint64)0);
+    QCOMPARE(hist.max(), (qint64)0);
+}
+
+QTEST_APPLESS_MAIN(TestLogLayout)
+#include "main.moc"
@@ -0,0 +1,4 @@
+include(../test.pri)
+TARGET = loglevel
+DEFINES += TF_LOG_LEVEL=2
+SOURCES = main.cpp
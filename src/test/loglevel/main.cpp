@@ -0,0 +1,100 @@
+#include <QtTest/QtTest>
+#include <TGlobal>
+#include <TSystemGlobal>
+
+
+class TestLogLevel : public QObject
+{
+    Q_OBJECT
+private slots:
+    void compiledOut();
+    void systemLogLevel();
+    void appLogLevel();
+    void formatLogMessage_data();
+    void formatLogMessage();
+};
+
+
+static QByteArray format(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    QByteArray message = Tf::formatLogMessage(fmt, ap);
+    va_end(ap);
+    return message;
+}
+
+
+void TestLogLevel::compiledOut()
+{
+    // TF_LOG_LEVEL=2 (warn) in loglevel.pro
+    Tf::setSystemLogLevel(Tf::TraceLevel);
+    int count = 0;
+    tSystemInfo("%d", ++count);
+    tSystemDebug("%d", ++count);
+    tSystemTrace("%d", ++count);
+    tInfo("%d", ++count);
+    tDebug() << ++count;
+    tTrace("%d", ++count);
+    QCOMPARE(count, 0);
+}
+
+
+void TestLogLevel::systemLogLevel()
+{
+    int count = 0;
+    Tf::setSystemLogLevel(Tf::FatalLevel);
+    QVERIFY(!Tf::isSystemLogEnabled(Tf::ErrorLevel));
+    tSystemError("%d", ++count);
+    tSystemWarn("%d", ++count);
+    QCOMPARE(count, 0);
+
+    Tf::setSystemLogLevel(Tf::WarnLevel);
+    QVERIFY(Tf::isSystemLogEnabled(Tf::ErrorLevel));
+    QVERIFY(Tf::isSystemLogEnabled(Tf::WarnLevel));
+    QVERIFY(!Tf::isSystemLogEnabled(Tf::InfoLevel));
+    Tf::setSystemLogLevel(Tf::TraceLevel);
+}
+
+
+void TestLogLevel::appLogLevel()
+{
+    // No loggers set up
+    int count = 0;
+    QVERIFY(!Tf::isLogEnabled(Tf::ErrorLevel));
+    tError("%d", ++count);
+    tWarn() << ++count;
+    QCOMPARE(count, 0);
+
+    // Binds to the inner statement as a plain function call
+    bool branch = false;
+    if (count > 0)
+        tError("%d", ++count);
+    else
+        branch = true;
+    QVERIFY(branch);
+}
+
+
+void TestLogLevel::formatLogMessage_data()
+{
+    QTest::addColumn<int>("length");
+    QTest::newRow("1") << 0;
+    QTest::newRow("2") << 10;
+    QTest::newRow("3") << 1023;
+    QTest::newRow("4") << 1024;
+    QTest::newRow("5") << 5000;
+}
+
+
+void TestLogLevel::formatLogMessage()
+{
+    QFETCH(int, length);
+    QByteArray str(length, 'a');
+    QByteArray expect = "[" + str + "] 12 x";
+    QCOMPARE(format("[%s] %d %c", str.data(), 12, 'x'), expect);
+}
+
+
+QTEST_APPLESS_MAIN(TestLogLevel)
+#include "main.moc"
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = logwriter
+SOURCES = main.cpp
@@ -0,0 +1,158 @@
+#include <QtTest/QtTest>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QThread>
+#include "../../tfileaiowriter.h"
+#include "../../tlogwriter.h"
+
+
+class WriterThread : public QThread
+{
+public:
+    WriterThread(TFileAioWriter *writer, int id, int count) :
+        writer(writer), id(id), count(count) { }
+    int written {0};
+
+protected:
+    void run() override
+    {
+        for (int i = 0; i < count; ++i) {
+            QByteArray line = QByteArray::number(id) + ":" + QByteArray::number(i) + ":" + QByteArray(80, 'x') + "\n";
+            if (writer->write(line.data(), line.length()) == 0) {
+                written++;
+            }
+        }
+    }
+
+private:
+    TFileAioWriter *writer;
+    int id;
+    int count;
+};
+
+
+class TestLogWriter : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void writeFromThreads();
+    void largeRecord();
+    void dropOnOverflow();
+    void countDropped();
+
+private:
+    QList<QByteArray> runThreads(int threads, int count, int *written);
+    QTemporaryDir dir;
+};
+
+
+void TestLogWriter::init()
+{
+    TLogWriter::instance()->setBufferSize(TLogWriter::DefaultBufferSize);
+    TLogWriter::instance()->setOverflowPolicy(TLogWriter::Block);
+}
+
+
+QList<QByteArray> TestLogWriter::runThreads(int threads, int count, int *written)
+{
+    static int fileNumber = 0;
+    QString path = dir.filePath(QString::number(++fileNumber) + ".log");
+    TFileAioWriter writer(path);
+    writer.open();
+
+    QList<WriterThread *> list;
+    for (int i = 0; i < threads; ++i) {
+        list << new WriterThread(&writer, i, count);
+        list.last()->start();
+    }
+
+    *written = 0;
+    for (auto *thread : list) {
+        thread->wait();
+        *written += thread->written;
+        delete thread;
+    }
+    writer.close();
+
+    QFile file(path);
+    file.open(QIODevice::ReadOnly);
+    return file.readAll().split('\n');
+}
+
+
+void TestLogWriter::writeFromThreads()
+{
+    int written;
+    QList<QByteArray> lines = runThreads(8, 20000, &written);
+    QCOMPARE(written, 8 * 20000);
+    QCOMPARE(lines.takeLast(), QByteArray());
+    QCOMPARE(lines.count(), 8 * 20000);
+
+    QVector<int> next(8, 0);
+    for (auto &line : lines) {
+        QList<QByteArray> fields = line.split(':');
+        QCOMPARE(fields.count(), 3);
+        QCOMPARE(fields[2], QByteArray(80, 'x'));
+        // Records of each thread keep their order
+        int id = fields[0].toInt();
+        QCOMPARE(fields[1].toInt(), next[id]++);
+    }
+}
+
+
+void TestLogWriter::largeRecord()
+{
+    QString path = dir.filePath("large.log");
+    TFileAioWriter writer(path);
+    writer.open();
+
+    QByteArray small("small\n");
+    QByteArray large(TLogWriter::DefaultBufferSize, 'L');
+    QCOMPARE(writer.write(small.data(), small.length()), 0);
+    writer.flush();
+    QCOMPARE(writer.write(large.data(), large.length()), 0);
+    writer.close();
+
+    QFile file(path);
+    file.open(QIODevice::ReadOnly);
+    QCOMPARE(file.readAll(), small + large);
+}
+
+
+void TestLogWriter::dropOnOverflow()
+{
+    TLogWriter::instance()->setBufferSize(4096);
+    TLogWriter::instance()->setOverflowPolicy(TLogWriter::Drop);
+    quint64 dropped = TLogWriter::instance()->droppedCount();
+
+    int written;
+    QList<QByteArray> lines = runThreads(4, 20000, &written);
+    lines.removeLast();
+    QCOMPARE(lines.count(), written);
+    QCOMPARE(written + (TLogWriter::instance()->droppedCount() - dropped), (quint64)4 * 20000);
+}
+
+
+void TestLogWriter::countDropped()
+{
+    TLogWriter::instance()->setBufferSize(4096);
+    TLogWriter::instance()->setOverflowPolicy(TLogWriter::CountDropped);
+    quint64 dropped = TLogWriter::instance()->droppedCount();
+
+    int written;
+    QList<QByteArray> lines = runThreads(4, 20000, &written);
+    dropped = TLogWriter::instance()->droppedCount() - dropped;
+    QCOMPARE(written + dropped, (quint64)4 * 20000);
+
+    quint64 reported = 0;
+    for (auto &line : lines) {
+        if (line.startsWith("TLogWriter: ")) {
+            reported += line.mid(12).split(' ').value(0).toULongLong();
+        }
+    }
+    QVERIFY(reported <= dropped);
+}
+
+QTEST_APPLESS_MAIN(TestLogWriter)
+#include "main.moc"
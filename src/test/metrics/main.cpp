@@ -0,0 +1,124 @@
+#include <QtTest/QtTest>
+#include <TMetrics>
+#include <THistogram>
+#include <thread>
+#include <vector>
+
+
+class TestMetrics : public QObject
+{
+    Q_OBJECT
+private slots:
+    void counter();
+    void gauge();
+    void label_data();
+    void label();
+    void exposition();
+    void histogramBuckets();
+    void merge();
+};
+
+
+void TestMetrics::counter()
+{
+    constexpr int THREADS = 8;
+    constexpr int COUNT = 100000;
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREADS; ++i) {
+        threads.emplace_back([]() {
+            auto &cnt = TMetrics::counter("test_counter_total", "kind=\"a\"");
+            for (int j = 0; j < COUNT; ++j) {
+                cnt.add();
+            }
+        });
+    }
+    for (auto &th : threads) {
+        th.join();
+    }
+
+    QCOMPARE(TMetrics::counter("test_counter_total", "kind=\"a\"").value(), (qint64)THREADS * COUNT);
+    QCOMPARE(TMetrics::counter("test_counter_total", "kind=\"b\"").value(), (qint64)0);
+    QVERIFY(&TMetrics::counter("test_counter_total", "kind=\"a\"") != &TMetrics::counter("test_counter_total", "kind=\"b\""));
+}
+
+
+void TestMetrics::gauge()
+{
+    auto &g = TMetrics::gauge("test_gauge");
+    g.set(10);
+    g.add(5);
+    g.sub(3);
+    QCOMPARE(g.value(), (qint64)12);
+    QCOMPARE(&TMetrics::gauge("test_gauge"), &g);
+}
+
+
+void TestMetrics::label_data()
+{
+    QTest::addColumn<QByteArray>("value");
+    QTest::addColumn<QByteArray>("correct");
+
+    QTest::newRow("1") << QByteArray("GET") << QByteArray("key=\"GET\"");
+    QTest::newRow("2") << QByteArray("a\"b") << QByteArray("key=\"a\\\"b\"");
+    QTest::newRow("3") << QByteArray("a\\b") << QByteArray("key=\"a\\\\b\"");
+    QTest::newRow("4") << QByteArray("a\nb") << QByteArray("key=\"a\\nb\"");
+    QTest::newRow("5") << QByteArray() << QByteArray("key=\"\"");
+}
+
+
+void TestMetrics::label()
+{
+    QFETCH(QByteArray, value);
+    QFETCH(QByteArray, correct);
+    QCOMPARE(TMetrics::label("key", value), correct);
+}
+
+
+void TestMetrics::exposition()
+{
+    TMetrics::counter("test_expo_total", QByteArray(), "Test counter").add(3);
+    TMetrics::registerGauge("test_expo_function", "x=\"1\"", []() { return (qint64)42; });
+
+    QByteArray expo = TMetrics::exposition();
+    QVERIFY(expo.contains("# HELP test_expo_total Test counter\n# TYPE test_expo_total counter\ntest_expo_total 3\n"));
+    QVERIFY(expo.contains("# TYPE test_expo_function gauge\ntest_expo_function{x=\"1\"} 42\n"));
+}
+
+
+void TestMetrics::histogramBuckets()
+{
+    auto &hist = TMetrics::histogram("test_duration_seconds", "phase=\"a\"");
+    hist.record(50000);  // 50us
+    hist.record(3000000);  // 3ms
+    hist.record(20000000000LL);  // 20s
+
+    QByteArray expo = TMetrics::exposition();
+    QVERIFY(expo.contains("# TYPE test_duration_seconds histogram\n"));
+    QVERIFY(expo.contains("test_duration_seconds_bucket{phase=\"a\",le=\"0.0001\"} 1\n"));
+    QVERIFY(expo.contains("test_duration_seconds_bucket{phase=\"a\",le=\"0.0025\"} 1\n"));
+    QVERIFY(expo.contains("test_duration_seconds_bucket{phase=\"a\",le=\"0.005\"} 2\n"));
+    QVERIFY(expo.contains("test_duration_seconds_bucket{phase=\"a\",le=\"10\"} 2\n"));
+    QVERIFY(expo.contains("test_duration_seconds_bucket{phase=\"a\",le=\"+Inf\"} 3\n"));
+    QVERIFY(expo.contains("test_duration_seconds_count{phase=\"a\"} 3\n"));
+}
+
+
+void TestMetrics::merge()
+{
+    QByteArray a = "# HELP req_total Requests\n# TYPE req_total counter\n"
+                   "req_total{status=\"200\"} 5\nreq_total{status=\"404\"} 1\n"
+                   "# TYPE lat_seconds histogram\nlat_seconds_bucket{le=\"+Inf\"} 2\nlat_seconds_sum 0.25\nlat_seconds_count 2\n";
+    QByteArray b = "# HELP req_total Requests\n# TYPE req_total counter\n"
+                   "req_total{status=\"200\"} 7\nreq_total{status=\"500\"} 2\n"
+                   "# TYPE lat_seconds histogram\nlat_seconds_bucket{le=\"+Inf\"} 1\nlat_seconds_sum 0.5\nlat_seconds_count 1\n";
+
+    QByteArray correct = "# TYPE lat_seconds histogram\nlat_seconds_bucket{le=\"+Inf\"} 3\nlat_seconds_sum 0.75\nlat_seconds_count 3\n"
+                         "# HELP req_total Requests\n# TYPE req_total counter\n"
+                         "req_total{status=\"200\"} 12\nreq_total{status=\"404\"} 1\nreq_total{status=\"500\"} 2\n";
+    QCOMPARE(TMetrics::merge({a, b}), correct);
+    QCOMPARE(TMetrics::merge({}), QByteArray());
+}
+
+QTEST_APPLESS_MAIN(TestMetrics)
+#include "main.moc"
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = metrics
+SOURCES = main.cpp
@@ -0,0 +1,53 @@
+#include <QtTest/QtTest>
+#include <TQueryTracer>
+
+
+class TestQueryTracer : public QObject
+{
+    Q_OBJECT
+private slots:
+    void normalize_data();
+    void normalize();
+    void formatValues();
+};
+
+
+void TestQueryTracer::normalize_data()
+{
+    QTest::addColumn<QString>("statement");
+    QTest::addColumn<QByteArray>("shape");
+
+    QTest::newRow("1") << "SELECT * FROM blog WHERE id = 12" << QByteArray("SELECT * FROM blog WHERE id = ?");
+    QTest::newRow("2") << "SELECT * FROM blog WHERE title = 'it''s' AND id=3" << QByteArray("SELECT * FROM blog WHERE title = ? AND id=?");
+    QTest::newRow("3") << "SELECT * FROM t0 WHERE t0.id IN (1, 2, 3)" << QByteArray("SELECT * FROM t0 WHERE t0.id IN (?)");
+    QTest::newRow("4") << "UPDATE blog SET title=?, body=? WHERE id=?" << QByteArray("UPDATE blog SET title=?, body=? WHERE id=?");
+    QTest::newRow("5") << "  SELECT\n  1  " << QByteArray("SELECT ?");
+    QTest::newRow("6") << "WHERE x = -1.5" << QByteArray("WHERE x = ?");
+    QTest::newRow("7") << "SELECT a-1 FROM b" << QByteArray("SELECT a-? FROM b");
+    QTest::newRow("8") << "SELECT 'a\\'b'" << QByteArray("SELECT ?");
+    QTest::newRow("9") << "INSERT INTO t (a, b) VALUES ('x', 2)" << QByteArray("INSERT INTO t (a, b) VALUES (?)");
+    QTest::newRow("10") << "GET session:1234" << QByteArray("GET session:?");
+    QTest::newRow("11") << "SELECT id FROM user1 WHERE name = :name" << QByteArray("SELECT id FROM user1 WHERE name = :name");
+}
+
+
+void TestQueryTracer::normalize()
+{
+    QFETCH(QString, statement);
+    QFETCH(QByteArray, shape);
+    QCOMPARE(TQueryTracer::normalize(statement), shape);
+}
+
+
+void TestQueryTracer::formatValues()
+{
+    QVariantList values {1, QStringLiteral("abc"), QVariant(), QByteArray("xyz"), true};
+    QCOMPARE(TQueryTracer::formatValues(values), QStringLiteral("1, 'abc', NULL, <3 bytes>, true"));
+
+    QString longValue = TQueryTracer::formatValues({QString(200, QLatin1Char('a'))});
+    QCOMPARE(longValue, QLatin1Char('\'') + QString(99, QLatin1Char('a')) + QLatin1String("..."));
+    QCOMPARE(TQueryTracer::formatValues({}), QString());
+}
+
+QTEST_APPLESS_MAIN(TestQueryTracer)
+#include "main.moc"
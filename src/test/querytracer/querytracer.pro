@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = querytracer
+SOURCES = main.cpp
@@ -0,0 +1,135 @@
+#include <TfTest/TfTest>
+#include "../../tredisdriver.h"
+
+
+// Feeds replies to the parser of the driver without a connection
+class RedisParser : public TRedisDriver {
+public:
+    using TRedisDriver::getLine;
+    using TRedisDriver::parseArray;
+    using TRedisDriver::parseBulkString;
+    using TRedisDriver::takeReply;
+
+    void feed(const QByteArray &data) { appendBuffer(data); }
+};
+
+
+class TestRedisParser : public QObject {
+    Q_OBJECT
+private slots:
+    void takeReply_data();
+    void takeReply();
+    void getLine();
+    void parseBulkString();
+    void parseArray();
+};
+
+
+void TestRedisParser::takeReply_data()
+{
+    QTest::addColumn<QByteArray>("input");
+    QTest::addColumn<int>("chunkSize");  // 0: all at once
+    QTest::addColumn<QVariantList>("expected");
+
+    const QByteArray message = "*3\r\n$7\r\nmessage\r\n$5\r\ntopic\r\n$5\r\nhello\r\n";
+    const QVariantList messageReply {QVariant(QVariantList {QByteArray("message"), QByteArray("topic"), QByteArray("hello")})};
+
+    QTest::newRow("simple") << QByteArray("+OK\r\n") << 0 << QVariantList {QByteArray("OK")};
+    QTest::newRow("simple partial") << QByteArray("+OK\r\n") << 1 << QVariantList {QByteArray("OK")};
+    QTest::newRow("error") << QByteArray("-ERR unknown\r\n") << 3 << QVariantList {QVariant()};
+    QTest::newRow("integer partial") << QByteArray(":1000\r\n") << 2 << QVariantList {1000};
+    QTest::newRow("bulk partial") << QByteArray("$5\r\nhello\r\n") << 4 << QVariantList {QByteArray("hello")};
+    QTest::newRow("bulk CRLF in data") << QByteArray("$4\r\na\r\nb\r\n") << 1 << QVariantList {QByteArray("a\r\nb")};
+    QTest::newRow("empty bulk") << QByteArray("$0\r\n\r\n") << 1 << QVariantList {QByteArray("")};
+    QTest::newRow("null bulk") << QByteArray("$-1\r\n") << 1 << QVariantList {QByteArray()};
+    QTest::newRow("array") << message << 0 << messageReply;
+    QTest::newRow("array partial") << message << 1 << messageReply;
+    QTest::newRow("array mixed") << QByteArray("*3\r\n+OK\r\n:2\r\n$1\r\nx\r\n") << 5
+                                 << QVariantList {QVariant(QVariantList {QByteArray("OK"), 2, QByteArray("x")})};
+    QTest::newRow("nested array") << QByteArray("*2\r\n*2\r\n:1\r\n:2\r\n$1\r\nx\r\n") << 3
+                                  << QVariantList {QVariant(QVariantList {QVariant(QVariantList {1, 2}), QByteArray("x")})};
+    QTest::newRow("empty array") << QByteArray("*0\r\n") << 1 << QVariantList {QVariant(QVariantList())};
+    QTest::newRow("pipelined") << QByteArray("+OK\r\n:2\r\n$3\r\nabc\r\n") + message << 0
+                               << QVariantList {QByteArray("OK"), 2, QByteArray("abc")} + messageReply;
+    QTest::newRow("pipelined partial") << QByteArray("+OK\r\n:2\r\n$3\r\nabc\r\n") + message << 7
+                                       << QVariantList {QByteArray("OK"), 2, QByteArray("abc")} + messageReply;
+}
+
+
+void TestRedisParser::takeReply()
+{
+    QFETCH(QByteArray, input);
+    QFETCH(int, chunkSize);
+    QFETCH(QVariantList, expected);
+
+    RedisParser parser;
+    QVariantList replies;
+    QVariant reply;
+    int size = (chunkSize > 0) ? chunkSize : input.length();
+
+    for (int pos = 0; pos < input.length(); pos += size) {
+        parser.feed(input.mid(pos, size));
+        while (parser.takeReply(reply)) {
+            replies << reply;
+        }
+    }
+    QCOMPARE(replies, expected);
+    QVERIFY(!parser.takeReply(reply));
+}
+
+
+void TestRedisParser::getLine()
+{
+    RedisParser parser;
+    bool ok = true;
+
+    parser.feed("abc\r");
+    QVERIFY(parser.getLine(&ok).isEmpty());
+    QVERIFY(!ok);
+
+    parser.feed("\ndef\r\n");
+    QCOMPARE(parser.getLine(&ok), QByteArray("abc"));
+    QVERIFY(ok);
+    QCOMPARE(parser.getLine(&ok), QByteArray("def"));
+    QVERIFY(ok);
+    parser.getLine(&ok);
+    QVERIFY(!ok);
+}
+
+
+void TestRedisParser::parseBulkString()
+{
+    RedisParser parser;
+    bool ok = true;
+
+    parser.feed("$5\r\nhel");
+    QVERIFY(parser.parseBulkString(&ok).isNull());
+    QVERIFY(!ok);
+
+    // Parses again from the beginning of the reply
+    parser.feed("lo\r\n$-2\r\n");
+    QCOMPARE(parser.parseBulkString(&ok), QByteArray("hello"));
+    QVERIFY(ok);
+
+    parser.parseBulkString(&ok);
+    QVERIFY(!ok);  // invalid length
+}
+
+
+void TestRedisParser::parseArray()
+{
+    RedisParser parser;
+    bool ok = true;
+
+    parser.feed("*2\r\n*1\r\n$3\r\nab");
+    QVERIFY(parser.parseArray(&ok).isEmpty());
+    QVERIFY(!ok);
+
+    parser.feed("c\r\n:7\r\n");
+    QVariantList list = parser.parseArray(&ok);
+    QVERIFY(ok);
+    QCOMPARE(list, (QVariantList {QVariant(QVariantList {QByteArray("abc")}), 7}));
+}
+
+TF_TEST_MAIN(TestRedisParser)
+#include "main.moc"
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = redisparser
+SOURCES = main.cpp
@@ -0,0 +1,222 @@
+#include <TfTest/TfTest>
+#include <TStaticFileCache>
+#include <QTemporaryDir>
+#include <QThread>
+
+
+static bool writeFile(const QString &path, const QByteArray &data)
+{
+    QFile file(path);
+    return file.open(QIODevice::WriteOnly | QIODevice::Truncate) && file.write(data) == data.length();
+}
+
+
+static void waitForChange()
+{
+#ifdef Q_OS_LINUX
+    QThread::msleep(20);  // inotify event delivered
+#else
+    QThread::msleep(1100);  // revalidated with stat
+#endif
+}
+
+
+class TestStaticFileCache : public QObject {
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void lookup();
+    void notFound();
+    void modified();
+    void removed();
+    void parseByteRange_data();
+    void parseByteRange();
+    void matchesEntityTag_data();
+    void matchesEntityTag();
+    void matchesIfRange_data();
+    void matchesIfRange();
+    void benchLookup();
+
+private:
+    QTemporaryDir dir;
+};
+
+
+void TestStaticFileCache::initTestCase()
+{
+    QVERIFY(dir.isValid());
+    QVERIFY(TStaticFileCache::isEnabled());
+}
+
+
+void TestStaticFileCache::lookup()
+{
+    QString path = dir.filePath("app.css");
+    QVERIFY(writeFile(path, "body { color: red; }"));
+
+    auto entry = TStaticFileCache::lookup(path);
+    QVERIFY(entry);
+    QCOMPARE(entry->size, 20LL);
+    QVERIFY(entry->hasContent);
+    QCOMPARE(entry->content, QByteArray("body { color: red; }"));
+    QVERIFY(entry->etag.startsWith('"') && entry->etag.endsWith('"'));
+    QVERIFY(!entry->lastModifiedString.isEmpty());
+
+    auto entry2 = TStaticFileCache::lookup(path);
+    QCOMPARE(entry2.data(), entry.data());  // cached
+}
+
+
+void TestStaticFileCache::notFound()
+{
+    QString path = dir.filePath("later.js");
+    QVERIFY(!TStaticFileCache::lookup(path));
+    QVERIFY(!TStaticFileCache::lookup(dir.path()));  // directory
+    QVERIFY(!TStaticFileCache::lookup(dir.filePath("nodir/a.js")));
+
+    QVERIFY(writeFile(path, "alert(1);"));
+    waitForChange();
+    auto entry = TStaticFileCache::lookup(path);
+    QVERIFY(entry);
+    QCOMPARE(entry->content, QByteArray("alert(1);"));
+}
+
+
+void TestStaticFileCache::modified()
+{
+    QString path = dir.filePath("index.html");
+    QVERIFY(writeFile(path, "<html></html>"));
+    auto entry = TStaticFileCache::lookup(path);
+    QVERIFY(entry);
+
+    waitForChange();
+    QVERIFY(writeFile(path, "<html><body>updated</body></html>"));
+    waitForChange();
+    auto entry2 = TStaticFileCache::lookup(path);
+    QVERIFY(entry2);
+    QCOMPARE(entry2->content, QByteArray("<html><body>updated</body></html>"));
+    QVERIFY(entry2->etag != entry->etag);
+    QCOMPARE(entry->content, QByteArray("<html></html>"));  // the old entry stays valid
+}
+
+
+void TestStaticFileCache::removed()
+{
+    QString path = dir.filePath("old.txt");
+    QVERIFY(writeFile(path, "old"));
+    QVERIFY(TStaticFileCache::lookup(path));
+
+    QVERIFY(QFile::remove(path));
+    waitForChange();
+    QVERIFY(!TStaticFileCache::lookup(path));
+}
+
+
+void TestStaticFileCache::parseByteRange_data()
+{
+    QTest::addColumn<QByteArray>("range");
+    QTest::addColumn<qint64>("size");
+    QTest::addColumn<int>("result");
+    QTest::addColumn<qint64>("offset");
+    QTest::addColumn<qint64>("length");
+
+    QTest::newRow("first-last") << QByteArray("bytes=0-499") << (qint64)1000 << 1 << (qint64)0 << (qint64)500;
+    QTest::newRow("middle") << QByteArray("bytes=500-999") << (qint64)1000 << 1 << (qint64)500 << (qint64)500;
+    QTest::newRow("spaces") << QByteArray("bytes= 10 - 19 ") << (qint64)1000 << 1 << (qint64)10 << (qint64)10;
+    QTest::newRow("open-ended") << QByteArray("bytes=900-") << (qint64)1000 << 1 << (qint64)900 << (qint64)100;
+    QTest::newRow("last clamped") << QByteArray("bytes=900-5000") << (qint64)1000 << 1 << (qint64)900 << (qint64)100;
+    QTest::newRow("single byte") << QByteArray("bytes=999-999") << (qint64)1000 << 1 << (qint64)999 << (qint64)1;
+    QTest::newRow("suffix") << QByteArray("bytes=-100") << (qint64)1000 << 1 << (qint64)900 << (qint64)100;
+    QTest::newRow("suffix oversize") << QByteArray("bytes=-5000") << (qint64)1000 << 1 << (qint64)0 << (qint64)1000;
+    QTest::newRow("suffix zero") << QByteArray("bytes=-0") << (qint64)1000 << -1 << (qint64)-1 << (qint64)-1;
+    QTest::newRow("suffix empty file") << QByteArray("bytes=-10") << (qint64)0 << -1 << (qint64)-1 << (qint64)-1;
+    QTest::newRow("first beyond size") << QByteArray("bytes=1000-1999") << (qint64)1000 << -1 << (qint64)-1 << (qint64)-1;
+    QTest::newRow("open-ended beyond size") << QByteArray("bytes=1000-") << (qint64)1000 << -1 << (qint64)-1 << (qint64)-1;
+    QTest::newRow("empty file") << QByteArray("bytes=0-") << (qint64)0 << -1 << (qint64)-1 << (qint64)-1;
+    QTest::newRow("multiple ranges") << QByteArray("bytes=0-9,20-29") << (qint64)1000 << 0 << (qint64)-1 << (qint64)-1;
+    QTest::newRow("last before first") << QByteArray("bytes=500-100") << (qint64)1000 << 0 << (qint64)-1 << (qint64)-1;
+    QTest::newRow("no dash") << QByteArray("bytes=100") << (qint64)1000 << 0 << (qint64)-1 << (qint64)-1;
+    QTest::newRow("not number") << QByteArray("bytes=a-b") << (qint64)1000 << 0 << (qint64)-1 << (qint64)-1;
+    QTest::newRow("other unit") << QByteArray("items=0-9") << (qint64)1000 << 0 << (qint64)-1 << (qint64)-1;
+    QTest::newRow("empty") << QByteArray() << (qint64)1000 << 0 << (qint64)-1 << (qint64)-1;
+}
+
+
+void TestStaticFileCache::parseByteRange()
+{
+    QFETCH(QByteArray, range);
+    QFETCH(qint64, size);
+    QFETCH(int, result);
+    QFETCH(qint64, offset);
+    QFETCH(qint64, length);
+
+    qint64 actualOffset = -1;
+    qint64 actualLength = -1;
+    QCOMPARE(TStaticFileCache::parseByteRange(range, size, actualOffset, actualLength), result);
+    QCOMPARE(actualOffset, offset);
+    QCOMPARE(actualLength, length);
+}
+
+
+void TestStaticFileCache::matchesEntityTag_data()
+{
+    QTest::addColumn<QByteArray>("condition");
+    QTest::addColumn<bool>("match");
+
+    const QByteArray etag = "\"5c9f-1a2b\"";
+    QTest::newRow("strong") << etag << true;
+    QTest::newRow("weak") << QByteArray("W/") + etag << true;
+    QTest::newRow("list") << QByteArray("\"abc\", ") + etag + QByteArray(" , \"def\"") << true;
+    QTest::newRow("weak in list") << QByteArray("\"abc\",W/") + etag << true;
+    QTest::newRow("any") << QByteArray(" * ") << true;
+    QTest::newRow("mismatch") << QByteArray("\"5c9f-1a2c\"") << false;
+    QTest::newRow("unquoted") << QByteArray("5c9f-1a2b") << false;
+    QTest::newRow("empty") << QByteArray() << false;
+}
+
+
+void TestStaticFileCache::matchesEntityTag()
+{
+    QFETCH(QByteArray, condition);
+    QFETCH(bool, match);
+    QCOMPARE(TStaticFileCache::matchesEntityTag(condition, "\"5c9f-1a2b\""), match);
+}
+
+
+void TestStaticFileCache::matchesIfRange_data()
+{
+    QTest::addColumn<QByteArray>("ifRange");
+    QTest::addColumn<bool>("match");
+
+    QTest::newRow("empty") << QByteArray() << true;
+    QTest::newRow("strong etag") << QByteArray("\"5c9f-1a2b\"") << true;
+    QTest::newRow("weak etag") << QByteArray("W/\"5c9f-1a2b\"") << false;  // strong comparison
+    QTest::newRow("other etag") << QByteArray("\"5c9f-1a2c\"") << false;
+    QTest::newRow("date") << QByteArray("Mon, 01 Apr 2019 10:30:15 GMT") << true;
+    QTest::newRow("other date") << QByteArray("Mon, 01 Apr 2019 10:30:16 GMT") << false;
+}
+
+
+void TestStaticFileCache::matchesIfRange()
+{
+    QFETCH(QByteArray, ifRange);
+    QFETCH(bool, match);
+    QCOMPARE(TStaticFileCache::matchesIfRange(ifRange, "\"5c9f-1a2b\"", "Mon, 01 Apr 2019 10:30:15 GMT"), match);
+}
+
+
+void TestStaticFileCache::benchLookup()
+{
+    QString path = dir.filePath("bench.css");
+    QVERIFY(writeFile(path, QByteArray(4096, 'a')));
+    TStaticFileCache::lookup(path);
+
+    QBENCHMARK {
+        auto entry = TStaticFileCache::lookup(path);
+        Q_UNUSED(entry);
+    }
+}
+
+
+TF_TEST_MAIN(TestStaticFileCache)
+#include "main.moc"
@@ -2,9 +2,10 @@ TEMPLATE = subdirs
 CONFIG  += testcase
 SUBDIRS  = htmlescape httpheader hmac htmlparser
 SUBDIRS += mailmessage multipartformdata  smtpmailer viewhelper paginator
-SUBDIRS += fieldnametovariablename rand urlrouter urlrouter2
+SUBDIRS += fieldnametovariablename rand urlrouter urlrouter2 urlrouter3
 SUBDIRS += sharedmemorylogstream buildtest stack queue forlist
-SUBDIRS += jscontext compression sqlitedb url
+SUBDIRS += jscontext compression sqlitedb url loglayout metrics querytracer tracing loglevel introspector dispatcher httpcompressor staticfilecache jsonwriter actionview redisparser
+unix:SUBDIRS += logwriter
 
 fwtests.target = test
 fwtests.commands = make check
@@ -0,0 +1,117 @@
+#include <QtTest/QtTest>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QUdpSocket>
+#include <TTracer>
+
+
+class TestTracing : public QObject
+{
+    Q_OBJECT
+private slots:
+    void fromTraceparent_data();
+    void fromTraceparent();
+    void toTraceparent();
+    void exportSpans();
+};
+
+
+void TestTracing::fromTraceparent_data()
+{
+    QTest::addColumn<QByteArray>("traceparent");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<bool>("sampled");
+
+    QTest::newRow("1") << QByteArray("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01") << true << true;
+    QTest::newRow("2") << QByteArray("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-00") << true << false;
+    QTest::newRow("3") << QByteArray("01-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01-what") << true << true;
+    QTest::newRow("4") << QByteArray("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01-what") << false << false;
+    QTest::newRow("5") << QByteArray("ff-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7-01") << false << false;
+    QTest::newRow("6") << QByteArray("00-00000000000000000000000000000000-00f067aa0ba902b7-01") << false << false;
+    QTest::newRow("7") << QByteArray("00-4bf92f3577b34da6a3ce929d0e0e4736-0000000000000000-01") << false << false;
+    QTest::newRow("8") << QByteArray("00-4BF92F3577B34DA6A3CE929D0E0E4736-00f067aa0ba902b7-01") << false << false;
+    QTest::newRow("9") << QByteArray("00-4bf92f3577b34da6a3ce929d0e0e4736-00f067aa0ba902b7") << false << false;
+    QTest::newRow("10") << QByteArray() << false << false;
+}
+
+
+void TestTracing::fromTraceparent()
+{
+    QFETCH(QByteArray, traceparent);
+    QFETCH(bool, valid);
+    QFETCH(bool, sampled);
+
+    TTraceContext context = TTraceContext::fromTraceparent(traceparent);
+    QCOMPARE(context.isValid(), valid);
+    QCOMPARE(context.isSampled(), sampled);
+}
+
+
+void TestTracing::toTraceparent()
+{
+    QByteArray traceId = TTraceContext::generateTraceId();
+    QByteArray spanId = TTraceContext::generateSpanId();
+    QCOMPARE(traceId.length(), 32);
+    QCOMPARE(spanId.length(), 16);
+
+    TTraceContext context(traceId, spanId, true);
+    TTraceContext parsed = TTraceContext::fromTraceparent(context.toTraceparent());
+    QVERIFY(parsed.isValid());
+    QCOMPARE(parsed.traceId(), traceId);
+    QCOMPARE(parsed.spanId(), spanId);
+    QVERIFY(parsed.isSampled());
+}
+
+
+void TestTracing::exportSpans()
+{
+    // Fake collector
+    QUdpSocket collector;
+    QVERIFY(collector.bind(QHostAddress::LocalHost, 0));
+    TTracer::setup(QStringLiteral("udp://127.0.0.1:%1").arg(collector.localPort()), 1.0, "test");
+    QVERIFY(TTracer::isEnabled());
+
+    const QByteArray traceId = "4bf92f3577b34da6a3ce929d0e0e4736";
+    const QByteArray parentId = "00f067aa0ba902b7";
+    TTracer::beginRequest("GET", "/blog/index?page=2", "00-" + traceId + '-' + parentId + "-01", "vendor=abc");
+    QVERIFY(TTracer::isSampled());
+    QByteArray serverSpanId = TTracer::currentContext().spanId();
+    {
+        TTraceSpan span("action blog#index");
+        QVERIFY(span.isRecording());
+        QCOMPARE(TTracer::currentContext().spanId(), TTraceContext::fromTraceparent(span.traceparent()).spanId());
+    }
+    TTracer::endRequest(200, "blog#index");
+    TTracer::flush();
+
+    // Spans may be exported in several datagrams
+    QJsonArray spans;
+    while (spans.count() < 2 && collector.waitForReadyRead(3000)) {
+        while (collector.hasPendingDatagrams()) {
+            QByteArray datagram(collector.pendingDatagramSize(), 0);
+            collector.readDatagram(datagram.data(), datagram.size());
+            QJsonObject scopeSpans = QJsonDocument::fromJson(datagram).object()["resourceSpans"].toArray()[0].toObject()["scopeSpans"].toArray()[0].toObject();
+            for (const auto &span : scopeSpans["spans"].toArray()) {
+                spans.append(span);
+            }
+        }
+    }
+    TTracer::release();
+
+    QCOMPARE(spans.count(), 2);
+
+    QJsonObject action = spans[0].toObject();
+    QJsonObject server = spans[1].toObject();
+    QCOMPARE(action["name"].toString(), QString("action blog#index"));
+    QCOMPARE(action["traceId"].toString(), QString(traceId));
+    QCOMPARE(action["parentSpanId"].toString(), QString(serverSpanId));
+    QCOMPARE(server["name"].toString(), QString("GET blog#index"));
+    QCOMPARE(server["kind"].toInt(), (int)TTracer::Server);
+    QCOMPARE(server["parentSpanId"].toString(), QString(parentId));
+    QCOMPARE(server["traceState"].toString(), QString("vendor=abc"));
+}
+
+
+QTEST_APPLESS_MAIN(TestTracing)
+#include "main.moc"
@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = tracing
+SOURCES = main.cpp
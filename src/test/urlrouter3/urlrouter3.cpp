@@ -0,0 +1,209 @@
+#include <TfTest/TfTest>
+#include <QDebug>
+#include "../../turlroute.h"
+
+static const int ROUTE_COUNT = 5000;
+
+
+class TestUrlRouter3 : public QObject, public TUrlRoute
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase() { }
+
+    void route_encoded_path_data();
+    void route_encoded_path();
+    void compare_with_linear_scan();
+    void bench_first_route();
+    void bench_last_route();
+    void bench_param_route();
+    void bench_not_found();
+    void bench_split_path();
+
+private:
+    TRouting linearRouting(Tf::HttpMethod method, const QStringList &components) const;
+};
+
+
+void TestUrlRouter3::initTestCase()
+{
+    addRouteFromString("GET   /                      'root.index'");
+    addRouteFromString("GET   /café/:param         'cafe.show'");
+    addRouteFromString("GET   /docs/:params          'docs.index'");
+    addRouteFromString("MATCH /static/:param/file    '/index.html'");
+
+    // Synthetic routes
+    const char *methods[] = {"GET", "POST", "PUT", "DELETE", "MATCH"};
+    for (int i = 0; i < ROUTE_COUNT; ++i) {
+        QString line;
+        switch (i % 4) {
+        case 0:
+            line = QString("%1 /resource%2 'res%2.index'").arg(methods[i % 5]).arg(i);
+            break;
+        case 1:
+            line = QString("%1 /resource%2/:param 'res%2.show'").arg(methods[i % 5]).arg(i - 1);
+            break;
+        case 2:
+            line = QString("%1 /api/v%2/item%3/:param/edit 'api%3.edit'").arg(methods[i % 5]).arg(i % 3).arg(i);
+            break;
+        default:
+            line = QString("%1 /files%2/:params 'file%2.get'").arg(methods[i % 5]).arg(i);
+            break;
+        }
+        QVERIFY(addRouteFromString(line));
+    }
+    addRouteFromString("MATCH /:param/:params        'fallback.index'");
+}
+
+
+void TestUrlRouter3::route_encoded_path_data()
+{
+    QTest::addColumn<QByteArray>("path");
+    QTest::addColumn<QString>("controller");
+    QTest::addColumn<QString>("action");
+    QTest::addColumn<QStringList>("params");
+
+    QTest::newRow("1") << QByteArray("/") << QString("rootcontroller") << QString("index") << QStringList();
+    QTest::newRow("2") << QByteArray("/?q=1") << QString("rootcontroller") << QString("index") << QStringList();
+    QTest::newRow("3") << QByteArray("/caf%C3%A9/%E3%81%82") << QString("cafecontroller") << QString("show") << QStringList(QString::fromUtf8("\xe3\x81\x82"));
+    QTest::newRow("4") << QByteArray("/docs/a+b/c%2Fd/") << QString("docscontroller") << QString("index") << (QStringList() << "a b" << "c" << "d");
+    QTest::newRow("5") << QByteArray("/resource8/12?x=/y") << QString("res8controller") << QString("show") << QStringList("12");
+    QTest::newRow("6") << QByteArray("/files15") << QString("file15controller") << QString("get") << QStringList();
+    QTest::newRow("7") << QByteArray("/files15//a") << QString("file15controller") << QString("get") << (QStringList() << "" << "a");
+    QTest::newRow("8") << QByteArray("/api/v1/item10/%zz/edit") << QString("api10controller") << QString("edit") << QStringList("%zz");
+    QTest::newRow("9") << QByteArray("/unknown/x/y") << QString("fallbackcontroller") << QString("index") << (QStringList() << "unknown" << "x" << "y");
+    QTest::newRow("10") << QByteArray("/static/a/file") << QString("/index.html") << QString("") << QStringList("a");
+}
+
+
+void TestUrlRouter3::route_encoded_path()
+{
+    QFETCH(QByteArray, path);
+    QFETCH(QString, controller);
+    QFETCH(QString, action);
+    QFETCH(QStringList, params);
+
+    TRouting r = findRouting(Tf::Get, path);
+    QVERIFY(r.exists);
+    QCOMPARE(QString(r.controller), controller);
+    QCOMPARE(QString(r.action), action);
+    QCOMPARE(r.params, params);
+}
+
+
+void TestUrlRouter3::compare_with_linear_scan()
+{
+    const Tf::HttpMethod methods[] = {Tf::Get, Tf::Post, Tf::Put, Tf::Delete, Tf::Patch};
+    QStringList paths;
+    for (int i = 0; i < ROUTE_COUNT; i += 7) {
+        paths << QString("/resource%1").arg(i)
+              << QString("/resource%1/%2").arg(i).arg(i * 3)
+              << QString("/api/v%1/item%2/x/edit").arg(i % 3).arg(i)
+              << QString("/api/v%1/item%2/x/edit").arg((i + 1) % 3).arg(i)
+              << QString("/files%1/a/b/").arg(i)
+              << QString("/files%1").arg(i);
+    }
+    paths << "/" << "" << "//" << "/docs" << "/a/b/c/d";
+
+    for (const auto &path : paths) {
+        for (auto method : methods) {
+            const QStringList components = splitPath(path);
+            TRouting expected = linearRouting(method, components);
+            TRouting actual = findRouting(method, components);
+            TRouting raw = findRouting(method, path.toUtf8());
+            QCOMPARE(actual.exists, expected.exists);
+            QCOMPARE(actual.controller, expected.controller);
+            QCOMPARE(actual.action, expected.action);
+            QCOMPARE(actual.params, expected.params);
+            QCOMPARE(raw.controller, expected.controller);
+            QCOMPARE(raw.params, expected.params);
+        }
+    }
+}
+
+
+void TestUrlRouter3::bench_first_route()
+{
+    QByteArray path("/resource0");
+    QBENCHMARK {
+        findRouting(Tf::Get, path);
+    }
+}
+
+
+void TestUrlRouter3::bench_last_route()
+{
+    QByteArray path = QString("/files%1/a/b").arg(ROUTE_COUNT - 1).toLatin1();
+    QBENCHMARK {
+        findRouting(Tf::Get, path);
+    }
+}
+
+
+void TestUrlRouter3::bench_param_route()
+{
+    QByteArray path = QString("/api/v%1/item%2/123/edit").arg((ROUTE_COUNT - 2) % 3).arg(ROUTE_COUNT - 2).toLatin1();
+    QBENCHMARK {
+        findRouting(Tf::Delete, path);
+    }
+}
+
+
+void TestUrlRouter3::bench_not_found()
+{
+    QByteArray path("/nothing");
+    QBENCHMARK {
+        findRouting(Tf::Get, path);
+    }
+}
+
+// Linear scan with the decoded component list, as routed formerly
+void TestUrlRouter3::bench_split_path()
+{
+    QByteArray path = QString("/files%1/a/b").arg(ROUTE_COUNT - 1).toLatin1();
+    QBENCHMARK {
+        linearRouting(Tf::Get, splitPath(QString::fromUtf8(path)));
+    }
+}
+
+
+TRouting TestUrlRouter3::linearRouting(Tf::HttpMethod method, const QStringList &components) const
+{
+    for (const auto &rt : allRoutes()) {
+        if (rt.hasVariableParams) {
+            if (components.length() < rt.componentList.length() - 1) {
+                continue;
+            }
+        } else if (components.length() != rt.componentList.length()) {
+            continue;
+        }
+
+        bool match = true;
+        for (int idx : rt.keywordIndexes) {
+            if (components.value(idx) != rt.componentList[idx]) {
+                match = false;
+                break;
+            }
+        }
+
+        if (match && (rt.method == TRoute::Match || rt.method == method)) {
+            QStringList params = components;
+            if (params.count() == 1 && params[0].isEmpty()) {
+                params.clear();
+            } else {
+                for (int i = rt.keywordIndexes.count() - 1; i >= 0; --i) {
+                    params.removeAt(rt.keywordIndexes[i]);
+                }
+            }
+            TRouting routing(rt.controller, rt.action, params);
+            routing.exists = true;
+            return routing;
+        }
+    }
+    return TRouting();
+}
+
+
+TF_TEST_MAIN(TestUrlRouter3)
+#include "urlrouter3.moc"
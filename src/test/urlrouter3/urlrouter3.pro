@@ -0,0 +1,3 @@
+include(../test.pri)
+TARGET = urlrouter3
+SOURCES = urlrouter3.cpp
@@ -7,22 +7,16 @@
 
 #include "tfcore_unix.h"
 #include "tfileaiowriter.h"
-#include "tqueue.h"
-#include <QList>
+#include "tlogwriter.h"
 #include <QMutexLocker>
 
-constexpr int MAX_NUM_BUFFERING_DATA = 10000;
-
 
 class TFileAioWriterData {
 public:
-    mutable QMutex mutex;
+    mutable QMutex mutex;  // for open and close
     QString fileName;
-    int fileDescriptor;
-    TQueue<struct aiocb *> syncBuffer;
-
-    TFileAioWriterData() :
-        mutex(QMutex::Recursive), fileName(), fileDescriptor(0), syncBuffer() { }
+    int fileDescriptor {0};
+    TAtomic<int> sink {-1};
 };
 
 /*!
@@ -54,6 +48,8 @@ bool TFileAioWriter::open()
         d->fileDescriptor = ::open(qPrintable(d->fileName), (O_CREAT | O_WRONLY | O_APPEND | O_CLOEXEC), 0666);
         if (d->fileDescriptor < 0) {
             //fprintf(stderr, "file open failed: %s\n", qPrintable(d->fileName));
+        } else {
+            d->sink = TLogWriter::instance()->addSink(d->fileDescriptor);
         }
     }
 
@@ -65,7 +61,11 @@ void TFileAioWriter::close()
 {
     QMutexLocker locker(&d->mutex);
 
-    flush();
+    int sink = d->sink.exchange(-1);
+    if (sink >= 0) {
+        TLogWriter::instance()->flush();
+        TLogWriter::instance()->removeSink(sink);
+    }
 
     if (d->fileDescriptor > 0) {
         tf_close(d->fileDescriptor);
@@ -79,7 +79,10 @@ bool TFileAioWriter::isOpen() const
     return (d->fileDescriptor > 0);
 }
 
-
+/*!
+  Appends the \a data of \a length bytes to the buffer of the current
+  thread without locking; the log writer thread writes it out to the file.
+*/
 int TFileAioWriter::write(const char *data, int length)
 {
     if (!isOpen()) {
@@ -90,95 +93,30 @@ int TFileAioWriter::write(const char *data, int length)
         return -1;
     }
 
-    if (d->syncBuffer.count() > 0) {
-        if (d->mutex.tryLock()) {
-            // check whether head's item  writing is finished
-            struct aiocb *headcb;
-            while (d->syncBuffer.head(headcb)) {
-                if (aio_error(headcb) == EINPROGRESS) {
-                    break;
-                }
-
-                if (d->syncBuffer.dequeue(headcb)) {
-                    delete[](char *) headcb->aio_buf;
-                    delete headcb;
-                } else {
-                    break;
-                }
-            }
-            d->mutex.unlock();
-        }
-
-        if (d->syncBuffer.count() > MAX_NUM_BUFFERING_DATA) {
-            flush();
-        }
+    int sink = d->sink.load();
+    if (Q_UNLIKELY(sink < 0)) {
+        // No sink available; writes it synchronously
+        return (tf_write(d->fileDescriptor, data, length) > 0) ? 0 : -1;
     }
-
-    struct aiocb *cb = new struct aiocb;
-    memset(cb, 0, sizeof(struct aiocb));
-
-    cb->aio_fildes = d->fileDescriptor;
-    cb->aio_nbytes = length;
-    cb->aio_buf = new char[length];
-    memcpy((void *)cb->aio_buf, data, length);
-
-    int ret = tf_aio_write(cb);
-    int err = errno;
-
-    if (ret < 0) {
-        //fprintf(stderr, "aio_write error fd:%d (pid:%d tid:%d) ret:%d errno:%d\n", d->fileDescriptor, getpid(), gettid(), ret, err);
-        //fprintf(stderr, "aio_write str: %s\n", data);
-        delete[](char *) cb->aio_buf;
-        delete cb;
-
-        if (err != EAGAIN) {
-            close();
-        } else {
-#ifdef Q_OS_DARWIN
-            // try sync-write
-            return (tf_write(d->fileDescriptor, data, length) > 0) ? 0 : -1;
-#endif
-        }
-        return ret;
-    }
-
-    d->syncBuffer.enqueue(cb);
-    return 0;
+    return TLogWriter::instance()->write(sink, data, length) ? 0 : -1;
 }
 
 
 void TFileAioWriter::flush()
 {
-    if (!isOpen()) {
-        return;
-    }
-
-    if (d->syncBuffer.count() == 0) {
-        return;
-    }
-
-    QMutexLocker locker(&d->mutex);
-    struct aiocb *headcb;
-
-    while (d->syncBuffer.count() > 0) {
-        if (d->syncBuffer.head(headcb) && aio_error(headcb) != EINPROGRESS) {
-            // Dequeue
-            if (d->syncBuffer.dequeue(headcb)) {
-                delete[](char *) headcb->aio_buf;
-                delete headcb;
-            }
-        }
+    if (d->sink.load() >= 0) {
+        TLogWriter::instance()->flush();
     }
 }
 
 
 void TFileAioWriter::setFileName(const QString &name)
 {
-    QMutexLocker locker(&d->mutex);
-
     if (isOpen()) {
         close();
     }
+
+    QMutexLocker locker(&d->mutex);
     d->fileName = name;
 }
 
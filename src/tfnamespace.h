@@ -203,6 +203,34 @@ enum AppAttribute {
     EnableForwardedForHeader,
     TrustedProxyServers,
     ActionMailerSmtpRequireTLS,
+    //
+    MPMEpollSendQueueLimitBytes,
+    MPMEpollSendQueueLimitMessages,
+    WebSocketBackplane,
+    LogWriterBufferSize,
+    LogWriterOverflowPolicy,
+    SystemLogFormat,
+    AccessLogFormat,
+    AccessLogSamplingRules,
+    MetricsPath,
+    MetricsPort,
+    SlowQueryLogFilePath,
+    SlowQueryLogThreshold,
+    SlowQueryLogRequestThreshold,
+    SlowQueryLogRepeatThreshold,
+    SlowQueryLogExplain,
+    TracingExport,
+    TracingSampleRate,
+    TracingServiceName,
+    SystemLogLevel,
+    HttpCompressionEncodings,
+    HttpCompressionMinimumSize,
+    HttpCompressionLevel,
+    HttpCompressionContentTypes,
+    HttpCompressionPrecompressed,
+    StaticFileCacheEnable,
+    StaticFileCacheMaxFileSize,
+    StaticFileCacheMaxMemory,
 };
 
 // Reason codes why a web socket has been closed
@@ -224,6 +252,14 @@ enum CloseCode {
     TLSHandshake = 1015,
 };
 
+// Policies applied when the send queue of a socket exceeds its limits
+enum SendQueuePolicy {
+    DropOldest = 0,  //!< Discards the oldest queued messages.
+    DropNewest,  //!< Discards the message being queued.
+    CoalesceLatest,  //!< Keeps only the latest queued message per topic.
+    DisconnectSocket,  //!< Closes the connection of the slow consumer.
+};
+
 enum LogPriority {
     FatalLevel = 0,  //!< Severe error events that will presumably lead the app to abort.
     ErrorLevel,  //!< Error events that might still allow the app to continue running.
@@ -213,6 +213,13 @@ QMap<QByteArray, std::function<QObject *()>> *Tf::objectFactories() noexcept
 }
 
 
+QMap<QByteArray, const QMetaObject *> *Tf::objectMetaObjects() noexcept
+{
+    static QMap<QByteArray, const QMetaObject *> metaObjectMap;
+    return &metaObjectMap;
+}
+
+
 QByteArray Tf::lz4Compress(const char *data, int nbytes, int compressionLevel) noexcept
 {
     // internal compress function
@@ -324,6 +331,16 @@ qint64 Tf::getMSecsSinceEpoch()
     return std::chrono::duration_cast<std::chrono::milliseconds>(p.time_since_epoch()).count();
 }
 
+/*!
+  Returns the nanoseconds of the monotonic clock, which is suitable for
+  measuring elapsed time.
+*/
+qint64 Tf::getMonotonicNSecs() noexcept
+{
+    auto p = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(p.time_since_epoch()).count();
+}
+
 
 /*!
   \def T_EXPORT(VAR)
@@ -31,6 +31,7 @@ constexpr auto TF_SRC_REVISION = 2274;
         Static##TYPE##Definition() noexcept                                                          \
         {                                                                                            \
             Tf::objectFactories()->insert(QByteArray(#TYPE).toLower(), []() { return new TYPE(); }); \
+            Tf::objectMetaObjects()->insert(QByteArray(#TYPE).toLower(), &TYPE::staticMetaObject);   \
         }                                                                                            \
     };                                                                                               \
     static Static##TYPE##Definition _static##TYPE##Definition;
@@ -92,59 +93,63 @@ constexpr auto TF_SRC_REVISION = 2274;
 #endif
 
 
-#define T_EXPORT(VAR)                                            \
-    do {                                                         \
-        QVariant ___##VAR##_;                                    \
-        ___##VAR##_.setValue(VAR);                               \
-        exportVariant(QLatin1String(#VAR), (___##VAR##_), true); \
-    } while (0)
-#define texport(VAR) T_EXPORT(VAR)
-
-#define T_EXPORT_UNLESS(VAR)                                      \
+#define T_EXPORT(VAR)                                             \
     do {                                                          \
         QVariant ___##VAR##_;                                     \
         ___##VAR##_.setValue(VAR);                                \
-        exportVariant(QLatin1String(#VAR), (___##VAR##_), false); \
+        exportVariant(QStringLiteral(#VAR), (___##VAR##_), true); \
+    } while (0)
+#define texport(VAR) T_EXPORT(VAR)
+
+#define T_EXPORT_UNLESS(VAR)                                       \
+    do {                                                           \
+        QVariant ___##VAR##_;                                      \
+        ___##VAR##_.setValue(VAR);                                 \
+        exportVariant(QStringLiteral(#VAR), (___##VAR##_), false); \
     } while (0)
 #define texportUnless(VAR) T_EXPORT_UNLESS(VAR)
 
-#define T_FETCH(TYPE, VAR) TYPE VAR = variant(QLatin1String(#VAR)).value<TYPE>()
+#define T_FETCH(TYPE, VAR) TYPE VAR = variant(QStringLiteral(#VAR)).value<TYPE>()
 #define tfetch(TYPE, VAR) T_FETCH(TYPE, VAR)
 
-#define T_FETCH_V(TYPE, VAR, DEFAULT) TYPE VAR = (hasVariant(QLatin1String(#VAR))) ? (variant(QLatin1String(#VAR)).value<TYPE>()) : (DEFAULT)
+#define T_FETCH_V(TYPE, VAR, DEFAULT) TYPE VAR = (hasVariant(QStringLiteral(#VAR))) ? (variant(QStringLiteral(#VAR)).value<TYPE>()) : (DEFAULT)
 #define tfetchv(TYPE, VAR, DEFAULT) T_FETCH_V(TYPE, VAR, DEFAULT)
 
-#define T_EHEX(VAR)                                      \
-    do {                                                 \
-        auto ___##VAR##_ = variant(QLatin1String(#VAR)); \
-        int ___##VAR##_type = (___##VAR##_).type();      \
-        switch (___##VAR##_type) {                       \
-        case QMetaType::QJsonValue:                      \
-            eh((___##VAR##_).toJsonValue());             \
-            break;                                       \
-        case QMetaType::QJsonObject:                     \
-            eh((___##VAR##_).toJsonObject());            \
-            break;                                       \
-        case QMetaType::QJsonArray:                      \
-            eh((___##VAR##_).toJsonArray());             \
-            break;                                       \
-        case QMetaType::QJsonDocument:                   \
-            eh((___##VAR##_).toJsonDocument());          \
-            break;                                       \
-        default:                                         \
-            eh(___##VAR##_);                             \
-        }                                                \
+// Refers to the exported value without copying it
+#define T_FETCH_REF(TYPE, VAR) const TYPE &VAR = variantRef<TYPE>(QStringLiteral(#VAR))
+#define tfetchref(TYPE, VAR) T_FETCH_REF(TYPE, VAR)
+
+#define T_EHEX(VAR)                                       \
+    do {                                                  \
+        auto ___##VAR##_ = variant(QStringLiteral(#VAR)); \
+        int ___##VAR##_type = (___##VAR##_).type();       \
+        switch (___##VAR##_type) {                        \
+        case QMetaType::QJsonValue:                       \
+            eh((___##VAR##_).toJsonValue());              \
+            break;                                        \
+        case QMetaType::QJsonObject:                      \
+            eh((___##VAR##_).toJsonObject());             \
+            break;                                        \
+        case QMetaType::QJsonArray:                       \
+            eh((___##VAR##_).toJsonArray());              \
+            break;                                        \
+        case QMetaType::QJsonDocument:                    \
+            eh((___##VAR##_).toJsonDocument());           \
+            break;                                        \
+        default:                                          \
+            eh(___##VAR##_);                              \
+        }                                                 \
     } while (0)
 
 #define tehex(VAR) T_EHEX(VAR)
 
-#define T_EHEX_V(VAR, DEFAULT)                                         \
-    do {                                                               \
-        QString ___##VAR##_ = variant(QLatin1String(#VAR)).toString(); \
-        if ((___##VAR##_).isEmpty())                                   \
-            eh(DEFAULT);                                               \
-        else                                                           \
-            T_EHEX(VAR);                                               \
+#define T_EHEX_V(VAR, DEFAULT)                                          \
+    do {                                                                \
+        QString ___##VAR##_ = variant(QStringLiteral(#VAR)).toString(); \
+        if ((___##VAR##_).isEmpty())                                    \
+            eh(DEFAULT);                                                \
+        else                                                            \
+            T_EHEX(VAR);                                                \
     } while (0)
 
 #define tehexv(VAR, DEFAULT) T_EHEX_V(VAR, DEFAULT)
@@ -153,37 +158,37 @@ constexpr auto TF_SRC_REVISION = 2274;
 #define T_EHEX2(VAR, DEFAULT) T_EHEX_V(VAR, DEFAULT)
 #define tehex2(VAR, DEFAULT) T_EHEX2(VAR, DEFAULT)
 
-#define T_ECHOEX(VAR)                                    \
-    do {                                                 \
-        auto ___##VAR##_ = variant(QLatin1String(#VAR)); \
-        int ___##VAR##_type = (___##VAR##_).type();      \
-        switch (___##VAR##_type) {                       \
-        case QMetaType::QJsonValue:                      \
-            echo((___##VAR##_).toJsonValue());           \
-            break;                                       \
-        case QMetaType::QJsonObject:                     \
-            echo((___##VAR##_).toJsonObject());          \
-            break;                                       \
-        case QMetaType::QJsonArray:                      \
-            echo((___##VAR##_).toJsonArray());           \
-            break;                                       \
-        case QMetaType::QJsonDocument:                   \
-            echo((___##VAR##_).toJsonDocument());        \
-            break;                                       \
-        default:                                         \
-            echo(___##VAR##_);                           \
-        }                                                \
+#define T_ECHOEX(VAR)                                     \
+    do {                                                  \
+        auto ___##VAR##_ = variant(QStringLiteral(#VAR)); \
+        int ___##VAR##_type = (___##VAR##_).type();       \
+        switch (___##VAR##_type) {                        \
+        case QMetaType::QJsonValue:                       \
+            echo((___##VAR##_).toJsonValue());            \
+            break;                                        \
+        case QMetaType::QJsonObject:                      \
+            echo((___##VAR##_).toJsonObject());           \
+            break;                                        \
+        case QMetaType::QJsonArray:                       \
+            echo((___##VAR##_).toJsonArray());            \
+            break;                                        \
+        case QMetaType::QJsonDocument:                    \
+            echo((___##VAR##_).toJsonDocument());         \
+            break;                                        \
+        default:                                          \
+            echo(___##VAR##_);                            \
+        }                                                 \
     } while (0)
 
 #define techoex(VAR) T_ECHOEX(VAR)
 
-#define T_ECHOEX_V(VAR, DEFAULT)                                       \
-    do {                                                               \
-        QString ___##VAR##_ = variant(QLatin1String(#VAR)).toString(); \
-        if ((___##VAR##_).isEmpty())                                   \
-            echo(DEFAULT);                                             \
-        else                                                           \
-            T_ECHOEX(VAR);                                             \
+#define T_ECHOEX_V(VAR, DEFAULT)                                        \
+    do {                                                                \
+        QString ___##VAR##_ = variant(QStringLiteral(#VAR)).toString(); \
+        if ((___##VAR##_).isEmpty())                                    \
+            echo(DEFAULT);                                              \
+        else                                                            \
+            T_ECHOEX(VAR);                                              \
     } while (0)
 
 #define techoexv(VAR, DEFAULT) T_ECHOEX_V(VAR, DEFAULT)
@@ -192,16 +197,16 @@ constexpr auto TF_SRC_REVISION = 2274;
 #define T_ECHOEX2(VAR, DEFAULT) T_ECHOEX_V(VAR, DEFAULT)
 #define techoex2(VAR, DEFAULT) T_ECHOEX2(VAR, DEFAULT)
 
-#define T_FLASH(VAR)                                  \
-    do {                                              \
-        QVariant ___##VAR##_;                         \
-        ___##VAR##_.setValue(VAR);                    \
-        setFlash(QLatin1String(#VAR), (___##VAR##_)); \
+#define T_FLASH(VAR)                                   \
+    do {                                               \
+        QVariant ___##VAR##_;                          \
+        ___##VAR##_.setValue(VAR);                     \
+        setFlash(QStringLiteral(#VAR), (___##VAR##_)); \
     } while (0)
 
 #define tflash(VAR) T_FLASH(VAR)
 
-#define T_VARIANT(VAR) (variant(QLatin1String(#VAR)).toString())
+#define T_VARIANT(VAR) (variant(QStringLiteral(#VAR)).toString())
 
 //  Some classes do not permit copies and moves to be made of an object.
 #define T_DISABLE_COPY(Class)      \
@@ -221,12 +226,27 @@ constexpr auto TF_SRC_REVISION = 2274;
         Q_UNUSED(once);                    \
     } while (0)
 
+// Log messages of priorities lower than TF_LOG_LEVEL are compiled out.
+// Only the release build of the framework itself drops debug and trace
+// messages by default; applications define TF_LOG_LEVEL to do so.
+#ifndef TF_LOG_LEVEL
+#if defined(TF_MAKEDLL) && defined(TF_NO_DEBUG)
+#define TF_LOG_LEVEL 3  // Tf::InfoLevel
+#else
+#define TF_LOG_LEVEL 5  // Tf::TraceLevel
+#endif
+#endif
+
+// Evaluates the arguments of a log message only if it will be written
+#define T_LOG_IF(PRIORITY, ENABLED) \
+    for (bool t_log_enabled = (TF_LOG_LEVEL >= (PRIORITY) && (ENABLED)); t_log_enabled; t_log_enabled = false)
+
 #define tFatal TDebug(Tf::FatalLevel).fatal
-#define tError TDebug(Tf::ErrorLevel).error
-#define tWarn TDebug(Tf::WarnLevel).warn
-#define tInfo TDebug(Tf::InfoLevel).info
-#define tDebug TDebug(Tf::DebugLevel).debug
-#define tTrace TDebug(Tf::TraceLevel).trace
+#define tError T_LOG_IF(Tf::ErrorLevel, Tf::isLogEnabled(Tf::ErrorLevel)) TDebug(Tf::ErrorLevel).error
+#define tWarn T_LOG_IF(Tf::WarnLevel, Tf::isLogEnabled(Tf::WarnLevel)) TDebug(Tf::WarnLevel).warn
+#define tInfo T_LOG_IF(Tf::InfoLevel, Tf::isLogEnabled(Tf::InfoLevel)) TDebug(Tf::InfoLevel).info
+#define tDebug T_LOG_IF(Tf::DebugLevel, Tf::isLogEnabled(Tf::DebugLevel)) TDebug(Tf::DebugLevel).debug
+#define tTrace T_LOG_IF(Tf::TraceLevel, Tf::isLogEnabled(Tf::TraceLevel)) TDebug(Tf::TraceLevel).trace
 
 
 #include "tfexception.h"
@@ -248,6 +268,7 @@ T_CORE_EXPORT TAppSettings *appSettings() noexcept;
 T_CORE_EXPORT const QVariantMap &conf(const QString &configName) noexcept;
 T_CORE_EXPORT void msleep(unsigned long msecs) noexcept;
 T_CORE_EXPORT qint64 getMSecsSinceEpoch();
+T_CORE_EXPORT qint64 getMonotonicNSecs() noexcept;
 
 // Xorshift random number generator
 T_CORE_EXPORT void srandXor128(quint32 seed) noexcept;  // obsolete
@@ -264,6 +285,7 @@ T_CORE_EXPORT TActionContext *currentContext();
 T_CORE_EXPORT TDatabaseContext *currentDatabaseContext();
 T_CORE_EXPORT QSqlDatabase &currentSqlDatabase(int id) noexcept;
 T_CORE_EXPORT QMap<QByteArray, std::function<QObject *()>> *objectFactories() noexcept;
+T_CORE_EXPORT QMap<QByteArray, const QMetaObject *> *objectMetaObjects() noexcept;
 
 // LZ4 lossless compression algorithm
 T_CORE_EXPORT QByteArray lz4Compress(const char *data, int nbytes, int compressionLevel = 1) noexcept;
@@ -0,0 +1,136 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "thistogram.h"
+#include <QtAlgorithms>
+#include <limits>
+
+/*!
+  \class THistogram
+  \brief The THistogram class records non-negative values, such as
+  latencies in nanoseconds, into log-linear buckets without locking.
+
+  Values below 8 are counted exactly; above that, each power of 2 is
+  divided into 8 buckets, so a percentile is accurate to within 12.5%.
+*/
+
+namespace {
+constexpr int SUB_BUCKET_COUNT = 1 << THistogram::SubBucketBits;
+}
+
+
+THistogram::THistogram()
+{
+    reset();
+}
+
+/*!
+  Records the \a value; negative values are ignored.
+*/
+void THistogram::record(qint64 value)
+{
+    if (value < 0) {
+        return;
+    }
+
+    _buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(value, std::memory_order_relaxed);
+
+    qint64 cur = _max.load(std::memory_order_relaxed);
+    while (value > cur && !_max.compare_exchange_weak(cur, value, std::memory_order_relaxed)) { }
+}
+
+/*!
+  Returns the number of recorded values.
+*/
+quint64 THistogram::count() const
+{
+    quint64 total = 0;
+    for (auto &bucket : _buckets) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/*!
+  Returns the value at the \a percent percentile (0-100), as the upper
+  bound of the bucket containing it. Returns 0 if nothing is recorded.
+*/
+qint64 THistogram::percentile(double percent) const
+{
+    const QVector<quint64> counts = bucketCounts();
+    quint64 total = 0;
+    for (auto c : counts) {
+        total += c;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    quint64 rank = qMax((quint64)(qBound(0.0, percent, 100.0) / 100.0 * total + 0.5), (quint64)1);
+    quint64 accum = 0;
+    for (int i = 0; i < counts.count(); ++i) {
+        accum += counts[i];
+        if (accum >= rank) {
+            return qMin(bucketUpperBound(i), max());
+        }
+    }
+    return max();
+}
+
+/*!
+  Returns a snapshot of the counts of all the buckets.
+*/
+QVector<quint64> THistogram::bucketCounts() const
+{
+    QVector<quint64> counts(BucketCount);
+    for (int i = 0; i < BucketCount; ++i) {
+        counts[i] = _buckets[i].load(std::memory_order_relaxed);
+    }
+    return counts;
+}
+
+
+void THistogram::reset()
+{
+    for (auto &bucket : _buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    _sum.store(0, std::memory_order_relaxed);
+    _max.store(0, std::memory_order_relaxed);
+}
+
+/*!
+  Returns the index of the bucket for the \a value.
+*/
+int THistogram::bucketIndex(qint64 value)
+{
+    if (value < SUB_BUCKET_COUNT) {
+        return qMax(value, (qint64)0);
+    }
+
+    int msb = 63 - qCountLeadingZeroBits((quint64)value);
+    int sub = (value >> (msb - SubBucketBits)) & (SUB_BUCKET_COUNT - 1);
+    return ((msb - SubBucketBits + 1) << SubBucketBits) + sub;
+}
+
+/*!
+  Returns the smallest value which falls into the bucket \a index.
+*/
+qint64 THistogram::bucketLowerBound(int index)
+{
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    if (index >= BucketCount) {
+        return std::numeric_limits<qint64>::max();
+    }
+
+    int msb = (index >> SubBucketBits) + SubBucketBits - 1;
+    int sub = index & (SUB_BUCKET_COUNT - 1);
+    return (qint64)(SUB_BUCKET_COUNT + sub) << (msb - SubBucketBits);
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <QVector>
+#include <TGlobal>
+#include <atomic>
+
+
+class T_CORE_EXPORT THistogram {
+public:
+    THistogram();
+
+    void record(qint64 value);
+    quint64 count() const;
+    qint64 sum() const { return _sum.load(std::memory_order_relaxed); }
+    qint64 max() const { return _max.load(std::memory_order_relaxed); }
+    qint64 percentile(double percent) const;
+    QVector<quint64> bucketCounts() const;
+    void reset();
+
+    static int bucketIndex(qint64 value);
+    static qint64 bucketLowerBound(int index);
+    static qint64 bucketUpperBound(int index) { return bucketLowerBound(index + 1) - 1; }
+
+    enum {
+        SubBucketBits = 3,  // 8 buckets per power of 2; error within 12.5%
+        BucketCount = (64 - SubBucketBits) << SubBucketBits,
+    };
+
+private:
+    std::atomic<quint64> _buckets[BucketCount];
+    std::atomic<qint64> _sum {0};
+    std::atomic<qint64> _max {0};
+
+    T_DISABLE_COPY(THistogram)
+    T_DISABLE_MOVE(THistogram)
+};
+
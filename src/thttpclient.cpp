@@ -11,6 +11,7 @@
 #include <QNetworkReply>
 #include <QNetworkRequest>
 #include <QThread>
+#include <TTracer>
 
 /*!
   \class THttpClient
@@ -38,6 +39,35 @@ bool waitForReadyRead(QNetworkReply *reply, int msecs)
 
     return reply->isFinished();
 }
+
+
+// Propagates the trace context to the server
+QNetworkRequest tracedRequest(const QNetworkRequest &request, TTraceSpan &span)
+{
+    QByteArray traceparent = span.traceparent();
+    if (traceparent.isEmpty()) {
+        return request;
+    }
+
+    QNetworkRequest req(request);
+    req.setRawHeader(QByteArrayLiteral("traceparent"), traceparent);
+    QByteArray tracestate = TTracer::currentTracestate();
+    if (!tracestate.isEmpty()) {
+        req.setRawHeader(QByteArrayLiteral("tracestate"), tracestate);
+    }
+    span.setAttribute("http.url", req.url().toString(QUrl::RemoveUserInfo));
+    return req;
+}
+
+
+void finishSpan(TTraceSpan &span, QNetworkReply *reply)
+{
+    if (span.isRecording()) {
+        int status = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        span.setAttribute("http.status_code", status);
+        span.setError(reply->error() != QNetworkReply::NoError || status >= 500);
+    }
+}
 }
 
 
@@ -67,11 +97,13 @@ QNetworkReply *THttpClient::get(const QUrl &url, int msecs)
  */
 QNetworkReply *THttpClient::get(const QNetworkRequest &request, int msecs)
 {
-    QNetworkReply *reply = _manager->get(request);
+    TTraceSpan span("HTTP GET", TTracer::Client);
+    QNetworkReply *reply = _manager->get(tracedRequest(request, span));
 
     if (!waitForReadyRead(reply, msecs)) {
         reply->readAll();  // clear data
     }
+    finishSpan(span, reply);
     return reply;
 }
 
@@ -92,11 +124,13 @@ QNetworkReply *THttpClient::post(const QUrl &url, const QJsonDocument &json, int
  */
 QNetworkReply *THttpClient::post(const QNetworkRequest &request, const QByteArray &data, int msecs)
 {
-    QNetworkReply *reply = _manager->post(request, data);
+    TTraceSpan span("HTTP POST", TTracer::Client);
+    QNetworkReply *reply = _manager->post(tracedRequest(request, span), data);
 
     if (!waitForReadyRead(reply, msecs)) {
         reply->readAll();  // clear data
     }
+    finishSpan(span, reply);
     return reply;
 }
 
@@ -117,11 +151,13 @@ QNetworkReply *THttpClient::put(const QUrl &url, const QJsonDocument &json, int
  */
 QNetworkReply *THttpClient::put(const QNetworkRequest &request, const QByteArray &data, int msecs)
 {
-    QNetworkReply *reply = _manager->put(request, data);
+    TTraceSpan span("HTTP PUT", TTracer::Client);
+    QNetworkReply *reply = _manager->put(tracedRequest(request, span), data);
 
     if (!waitForReadyRead(reply, msecs)) {
         reply->readAll();  // clear data
     }
+    finishSpan(span, reply);
     return reply;
 }
 
@@ -138,10 +174,12 @@ QNetworkReply *THttpClient::deleteResource(const QUrl &url, int msecs)
  */
 QNetworkReply *THttpClient::deleteResource(const QNetworkRequest &request, int msecs)
 {
-    QNetworkReply *reply = _manager->deleteResource(request);
+    TTraceSpan span("HTTP DELETE", TTracer::Client);
+    QNetworkReply *reply = _manager->deleteResource(tracedRequest(request, span));
 
     if (!waitForReadyRead(reply, msecs)) {
         reply->readAll();  // clear data
     }
+    finishSpan(span, reply);
     return reply;
 }
@@ -0,0 +1,500 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "thttpcompressor.h"
+#include <QtAlgorithms>
+#if defined(Q_OS_WIN)
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+#ifdef TF_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+#ifdef TF_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+/*!
+  \class THttpCompressor
+  \brief The THttpCompressor class compresses an HTTP message body with
+  a content coding, i.e. gzip, deflate, br or zstd.
+
+  The data can be given in pieces; each call of compress() appends the
+  compressed bytes that are ready to \a output, and finish() appends the
+  rest. 'br' and 'zstd' are available only if TreeFrog is built with the
+  Brotli or Zstandard library.
+*/
+
+namespace {
+constexpr int OUTPUT_CHUNK_SIZE = 16 * 1024;
+constexpr int MAX_POOLED_COMPRESSORS = 8;
+constexpr int DEFAULT_BROTLI_QUALITY = 5;  // 11 is too slow for dynamic content
+constexpr int DEFAULT_ZSTD_LEVEL = 3;
+
+const struct {
+    const char *name;
+    THttpCompressor::Encoding encoding;
+} EncodingNames[] = {
+    {"identity", THttpCompressor::Identity},
+    {"gzip", THttpCompressor::Gzip},
+    {"x-gzip", THttpCompressor::Gzip},
+    {"deflate", THttpCompressor::Deflate},
+    {"br", THttpCompressor::Brotli},
+    {"zstd", THttpCompressor::Zstd},
+};
+
+int encodingFromName(const char *name, int length)
+{
+    for (auto &en : EncodingNames) {
+        if ((int)qstrlen(en.name) == length && qstrnicmp(en.name, name, length) == 0) {
+            return en.encoding;
+        }
+    }
+    return -1;
+}
+
+// Parses a qvalue into thousandths
+int parseQValue(const char *&p, const char *end)
+{
+    int value = 0;
+    if (p < end && *p >= '0' && *p <= '9') {
+        value = (*p++ - '0') * 1000;
+        if (p < end && *p == '.') {
+            int scale = 100;
+            for (++p; p < end && *p >= '0' && *p <= '9'; ++p) {
+                value += (*p - '0') * scale;
+                scale /= 10;
+            }
+        }
+    }
+    return qMin(value, 1000);
+}
+
+inline bool isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+struct CompressorPool {
+    QList<THttpCompressor *> compressors;
+    ~CompressorPool() { qDeleteAll(compressors); }
+};
+
+thread_local CompressorPool compressorPool;
+}
+
+/*!
+  Constructs a compressor for the content coding \a encoding with the
+  compression level \a level; -1 means the default of the coding.
+*/
+THttpCompressor::THttpCompressor(Encoding encoding, int level) :
+    _encoding(encoding),
+    _level(level)
+{
+    init();
+}
+
+
+THttpCompressor::~THttpCompressor()
+{
+    destroy();
+}
+
+
+bool THttpCompressor::init()
+{
+    switch (_encoding) {
+    case Gzip:
+    case Deflate: {
+        auto *zs = new z_stream;
+        zs->zalloc = Z_NULL;
+        zs->zfree = Z_NULL;
+        zs->opaque = Z_NULL;
+        int level = (_level < 0) ? Z_DEFAULT_COMPRESSION : qMin(_level, 9);
+        int windowBits = (_encoding == Gzip) ? 15 + 16 : 15;  // gzip or zlib format
+        if (deflateInit2(zs, level, Z_DEFLATED, windowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            delete zs;
+            return false;
+        }
+        _stream = zs;
+        break;
+    }
+
+#ifdef TF_HAVE_BROTLI
+    case Brotli: {
+        auto *state = BrotliEncoderCreateInstance(nullptr, nullptr, nullptr);
+        if (!state) {
+            return false;
+        }
+        int quality = (_level < 0) ? DEFAULT_BROTLI_QUALITY : qMin(_level, BROTLI_MAX_QUALITY);
+        BrotliEncoderSetParameter(state, BROTLI_PARAM_QUALITY, quality);
+        _stream = state;
+        break;
+    }
+#endif
+
+#ifdef TF_HAVE_ZSTD
+    case Zstd: {
+        auto *cctx = ZSTD_createCCtx();
+        if (!cctx) {
+            return false;
+        }
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, (_level < 0) ? DEFAULT_ZSTD_LEVEL : _level);
+        _stream = cctx;
+        break;
+    }
+#endif
+
+    default:
+        return false;
+    }
+    return true;
+}
+
+
+void THttpCompressor::destroy()
+{
+    if (!_stream) {
+        return;
+    }
+
+    switch (_encoding) {
+    case Gzip:
+    case Deflate:
+        deflateEnd((z_stream *)_stream);
+        delete (z_stream *)_stream;
+        break;
+#ifdef TF_HAVE_BROTLI
+    case Brotli:
+        BrotliEncoderDestroyInstance((BrotliEncoderState *)_stream);
+        break;
+#endif
+#ifdef TF_HAVE_ZSTD
+    case Zstd:
+        ZSTD_freeCCtx((ZSTD_CCtx *)_stream);
+        break;
+#endif
+    default:
+        break;
+    }
+    _stream = nullptr;
+}
+
+/*!
+  Compresses the \a length bytes of \a data, appending the compressed
+  bytes ready so far to \a output. Returns false if an error occurred.
+*/
+bool THttpCompressor::compress(const char *data, int length, QByteArray &output)
+{
+    return (length > 0) ? process(data, length, output, false) : isValid();
+}
+
+/*!
+  Ends the stream, appending the rest of the compressed bytes to \a output.
+  Call reset() to compress another stream.
+*/
+bool THttpCompressor::finish(QByteArray &output)
+{
+    return process(nullptr, 0, output, true);
+}
+
+/*!
+  Resets the compressor to begin a new stream, keeping its buffers.
+*/
+bool THttpCompressor::reset()
+{
+    switch (_encoding) {
+    case Gzip:
+    case Deflate:
+        return _stream && deflateReset((z_stream *)_stream) == Z_OK;
+#ifdef TF_HAVE_ZSTD
+    case Zstd:
+        return _stream && !ZSTD_isError(ZSTD_CCtx_reset((ZSTD_CCtx *)_stream, ZSTD_reset_session_only));
+#endif
+    default:
+        // No way to reset the state
+        destroy();
+        return init();
+    }
+}
+
+
+bool THttpCompressor::process(const char *data, int length, QByteArray &output, bool end)
+{
+    if (Q_UNLIKELY(!_stream)) {
+        return false;
+    }
+
+    int chunkSize = qMax(OUTPUT_CHUNK_SIZE, length / 2);
+
+    switch (_encoding) {
+    case Gzip:
+    case Deflate: {
+        auto *zs = (z_stream *)_stream;
+        zs->next_in = (Bytef *)data;
+        zs->avail_in = length;
+
+        for (;;) {
+            int offset = output.size();
+            output.resize(offset + chunkSize);
+            zs->next_out = (Bytef *)output.data() + offset;
+            zs->avail_out = chunkSize;
+            int res = deflate(zs, (end) ? Z_FINISH : Z_NO_FLUSH);
+            output.resize(offset + chunkSize - zs->avail_out);
+
+            if (res == Z_STREAM_ERROR) {
+                return false;
+            }
+            if ((end) ? res == Z_STREAM_END : zs->avail_out > 0) {
+                break;
+            }
+        }
+        return true;
+    }
+
+#ifdef TF_HAVE_BROTLI
+    case Brotli: {
+        auto *state = (BrotliEncoderState *)_stream;
+        size_t availIn = length;
+        auto *nextIn = (const uint8_t *)data;
+
+        do {
+            int offset = output.size();
+            output.resize(offset + chunkSize);
+            size_t availOut = chunkSize;
+            auto *nextOut = (uint8_t *)output.data() + offset;
+            bool ok = BrotliEncoderCompressStream(state, (end) ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS,
+                &availIn, &nextIn, &availOut, &nextOut, nullptr);
+            output.resize(offset + chunkSize - (int)availOut);
+
+            if (!ok) {
+                return false;
+            }
+        } while (availIn > 0 || BrotliEncoderHasMoreOutput(state) || (end && !BrotliEncoderIsFinished(state)));
+        return true;
+    }
+#endif
+
+#ifdef TF_HAVE_ZSTD
+    case Zstd: {
+        auto *cctx = (ZSTD_CCtx *)_stream;
+        ZSTD_inBuffer in = {data, (size_t)length, 0};
+
+        for (;;) {
+            int offset = output.size();
+            output.resize(offset + chunkSize);
+            ZSTD_outBuffer out = {output.data() + offset, (size_t)chunkSize, 0};
+            size_t remaining = ZSTD_compressStream2(cctx, &out, &in, (end) ? ZSTD_e_end : ZSTD_e_continue);
+            output.resize(offset + (int)out.pos);
+
+            if (ZSTD_isError(remaining)) {
+                return false;
+            }
+            if ((end) ? remaining == 0 : in.pos == in.size) {
+                break;
+            }
+        }
+        return true;
+    }
+#endif
+
+    default:
+        return false;
+    }
+}
+
+/*!
+  Compresses the \a length bytes of \a data with the content coding
+  \a encoding, using a compressor of the pool of the current thread.
+  Returns an empty byte array if an error occurred.
+*/
+QByteArray THttpCompressor::compress(Encoding encoding, const char *data, int length, int level)
+{
+    QByteArray output;
+    THttpCompressor *compressor = acquire(encoding, level);
+    if (compressor) {
+        output.reserve(qMax(length / 3, 64));
+        if (!compressor->compress(data, length, output) || !compressor->finish(output)) {
+            output.clear();
+        }
+        release(compressor);
+    }
+    return output;
+}
+
+/*!
+  Takes a compressor from the pool of the current thread, or creates one.
+  Returns nullptr if the coding \a encoding is not supported. Give it back
+  by release() after use.
+*/
+THttpCompressor *THttpCompressor::acquire(Encoding encoding, int level)
+{
+    auto &pool = compressorPool.compressors;
+    for (int i = 0; i < pool.count(); ++i) {
+        if (pool[i]->encoding() == encoding && pool[i]->level() == level) {
+            return pool.takeAt(i);
+        }
+    }
+
+    auto *compressor = new THttpCompressor(encoding, level);
+    if (!compressor->isValid()) {
+        delete compressor;
+        compressor = nullptr;
+    }
+    return compressor;
+}
+
+/*!
+  Resets the compressor \a compressor and puts it into the pool of the
+  current thread, which may differ from the thread that acquired it.
+*/
+void THttpCompressor::release(THttpCompressor *compressor)
+{
+    if (!compressor) {
+        return;
+    }
+
+    auto &pool = compressorPool.compressors;
+    if (pool.count() < MAX_POOLED_COMPRESSORS && compressor->reset()) {
+        pool.append(compressor);
+    } else {
+        delete compressor;
+    }
+}
+
+/*!
+  Returns the content coding to be applied according to the value of an
+  Accept-Encoding header \a acceptEncoding. The codings in \a available are
+  given in the order of the server's preference, which decides between
+  codings of the same qvalue. Returns Identity if none is acceptable.
+*/
+THttpCompressor::Encoding THttpCompressor::negotiate(const QByteArray &acceptEncoding, const QList<Encoding> &available)
+{
+    int qvalues[Zstd + 1] = {-1, -1, -1, -1, -1};  // -1 means not listed
+    int wildcard = -1;
+
+    const char *p = acceptEncoding.constData();
+    const char *end = p + acceptEncoding.length();
+    while (p < end) {
+        while (p < end && (isSpace(*p) || *p == ',')) {
+            ++p;
+        }
+        const char *name = p;
+        while (p < end && !isSpace(*p) && *p != ',' && *p != ';') {
+            ++p;
+        }
+        int nameLength = p - name;
+        int q = 1000;
+
+        // Parameters
+        while (p < end && *p != ',') {
+            if (*p++ != ';') {
+                continue;
+            }
+            while (p < end && isSpace(*p)) {
+                ++p;
+            }
+            if (p + 1 < end && (*p == 'q' || *p == 'Q') && p[1] == '=') {
+                p += 2;
+                q = parseQValue(p, end);
+            }
+        }
+
+        if (nameLength == 1 && *name == '*') {
+            wildcard = q;
+        } else if (nameLength > 0) {
+            int encoding = encodingFromName(name, nameLength);
+            if (encoding >= 0) {
+                qvalues[encoding] = q;
+            }
+        }
+    }
+
+    Encoding best = Identity;
+    int bestQ = 0;
+    for (auto encoding : available) {
+        int q = (qvalues[encoding] >= 0) ? qvalues[encoding] : wildcard;
+        if (q > bestQ && isSupported(encoding)) {
+            best = encoding;
+            bestQ = q;
+        }
+    }
+    return best;
+}
+
+/*!
+  Returns the content coding named \a name, such as 'gzip' or 'br', or
+  Identity if unknown.
+*/
+THttpCompressor::Encoding THttpCompressor::fromName(const QByteArray &name)
+{
+    QByteArray n = name.trimmed();
+    int encoding = encodingFromName(n.constData(), n.length());
+    return (encoding >= 0) ? (Encoding)encoding : Identity;
+}
+
+/*!
+  Returns the name of the content coding \a encoding for the
+  Content-Encoding header.
+*/
+QByteArray THttpCompressor::name(Encoding encoding)
+{
+    switch (encoding) {
+    case Gzip:
+        return QByteArrayLiteral("gzip");
+    case Deflate:
+        return QByteArrayLiteral("deflate");
+    case Brotli:
+        return QByteArrayLiteral("br");
+    case Zstd:
+        return QByteArrayLiteral("zstd");
+    default:
+        return QByteArrayLiteral("identity");
+    }
+}
+
+/*!
+  Returns the suffix of a file pre-compressed with the content coding
+  \a encoding, e.g. '.gz'; an empty byte array for deflate and identity.
+*/
+QByteArray THttpCompressor::fileSuffix(Encoding encoding)
+{
+    switch (encoding) {
+    case Gzip:
+        return QByteArrayLiteral(".gz");
+    case Brotli:
+        return QByteArrayLiteral(".br");
+    case Zstd:
+        return QByteArrayLiteral(".zst");
+    default:
+        return QByteArray();
+    }
+}
+
+/*!
+  Returns true if the content coding \a encoding is supported by this
+  build.
+*/
+bool THttpCompressor::isSupported(Encoding encoding)
+{
+    switch (encoding) {
+    case Gzip:
+    case Deflate:
+        return true;
+#ifdef TF_HAVE_BROTLI
+    case Brotli:
+        return true;
+#endif
+#ifdef TF_HAVE_ZSTD
+    case Zstd:
+        return true;
+#endif
+    default:
+        return false;
+    }
+}
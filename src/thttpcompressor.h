@@ -0,0 +1,47 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <TGlobal>
+
+
+class T_CORE_EXPORT THttpCompressor {
+public:
+    enum Encoding {
+        Identity = 0,
+        Gzip,
+        Deflate,
+        Brotli,
+        Zstd,
+    };
+
+    THttpCompressor(Encoding encoding, int level = -1);
+    ~THttpCompressor();
+
+    Encoding encoding() const { return _encoding; }
+    int level() const { return _level; }
+    bool isValid() const { return _stream != nullptr; }
+    bool compress(const char *data, int length, QByteArray &output);
+    bool finish(QByteArray &output);
+    bool reset();
+
+    static QByteArray compress(Encoding encoding, const char *data, int length, int level = -1);
+    static THttpCompressor *acquire(Encoding encoding, int level = -1);
+    static void release(THttpCompressor *compressor);
+    static Encoding negotiate(const QByteArray &acceptEncoding, const QList<Encoding> &available);
+    static Encoding fromName(const QByteArray &name);
+    static QByteArray name(Encoding encoding);
+    static QByteArray fileSuffix(Encoding encoding);
+    static bool isSupported(Encoding encoding);
+
+private:
+    bool init();
+    void destroy();
+    bool process(const char *data, int length, QByteArray &output, bool end);
+
+    Encoding _encoding {Identity};
+    int _level {-1};
+    void *_stream {nullptr};  // z_stream, BrotliEncoderState or ZSTD_CCtx
+
+    T_DISABLE_COPY(THttpCompressor)
+    T_DISABLE_MOVE(THttpCompressor)
+};
@@ -101,13 +101,18 @@ qint64 THttpSocket::write(const THttpHeader *header, QIODevice *body)
             }
             total += buffer->size();
         } else {
+            // Sends Content-Length bytes from the current position
             QByteArray buf(WRITE_BUFFER_LENGTH, 0);
+            qint64 remaining = (header->hasRawHeader(QByteArrayLiteral("Content-Length"))) ? header->contentLength() : -1;
             qint64 readLen = 0;
-            while ((readLen = body->read(buf.data(), buf.size())) > 0) {
+            while (remaining != 0 && (readLen = body->read(buf.data(), (remaining > 0) ? qMin(remaining, (qint64)buf.size()) : buf.size())) > 0) {
                 if (writeRawData(buf.data(), readLen) != readLen) {
                     return -1;
                 }
                 total += readLen;
+                if (remaining > 0) {
+                    remaining -= readLen;
+                }
             }
         }
     }
@@ -206,6 +211,9 @@ bool THttpSocket::waitForReadyReadRequest(int msecs)
     int len = readRawData(_readBuffer.data() + _readBuffer.size(), buflen, msecs);
 
     if (len > 0) {
+        if (_firstByteTicks == 0) {
+            _firstByteTicks = Tf::getMonotonicNSecs();
+        }
         _readBuffer.resize(_readBuffer.size() + len);
 
         if (_lengthToRead > 0) {
@@ -259,10 +267,27 @@ bool THttpSocket::waitForReadyReadRequest(int msecs)
         } else {
             // do nothing
         }
+
+        if (canReadRequest()) {
+            _receivedTicks = Tf::getMonotonicNSecs();
+        }
     }
     return canReadRequest();
 }
 
+/*!
+  Returns the monotonic times when this connection was \a accepted,
+  the \a firstByte of the request arrived and the request was
+  \a received entirely, and resets them for the next request.
+*/
+void THttpSocket::takeRequestTicks(qint64 &accepted, qint64 &firstByte, qint64 &received)
+{
+    accepted = _acceptedTicks;
+    firstByte = _firstByteTicks;
+    received = _receivedTicks;
+    _acceptedTicks = _firstByteTicks = _receivedTicks = 0;
+}
+
 
 void THttpSocket::setSocketDescriptor(int socketDescriptor, QAbstractSocket::SocketState socketState)
 {
@@ -270,6 +295,7 @@ void THttpSocket::setSocketDescriptor(int socketDescriptor, QAbstractSocket::Soc
     _state = socketState;
 
     if (_socket > 0) {
+        _acceptedTicks = Tf::getMonotonicNSecs();
         auto peerInfo = TApplicationServerBase::getPeerInfo(_socket);
         _peerAddr = peerInfo.first;
         _peerPort = peerInfo.second;
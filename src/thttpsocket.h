@@ -17,6 +17,7 @@ public:
     QList<THttpRequest> read();
     bool waitForReadyReadRequest(int msecs = 5000);
     bool canReadRequest() const;
+    void takeRequestTicks(qint64 &accepted, qint64 &firstByte, qint64 &received);
     qint64 write(const THttpHeader *header, QIODevice *body);
     int idleTime() const;
     int socketId() const { return _sid; }
@@ -56,6 +57,9 @@ private:
     QByteArray _headerBuffer;
     TTemporaryFile _fileBuffer;
     quint64 _idleElapsed {0};
+    qint64 _acceptedTicks {0};
+    qint64 _firstByteTicks {0};
+    qint64 _receivedTicks {0};
 
     friend class TActionThread;
 };
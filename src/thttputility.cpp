@@ -11,11 +11,20 @@
 #include <QMap>
 #include <QTextCodec>
 #include <QUrl>
+#include <QtAlgorithms>
+#include <type_traits>
 #if defined(Q_OS_WIN)
 #include <qt_windows.h>
 #else
 #include <ctime>
 #endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define TF_ESCAPE_SSE2
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
 
 constexpr auto HTTP_DATE_TIME_FORMAT = "ddd, d MMM yyyy hh:mm:ss";
 
@@ -122,6 +131,382 @@ QList<QPair<QString, QString>> THttpUtility::fromFormUrlEncoded(const QByteArray
     return items;
 }
 
+namespace {
+
+/*
+  Escaping kernels: find the next character to escape 32 (AVX2) or 16
+  (SSE2) bytes at a time and copy the clean run before it in bulk. The
+  AVX2 path is compiled in when the compiler targets it, e.g. -mavx2.
+*/
+
+// Quote characters to escape; '&' stands for 'none' as it is always escaped
+struct EscapeSet {
+    char dquot;
+    char squot;
+};
+
+inline EscapeSet htmlEscapeSet(Tf::EscapeFlag flag)
+{
+    char dquot = (flag == Tf::Compatible || flag == Tf::Quotes) ? '"' : '&';
+    char squot = (flag == Tf::Quotes) ? '\'' : '&';
+    return EscapeSet {dquot, squot};
+}
+
+constexpr EscapeSet JsonEscapeSet {'&', '&'};
+
+inline bool needsEscape(uint c, const EscapeSet &set)
+{
+    return c == '&' || c == '<' || c == '>' || c == (uint)set.dquot || c == (uint)set.squot;
+}
+
+inline QLatin1String htmlEntity(uint c)
+{
+    switch (c) {
+    case '&':
+        return QLatin1String("&amp;");
+    case '<':
+        return QLatin1String("&lt;");
+    case '>':
+        return QLatin1String("&gt;");
+    case '"':
+        return QLatin1String("&quot;");
+    default:
+        return QLatin1String("&#039;");
+    }
+}
+
+inline QLatin1String jsonEntity(uint c)
+{
+    switch (c) {
+    case '&':
+        return QLatin1String("\\u0026");
+    case '<':
+        return QLatin1String("\\u003C");
+    default:
+        return QLatin1String("\\u003E");
+    }
+}
+
+// Returns the first UTF-8 byte to escape in [p, end), or end
+const char *findEscape(const char *p, const char *end, const EscapeSet &set)
+{
+#if defined(__AVX2__)
+    const __m256i amp256 = _mm256_set1_epi8('&');
+    const __m256i lt256 = _mm256_set1_epi8('<');
+    const __m256i gt256 = _mm256_set1_epi8('>');
+    const __m256i dq256 = _mm256_set1_epi8(set.dquot);
+    const __m256i sq256 = _mm256_set1_epi8(set.squot);
+
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, amp256), _mm256_cmpeq_epi8(v, lt256));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, gt256));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, dq256));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, sq256));
+        uint mask = (uint)_mm256_movemask_epi8(m);
+        if (mask) {
+            return p + qCountTrailingZeroBits(mask);
+        }
+    }
+#endif
+#if defined(TF_ESCAPE_SSE2)
+    const __m128i amp = _mm_set1_epi8('&');
+    const __m128i lt = _mm_set1_epi8('<');
+    const __m128i gt = _mm_set1_epi8('>');
+    const __m128i dq = _mm_set1_epi8(set.dquot);
+    const __m128i sq = _mm_set1_epi8(set.squot);
+
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(v, lt));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, gt));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, dq));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(v, sq));
+        uint mask = (uint)_mm_movemask_epi8(m);
+        if (mask) {
+            return p + qCountTrailingZeroBits(mask);
+        }
+    }
+#endif
+    for (; p < end; ++p) {
+        if (needsEscape((uchar)*p, set)) {
+            break;
+        }
+    }
+    return p;
+}
+
+// Returns the first UTF-16 unit to escape in [p, end), or end
+const ushort *findEscape(const ushort *p, const ushort *end, const EscapeSet &set)
+{
+#if defined(__AVX2__)
+    const __m256i amp256 = _mm256_set1_epi16('&');
+    const __m256i lt256 = _mm256_set1_epi16('<');
+    const __m256i gt256 = _mm256_set1_epi16('>');
+    const __m256i dq256 = _mm256_set1_epi16(set.dquot);
+    const __m256i sq256 = _mm256_set1_epi16(set.squot);
+
+    for (; end - p >= 16; p += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi16(v, amp256), _mm256_cmpeq_epi16(v, lt256));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi16(v, gt256));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi16(v, dq256));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi16(v, sq256));
+        uint mask = (uint)_mm256_movemask_epi8(m);
+        if (mask) {
+            return p + qCountTrailingZeroBits(mask) / 2;  // 2 bits per unit
+        }
+    }
+#endif
+#if defined(TF_ESCAPE_SSE2)
+    const __m128i amp = _mm_set1_epi16('&');
+    const __m128i lt = _mm_set1_epi16('<');
+    const __m128i gt = _mm_set1_epi16('>');
+    const __m128i dq = _mm_set1_epi16(set.dquot);
+    const __m128i sq = _mm_set1_epi16(set.squot);
+
+    for (; end - p >= 8; p += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi16(v, amp), _mm_cmpeq_epi16(v, lt));
+        m = _mm_or_si128(m, _mm_cmpeq_epi16(v, gt));
+        m = _mm_or_si128(m, _mm_cmpeq_epi16(v, dq));
+        m = _mm_or_si128(m, _mm_cmpeq_epi16(v, sq));
+        uint mask = (uint)_mm_movemask_epi8(m);
+        if (mask) {
+            return p + qCountTrailingZeroBits(mask) / 2;
+        }
+    }
+#endif
+    for (; p < end; ++p) {
+        if (needsEscape(*p, set)) {
+            break;
+        }
+    }
+    return p;
+}
+
+inline void appendRun(QString &dest, const ushort *p, const ushort *end)
+{
+    dest.append(reinterpret_cast<const QChar *>(p), end - p);
+}
+
+inline void appendRun(QByteArray &dest, const char *p, const char *end)
+{
+    dest.append(p, end - p);
+}
+
+// Encodes the UTF-16 units in UTF-8
+void appendRun(QByteArray &dest, const ushort *p, const ushort *end)
+{
+    const int pos = dest.size();
+    dest.resize(pos + (end - p) * 3);  // at most 3 bytes per unit
+    uchar *dst = reinterpret_cast<uchar *>(dest.data()) + pos;
+
+    while (p < end) {
+#if defined(TF_ESCAPE_SSE2)
+        // Packs 8 ASCII units at a time
+        const __m128i nonAscii = _mm_set1_epi16((short)0xFF80);
+        while (end - p >= 8) {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, nonAscii), _mm_setzero_si128())) != 0xFFFF) {
+                break;
+            }
+            _mm_storel_epi64(reinterpret_cast<__m128i *>(dst), _mm_packus_epi16(v, v));
+            dst += 8;
+            p += 8;
+        }
+        if (p == end) {
+            break;
+        }
+#endif
+        uint c = *p++;
+        if (c < 0x80) {
+            *dst++ = (uchar)c;
+        } else if (c < 0x800) {
+            *dst++ = 0xC0 | (c >> 6);
+            *dst++ = 0x80 | (c & 0x3F);
+        } else if (QChar::isHighSurrogate(c) && p < end && QChar::isLowSurrogate(*p)) {
+            c = QChar::surrogateToUcs4(c, *p++);
+            *dst++ = 0xF0 | (c >> 18);
+            *dst++ = 0x80 | ((c >> 12) & 0x3F);
+            *dst++ = 0x80 | ((c >> 6) & 0x3F);
+            *dst++ = 0x80 | (c & 0x3F);
+        } else if (QChar::isSurrogate(c)) {
+            *dst++ = '?';  // as QString::toUtf8() does
+        } else {
+            *dst++ = 0xE0 | (c >> 12);
+            *dst++ = 0x80 | ((c >> 6) & 0x3F);
+            *dst++ = 0x80 | (c & 0x3F);
+        }
+    }
+    dest.resize(reinterpret_cast<char *>(dst) - dest.data());
+}
+
+inline void appendEntity(QString &dest, QLatin1String entity)
+{
+    dest.append(entity);
+}
+
+inline void appendEntity(QByteArray &dest, QLatin1String entity)
+{
+    dest.append(entity.data(), entity.size());
+}
+
+inline bool needsJsonStringEscape(uint c)
+{
+    return c < 0x20 || c == '"' || c == '\\';
+}
+
+// Returns the first UTF-8 byte to escape in a JSON string in [p, end), or end
+const char *findJsonStringEscape(const char *p, const char *end)
+{
+#if defined(__AVX2__)
+    const __m256i dq256 = _mm256_set1_epi8('"');
+    const __m256i bs256 = _mm256_set1_epi8('\\');
+    const __m256i ctl256 = _mm256_set1_epi8(0x1F);
+
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, dq256), _mm256_cmpeq_epi8(v, bs256));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl256), v));  // v <= 0x1F
+        uint mask = (uint)_mm256_movemask_epi8(m);
+        if (mask) {
+            return p + qCountTrailingZeroBits(mask);
+        }
+    }
+#endif
+#if defined(TF_ESCAPE_SSE2)
+    const __m128i dq = _mm_set1_epi8('"');
+    const __m128i bs = _mm_set1_epi8('\\');
+    const __m128i ctl = _mm_set1_epi8(0x1F);
+
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, dq), _mm_cmpeq_epi8(v, bs));
+        m = _mm_or_si128(m, _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v));
+        uint mask = (uint)_mm_movemask_epi8(m);
+        if (mask) {
+            return p + qCountTrailingZeroBits(mask);
+        }
+    }
+#endif
+    for (; p < end; ++p) {
+        if (needsJsonStringEscape((uchar)*p)) {
+            break;
+        }
+    }
+    return p;
+}
+
+// Returns the first UTF-16 unit to escape in a JSON string in [p, end), or end
+const ushort *findJsonStringEscape(const ushort *p, const ushort *end)
+{
+#if defined(__AVX2__)
+    const __m256i dq256 = _mm256_set1_epi16('"');
+    const __m256i bs256 = _mm256_set1_epi16('\\');
+    const __m256i ctl256 = _mm256_set1_epi16((short)0xFFE0);
+
+    for (; end - p >= 16; p += 16) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i m = _mm256_or_si256(_mm256_cmpeq_epi16(v, dq256), _mm256_cmpeq_epi16(v, bs256));
+        m = _mm256_or_si256(m, _mm256_cmpeq_epi16(_mm256_and_si256(v, ctl256), _mm256_setzero_si256()));  // v < 0x20
+        uint mask = (uint)_mm256_movemask_epi8(m);
+        if (mask) {
+            return p + qCountTrailingZeroBits(mask) / 2;  // 2 bits per unit
+        }
+    }
+#endif
+#if defined(TF_ESCAPE_SSE2)
+    const __m128i dq = _mm_set1_epi16('"');
+    const __m128i bs = _mm_set1_epi16('\\');
+    const __m128i ctl = _mm_set1_epi16((short)0xFFE0);
+
+    for (; end - p >= 8; p += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        __m128i m = _mm_or_si128(_mm_cmpeq_epi16(v, dq), _mm_cmpeq_epi16(v, bs));
+        m = _mm_or_si128(m, _mm_cmpeq_epi16(_mm_and_si128(v, ctl), _mm_setzero_si128()));
+        uint mask = (uint)_mm_movemask_epi8(m);
+        if (mask) {
+            return p + qCountTrailingZeroBits(mask) / 2;
+        }
+    }
+#endif
+    for (; p < end; ++p) {
+        if (needsJsonStringEscape(*p)) {
+            break;
+        }
+    }
+    return p;
+}
+
+// Escapes the character as QJsonDocument::toJson() does
+void appendJsonStringEntity(QByteArray &dest, uint c)
+{
+    static const char hexdig[] = "0123456789abcdef";
+
+    switch (c) {
+    case '"':
+        dest.append("\\\"", 2);
+        break;
+    case '\\':
+        dest.append("\\\\", 2);
+        break;
+    case '\b':
+        dest.append("\\b", 2);
+        break;
+    case '\f':
+        dest.append("\\f", 2);
+        break;
+    case '\n':
+        dest.append("\\n", 2);
+        break;
+    case '\r':
+        dest.append("\\r", 2);
+        break;
+    case '\t':
+        dest.append("\\t", 2);
+        break;
+    default: {
+        const char u[] = {'\\', 'u', '0', '0', hexdig[(c >> 4) & 0xF], hexdig[c & 0xF]};
+        dest.append(u, sizeof(u));
+        break;
+    }
+    }
+}
+
+template <typename Char>
+void appendJsonStringLiteral(QByteArray &dest, const Char *p, const Char *end)
+{
+    dest.append('"');
+    while (p < end) {
+        const Char *q = findJsonStringEscape(p, end);
+        appendRun(dest, p, q);
+        if (q == end) {
+            break;
+        }
+        appendJsonStringEntity(dest, (uint)(typename std::make_unsigned<Char>::type)*q);
+        p = q + 1;
+    }
+    dest.append('"');
+}
+
+template <typename Dest, typename Char>
+void appendEscaped(Dest &dest, const Char *p, const Char *end, const EscapeSet &set, QLatin1String (*entity)(uint))
+{
+    dest.reserve(dest.size() + (end - p) + (end - p) / 8);
+    while (p < end) {
+        const Char *q = findEscape(p, end, set);
+        appendRun(dest, p, q);
+        if (q == end) {
+            break;
+        }
+        appendEntity(dest, entity((uint)(typename std::make_unsigned<Char>::type)*q));
+        p = q + 1;
+    }
+}
+
+}
+
 /*!
   Returns a converted copy of \a input. All applicable characters in \a input
   are converted to HTML entities. The conversions performed are:
@@ -134,43 +519,32 @@ QList<QPair<QString, QString>> THttpUtility::fromFormUrlEncoded(const QByteArray
 */
 QString THttpUtility::htmlEscape(const QString &input, Tf::EscapeFlag flag)
 {
-    const QLatin1Char amp('&');
-    const QLatin1Char lt('<');
-    const QLatin1Char gt('>');
-    const QLatin1Char dquot('"');
-    const QLatin1Char squot('\'');
-    const QLatin1String eamp("&amp;");
-    const QLatin1String elt("&lt;");
-    const QLatin1String egt("&gt;");
-    const QString edquot("&quot;");
-    const QString esquot("&#039;");
+    const ushort *begin = input.utf16();
+    const ushort *end = begin + input.length();
+    const EscapeSet set = htmlEscapeSet(flag);
 
-    QString escaped;
-    escaped.reserve(int(input.length() * 1.1));
-    for (int i = 0; i < input.length(); ++i) {
-        if (input.at(i) == amp) {
-            escaped += eamp;
-        } else if (input.at(i) == lt) {
-            escaped += elt;
-        } else if (input.at(i) == gt) {
-            escaped += egt;
-        } else if (input.at(i) == dquot) {
-            escaped += (flag == Tf::Compatible || flag == Tf::Quotes) ? edquot : input.at(i);
-        } else if (input.at(i) == squot) {
-            escaped += (flag == Tf::Quotes) ? esquot : input.at(i);
-        } else {
-            escaped += input.at(i);
-        }
+    const ushort *p = findEscape(begin, end, set);
+    if (p == end) {
+        return input;  // shares the data
     }
+
+    QString escaped;
+    escaped.reserve(input.length() + input.length() / 8);
+    appendRun(escaped, begin, p);
+    appendEscaped(escaped, p, end, set, htmlEntity);
     return escaped;
 }
 
 /*!
   This function overloads htmlEscape(const QString &, Tf::EscapeFlag).
+  The UTF-8 string \a input is escaped without being converted to UTF-16
+  beforehand.
 */
 QString THttpUtility::htmlEscape(const char *input, Tf::EscapeFlag flag)
 {
-    return htmlEscape(QString(input), flag);
+    QByteArray escaped;
+    appendHtmlEscaped(escaped, input, qstrlen(input), flag);
+    return QString::fromUtf8(escaped);
 }
 
 /*!
@@ -178,7 +552,9 @@ QString THttpUtility::htmlEscape(const char *input, Tf::EscapeFlag flag)
 */
 QString THttpUtility::htmlEscape(const QByteArray &input, Tf::EscapeFlag flag)
 {
-    return htmlEscape(QString(input), flag);
+    QByteArray escaped;
+    appendHtmlEscaped(escaped, input.constData(), input.length(), flag);
+    return QString::fromUtf8(escaped);
 }
 
 /*!
@@ -203,23 +579,18 @@ QString THttpUtility::htmlEscape(const QVariant &input, Tf::EscapeFlag flag)
 */
 QString THttpUtility::jsonEscape(const QString &input)
 {
-    const QLatin1Char amp('&');
-    const QLatin1Char lt('<');
-    const QLatin1Char gt('>');
+    const ushort *begin = input.utf16();
+    const ushort *end = begin + input.length();
 
-    QString escaped;
-    escaped.reserve(int(input.length() * 1.1));
-    for (int i = 0; i < input.length(); ++i) {
-        if (input.at(i) == amp) {
-            escaped += QLatin1String("\\u0026");
-        } else if (input.at(i) == lt) {
-            escaped += QLatin1String("\\u003C");
-        } else if (input.at(i) == gt) {
-            escaped += QLatin1String("\\u003E");
-        } else {
-            escaped += input.at(i);
-        }
+    const ushort *p = findEscape(begin, end, JsonEscapeSet);
+    if (p == end) {
+        return input;
     }
+
+    QString escaped;
+    escaped.reserve(input.length() + input.length() / 4);
+    appendRun(escaped, begin, p);
+    appendEscaped(escaped, p, end, JsonEscapeSet, jsonEntity);
     return escaped;
 }
 
@@ -228,7 +599,9 @@ QString THttpUtility::jsonEscape(const QString &input)
 */
 QString THttpUtility::jsonEscape(const char *input)
 {
-    return jsonEscape(QString(input));
+    QByteArray escaped;
+    appendJsonEscaped(escaped, input, qstrlen(input));
+    return QString::fromUtf8(escaped);
 }
 
 /*!
@@ -236,7 +609,9 @@ QString THttpUtility::jsonEscape(const char *input)
 */
 QString THttpUtility::jsonEscape(const QByteArray &input)
 {
-    return jsonEscape(QString(input));
+    QByteArray escaped;
+    appendJsonEscaped(escaped, input.constData(), input.length());
+    return QString::fromUtf8(escaped);
 }
 
 /*!
@@ -247,6 +622,75 @@ QString THttpUtility::jsonEscape(const QVariant &input)
     return jsonEscape(input.toString());
 }
 
+/*!
+  Appends the UTF-16 string \a input of \a length units to \a dest,
+  converting the characters to HTML entities as htmlEscape() does.
+*/
+void THttpUtility::appendHtmlEscaped(QString &dest, const QChar *input, int length, Tf::EscapeFlag flag)
+{
+    const ushort *p = reinterpret_cast<const ushort *>(input);
+    appendEscaped(dest, p, p + length, htmlEscapeSet(flag), htmlEntity);
+}
+
+/*!
+  Appends the UTF-16 string \a input of \a length units to \a dest in
+  UTF-8, converting the characters to HTML entities as htmlEscape() does.
+*/
+void THttpUtility::appendHtmlEscaped(QByteArray &dest, const QChar *input, int length, Tf::EscapeFlag flag)
+{
+    const ushort *p = reinterpret_cast<const ushort *>(input);
+    appendEscaped(dest, p, p + length, htmlEscapeSet(flag), htmlEntity);
+}
+
+/*!
+  Appends the UTF-8 string \a input of \a length bytes to \a dest,
+  converting the characters to HTML entities as htmlEscape() does.
+*/
+void THttpUtility::appendHtmlEscaped(QByteArray &dest, const char *input, int length, Tf::EscapeFlag flag)
+{
+    appendEscaped(dest, input, input + length, htmlEscapeSet(flag), htmlEntity);
+}
+
+/*!
+  Appends the UTF-16 string \a input of \a length units to \a dest,
+  converting the characters as jsonEscape() does.
+*/
+void THttpUtility::appendJsonEscaped(QString &dest, const QChar *input, int length)
+{
+    const ushort *p = reinterpret_cast<const ushort *>(input);
+    appendEscaped(dest, p, p + length, JsonEscapeSet, jsonEntity);
+}
+
+/*!
+  Appends the UTF-8 string \a input of \a length bytes to \a dest,
+  converting the characters as jsonEscape() does.
+*/
+void THttpUtility::appendJsonEscaped(QByteArray &dest, const char *input, int length)
+{
+    appendEscaped(dest, input, input + length, JsonEscapeSet, jsonEntity);
+}
+
+/*!
+  Appends the UTF-16 string \a input of \a length units to \a dest as
+  a JSON string literal in UTF-8; it is enclosed in double quotes, and
+  the quotation marks, backslashes and control characters are escaped
+  as QJsonDocument::toJson() does.
+*/
+void THttpUtility::appendJsonString(QByteArray &dest, const QChar *input, int length)
+{
+    const ushort *p = reinterpret_cast<const ushort *>(input);
+    appendJsonStringLiteral(dest, p, p + length);
+}
+
+/*!
+  Appends the UTF-8 string \a input of \a length bytes to \a dest as
+  a JSON string literal.
+*/
+void THttpUtility::appendJsonString(QByteArray &dest, const char *input, int length)
+{
+    appendJsonStringLiteral(dest, input, input + length);
+}
+
 /*!
   This function overloads toMimeEncoded(const QString &, QTextCodec *).
   @sa fromMimeEncoded(const QByteArray &)
@@ -29,6 +29,13 @@ public:
     static QString jsonEscape(const char *input);
     static QString jsonEscape(const QByteArray &input);
     static QString jsonEscape(const QVariant &input);
+    static void appendHtmlEscaped(QString &dest, const QChar *input, int length, Tf::EscapeFlag flag = Tf::Quotes);
+    static void appendHtmlEscaped(QByteArray &dest, const QChar *input, int length, Tf::EscapeFlag flag = Tf::Quotes);
+    static void appendHtmlEscaped(QByteArray &dest, const char *input, int length, Tf::EscapeFlag flag = Tf::Quotes);
+    static void appendJsonEscaped(QString &dest, const QChar *input, int length);
+    static void appendJsonEscaped(QByteArray &dest, const char *input, int length);
+    static void appendJsonString(QByteArray &dest, const QChar *input, int length);
+    static void appendJsonString(QByteArray &dest, const char *input, int length);
     static QByteArray toMimeEncoded(const QString &input, const QByteArray &encoding = "UTF-8");
     static QByteArray toMimeEncoded(const QString &input, QTextCodec *codec);
     static QString fromMimeEncoded(const QByteArray &mime);
@@ -0,0 +1,341 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tintrospector.h"
+#include "tsystemglobal.h"
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QList>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+#include <QSaveFile>
+#include <QThread>
+#include <TWebApplication>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#ifdef Q_OS_UNIX
+#include "tfcore_unix.h"
+#include <csignal>
+#include <fcntl.h>
+#endif
+
+/*!
+  \class TIntrospector
+  \brief The TIntrospector class takes a snapshot of the state of the
+  application server; the requests in flight, the open sockets, the
+  checkouts of the connection pools and so on, to find out what is
+  stuck.
+
+  Each thread publishes the request it is processing in a slot of its own
+  with a sequence lock, so the snapshot is taken without blocking the
+  threads and every entry of it is consistent. Other modules add their
+  sections by registerSection().
+*/
+
+namespace {
+constexpr int MAX_READ_RETRIES = 100;
+
+struct RequestSlot {
+    std::atomic<quint32> seq {0};  // odd while the owner thread writes
+    std::atomic<bool> inUse {false};
+    qint64 threadId {0};
+    qint64 startNsecs {0};  // 0 if idle
+    char method[16] {};
+    char path[160] {};
+    char action[96] {};
+    RequestSlot *next {nullptr};
+};
+
+// Slots are reused by new threads but never freed
+std::atomic<RequestSlot *> requestSlots {nullptr};
+
+
+struct LocalSlot {
+    RequestSlot *slot {nullptr};
+
+    ~LocalSlot()
+    {
+        if (slot) {
+            slot->startNsecs = 0;
+            slot->inUse.store(false);
+        }
+    }
+};
+
+thread_local LocalSlot localSlot;
+
+
+RequestSlot *currentSlot()
+{
+    RequestSlot *slot = localSlot.slot;
+    if (Q_UNLIKELY(!slot)) {
+        for (slot = requestSlots.load(); slot; slot = slot->next) {
+            bool expected = false;
+            if (slot->inUse.compare_exchange_strong(expected, true)) {
+                break;
+            }
+        }
+
+        if (!slot) {
+            slot = new RequestSlot;
+            slot->inUse.store(true);
+            RequestSlot *head = requestSlots.load();
+            do {
+                slot->next = head;
+            } while (!requestSlots.compare_exchange_weak(head, slot));
+        }
+        slot->threadId = (qint64)QThread::currentThreadId();
+        localSlot.slot = slot;
+    }
+    return slot;
+}
+
+
+inline void copyString(char *dst, int size, const QByteArray &src)
+{
+    int len = std::min(src.length(), size - 1);
+    std::memcpy(dst, src.constData(), len);
+    dst[len] = '\0';
+}
+
+
+// Writes the slot of the current thread under the sequence lock
+template <typename Function>
+inline void writeSlot(Function function)
+{
+    RequestSlot *slot = currentSlot();
+    quint32 seq = slot->seq.load(std::memory_order_relaxed);
+    slot->seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    function(slot);
+    slot->seq.store(seq + 2, std::memory_order_release);
+}
+
+
+QJsonArray requestsInFlight()
+{
+    const qint64 now = Tf::getMonotonicNSecs();
+    QList<QPair<qint64, QJsonObject>> requests;
+
+    for (RequestSlot *slot = requestSlots.load(); slot; slot = slot->next) {
+        for (int i = 0; i < MAX_READ_RETRIES; ++i) {
+            quint32 seq = slot->seq.load(std::memory_order_acquire);
+            if (seq & 1) {
+                QThread::yieldCurrentThread();
+                continue;
+            }
+
+            RequestSlot copy;
+            copy.threadId = slot->threadId;
+            copy.startNsecs = slot->startNsecs;
+            std::memcpy(copy.method, slot->method, sizeof(copy.method));
+            std::memcpy(copy.path, slot->path, sizeof(copy.path));
+            std::memcpy(copy.action, slot->action, sizeof(copy.action));
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (slot->seq.load(std::memory_order_relaxed) != seq) {
+                continue;  // updated while copying
+            }
+
+            if (copy.startNsecs > 0) {
+                qint64 elapsed = now - copy.startNsecs;
+                QJsonObject req;
+                req.insert(QStringLiteral("thread"), QString::number(copy.threadId, 16));
+                req.insert(QStringLiteral("method"), QString::fromLatin1(copy.method));
+                req.insert(QStringLiteral("path"), QString::fromUtf8(copy.path));
+                req.insert(QStringLiteral("action"), QString::fromLatin1(copy.action));
+                req.insert(QStringLiteral("elapsed_ms"), (double)(elapsed / 1000000));
+                requests << qMakePair(elapsed, req);
+            }
+            break;
+        }
+    }
+
+    // Longest first
+    std::sort(requests.begin(), requests.end(), [](const QPair<qint64, QJsonObject> &a, const QPair<qint64, QJsonObject> &b) {
+        return a.first > b.first;
+    });
+
+    QJsonArray array;
+    for (const auto &req : requests) {
+        array.append(req.second);
+    }
+    return array;
+}
+
+
+struct SectionRegistry {
+    QMutex mutex;
+    QList<QPair<QString, std::function<QJsonValue()>>> sections;
+};
+
+SectionRegistry *registry()
+{
+    static SectionRegistry sectionRegistry;
+    return &sectionRegistry;
+}
+}
+
+/*!
+  Publishes that the current thread has started processing the request
+  with the \a method and the \a path.
+*/
+void TIntrospector::beginRequest(const QByteArray &method, const QByteArray &path)
+{
+    const qint64 now = Tf::getMonotonicNSecs();
+    writeSlot([&](RequestSlot *slot) {
+        slot->startNsecs = now;
+        copyString(slot->method, sizeof(slot->method), method);
+        copyString(slot->path, sizeof(slot->path), path.left(path.indexOf('?')));
+        slot->action[0] = '\0';
+    });
+}
+
+/*!
+  Publishes the \a controller and the \a action which the request of the
+  current thread has been routed to.
+*/
+void TIntrospector::setAction(const QByteArray &controller, const QByteArray &action)
+{
+    writeSlot([&](RequestSlot *slot) {
+        copyString(slot->action, sizeof(slot->action), controller + '#' + action);
+    });
+}
+
+/*!
+  Publishes that the current thread has finished processing the request.
+*/
+void TIntrospector::endRequest()
+{
+    writeSlot([](RequestSlot *slot) {
+        slot->startNsecs = 0;
+    });
+}
+
+/*!
+  Registers the \a function which returns the section named \a name of
+  the snapshot. It is called on the thread taking the snapshot, so must
+  be thread-safe.
+*/
+void TIntrospector::registerSection(const QString &name, const std::function<QJsonValue()> &function)
+{
+    SectionRegistry *reg = registry();
+    QMutexLocker locker(&reg->mutex);
+    for (auto &section : reg->sections) {
+        if (section.first == name) {
+            section.second = function;
+            return;
+        }
+    }
+    reg->sections << qMakePair(name, function);
+}
+
+/*!
+  Returns the snapshot of the state of this application server.
+*/
+QJsonObject TIntrospector::snapshot()
+{
+    QJsonObject snapshot;
+    snapshot.insert(QStringLiteral("pid"), (double)QCoreApplication::applicationPid());
+    snapshot.insert(QStringLiteral("time"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    snapshot.insert(QStringLiteral("requests"), requestsInFlight());
+
+    SectionRegistry *reg = registry();
+    QMutexLocker locker(&reg->mutex);
+    for (const auto &section : reg->sections) {
+        snapshot.insert(section.first, section.second());
+    }
+    return snapshot;
+}
+
+/*!
+  Writes the snapshot to the file \a filePath in JSON.
+*/
+bool TIntrospector::writeSnapshot(const QString &filePath)
+{
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(QJsonDocument(snapshot()).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+/*!
+  Returns the path of the snapshot file of the application server \a pid,
+  which the manager process reads.
+*/
+QString TIntrospector::snapshotPath(qint64 pid)
+{
+    return Tf::app()->tmpPath() + QLatin1String("introspect/") + QString::number(pid) + QLatin1String(".json");
+}
+
+
+#ifdef Q_OS_UNIX
+namespace {
+int triggerPipe[2] = {-1, -1};
+
+
+void triggerSignalHandler(int)
+{
+    int err = errno;
+    char c = 0;
+    tf_write(triggerPipe[1], &c, 1);
+    errno = err;
+}
+
+
+// Not on the event loop, which might be the one stuck
+class TriggerThread : public QThread {
+protected:
+    void run() override
+    {
+        const QString path = TIntrospector::snapshotPath(QCoreApplication::applicationPid());
+        char buf[16];
+        while (tf_read(triggerPipe[0], buf, sizeof(buf)) > 0) {
+            if (!TIntrospector::writeSnapshot(path)) {
+                tSystemError("Failed to write the introspection snapshot: %s", qPrintable(path));
+            }
+        }
+    }
+};
+}
+#endif
+
+/*!
+  Makes this application server write its snapshot to snapshotPath() when
+  it receives SIGUSR1. The snapshot is taken on a dedicated thread. This
+  function is available on UNIX only.
+*/
+void TIntrospector::setupTrigger()
+{
+#ifdef Q_OS_UNIX
+    if (triggerPipe[0] >= 0 || pipe(triggerPipe) < 0) {
+        return;
+    }
+    fcntl(triggerPipe[0], F_SETFD, FD_CLOEXEC);
+    fcntl(triggerPipe[1], F_SETFD, FD_CLOEXEC);
+    fcntl(triggerPipe[1], F_SETFL, O_NONBLOCK);
+
+    auto *thread = new TriggerThread;
+    thread->start(QThread::LowPriority);
+
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    action.sa_handler = triggerSignalHandler;
+    sigaction(SIGUSR1, &action, nullptr);
+#endif
+}
@@ -0,0 +1,21 @@
+#pragma once
+#include <QByteArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QString>
+#include <TGlobal>
+#include <functional>
+
+
+class T_CORE_EXPORT TIntrospector {
+public:
+    static void beginRequest(const QByteArray &method, const QByteArray &path);
+    static void setAction(const QByteArray &controller, const QByteArray &action);
+    static void endRequest();
+
+    static void registerSection(const QString &name, const std::function<QJsonValue()> &function);
+    static QJsonObject snapshot();
+    static bool writeSnapshot(const QString &filePath);
+    static QString snapshotPath(qint64 pid);
+    static void setupTrigger();
+};
@@ -10,6 +10,7 @@
 #include <QDir>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QTextStream>
@@ -22,12 +23,27 @@
 /*!
   \class TJSLoader
   \brief The TJSLoader class loads a JavaScript module at run-time.
+
+  A module returned by load() is shared among threads, and each call to it
+  is serialized. acquire() instead takes a module from a pool for exclusive
+  use until release(); a module stays loaded in the pool, so concurrent
+  threads evaluate scripts on their own engines without waiting for each
+  other.
 */
 
 namespace {
+constexpr int MAX_IDLE_MODULES = 64;  // per module in the pool
+constexpr int MAX_COMPILED_JSX = 1000;
+
 QMap<QString, TJSModule *> jsContexts;
 QStringList defaultPaths;
-QMutex gMutex(QMutex::Recursive);
+QMutex gMutex;  // guards jsContexts and defaultPaths
+
+QMap<QString, QList<TJSModule *>> idleModules;
+QMutex poolMutex;
+
+QHash<QString, QString> compiledJsx;
+QMutex jsxMutex;
 }
 
 
@@ -136,36 +152,121 @@ TJSModule *TJSLoader::load(bool reload)
         return nullptr;
     }
 
-    QMutexLocker lock(&gMutex);
-    QString key = member + QLatin1Char(';') + module;
-    TJSModule *context = jsContexts.value(key);
+    const QString k = key();
+    {
+        QMutexLocker lock(&gMutex);
+        TJSModule *context = jsContexts.value(k);
+        if (context && !reload) {
+            return context;
+        }
 
-    if (reload && context) {
-        jsContexts.remove(key);
-        context->deleteLater();
-        context = nullptr;
+        if (context) {
+            jsContexts.remove(k);
+            context->deleteLater();
+        }
     }
 
-    if (!context) {
-        context = new TJSModule();
+    // Loads it without the lock
+    TJSModule *context = create();
+    if (context) {
+        QMutexLocker lock(&gMutex);
+        TJSModule *loaded = jsContexts.value(k);
+        if (loaded) {
+            // Loaded by another thread in the meantime
+            delete context;
+            return loaded;
+        }
+        jsContexts.insert(k, context);
+    }
+    return context;
+}
+
+/*!
+  Takes a loaded module from the pool for exclusive use, or loads a new one
+  if no idle module is found; returns null pointer if loading failed. A
+  module whose file has been modified since it was loaded is discarded.
+  Give it back by release() after use.
+*/
+TJSModule *TJSLoader::acquire()
+{
+    if (module.isEmpty()) {
+        return nullptr;
+    }
 
-        for (auto &p : (const QList<QPair<QString, QString>> &)importFiles) {
-            // Imports as JavaScript
-            TJSLoader(p.first, p.second, Default).importTo(context, false);
+    const QString k = key();
+    TJSModule *context = nullptr;
+    {
+        QMutexLocker lock(&poolMutex);
+        auto it = idleModules.find(k);
+        if (it != idleModules.end() && !it->isEmpty()) {
+            context = it->takeLast();
         }
+    }
 
-        QJSValue res = importTo(context, true);
-        if (res.isError()) {
-            context->deleteLater();
+    if (context) {
+        QFileInfo fi(context->moduleFilePath);
+        if (context->moduleFilePath.isEmpty() || (fi.exists() && fi.lastModified() > context->loadedTime)) {
+            tSystemDebug("TJSLoader module modified: %s", qPrintable(module));
+            delete context;
             context = nullptr;
-        } else {
-            jsContexts.insert(key, context);
         }
     }
+
+    if (!context) {
+        context = create();
+        if (context) {
+            context->poolKey = k;
+        }
+    }
+    return context;
+}
+
+/*!
+  Returns the module \a context taken by acquire() to the pool.
+*/
+void TJSLoader::release(TJSModule *context)
+{
+    if (!context) {
+        return;
+    }
+
+    if (!context->poolKey.isEmpty()) {
+        QMutexLocker lock(&poolMutex);
+        auto &idle = idleModules[context->poolKey];
+        if (idle.count() < MAX_IDLE_MODULES) {
+            idle << context;
+            return;
+        }
+    }
+    delete context;
+}
+
+
+TJSModule *TJSLoader::create() const
+{
+    auto *context = new TJSModule();
+
+    for (auto &p : (const QList<QPair<QString, QString>> &)importFiles) {
+        // Imports as JavaScript
+        TJSLoader(p.first, p.second, Default).importTo(context, false);
+    }
+
+    QJSValue res = importTo(context, true);
+    if (res.isError()) {
+        delete context;
+        return nullptr;
+    }
+    context->loadedTime = QDateTime::currentDateTime();
     return context;
 }
 
 
+QString TJSLoader::key() const
+{
+    return member + QLatin1Char(';') + module + QLatin1Char(';') + QString::number(altJs);
+}
+
+
 QString TJSLoader::search(const QString &moduleName, AltJS alt) const
 {
     QString filePath;
@@ -310,7 +411,6 @@ TJSInstance TJSLoader::loadAsConstructor(const QJSValue &arg) const
 
 TJSInstance TJSLoader::loadAsConstructor(const QJSValueList &args) const
 {
-    QMutexLocker lock(&gMutex);
     QString constructorName = (member.isEmpty()) ? QLatin1String("_TF_") + QFileInfo(module).baseName().replace(QChar('-'), QChar('_')) : member;
     auto *ctx = TJSLoader(constructorName, module).load();
     return (ctx) ? ctx->callAsConstructor(constructorName, args) : TJSInstance();
@@ -393,10 +493,38 @@ void TJSLoader::replaceRequire(TJSModule *context, QString &content, const QDir
 }
 
 
+/*!
+  Compiles the JSX code \a jsx into JavaScript. The results are cached,
+  so that a component rendered repeatedly is compiled only once.
+*/
 QString TJSLoader::compileJsx(const QString &jsx)
 {
-    auto *transform = TJSLoader("JSXTransformer", "JSXTransformer").load();
+    {
+        QMutexLocker lock(&jsxMutex);
+        auto it = compiledJsx.constFind(jsx);
+        if (it != compiledJsx.constEnd()) {
+            return it.value();
+        }
+    }
+
+    TJSLoader loader("JSXTransformer", "JSXTransformer");
+    auto *transform = loader.acquire();
+    if (!transform) {
+        return QString();
+    }
+
     QJSValue jscode = transform->call("JSXTransformer.transform", QJSValue(jsx));
     //tSystemDebug("code:%s", qPrintable(jscode.property("code").toString()));
-    return jscode.property("code").toString();
+    QString code = jscode.property("code").toString();
+    bool compiled = !jscode.isError();
+    TJSLoader::release(transform);
+
+    if (compiled) {
+        QMutexLocker lock(&jsxMutex);
+        if (compiledJsx.count() >= MAX_COMPILED_JSX) {
+            compiledJsx.clear();
+        }
+        compiledJsx.insert(jsx, code);
+    }
+    return code;
 }
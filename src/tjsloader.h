@@ -16,6 +16,8 @@ public:
     TJSLoader(const QString &defaultMember, const QString &moduleName, AltJS alt = Default);
 
     TJSModule *load(bool reload = false);
+    TJSModule *acquire();
+    static void release(TJSModule *context);
     void import(const QString &moduleName);
     void import(const QString &defaultMember, const QString &moduleName);
     TJSInstance loadAsConstructor(const QJSValue &arg) const;
@@ -27,6 +29,8 @@ public:
     static QString compileJsx(const QString &jsx);
 
 protected:
+    TJSModule *create() const;
+    QString key() const;
     QJSValue importTo(TJSModule *context, bool isMain) const;
     QString search(const QString &moduleName, AltJS alt) const;
     QString absolutePath(const QString &moduleName, const QDir &dir, AltJS alt) const;
@@ -1,4 +1,5 @@
 #pragma once
+#include <QDateTime>
 #include <QDir>
 #include <QJSValue>
 #include <QMap>
@@ -33,6 +34,8 @@ private:
     QJSValue *funcObj;
     QString lastFunc;
     QString moduleFilePath;
+    QString poolKey;  // key of the pool to return to
+    QDateTime loadedTime;
     QMutex mutex;
 
     T_DISABLE_COPY(TJSModule)
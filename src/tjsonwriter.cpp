@@ -0,0 +1,521 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tjsonwriter.h"
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QLocale>
+#include <QMetaProperty>
+#include <QReadLocker>
+#include <QReadWriteLock>
+#include <QVector>
+#include <QWriteLocker>
+#include <TAbstractModel>
+#include <THttpUtility>
+#include <TModelObject>
+#include <algorithm>
+#include <cmath>
+
+/*!
+  \class TJsonWriter
+  \brief The TJsonWriter class serializes models and QVariant trees into
+  compact JSON in UTF-8, without building QJsonObject or QJsonArray.
+
+  The output has the same content and key order as QJsonDocument::toJson()
+  with the QJsonDocument::Compact format produces from the corresponding
+  QJsonObject or QJsonArray, except that integers out of the range of
+  a double are written exactly. Strings are escaped by the SIMD kernel of
+  THttpUtility::appendJsonString().
+
+  \code
+  TJsonWriter writer;
+  writer.beginObject();
+  writer.writeName("count");
+  writer.writeNumber(blogs.count());
+  writer.writeName("blogs");
+  writer.writeModels(blogs);
+  writer.endObject();
+  sendData(writer.data(), "application/json; charset=utf-8");
+  \endcode
+*/
+
+namespace {
+
+// Property of a model object with its JSON name, e.g. "updatedAt":
+struct ModelField {
+    QMetaProperty property;
+    QByteArray name;
+};
+
+QReadWriteLock fieldsLock;
+QHash<const QMetaObject *, QVector<ModelField>> modelFields;
+
+// Returns the properties in the order of the keys of TAbstractModel::toVariantMap()
+QVector<ModelField> fieldsOf(const QMetaObject *metaObj)
+{
+    {
+        QReadLocker locker(&fieldsLock);
+        auto it = modelFields.constFind(metaObj);
+        if (it != modelFields.constEnd()) {
+            return *it;
+        }
+    }
+
+    struct Property {
+        QString variableName;
+        QString fieldName;
+        QMetaProperty property;
+    };
+
+    QVector<Property> properties;
+    for (int i = metaObj->propertyOffset(); i < metaObj->propertyCount(); ++i) {
+        QMetaProperty prop = metaObj->property(i);
+        QString field = QString::fromUtf8(prop.name());
+        if (!field.isEmpty()) {
+            properties << Property {TAbstractModel::fieldNameToVariableName(field), field, prop};
+        }
+    }
+
+    std::sort(properties.begin(), properties.end(), [](const Property &a, const Property &b) {
+        return (a.variableName != b.variableName) ? a.variableName < b.variableName : a.fieldName < b.fieldName;
+    });
+
+    QVector<ModelField> fields;
+    for (int i = 0; i < properties.count(); ++i) {
+        const Property &prop = properties[i];
+        if (i + 1 < properties.count() && properties[i + 1].variableName == prop.variableName) {
+            continue;  // overwritten by the next one in toVariantMap()
+        }
+
+        ModelField field;
+        field.property = prop.property;
+        THttpUtility::appendJsonString(field.name, prop.variableName.constData(), prop.variableName.length());
+        field.name += ':';
+        fields << field;
+    }
+
+    QWriteLocker locker(&fieldsLock);
+    modelFields.insert(metaObj, fields);
+    return fields;
+}
+
+
+inline void appendInteger(QByteArray &dest, quint64 value, bool negative)
+{
+    char buf[24];
+    char *p = buf + sizeof(buf);
+    do {
+        *--p = '0' + (value % 10);
+        value /= 10;
+    } while (value);
+
+    if (negative) {
+        *--p = '-';
+    }
+    dest.append(p, buf + sizeof(buf) - p);
+}
+
+}
+
+
+TJsonWriter::TJsonWriter(int reserveSize)
+{
+    if (reserveSize > 0) {
+        buffer.reserve(reserveSize);
+    }
+}
+
+/*!
+  Begins a JSON object; writes the members with writeName() and a value,
+  then calls endObject().
+*/
+void TJsonWriter::beginObject()
+{
+    beginValue();
+    buffer += '{';
+    separate = false;
+}
+
+/*!
+  Ends the JSON object begun by beginObject().
+*/
+void TJsonWriter::endObject()
+{
+    buffer += '}';
+    separate = true;
+}
+
+/*!
+  Begins a JSON array; writes the elements, then calls endArray().
+*/
+void TJsonWriter::beginArray()
+{
+    beginValue();
+    buffer += '[';
+    separate = false;
+}
+
+/*!
+  Ends the JSON array begun by beginArray().
+*/
+void TJsonWriter::endArray()
+{
+    buffer += ']';
+    separate = true;
+}
+
+/*!
+  Writes the name \a name of the next member of the current object.
+*/
+void TJsonWriter::writeName(const QString &name)
+{
+    beginValue();
+    THttpUtility::appendJsonString(buffer, name.constData(), name.length());
+    buffer += ':';
+    separate = false;
+}
+
+/*!
+  Writes null.
+*/
+void TJsonWriter::writeNull()
+{
+    beginValue();
+    buffer += "null";
+}
+
+/*!
+  Writes the boolean \a value.
+*/
+void TJsonWriter::writeBool(bool value)
+{
+    beginValue();
+    buffer += (value) ? "true" : "false";
+}
+
+/*!
+  Writes the integer \a value.
+*/
+void TJsonWriter::writeNumber(qint64 value)
+{
+    beginValue();
+    appendInteger(buffer, (value < 0) ? 0 - (quint64)value : (quint64)value, value < 0);
+}
+
+/*!
+  \overload
+*/
+void TJsonWriter::writeNumber(quint64 value)
+{
+    beginValue();
+    appendInteger(buffer, value, false);
+}
+
+/*!
+  Writes the double \a value in the shortest form that reads back
+  the same value. Infinity and NaN are written as null.
+*/
+void TJsonWriter::writeNumber(double value)
+{
+    beginValue();
+    if (std::isfinite(value)) {
+        const double abs = std::abs(value);
+        bool integral = (abs < 18446744073709551616.0 && abs == (double)(quint64)abs);
+        buffer += QByteArray::number(value, (integral) ? 'f' : 'g', QLocale::FloatingPointShortest);
+    } else {
+        buffer += "null";
+    }
+}
+
+/*!
+  Writes the string \a value.
+*/
+void TJsonWriter::writeString(const QString &value)
+{
+    beginValue();
+    THttpUtility::appendJsonString(buffer, value.constData(), value.length());
+}
+
+/*!
+  Writes the UTF-8 string \a value of \a length bytes.
+*/
+void TJsonWriter::writeUtf8String(const char *value, int length)
+{
+    beginValue();
+    THttpUtility::appendJsonString(buffer, value, length);
+}
+
+/*!
+  Writes the \a value converted as QJsonValue::fromVariant() does;
+  maps and lists are written recursively.
+*/
+void TJsonWriter::writeVariant(const QVariant &value)
+{
+    switch (value.userType()) {
+    case QMetaType::UnknownType:
+    case QMetaType::Nullptr:
+        writeNull();
+        break;
+
+    case QMetaType::Bool:
+        writeBool(value.toBool());
+        break;
+
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+        writeNumber(value.toLongLong());
+        break;
+
+    case QMetaType::UInt:
+    case QMetaType::ULongLong:
+        writeNumber(value.toULongLong());
+        break;
+
+    case QMetaType::Float:
+    case QMetaType::Double:
+        writeNumber(value.toDouble());
+        break;
+
+    case QMetaType::QString:
+        writeString(*reinterpret_cast<const QString *>(value.constData()));
+        break;
+
+    case QMetaType::QStringList:
+        writeStringList(*reinterpret_cast<const QStringList *>(value.constData()));
+        break;
+
+    case QMetaType::QVariantList:
+        writeList(*reinterpret_cast<const QVariantList *>(value.constData()));
+        break;
+
+    case QMetaType::QVariantMap:
+        writeMap(*reinterpret_cast<const QVariantMap *>(value.constData()));
+        break;
+
+    case QMetaType::QVariantHash:
+        writeHash(*reinterpret_cast<const QVariantHash *>(value.constData()));
+        break;
+
+    case QMetaType::QJsonValue:
+        writeVariant(value.toJsonValue().toVariant());
+        break;
+
+    case QMetaType::QJsonObject:
+        writeMap(value.toJsonObject().toVariantMap());
+        break;
+
+    case QMetaType::QJsonArray:
+        writeList(value.toJsonArray().toVariantList());
+        break;
+
+    case QMetaType::QJsonDocument: {
+        QJsonDocument doc = value.toJsonDocument();
+        if (doc.isArray()) {
+            writeList(doc.array().toVariantList());
+        } else {
+            writeMap(doc.object().toVariantMap());
+        }
+        break;
+    }
+
+    default: {
+        // Same as QJsonValue::fromVariant(), e.g. QDateTime in ISO 8601
+        QString str = value.toString();
+        if (str.isEmpty()) {
+            writeNull();
+        } else {
+            writeString(str);
+        }
+        break;
+    }
+    }
+}
+
+/*!
+  Writes the \a map as an object.
+*/
+void TJsonWriter::writeMap(const QVariantMap &map)
+{
+    beginObject();
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+        writeName(it.key());
+        writeVariant(it.value());
+    }
+    endObject();
+}
+
+/*!
+  Writes the \a hash as an object; the members are sorted by name as
+  QJsonObject does.
+*/
+void TJsonWriter::writeHash(const QVariantHash &hash)
+{
+    QVector<QVariantHash::const_iterator> members;
+    members.reserve(hash.count());
+    for (auto it = hash.constBegin(); it != hash.constEnd(); ++it) {
+        members << it;
+    }
+    std::sort(members.begin(), members.end(), [](const QVariantHash::const_iterator &a, const QVariantHash::const_iterator &b) {
+        return a.key() < b.key();
+    });
+
+    beginObject();
+    for (auto &it : members) {
+        writeName(it.key());
+        writeVariant(it.value());
+    }
+    endObject();
+}
+
+/*!
+  Writes the \a list as an array.
+*/
+void TJsonWriter::writeList(const QVariantList &list)
+{
+    beginArray();
+    for (auto &value : list) {
+        writeVariant(value);
+    }
+    endArray();
+}
+
+/*!
+  Writes the \a list as an array of strings.
+*/
+void TJsonWriter::writeStringList(const QStringList &list)
+{
+    beginArray();
+    for (auto &str : list) {
+        writeString(str);
+    }
+    endArray();
+}
+
+/*!
+  Writes the \a model as an object of the map returned by
+  TAbstractModel::toVariantMap(), so that a model reimplementing it is
+  written as it defines.
+*/
+void TJsonWriter::writeModel(const TAbstractModel &model)
+{
+    writeMap(model.toVariantMap());
+}
+
+/*!
+  Writes the properties of the \a model as an object, reading them from
+  the model object directly without building a QVariantMap. The output is
+  the same as writeModel() writes only if the model does not reimplement
+  TAbstractModel::toVariantMap(); no field hidden by it should be in the
+  model object.
+*/
+void TJsonWriter::writeModelProperties(const TAbstractModel &model)
+{
+    const TModelObject *obj = model.modelData();
+
+    beginObject();
+    if (obj) {
+        const QVector<ModelField> fields = fieldsOf(obj->metaObject());
+        for (auto &field : fields) {
+            beginValue();
+            buffer += field.name;
+            separate = false;
+            writeVariant(field.property.read(obj));
+        }
+    }
+    endObject();
+}
+
+/*!
+  \fn void TJsonWriter::writeModels(const QList<T> &models)
+  Writes the list of the models \a models as an array of objects.
+*/
+
+/*!
+  \fn const QByteArray &TJsonWriter::data() const
+  Returns the JSON written so far.
+*/
+
+/*!
+  Returns the JSON written so far and clears the writer.
+*/
+QByteArray TJsonWriter::takeData()
+{
+    QByteArray data = std::move(buffer);
+    clear();
+    return data;
+}
+
+/*!
+  Clears the JSON written so far.
+*/
+void TJsonWriter::clear()
+{
+    buffer.clear();
+    separate = false;
+}
+
+/*!
+  Returns the \a value as compact JSON.
+*/
+QByteArray TJsonWriter::toJson(const QVariant &value)
+{
+    TJsonWriter writer;
+    writer.writeVariant(value);
+    return writer.takeData();
+}
+
+/*!
+  Returns the \a map as a compact JSON object.
+*/
+QByteArray TJsonWriter::toJson(const QVariantMap &map)
+{
+    TJsonWriter writer;
+    writer.writeMap(map);
+    return writer.takeData();
+}
+
+/*!
+  Returns the \a list as a compact JSON array.
+*/
+QByteArray TJsonWriter::toJson(const QVariantList &list)
+{
+    TJsonWriter writer;
+    writer.writeList(list);
+    return writer.takeData();
+}
+
+/*!
+  Returns the \a list as a compact JSON array of strings.
+*/
+QByteArray TJsonWriter::toJson(const QStringList &list)
+{
+    TJsonWriter writer;
+    writer.writeStringList(list);
+    return writer.takeData();
+}
+
+/*!
+  Returns the \a model as a compact JSON object of the map returned by
+  TAbstractModel::toVariantMap().
+*/
+QByteArray TJsonWriter::toJson(const TAbstractModel &model)
+{
+    TJsonWriter writer;
+    writer.writeModel(model);
+    return writer.takeData();
+}
+
+/*!
+  \fn QByteArray TJsonWriter::toJson(const QList<T> &models)
+  Returns the list of the models \a models as a compact JSON array of
+  the maps returned by TAbstractModel::toVariantMap(). It has the same
+  content as tfConvertToJsonArray() builds unless the models reimplement
+  TAbstractModel::toJsonObject().
+*/
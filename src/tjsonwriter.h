@@ -0,0 +1,83 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <TGlobal>
+
+class TAbstractModel;
+
+
+class T_CORE_EXPORT TJsonWriter {
+public:
+    TJsonWriter(int reserveSize = 0);
+
+    void beginObject();
+    void endObject();
+    void beginArray();
+    void endArray();
+    void writeName(const QString &name);
+    void writeNull();
+    void writeBool(bool value);
+    void writeNumber(int value) { writeNumber((qint64)value); }
+    void writeNumber(qint64 value);
+    void writeNumber(quint64 value);
+    void writeNumber(double value);
+    void writeString(const QString &value);
+    void writeUtf8String(const char *value, int length);
+    void writeVariant(const QVariant &value);
+    void writeMap(const QVariantMap &map);
+    void writeHash(const QVariantHash &hash);
+    void writeList(const QVariantList &list);
+    void writeStringList(const QStringList &list);
+    void writeModel(const TAbstractModel &model);
+    void writeModelProperties(const TAbstractModel &model);
+    template <class T>
+    void writeModels(const QList<T> &models);
+
+    const QByteArray &data() const { return buffer; }
+    QByteArray takeData();
+    void clear();
+
+    static QByteArray toJson(const QVariant &value);
+    static QByteArray toJson(const QVariantMap &map);
+    static QByteArray toJson(const QVariantList &list);
+    static QByteArray toJson(const QStringList &list);
+    static QByteArray toJson(const TAbstractModel &model);
+    template <class T>
+    static QByteArray toJson(const QList<T> &models);
+
+private:
+    void beginValue();
+
+    QByteArray buffer;
+    bool separate {false};  // a comma precedes the next value
+};
+
+
+inline void TJsonWriter::beginValue()
+{
+    if (separate) {
+        buffer += ',';
+    }
+    separate = true;
+}
+
+template <class T>
+inline void TJsonWriter::writeModels(const QList<T> &models)
+{
+    beginArray();
+    for (auto &model : models) {
+        writeModel(model);
+    }
+    endArray();
+}
+
+template <class T>
+inline QByteArray TJsonWriter::toJson(const QList<T> &models)
+{
+    TJsonWriter writer(models.count() * 128);
+    writer.writeModels(models);
+    return writer.takeData();
+}
@@ -7,12 +7,17 @@
 
 #include "tkvsdatabasepool.h"
 #include "tfnamespace.h"
+#include "thistogram.h"
 #include "tsqldatabasepool.h"
 #include "tsystemglobal.h"
 #include <QDateTime>
+#include <QJsonArray>
+#include <QJsonObject>
 #include <QMap>
 #include <QStringList>
 #include <QThread>
+#include <TIntrospector>
+#include <TMetrics>
 #include <TWebApplication>
 #include <ctime>
 
@@ -102,6 +107,8 @@ void TKvsDatabasePool::init()
     cachedDatabase = new TStack<QString>[kvsEngineHash()->count()];
     lastCachedTime = new TAtomic<uint>[kvsEngineHash()->count()];
     availableNames = new TStack<QString>[kvsEngineHash()->count()];
+    checkedOut.resize(kvsEngineHash()->count());
+    waitTime.resize(kvsEngineHash()->count());
     bool aval = false;
 
     // Adds databases previously
@@ -117,6 +124,17 @@ void TKvsDatabasePool::init()
             tSystemDebug("KVS database available. engine:%d", (int)engine);
         }
 
+        // Metrics
+        int e = (int)engine;
+        QByteArray label = TMetrics::label("engine", drv.toLatin1());
+        // Counted even if the metrics are disabled, for the introspector
+        TMetricGauge *gauge = checkedOut[e] = new TMetricGauge;
+        TMetrics::registerGauge("tf_kvs_pool_checked_out_connections", label, [gauge]() { return gauge->value(); },
+            "Number of KVS connections checked out of the pool");
+        waitTime[e] = &TMetrics::histogram("tf_kvs_pool_wait_seconds", label, "Time to check out a KVS connection, including opening it");
+        TMetrics::registerGauge("tf_kvs_pool_idle_connections", label, [this, e]() { return (qint64)cachedDatabase[e].count(); },
+            "Number of open KVS connections idle in the pool");
+
         auto &stack = availableNames[(int)engine];
         for (int i = 0; i < maxConnects; ++i) {
             TKvsDatabase db = TKvsDatabase::addDatabase(drv, QString().sprintf(CONN_NAME_FORMAT, (int)engine, i));
@@ -134,6 +152,22 @@ void TKvsDatabasePool::init()
     if (aval) {
         // Starts the timer to close extra-connection
         timer.start(10000, this);
+
+        TIntrospector::registerSection(QStringLiteral("kvs_pools"), [this]() {
+            QJsonArray pools;
+            for (auto it = kvsEngineHash()->cbegin(); it != kvsEngineHash()->cend(); ++it) {
+                int e = (int)it.key();
+                if (e < checkedOut.count() && checkedOut[e]) {
+                    QJsonObject pool;
+                    pool.insert(QStringLiteral("engine"), it.value());
+                    pool.insert(QStringLiteral("checked_out"), (double)checkedOut[e]->value());
+                    pool.insert(QStringLiteral("idle"), cachedDatabase[e].count());
+                    pool.insert(QStringLiteral("max"), maxConnects);
+                    pools.append(pool);
+                }
+            }
+            return QJsonValue(pools);
+        });
     }
 }
 
@@ -164,6 +198,13 @@ TKvsDatabase TKvsDatabasePool::database(Tf::KvsEngine engine)
 
     auto &cache = cachedDatabase[(int)engine];
     auto &stack = availableNames[(int)engine];
+    const qint64 startTicks = Tf::getMonotonicNSecs();
+
+    auto checkOut = [&](const TKvsDatabase &database) {
+        checkedOut[(int)engine]->add();
+        waitTime[(int)engine]->record(Tf::getMonotonicNSecs() - startTicks);
+        return database;
+    };
 
     for (;;) {
         QString name;
@@ -172,7 +213,7 @@ TKvsDatabase TKvsDatabasePool::database(Tf::KvsEngine engine)
             if (Q_LIKELY(db.isOpen())) {
                 tSystemDebug("Gets cached KVS database: %s", qPrintable(db.connectionName()));
                 db.moveToThread(QThread::currentThread());  // move to thread
-                return db;
+                return checkOut(db);
             } else {
                 tSystemError("Pooled database is not open: %s  [%s:%d]", qPrintable(db.connectionName()), __FILE__, __LINE__);
                 stack.push(name);
@@ -184,7 +225,7 @@ TKvsDatabase TKvsDatabasePool::database(Tf::KvsEngine engine)
             db = TKvsDatabase::database(name);
             if (Q_UNLIKELY(db.isOpen())) {
                 tSystemWarn("Gets a opend KVS database: %s", qPrintable(db.connectionName()));
-                return db;
+                return checkOut(db);
             } else {
                 db.moveToThread(QThread::currentThread());  // move to thread
 
@@ -204,7 +245,7 @@ TKvsDatabase TKvsDatabasePool::database(Tf::KvsEngine engine)
                     }
                 }
 
-                return db;
+                return checkOut(db);
             }
         }
     }
@@ -273,6 +314,7 @@ void TKvsDatabasePool::pool(TKvsDatabase &database)
             throw RuntimeException("No such KVS engine", __FILE__, __LINE__);
         }
 
+        checkedOut[engine]->sub();
         cachedDatabase[engine].push(database.connectionName());
         lastCachedTime[engine].store((uint)std::time(nullptr));
         tSystemDebug("Pooled KVS database: %s", qPrintable(database.connectionName()));
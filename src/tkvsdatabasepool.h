@@ -10,6 +10,8 @@
 #include <TKvsDatabase>
 
 class QSettings;
+class TMetricGauge;
+class THistogram;
 
 
 class T_CORE_EXPORT TKvsDatabasePool : public QObject {
@@ -37,6 +39,8 @@ private:
     TAtomic<uint> *lastCachedTime {nullptr};
     TStack<QString> *availableNames {nullptr};
     int maxConnects {0};
+    QVector<TMetricGauge *> checkedOut;
+    QVector<THistogram *> waitTime;
     QBasicTimer timer;
 };
 
@@ -5,6 +5,7 @@
  * the New BSD License, which is incorporated herein by reference.
  */
 
+#include "tloglayout.h"
 #include <QDir>
 #include <QFileInfo>
 #include <QTextCodec>
@@ -43,6 +44,14 @@ TLogger::TLogger()
 {
 }
 
+/*!
+  Destructor.
+*/
+TLogger::~TLogger()
+{
+    delete _compiledLayout.load();
+}
+
 /*!
   Returns the value for logger setting \a key. If the setting doesn't exist,
   returns \a defaultValue.
@@ -60,101 +69,29 @@ QVariant TLogger::settingsValue(const QString &k, const QVariant &defaultValue)
 */
 QByteArray TLogger::logToByteArray(const TLog &log) const
 {
-    return logToByteArray(log, layout(), dateTimeFormat(), codec());
+    TLogLayout *compiled = _compiledLayout.load();
+    if (Q_UNLIKELY(!compiled)) {
+        auto *newLayout = new TLogLayout(layout(), dateTimeFormat());
+        if (_compiledLayout.compareExchange(nullptr, newLayout)) {
+            compiled = newLayout;
+        } else {
+            delete newLayout;
+            compiled = _compiledLayout.load();
+        }
+    }
+
+    QByteArray message = compiled->format(log);
+    QTextCodec *cdc = codec();
+    return (cdc) ? cdc->fromUnicode(QString::fromLocal8Bit(message.data(), message.length())) : message;
 }
 
 /*!
   Converts the log \a log to its textual representation and returns
-  a QByteArray containing the data.
+  a QByteArray containing the data. The \a layout is parsed each call.
 */
 QByteArray TLogger::logToByteArray(const TLog &log, const QByteArray &layout, const QByteArray &dateTimeFormat, QTextCodec *codec)
 {
-    QByteArray message;
-    int pos = 0;
-    QByteArray dig;
-    message.reserve(layout.length() + log.message.length() + 100);
-
-    while (pos < layout.length()) {
-        char c = layout.at(pos++);
-        if (c != '%') {
-            message.append(c);
-            continue;
-        }
-
-        dig.resize(0);
-        for (;;) {
-            if (pos >= layout.length()) {
-                message.append('%').append(dig);
-                break;
-            }
-
-            c = layout.at(pos++);
-            if (c >= '0' && c <= '9') {
-                dig += c;
-                continue;
-            }
-
-            switch (c) {
-            case 'd':  // %d : timestamp
-                if (!dateTimeFormat.isEmpty()) {
-                    message.append(log.timestamp.toString(dateTimeFormat).toLatin1());
-                } else {
-                    message.append(log.timestamp.toString(Qt::ISODate).toLatin1());
-                }
-                break;
-
-            case 'p':
-            case 'P': {  // %p or %P : priority
-                QByteArray pri = priorityToString((Tf::LogPriority)log.priority);
-                if (c == 'p') {
-                    pri = pri.toLower();
-                }
-                if (!pri.isEmpty()) {
-                    message.append(pri);
-                    int d = dig.toInt() - pri.length();
-                    if (d > 0) {
-                        message.append(QByteArray(d, ' '));
-                    }
-                }
-                break;
-            }
-
-            case 't':
-            case 'T': {  // %t or %T : thread ID (dec or hex)
-                const QChar fillChar = (dig.length() > 0 && dig[0] == '0') ? QLatin1Char('0') : QLatin1Char(' ');
-                message.append(QString("%1").arg((qulonglong)log.threadId, dig.toInt(), ((c == 't') ? 10 : 16), fillChar).toLatin1());
-                break;
-            }
-
-            case 'i':
-            case 'I': {  // %i or %I : PID (dec or hex)
-                const QChar fillChar = (dig.length() > 0 && dig[0] == '0') ? QLatin1Char('0') : QLatin1Char(' ');
-                message.append(QString("%1").arg(log.pid, dig.toInt(), ((c == 'i') ? 10 : 16), fillChar).toLatin1());
-                break;
-            }
-
-            case 'n':  // %n : newline
-                message.append('\n');
-                break;
-
-            case 'm':  // %m : message
-                message.append(log.message);
-                break;
-
-            case '%':
-                message.append('%').append(dig);
-                dig.resize(0);
-                continue;
-                break;
-
-            default:
-                message.append('%').append(dig).append(c);
-                break;
-            }
-            break;
-        }
-    }
-
+    QByteArray message = TLogLayout(layout, dateTimeFormat).format(log);
     return (codec) ? codec->fromUnicode(QString::fromLocal8Bit(message.data(), message.length())) : message;
 }
 
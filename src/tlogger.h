@@ -1,17 +1,19 @@
 #pragma once
 #include <QString>
 #include <QVariant>
+#include <TAtomicPtr>
 #include <TGlobal>
 #include <TLog>
 
 class TLog;
+class TLogLayout;
 class QTextCodec;
 
 
 class T_CORE_EXPORT TLogger {
 public:
     TLogger();
-    virtual ~TLogger() { }
+    virtual ~TLogger();
     virtual QString key() const = 0;
     virtual bool isMultiProcessSafe() const = 0;
     virtual bool open() = 0;
@@ -40,5 +42,6 @@ private:
     mutable Tf::LogPriority _threshold {(Tf::LogPriority)-1};
     mutable QString _target;
     mutable QTextCodec *_codec {nullptr};
+    mutable TAtomicPtr<TLogLayout> _compiledLayout;
 };
 
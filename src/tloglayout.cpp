@@ -0,0 +1,625 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tloglayout.h"
+#include <QDateTime>
+#include <QtEndian>
+#include <TAccessLog>
+#include <TLog>
+#include <TLogger>
+#include <atomic>
+#include <cstring>
+
+/*!
+  \class TLogLayout
+  \brief The TLogLayout class converts logs to text according to a layout,
+  such as "%d %5P %m%n", compiled once into a list of elements.
+
+  The formatted timestamp is cached per second in each thread unless
+  the date-time format contains milliseconds.
+
+  Instead of the layout, logs can be output in a structured format; JSON
+  lines or binary records. In the binary format, a record starts with
+  the magic byte 0xF1, the record type ('L' for log, 'A' for access log)
+  and the 32-bit length of the body. Integers are little-endian and
+  strings are preceded by their 32-bit lengths. The body of a log is
+  timestamp(ns) i64, PID i64, thread ID u64, priority i32 and message.
+  The body of an access log is timestamp(ns) i64, latency(ns) i64,
+  thread ID u64, socket ID i32, status code i32, bytes i32, remote host,
+  method, path, request line, the 8-bit number of phases and the
+  durations(ns) i64 of the phases. decodeBinary() converts a record to
+  JSON.
+*/
+
+namespace {
+std::atomic<quint32> layoutCounter {0};
+
+struct TimestampCache {
+    quint32 layoutId {0};
+    qint64 secs {-1};
+    int spec {0};
+    QByteArray text;
+};
+
+constexpr int TIMESTAMP_CACHE_SIZE = 4;  // layouts per thread
+thread_local TimestampCache timestampCache[TIMESTAMP_CACHE_SIZE];
+
+constexpr quint8 BINARY_MAGIC = 0xF1;
+constexpr int BINARY_HEADER_LENGTH = 6;
+
+template <typename T>
+inline void appendInt(QByteArray &buffer, T value)
+{
+    T le = qToLittleEndian(value);
+    buffer.append(reinterpret_cast<const char *>(&le), sizeof(T));
+}
+
+
+inline void appendString(QByteArray &buffer, const QByteArray &str)
+{
+    appendInt<quint32>(buffer, str.length());
+    buffer.append(str);
+}
+
+
+class BinaryReader {
+public:
+    BinaryReader(const char *data, int length) :
+        data(data), length(length) { }
+
+    template <typename T>
+    T readInt()
+    {
+        T value = 0;
+        if (pos + (int)sizeof(T) > length) {
+            ok = false;
+        } else {
+            std::memcpy(&value, data + pos, sizeof(T));
+            pos += sizeof(T);
+        }
+        return qFromLittleEndian(value);
+    }
+
+    QByteArray readString()
+    {
+        quint32 len = readInt<quint32>();
+        if (!ok || len > (quint32)(length - pos)) {
+            ok = false;
+            return QByteArray();
+        }
+        QByteArray str(data + pos, len);
+        pos += len;
+        return str;
+    }
+
+    bool atEnd() const { return pos >= length; }
+    bool ok {true};
+
+private:
+    const char *data;
+    int length;
+    int pos {0};
+};
+
+
+void appendJsonString(QByteArray &buffer, const QByteArray &str)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    buffer.append('"');
+    for (char c : str) {
+        switch (c) {
+        case '"':
+            buffer.append("\\\"");
+            break;
+        case '\\':
+            buffer.append("\\\\");
+            break;
+        case '\n':
+            buffer.append("\\n");
+            break;
+        case '\r':
+            buffer.append("\\r");
+            break;
+        case '\t':
+            buffer.append("\\t");
+            break;
+        default:
+            if ((uchar)c < 0x20) {
+                buffer.append("\\u00").append(hex[(uchar)c >> 4]).append(hex[c & 0xF]);
+            } else {
+                buffer.append(c);
+            }
+            break;
+        }
+    }
+    buffer.append('"');
+}
+
+
+inline qint64 toNsecs(const QDateTime &timestamp)
+{
+    return (timestamp.isValid()) ? timestamp.toMSecsSinceEpoch() * 1000000 : 0;
+}
+
+
+const QByteArray &priorityText(int priority, bool lower)
+{
+    static const QByteArray upperTexts[] = {"FATAL", "ERROR", "WARN", "INFO", "DEBUG", "TRACE"};
+    static const QByteArray lowerTexts[] = {"fatal", "error", "warn", "info", "debug", "trace"};
+    static const QByteArray empty;
+
+    if (priority < Tf::FatalLevel || priority > Tf::TraceLevel) {
+        return empty;
+    }
+    return (lower) ? lowerTexts[priority] : upperTexts[priority];
+}
+}
+
+
+TLogLayout::TLogLayout(const QByteArray &layout, const QByteArray &dateTimeFormat)
+{
+    compile(layout, dateTimeFormat);
+}
+
+/*!
+  Parses the \a layout and keeps the result. The \a dateTimeFormat is
+  the format of %d; if empty, the ISO 8601 format is used.
+*/
+void TLogLayout::compile(const QByteArray &layout, const QByteArray &dateTimeFormat)
+{
+    _layout = layout;
+    _dateTimeFormat = dateTimeFormat;
+    _elements.clear();
+    _literalLength = 0;
+    _cacheTimestamp = !dateTimeFormat.contains('z');  // milliseconds
+    _id = ++layoutCounter;
+
+    QByteArray literal;
+    QByteArray dig;
+    int pos = 0;
+
+    auto appendLiteral = [&]() {
+        if (!literal.isEmpty()) {
+            Element e;
+            e.text = literal;
+            _elements << e;
+            _literalLength += literal.length();
+            literal.resize(0);
+        }
+    };
+
+    while (pos < layout.length()) {
+        char c = layout.at(pos++);
+        if (c != '%') {
+            literal.append(c);
+            continue;
+        }
+
+        dig.resize(0);
+        for (;;) {
+            if (pos >= layout.length()) {
+                literal.append('%').append(dig);
+                break;
+            }
+
+            c = layout.at(pos++);
+            if (c >= '0' && c <= '9') {
+                dig += c;
+                continue;
+            }
+
+            QByteArray arg;
+            if (c == '{') {
+                int end = layout.indexOf('}', pos);
+                if (end < 0 || end + 1 >= layout.length()) {
+                    literal.append('%').append(dig).append(layout.mid(pos - 1));
+                    pos = layout.length();
+                    break;
+                }
+                arg = layout.mid(pos, end - pos);
+                pos = end + 1;
+                c = layout.at(pos++);
+            }
+
+            switch (c) {
+            case 'n':  // %n : newline
+                literal.append('\n');
+                break;
+
+            case '%':
+                literal.append('%').append(dig);
+                dig.resize(0);
+                continue;
+                break;
+
+            default: {
+                appendLiteral();
+                Element e;
+                e.conversion = c;
+                e.width = dig.toInt();
+                e.fill = (dig.length() > 0 && dig[0] == '0') ? '0' : ' ';
+                e.text = QByteArray("%") + dig + ((arg.isNull()) ? QByteArray() : '{' + arg + '}') + c;
+                if (c == 'L') {
+                    e.arg = TAccessLog::phaseFromName(arg);
+                    if (e.arg < 0) {
+                        e.conversion = 0;  // unknown phase as literal text
+                        _literalLength += e.text.length();
+                    }
+                }
+                _elements << e;
+                break;
+            }
+            }
+            break;
+        }
+    }
+    appendLiteral();
+}
+
+/*!
+  Converts the application or system \a log to text.
+  Supported conversions are %d, %p, %P, %t, %T, %i, %I, %m and %n.
+*/
+QByteArray TLogLayout::format(const TLog &log) const
+{
+    if (_outputFormat == Json) {
+        return toJson(log);
+    } else if (_outputFormat == Binary) {
+        return toBinary(log);
+    }
+
+    QByteArray message;
+    message.reserve(_literalLength + log.message.length() + 64);
+
+    for (const auto &e : _elements) {
+        switch (e.conversion) {
+        case 0:
+            message.append(e.text);
+            break;
+
+        case 'd':  // %d : timestamp
+            appendTimestamp(message, log.timestamp);
+            break;
+
+        case 'p':
+        case 'P': {  // %p or %P : priority
+            const QByteArray &pri = priorityText(log.priority, (e.conversion == 'p'));
+            if (!pri.isEmpty()) {
+                message.append(pri);
+                int d = e.width - pri.length();
+                if (d > 0) {
+                    message.append(d, ' ');
+                }
+            }
+            break;
+        }
+
+        case 't':
+        case 'T':  // %t or %T : thread ID (dec or hex)
+            appendNumber(message, (qint64)log.threadId, ((e.conversion == 't') ? 10 : 16), e.width, e.fill);
+            break;
+
+        case 'i':
+        case 'I':  // %i or %I : PID (dec or hex)
+            appendNumber(message, log.pid, ((e.conversion == 'i') ? 10 : 16), e.width, e.fill);
+            break;
+
+        case 'm':  // %m : message
+            message.append(log.message);
+            break;
+
+        default:
+            message.append(e.text);
+            break;
+        }
+    }
+    return message;
+}
+
+/*!
+  Converts the access \a log to text.
+  Supported conversions are %h, %d, %r, %s, %O, %D, %{phase}L and %n.
+  %D is the latency and %{phase}L is the duration of the phase in
+  microseconds; the phase is one of wait, receive, route, filter,
+  action, render, db, session, send and total.
+*/
+QByteArray TLogLayout::format(const TAccessLog &log) const
+{
+    if (_outputFormat == Json) {
+        return toJson(log);
+    } else if (_outputFormat == Binary) {
+        return toBinary(log);
+    }
+
+    QByteArray message;
+    message.reserve(_literalLength + log.remoteHost.length() + log.request.length() + 64);
+
+    for (const auto &e : _elements) {
+        switch (e.conversion) {
+        case 0:
+            message.append(e.text);
+            break;
+
+        case 'h':
+            message.append(log.remoteHost);
+            break;
+
+        case 'd':  // %d : timestamp
+            appendTimestamp(message, log.timestamp);
+            break;
+
+        case 'r':
+            message.append(log.request);
+            break;
+
+        case 's':
+            appendNumber(message, log.statusCode);
+            break;
+
+        case 'O':
+            appendNumber(message, log.responseBytes, 10, e.width, e.fill);
+            break;
+
+        case 'D':  // %D : latency in microseconds
+            appendNumber(message, (log.latencyNsecs >= 0) ? log.latencyNsecs / 1000 : -1, 10, e.width, e.fill);
+            break;
+
+        case 'L': {  // %{phase}L : phase in microseconds
+            qint64 nsecs = (e.arg == TAccessLog::PhaseCount) ? log.latencyNsecs : log.phaseNsecs[e.arg];
+            appendNumber(message, (nsecs >= 0) ? nsecs / 1000 : -1, 10, e.width, e.fill);
+            break;
+        }
+
+        default:
+            message.append(e.text);
+            break;
+        }
+    }
+    return message;
+}
+
+/*!
+  Appends the \a value in the \a base, right-aligned in the \a width
+  with the \a fill character, to the \a buffer without allocation of
+  temporary strings.
+*/
+void TLogLayout::appendNumber(QByteArray &buffer, qint64 value, int base, int width, char fill)
+{
+    static const char digits[] = "0123456789abcdef";
+    char buf[24];
+    char *end = buf + sizeof(buf);
+    char *p = end;
+    bool negative = (value < 0 && base == 10);
+    quint64 v = (negative) ? (quint64)(-(value + 1)) + 1 : (quint64)value;
+
+    do {
+        *--p = digits[v % base];
+        v /= base;
+    } while (v > 0);
+
+    int len = end - p + (negative ? 1 : 0);
+    int pad = qMax(width - len, 0);
+    if (negative && fill == '0') {
+        buffer.append('-').append(pad, '0');
+    } else {
+        buffer.append(pad, fill);
+        if (negative) {
+            buffer.append('-');
+        }
+    }
+    buffer.append(p, end - p);
+}
+
+
+void TLogLayout::appendTimestamp(QByteArray &buffer, const QDateTime &timestamp) const
+{
+    auto toText = [this](const QDateTime &dt) {
+        return (_dateTimeFormat.isEmpty()) ? dt.toString(Qt::ISODate).toLatin1() : dt.toString(_dateTimeFormat).toLocal8Bit();
+    };
+
+    if (!_cacheTimestamp) {
+        buffer.append(toText(timestamp));
+        return;
+    }
+
+    qint64 secs = timestamp.toMSecsSinceEpoch();
+    secs = (secs >= 0) ? secs / 1000 : (secs - 999) / 1000;
+    int spec = timestamp.timeSpec();
+    auto &cache = timestampCache[_id % TIMESTAMP_CACHE_SIZE];
+
+    if (cache.layoutId != _id || cache.secs != secs || cache.spec != spec) {
+        cache.layoutId = _id;
+        cache.secs = secs;
+        cache.spec = spec;
+        cache.text = toText(timestamp);
+    }
+    buffer.append(cache.text);
+}
+
+
+/*!
+  Returns the output format represented by the string \a str;
+  'text', 'json' or 'binary'.
+*/
+TLogLayout::OutputFormat TLogLayout::outputFormatFromString(const QString &str)
+{
+    QString format = str.trimmed().toLower();
+    if (format == QLatin1String("json")) {
+        return Json;
+    } else if (format == QLatin1String("binary")) {
+        return Binary;
+    }
+    return Text;
+}
+
+
+QByteArray TLogLayout::toJson(const TLog &log)
+{
+    QByteArray json;
+    json.reserve(log.message.length() + 96);
+    json.append("{\"ts\":");
+    appendNumber(json, toNsecs(log.timestamp));
+    json.append(",\"level\":");
+    appendJsonString(json, priorityText(log.priority, true));
+    json.append(",\"pid\":");
+    appendNumber(json, log.pid);
+    json.append(",\"thread_id\":");
+    appendNumber(json, (qint64)log.threadId);
+    json.append(",\"msg\":");
+    appendJsonString(json, log.message);
+    json.append("}\n");
+    return json;
+}
+
+
+QByteArray TLogLayout::toJson(const TAccessLog &log)
+{
+    QByteArray json;
+    json.reserve(log.remoteHost.length() + log.method.length() + log.path.length() + 160);
+    json.append("{\"ts\":");
+    appendNumber(json, (log.timestampNsecs > 0) ? log.timestampNsecs : toNsecs(log.timestamp));
+    json.append(",\"remote_host\":");
+    appendJsonString(json, log.remoteHost);
+    json.append(",\"method\":");
+    appendJsonString(json, log.method);
+    json.append(",\"path\":");
+    appendJsonString(json, log.path);
+    json.append(",\"status\":");
+    appendNumber(json, log.statusCode);
+    json.append(",\"bytes\":");
+    appendNumber(json, log.responseBytes);
+    json.append(",\"latency_ns\":");
+    appendNumber(json, log.latencyNsecs);
+    json.append(",\"socket_id\":");
+    appendNumber(json, log.socketId);
+    json.append(",\"thread_id\":");
+    appendNumber(json, (qint64)log.threadId);
+    json.append(",\"phases_ns\":{");
+    for (int i = 0; i < TAccessLog::PhaseCount; ++i) {
+        if (i > 0) {
+            json.append(',');
+        }
+        json.append('"').append(TAccessLog::phaseName(i)).append("\":");
+        appendNumber(json, log.phaseNsecs[i]);
+    }
+    json.append("}}\n");
+    return json;
+}
+
+
+QByteArray TLogLayout::toBinary(const TLog &log)
+{
+    QByteArray record;
+    record.reserve(BINARY_HEADER_LENGTH + log.message.length() + 32);
+    record.append((char)BINARY_MAGIC).append('L');
+    appendInt<quint32>(record, 0);  // body length
+    appendInt<qint64>(record, toNsecs(log.timestamp));
+    appendInt<qint64>(record, log.pid);
+    appendInt<quint64>(record, log.threadId);
+    appendInt<qint32>(record, log.priority);
+    appendString(record, log.message);
+    qToLittleEndian<quint32>(record.length() - BINARY_HEADER_LENGTH, record.data() + 2);
+    return record;
+}
+
+
+QByteArray TLogLayout::toBinary(const TAccessLog &log)
+{
+    QByteArray record;
+    record.reserve(BINARY_HEADER_LENGTH + log.remoteHost.length() + log.method.length() + log.path.length() + log.request.length() + 57 + TAccessLog::PhaseCount * 8);
+    record.append((char)BINARY_MAGIC).append('A');
+    appendInt<quint32>(record, 0);  // body length
+    appendInt<qint64>(record, (log.timestampNsecs > 0) ? log.timestampNsecs : toNsecs(log.timestamp));
+    appendInt<qint64>(record, log.latencyNsecs);
+    appendInt<quint64>(record, log.threadId);
+    appendInt<qint32>(record, log.socketId);
+    appendInt<qint32>(record, log.statusCode);
+    appendInt<qint32>(record, log.responseBytes);
+    appendString(record, log.remoteHost);
+    appendString(record, log.method);
+    appendString(record, log.path);
+    appendString(record, log.request);
+    appendInt<quint8>(record, TAccessLog::PhaseCount);
+    for (qint64 nsecs : log.phaseNsecs) {
+        appendInt<qint64>(record, nsecs);
+    }
+    qToLittleEndian<quint32>(record.length() - BINARY_HEADER_LENGTH, record.data() + 2);
+    return record;
+}
+
+/*!
+  Decodes the binary record at the beginning of the \a data of \a length
+  bytes into a JSON line, \a json. Returns the number of bytes of the
+  record, 0 if the data is incomplete, or -1 if it is not a valid record.
+*/
+int TLogLayout::decodeBinary(const char *data, int length, QByteArray &json)
+{
+    if (length < BINARY_HEADER_LENGTH) {
+        return 0;
+    }
+
+    if ((quint8)data[0] != BINARY_MAGIC) {
+        return -1;
+    }
+
+    quint32 bodyLength;
+    std::memcpy(&bodyLength, data + 2, sizeof(bodyLength));
+    bodyLength = qFromLittleEndian(bodyLength);
+    if (bodyLength > (quint32)(length - BINARY_HEADER_LENGTH)) {
+        return 0;
+    }
+
+    BinaryReader reader(data + BINARY_HEADER_LENGTH, bodyLength);
+    switch (data[1]) {
+    case 'L': {
+        TLog log;
+        log.timestamp = QDateTime::fromMSecsSinceEpoch(reader.readInt<qint64>() / 1000000);
+        log.pid = reader.readInt<qint64>();
+        log.threadId = reader.readInt<quint64>();
+        log.priority = reader.readInt<qint32>();
+        log.message = reader.readString();
+        if (!reader.ok) {
+            return -1;
+        }
+        json = toJson(log);
+        break;
+    }
+
+    case 'A': {
+        TAccessLog log;
+        log.timestampNsecs = reader.readInt<qint64>();
+        log.latencyNsecs = reader.readInt<qint64>();
+        log.threadId = reader.readInt<quint64>();
+        log.socketId = reader.readInt<qint32>();
+        log.statusCode = reader.readInt<qint32>();
+        log.responseBytes = reader.readInt<qint32>();
+        log.remoteHost = reader.readString();
+        log.method = reader.readString();
+        log.path = reader.readString();
+        log.request = reader.readString();
+        if (!reader.atEnd()) {
+            int count = reader.readInt<quint8>();
+            for (int i = 0; i < count; ++i) {
+                qint64 nsecs = reader.readInt<qint64>();
+                if (i < TAccessLog::PhaseCount) {
+                    log.phaseNsecs[i] = nsecs;
+                }
+            }
+        }
+        if (!reader.ok) {
+            return -1;
+        }
+        json = toJson(log);
+        break;
+    }
+
+    default:
+        return -1;
+    }
+    return BINARY_HEADER_LENGTH + bodyLength;
+}
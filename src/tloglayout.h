@@ -0,0 +1,57 @@
+#pragma once
+#include <QByteArray>
+#include <QVector>
+#include <TGlobal>
+
+class QDateTime;
+class QString;
+class TLog;
+class TAccessLog;
+
+
+class T_CORE_EXPORT TLogLayout {
+public:
+    enum OutputFormat {
+        Text = 0,
+        Json,
+        Binary,
+    };
+
+    TLogLayout() { }
+    TLogLayout(const QByteArray &layout, const QByteArray &dateTimeFormat);
+
+    void compile(const QByteArray &layout, const QByteArray &dateTimeFormat);
+    const QByteArray &layout() const { return _layout; }
+    const QByteArray &dateTimeFormat() const { return _dateTimeFormat; }
+    QByteArray format(const TLog &log) const;
+    QByteArray format(const TAccessLog &log) const;
+    OutputFormat outputFormat() const { return _outputFormat; }
+    void setOutputFormat(OutputFormat format) { _outputFormat = format; }
+
+    static void appendNumber(QByteArray &buffer, qint64 value, int base = 10, int width = 0, char fill = ' ');
+    static OutputFormat outputFormatFromString(const QString &str);
+    static int decodeBinary(const char *data, int length, QByteArray &json);
+
+private:
+    struct Element {
+        char conversion {0};  // 0: literal text
+        char fill {' '};
+        int width {0};
+        int arg {-1};  // argument in braces, such as a phase of %{route}L
+        QByteArray text;  // literal text, or the conversion as written
+    };
+
+    void appendTimestamp(QByteArray &buffer, const QDateTime &timestamp) const;
+    static QByteArray toJson(const TLog &log);
+    static QByteArray toJson(const TAccessLog &log);
+    static QByteArray toBinary(const TLog &log);
+    static QByteArray toBinary(const TAccessLog &log);
+
+    QByteArray _layout;
+    QByteArray _dateTimeFormat;
+    QVector<Element> _elements;
+    int _literalLength {0};
+    bool _cacheTimestamp {true};
+    quint32 _id {0};
+    OutputFormat _outputFormat {Text};
+};
@@ -0,0 +1,428 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tlogwriter.h"
+#include "tfcore_unix.h"
+#include <QString>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <thread>
+
+/*!
+  \class TLogWriter
+  \brief The TLogWriter class writes log records to files on a dedicated
+  thread.
+
+  Every thread appends its records into its own single-producer/single-consumer
+  ring buffer without taking any lock. The writer thread drains all the rings
+  every few milliseconds, gathering consecutive records for the same file
+  into one writev() call.
+*/
+
+namespace {
+constexpr int FLUSH_INTERVAL_MSECS = 5;
+constexpr int MAX_IOVEC_COUNT = 1024;  // IOV_MAX of Linux
+constexpr int UNSAFE_FLUSH_WAIT_MSECS = 1000;
+constexpr int SINK_INDEX_BITS = 8;
+constexpr quint32 SINK_INDEX_MASK = (1 << SINK_INDEX_BITS) - 1;
+constexpr quint32 PADDING_KEY = 0xFFFFFFFF;  // wraps to the beginning of the ring
+constexpr int MIN_BUFFER_SIZE = 4 * 1024;
+constexpr int MAX_BUFFER_SIZE = 64 * 1024 * 1024;
+
+struct RecordHeader {
+    quint32 length;
+    quint32 sinkKey;
+};
+
+inline quint64 recordSize(quint32 length)
+{
+    return (sizeof(RecordHeader) + length + 7) & ~quint64(7);
+}
+}
+
+
+class TLogRing {
+public:
+    TLogRing(quint64 size) :
+        capacity(size), buffer(new char[size]) { }
+    ~TLogRing() { delete[] buffer; }
+
+    const quint64 capacity;  // power of 2
+    char *buffer;
+    TAtomic<quint64> head {0};  // advanced by the producer
+    char padding[64];  // keeps head and tail on separate cache lines
+    TAtomic<quint64> tail {0};  // advanced by the consumer
+    TAtomic<bool> orphaned {false};  // the producer thread has finished
+    TLogRing *next {nullptr};
+
+    T_DISABLE_COPY(TLogRing)
+    T_DISABLE_MOVE(TLogRing)
+};
+
+
+namespace {
+struct LocalRing {
+    TLogRing *ring {nullptr};
+
+    ~LocalRing()
+    {
+        if (ring) {
+            // Released by the consumer after drained
+            ring->orphaned.store(true);
+            ring = nullptr;
+        }
+    }
+};
+
+thread_local LocalRing localRingHolder;
+}
+
+
+TLogWriter::TLogWriter() :
+    QThread(),
+    iov(new struct iovec[MAX_IOVEC_COUNT])
+{
+}
+
+
+TLogWriter::~TLogWriter()
+{
+    requestInterruption();
+    wait();
+    drain(true);
+    delete[] iov;
+}
+
+/*!
+  Returns a pointer to the TLogWriter object, starting the writer thread
+  at the first call.
+*/
+TLogWriter *TLogWriter::instance()
+{
+    static TLogWriter *logWriter = []() {
+        auto *writer = new TLogWriter;
+        writer->start();
+        return writer;
+    }();
+    return logWriter;
+}
+
+/*!
+  Returns the overflow policy represented by the string \a str;
+  'block', 'drop' or 'count'.
+*/
+TLogWriter::OverflowPolicy TLogWriter::overflowPolicyFromString(const QString &str)
+{
+    QString policy = str.trimmed().toLower();
+    if (policy == QLatin1String("drop")) {
+        return Drop;
+    } else if (policy == QLatin1String("count")) {
+        return CountDropped;
+    }
+    return Block;
+}
+
+/*!
+  Sets the size of the ring buffer of each thread to \a size bytes, rounded
+  up to a power of 2. It takes effect for the threads that write their first
+  log record after this call.
+*/
+void TLogWriter::setBufferSize(int size)
+{
+    int cap = MIN_BUFFER_SIZE;
+    while (cap < size && cap < MAX_BUFFER_SIZE) {
+        cap <<= 1;
+    }
+    ringCapacity.store(cap);
+}
+
+/*!
+  Registers the file descriptor \a fd as a destination of log records and
+  returns its sink ID, or -1 if no more sinks are available.
+*/
+int TLogWriter::addSink(int fd)
+{
+    if (fd < 0) {
+        return -1;
+    }
+
+    for (int i = 0; i < MaxSinks; ++i) {
+        int expected = -1;
+        if (sinks[i].fd.compareExchangeStrong(expected, fd)) {
+            // Generation keeps records for a closed sink out of a reused slot
+            quint32 generation = (sinkGeneration++ % 0x7FFFFF) + 1;
+            quint32 key = (generation << SINK_INDEX_BITS) | i;
+            sinks[i].dropped.store(0);
+            sinks[i].key.store(key);
+            return (int)key;
+        }
+    }
+    return -1;
+}
+
+/*!
+  Unregisters the sink \a sink. Records for it which are still buffered
+  are discarded; call flush() beforehand to write them out.
+*/
+void TLogWriter::removeSink(int sink)
+{
+    quint32 index = (quint32)sink & SINK_INDEX_MASK;
+    if (sink < 0 || index >= MaxSinks || sinks[index].key.load() != (quint32)sink) {
+        return;
+    }
+
+    sinks[index].key.store(0);
+    // Waits for the consumer which may be writing to the descriptor
+    while (draining.load()) {
+        std::this_thread::yield();
+    }
+    sinks[index].fd.store(-1);
+}
+
+/*!
+  Appends the record \a data of \a length bytes for the sink \a sink to
+  the ring buffer of the current thread. Returns false if the record has
+  been dropped due to buffer overflow.
+*/
+bool TLogWriter::write(int sink, const char *data, int length)
+{
+    quint32 index = (quint32)sink & SINK_INDEX_MASK;
+    if (Q_UNLIKELY(sink < 0 || index >= MaxSinks || length <= 0)) {
+        return false;
+    }
+
+    Sink &dest = sinks[index];
+    TLogRing *ring = localRing();
+    const quint64 size = recordSize(length);
+
+    if (Q_UNLIKELY(size > ring->capacity / 2)) {
+        // Too large to buffer; writes it directly
+        int fd = dest.fd.load();
+        return dest.key.load() == (quint32)sink && fd >= 0 && tf_write(fd, data, length) == length;
+    }
+
+    quint64 head = ring->head.load();
+    quint64 offset = head & (ring->capacity - 1);
+    quint64 contiguous = ring->capacity - offset;
+    quint64 need = (contiguous < size) ? contiguous + size : size;
+
+    while (head + need - ring->tail.load() > ring->capacity) {
+        if (overflowPolicy() != Block) {
+            dest.dropped++;
+            totalDropped++;
+            return false;
+        }
+
+        // Drains the rings by itself while the writer thread sleeps
+        if (drain(false) < 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    if (contiguous < size) {
+        auto *padding = reinterpret_cast<RecordHeader *>(ring->buffer + offset);
+        padding->length = 0;
+        padding->sinkKey = PADDING_KEY;
+        head += contiguous;
+        offset = 0;
+    }
+
+    auto *header = reinterpret_cast<RecordHeader *>(ring->buffer + offset);
+    header->length = length;
+    header->sinkKey = sink;
+    std::memcpy(header + 1, data, length);
+    ring->head.store(head + size);
+    return true;
+}
+
+/*!
+  Writes out all the records buffered so far.
+*/
+void TLogWriter::flush()
+{
+    while (drain(false) < 0) {
+        std::this_thread::yield();
+    }
+}
+
+/*!
+  Writes out the buffered records in a signal handler. Waits for another
+  thread draining the rings for up to a second, and gives up if it does
+  not finish, as when the signal interrupted the draining on this thread;
+  the rings are never drained by two threads at once. The rings of finished
+  threads are not freed here, since delete is not async-signal-safe.
+*/
+void TLogWriter::flushUnsafe()
+{
+    for (int i = 0; i < UNSAFE_FLUSH_WAIT_MSECS; ++i) {
+        if (drain(false) >= 0) {
+            return;
+        }
+        struct timespec ts = {0, 1000000L};
+        ::nanosleep(&ts, nullptr);  // async-signal-safe
+    }
+}
+
+
+void TLogWriter::run()
+{
+    while (!isInterruptionRequested()) {
+        drain(true);
+        QThread::msleep(FLUSH_INTERVAL_MSECS);
+    }
+}
+
+
+TLogRing *TLogWriter::localRing()
+{
+    TLogRing *ring = localRingHolder.ring;
+    if (Q_UNLIKELY(!ring)) {
+        ring = new TLogRing(ringCapacity.load());
+        TLogRing *top;
+        do {
+            top = incomingRings.load();
+            ring->next = top;
+        } while (!incomingRings.compareExchange(top, ring));
+        localRingHolder.ring = ring;
+    }
+    return ring;
+}
+
+/*!
+  Drains the rings of all the threads as their consumer, and frees the
+  rings of the finished threads if \a reclaim is true; only the writer
+  thread and the destructor reclaim them. Returns the number of bytes
+  written, or -1 if another thread is draining them.
+*/
+qint64 TLogWriter::drain(bool reclaim)
+{
+    bool expected = false;
+    if (!draining.compareExchangeStrong(expected, true)) {
+        return -1;
+    }
+
+    // Adopts the rings of new threads
+    TLogRing *ring = incomingRings.exchange(nullptr);
+    while (ring) {
+        TLogRing *next = ring->next;
+        ring->next = rings;
+        rings = ring;
+        ring = next;
+    }
+
+    qint64 total = 0;
+    TLogRing **link = &rings;
+    while (*link) {
+        ring = *link;
+        bool orphaned = ring->orphaned.load();  // loads before draining
+        total += drainRing(ring, iov, MAX_IOVEC_COUNT);
+
+        if (orphaned && reclaim) {
+            *link = ring->next;
+            delete ring;
+        } else {
+            link = &ring->next;
+        }
+    }
+
+    reportDropped();
+    draining.store(false);
+    return total;
+}
+
+
+qint64 TLogWriter::drainRing(TLogRing *ring, struct iovec *vec, int maxCount)
+{
+    const quint64 head = ring->head.load();
+    quint64 tail = ring->tail.load();
+    quint32 batchKey = 0;
+    int fd = -1;
+    int count = 0;
+    qint64 total = 0;
+
+    while (tail < head) {
+        quint64 offset = tail & (ring->capacity - 1);
+        auto *header = reinterpret_cast<RecordHeader *>(ring->buffer + offset);
+
+        if (header->sinkKey == PADDING_KEY) {
+            tail += ring->capacity - offset;
+            continue;
+        }
+
+        if (header->sinkKey != batchKey || count == maxCount) {
+            total += writeBatch(fd, vec, count);
+            count = 0;
+            batchKey = header->sinkKey;
+
+            quint32 index = batchKey & SINK_INDEX_MASK;
+            fd = (index < MaxSinks && sinks[index].key.load() == batchKey) ? sinks[index].fd.load() : -1;
+        }
+
+        if (fd >= 0) {
+            vec[count].iov_base = header + 1;
+            vec[count].iov_len = header->length;
+            count++;
+        }
+        tail += recordSize(header->length);
+    }
+
+    total += writeBatch(fd, vec, count);
+    ring->tail.store(tail);
+    return total;
+}
+
+
+qint64 TLogWriter::writeBatch(int fd, struct iovec *vec, int count)
+{
+    qint64 total = 0;
+    int idx = 0;
+
+    if (fd < 0) {
+        return 0;
+    }
+
+    while (idx < count) {
+        int len = tf_writev(fd, vec + idx, std::min(count - idx, MAX_IOVEC_COUNT));
+        if (len <= 0) {
+            break;  // discards the records
+        }
+
+        total += len;
+        while (idx < count && (size_t)len >= vec[idx].iov_len) {
+            len -= vec[idx].iov_len;
+            idx++;
+        }
+        if (idx < count && len > 0) {
+            // Partially written
+            vec[idx].iov_base = (char *)vec[idx].iov_base + len;
+            vec[idx].iov_len -= len;
+        }
+    }
+    return total;
+}
+
+
+void TLogWriter::reportDropped()
+{
+    if (overflowPolicy() != CountDropped) {
+        return;
+    }
+
+    for (auto &sink : sinks) {
+        int fd = sink.fd.load();
+        if (fd < 0 || sink.dropped.load() == 0) {
+            continue;
+        }
+
+        quint64 count = sink.dropped.exchange(0);
+        char msg[96];
+        int len = std::snprintf(msg, sizeof(msg), "TLogWriter: %llu log records dropped, buffer full\n", (unsigned long long)count);
+        tf_write(fd, msg, len);
+    }
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "tatomic.h"
+#include "tatomicptr.h"
+#include <QThread>
+#include <TGlobal>
+
+struct iovec;
+class TLogRing;
+
+
+class T_CORE_EXPORT TLogWriter : public QThread {
+public:
+    enum OverflowPolicy {
+        Block = 0,
+        Drop,
+        CountDropped,
+    };
+
+    int addSink(int fd);
+    void removeSink(int sink);
+    bool write(int sink, const char *data, int length);
+    void flush();
+    void flushUnsafe();
+
+    OverflowPolicy overflowPolicy() const { return (OverflowPolicy)policy.load(); }
+    void setOverflowPolicy(OverflowPolicy overflowPolicy) { policy.store(overflowPolicy); }
+    int bufferSize() const { return ringCapacity.load(); }
+    void setBufferSize(int size);
+    quint64 droppedCount() const { return totalDropped.load(); }
+
+    static OverflowPolicy overflowPolicyFromString(const QString &str);
+    static TLogWriter *instance();
+
+    enum {
+        MaxSinks = 64,
+        DefaultBufferSize = 256 * 1024,
+    };
+
+protected:
+    void run() override;
+
+private:
+    struct Sink {
+        TAtomic<int> fd {-1};
+        TAtomic<quint32> key {0};
+        TAtomic<quint64> dropped {0};
+    };
+
+    TLogWriter();
+    ~TLogWriter();
+    TLogRing *localRing();
+    qint64 drain(bool reclaim);
+    qint64 drainRing(TLogRing *ring, struct iovec *vec, int maxCount);
+    qint64 writeBatch(int fd, struct iovec *vec, int count);
+    void reportDropped();
+
+    Sink sinks[MaxSinks];
+    TAtomic<quint32> sinkGeneration {0};
+    TAtomicPtr<TLogRing> incomingRings {nullptr};  // rings not yet adopted by the consumer
+    TLogRing *rings {nullptr};  // consumer side only
+    TAtomic<bool> draining {false};
+    TAtomic<int> policy {Block};
+    TAtomic<int> ringCapacity {DefaultBufferSize};
+    TAtomic<quint64> totalDropped {0};
+    struct iovec *iov {nullptr};  // consumer side only
+
+    T_DISABLE_COPY(TLogWriter)
+    T_DISABLE_MOVE(TLogWriter)
+};
+
@@ -0,0 +1,508 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tmetrics.h"
+#include "thistogram.h"
+#include "tsystemglobal.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <TAccessLog>
+#include <TActionThread>
+#include <TAppSettings>
+#include <TWebApplication>
+#ifdef Q_OS_LINUX
+#include "tepollsocket.h"
+#endif
+
+/*!
+  \class TMetricCounter
+  \brief The TMetricCounter class is a monotonically increasing counter
+  sharded per thread; the shards are summed up when read.
+*/
+
+/*!
+  \class TMetricGauge
+  \brief The TMetricGauge class is a value that can go up and down.
+*/
+
+/*!
+  \class TMetrics
+  \brief The TMetrics class is the registry of the runtime metrics, which
+  are exposed in the Prometheus text format.
+
+  A metric is identified by its name and labels, such as 'method="GET"',
+  and is created at the first lookup; it is never deleted. Lookups are
+  cached per thread, so the registry lock is taken only once per metric
+  and thread. Histograms record durations in nanoseconds and are exposed
+  in seconds.
+*/
+
+const char *const TMetrics::ContentType = "text/plain; version=0.0.4; charset=utf-8";
+
+namespace {
+enum MetricType {
+    CounterType = 0,
+    GaugeType,
+    HistogramType,
+};
+
+const char *const TYPE_NAMES[] = {"counter", "gauge", "histogram"};
+
+// Upper bounds of the histogram buckets in seconds
+const double BUCKET_BOUNDS[] = {0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10};
+
+struct Series {
+    QByteArray labels;
+    TMetricCounter *counter {nullptr};
+    TMetricGauge *gauge {nullptr};
+    const THistogram *histogram {nullptr};
+    std::function<qint64()> function;
+};
+
+struct Family {
+    int type {CounterType};
+    QByteArray help;
+    QList<Series *> series;
+};
+
+struct Registry {
+    QMutex mutex;
+    QMap<QByteArray, Family> families;
+};
+
+Registry *registry()
+{
+    static Registry *reg = new Registry;  // never deleted; used until exit
+    return reg;
+}
+
+std::atomic<int> enabledState {-1};
+std::atomic<int> shardCounter {0};
+thread_local QHash<QByteArray, void *> localCache;
+
+
+Series *findSeries(const QByteArray &name, const QByteArray &labels, int type, const char *help)
+{
+    Registry *reg = registry();
+    QMutexLocker locker(&reg->mutex);
+
+    auto it = reg->families.find(name);
+    if (it == reg->families.end()) {
+        it = reg->families.insert(name, Family());
+        it->type = type;
+    } else if (it->type != type) {
+        tSystemError("Metric type mismatch: %s", name.data());
+        return nullptr;
+    }
+
+    if (help && it->help.isEmpty()) {
+        it->help = help;
+    }
+
+    for (auto *series : it->series) {
+        if (series->labels == labels) {
+            return series;
+        }
+    }
+
+    auto *series = new Series;
+    series->labels = labels;
+    it->series << series;
+    return series;
+}
+
+
+inline QByteArray cacheKey(char type, const QByteArray &name, const QByteArray &labels)
+{
+    QByteArray key;
+    key.reserve(name.length() + labels.length() + 2);
+    key.append(type).append(name).append('{').append(labels);
+    return key;
+}
+
+
+void appendSample(QByteArray &out, const QByteArray &name, const QByteArray &labels, const QByteArray &extraLabel, const QByteArray &value)
+{
+    out.append(name);
+    if (!labels.isEmpty() || !extraLabel.isEmpty()) {
+        out.append('{').append(labels);
+        if (!labels.isEmpty() && !extraLabel.isEmpty()) {
+            out.append(',');
+        }
+        out.append(extraLabel).append('}');
+    }
+    out.append(' ').append(value).append('\n');
+}
+
+
+void appendHistogram(QByteArray &out, const QByteArray &name, const QByteArray &labels, const THistogram &histogram)
+{
+    const QVector<quint64> counts = histogram.bucketCounts();
+    const QByteArray bucketName = name + "_bucket";
+    quint64 cumulative = 0;
+    int idx = 0;
+
+    for (double bound : BUCKET_BOUNDS) {
+        qint64 limit = (qint64)(bound * 1000000000);
+        while (idx < counts.count() && THistogram::bucketUpperBound(idx) <= limit) {
+            cumulative += counts[idx++];
+        }
+        appendSample(out, bucketName, labels, "le=\"" + QByteArray::number(bound, 'g', 6) + '"', QByteArray::number(cumulative));
+    }
+
+    while (idx < counts.count()) {
+        cumulative += counts[idx++];
+    }
+    appendSample(out, bucketName, labels, "le=\"+Inf\"", QByteArray::number(cumulative));
+    appendSample(out, name + "_sum", labels, QByteArray(), QByteArray::number(histogram.sum() / 1e9, 'g', 12));
+    appendSample(out, name + "_count", labels, QByteArray(), QByteArray::number(cumulative));
+}
+
+
+QByteArray metricName(const QByteArray &key)
+{
+    int idx = key.indexOf('{');
+    return (idx < 0) ? key : key.left(idx);
+}
+}
+
+
+qint64 TMetricCounter::value() const
+{
+    qint64 total = 0;
+    for (auto &shard : _shards) {
+        total += shard.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+
+int TMetricCounter::shardIndex()
+{
+    static thread_local int index = shardCounter.fetch_add(1, std::memory_order_relaxed) % ShardCount;
+    return index;
+}
+
+/*!
+  Returns the counter named \a name with the \a labels, creating it if
+  it does not exist. The \a help is the description of the metric.
+*/
+TMetricCounter &TMetrics::counter(const QByteArray &name, const QByteArray &labels, const char *help)
+{
+    static TMetricCounter dummy;
+    void *&cached = localCache[cacheKey('c', name, labels)];
+    if (Q_UNLIKELY(!cached)) {
+        Series *series = findSeries(name, labels, CounterType, help);
+        if (series && !series->counter) {
+            series->counter = new TMetricCounter;
+        }
+        cached = (series) ? series->counter : &dummy;
+    }
+    return *static_cast<TMetricCounter *>(cached);
+}
+
+/*!
+  Returns the gauge named \a name with the \a labels, creating it if
+  it does not exist.
+*/
+TMetricGauge &TMetrics::gauge(const QByteArray &name, const QByteArray &labels, const char *help)
+{
+    static TMetricGauge dummy;
+    void *&cached = localCache[cacheKey('g', name, labels)];
+    if (Q_UNLIKELY(!cached)) {
+        Series *series = findSeries(name, labels, GaugeType, help);
+        if (series && !series->gauge && !series->function) {
+            series->gauge = new TMetricGauge;
+        }
+        cached = (series && series->gauge) ? series->gauge : &dummy;
+    }
+    return *static_cast<TMetricGauge *>(cached);
+}
+
+/*!
+  Returns the histogram named \a name with the \a labels, creating it if
+  it does not exist. Values are recorded in nanoseconds.
+*/
+THistogram &TMetrics::histogram(const QByteArray &name, const QByteArray &labels, const char *help)
+{
+    static THistogram dummy;
+    void *&cached = localCache[cacheKey('h', name, labels)];
+    if (Q_UNLIKELY(!cached)) {
+        Series *series = findSeries(name, labels, HistogramType, help);
+        if (series && !series->histogram) {
+            series->histogram = new THistogram;
+        }
+        // Registered by registerHistogram() if not created here
+        cached = (series) ? const_cast<THistogram *>(series->histogram) : &dummy;
+    }
+    return *static_cast<THistogram *>(cached);
+}
+
+/*!
+  Registers the gauge named \a name with the \a labels, whose value is
+  returned by the \a function when the metrics are collected. The function
+  must not call the functions of TMetrics.
+*/
+void TMetrics::registerGauge(const QByteArray &name, const QByteArray &labels, const std::function<qint64()> &function, const char *help)
+{
+    Series *series = findSeries(name, labels, GaugeType, help);
+    if (series) {
+        QMutexLocker locker(&registry()->mutex);
+        series->function = function;
+    }
+}
+
+/*!
+  Registers the \a histogram owned by the caller as the histogram named
+  \a name with the \a labels. The histogram must live until exit.
+*/
+void TMetrics::registerHistogram(const QByteArray &name, const QByteArray &labels, const THistogram *histogram, const char *help)
+{
+    Series *series = findSeries(name, labels, HistogramType, help);
+    if (series && !series->histogram) {
+        QMutexLocker locker(&registry()->mutex);
+        series->histogram = histogram;
+    }
+}
+
+/*!
+  Registers the metrics of the application server; the latency breakdown
+  of requests and the number of open connections.
+*/
+void TMetrics::registerDefaultMetrics()
+{
+    static bool registered = false;
+    if (registered) {
+        return;
+    }
+    registered = true;
+
+    for (int i = 0; i < TAccessLog::PhaseCount; ++i) {
+        registerHistogram("tf_http_request_phase_duration_seconds", label("phase", TAccessLog::phaseName(i)),
+            &TAccessLog::histogram(i), "Duration of each phase of HTTP requests");
+    }
+    registerHistogram("tf_http_request_duration_seconds", QByteArray(), &TAccessLog::histogram(TAccessLog::PhaseCount),
+        "Duration of HTTP requests from the first byte to the last byte sent");
+
+    switch (Tf::app()->multiProcessingModule()) {
+    case TWebApplication::Thread:
+        registerGauge("tf_http_open_connections", QByteArray(), []() { return (qint64)TActionThread::threadCount(); },
+            "Number of open HTTP connections");
+        break;
+
+    case TWebApplication::Epoll:
+#ifdef Q_OS_LINUX
+        registerGauge("tf_http_open_connections", QByteArray(), []() { return (qint64)TEpollSocket::socketCount(); },
+            "Number of open HTTP connections, including keep-alive ones");
+#endif
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*!
+  Returns the label \a key with the \a value escaped, such as 'key="value"'.
+*/
+QByteArray TMetrics::label(const char *key, const QByteArray &value)
+{
+    QByteArray lbl;
+    lbl.reserve(value.length() + 16);
+    lbl.append(key).append("=\"");
+    for (char c : value) {
+        switch (c) {
+        case '\\':
+            lbl.append("\\\\");
+            break;
+        case '"':
+            lbl.append("\\\"");
+            break;
+        case '\n':
+            lbl.append("\\n");
+            break;
+        default:
+            lbl.append(c);
+            break;
+        }
+    }
+    lbl.append('"');
+    return lbl;
+}
+
+/*!
+  Returns all the metrics in the Prometheus text format.
+*/
+QByteArray TMetrics::exposition()
+{
+    QByteArray out;
+    out.reserve(8192);
+
+    Registry *reg = registry();
+    QMutexLocker locker(&reg->mutex);
+
+    for (auto it = reg->families.cbegin(); it != reg->families.cend(); ++it) {
+        const QByteArray &name = it.key();
+        const Family &family = it.value();
+
+        if (!family.help.isEmpty()) {
+            out.append("# HELP ").append(name).append(' ').append(family.help).append('\n');
+        }
+        out.append("# TYPE ").append(name).append(' ').append(TYPE_NAMES[family.type]).append('\n');
+
+        for (const auto *series : family.series) {
+            if (family.type == HistogramType) {
+                if (series->histogram) {
+                    appendHistogram(out, name, series->labels, *series->histogram);
+                }
+                continue;
+            }
+
+            qint64 value = 0;
+            if (series->counter) {
+                value = series->counter->value();
+            } else if (series->gauge) {
+                value = series->gauge->value();
+            } else if (series->function) {
+                value = series->function();
+            }
+            appendSample(out, name, series->labels, QByteArray(), QByteArray::number(value));
+        }
+    }
+    return out;
+}
+
+/*!
+  Merges the \a expositions of several processes into one by summing
+  up the values of the same samples.
+*/
+QByteArray TMetrics::merge(const QList<QByteArray> &expositions)
+{
+    struct MergedFamily {
+        QByteArray help;
+        QByteArray type;
+        QList<QByteArray> keys;
+        QHash<QByteArray, double> values;
+    };
+    QMap<QByteArray, MergedFamily> families;
+
+    for (const auto &exposition : expositions) {
+        QByteArray current;
+        for (const QByteArray &line : exposition.split('\n')) {
+            if (line.isEmpty()) {
+                continue;
+            }
+
+            if (line.startsWith("# HELP ") || line.startsWith("# TYPE ")) {
+                QByteArray name = line.mid(7, line.indexOf(' ', 7) - 7);
+                auto &family = families[name];
+                QByteArray &text = (line[2] == 'H') ? family.help : family.type;
+                if (text.isEmpty()) {
+                    text = line;
+                }
+                current = name;
+                continue;
+            }
+
+            if (line.startsWith('#')) {
+                continue;
+            }
+
+            int sp = line.lastIndexOf(' ');
+            if (sp <= 0) {
+                continue;
+            }
+            QByteArray key = line.left(sp);
+            QByteArray name = (!current.isEmpty() && key.startsWith(current)) ? current : metricName(key);
+            auto &family = families[name];
+            if (!family.values.contains(key)) {
+                family.keys << key;
+            }
+            family.values[key] += line.mid(sp + 1).toDouble();
+        }
+    }
+
+    QByteArray out;
+    for (const auto &family : families) {
+        if (!family.help.isEmpty()) {
+            out.append(family.help).append('\n');
+        }
+        if (!family.type.isEmpty()) {
+            out.append(family.type).append('\n');
+        }
+        for (const auto &key : family.keys) {
+            double value = family.values.value(key);
+            bool integral = (value == (double)(qint64)value && qAbs(value) < 9007199254740992.0);  // 2^53
+            out.append(key).append(' ').append((integral) ? QByteArray::number((qint64)value) : QByteArray::number(value, 'g', 12)).append('\n');
+        }
+    }
+    return out;
+}
+
+/*!
+  Writes the metrics to the file \a filePath atomically, for the
+  aggregation by the manager process.
+*/
+bool TMetrics::writeSnapshot(const QString &filePath)
+{
+    QDir().mkpath(QFileInfo(filePath).absolutePath());
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        tSystemError("Failed to write metrics: %s", qPrintable(filePath));
+        return false;
+    }
+    file.write(exposition());
+    return file.commit();
+}
+
+/*!
+  Returns the path of the snapshot file of the metrics of the application
+  server whose process ID is \a pid.
+*/
+QString TMetrics::snapshotPath(qint64 pid)
+{
+    return Tf::app()->tmpPath() + QLatin1String("metrics/") + QString::number(pid) + QLatin1String(".prom");
+}
+
+/*!
+  Returns true if the metrics are exposed; Metrics.Path or Metrics.Port
+  is set in the application settings.
+*/
+bool TMetrics::isEnabled()
+{
+    int state = enabledState.load(std::memory_order_relaxed);
+    if (Q_UNLIKELY(state < 0)) {
+        auto *settings = Tf::appSettings();
+        state = (settings && (!path().isEmpty() || settings->value(Tf::MetricsPort).toInt() > 0)) ? 1 : 0;
+        enabledState.store(state, std::memory_order_relaxed);
+    }
+    return state > 0;
+}
+
+
+void TMetrics::setEnabled(bool enable)
+{
+    enabledState.store((enable) ? 1 : 0, std::memory_order_relaxed);
+}
+
+/*!
+  Returns the path of the URL where the application server exposes
+  its metrics, or an empty string if not exposed.
+*/
+QByteArray TMetrics::path()
+{
+    static const QByteArray metricsPath = []() {
+        auto *settings = Tf::appSettings();
+        return (settings) ? settings->value(Tf::MetricsPath).toByteArray().trimmed() : QByteArray();
+    }();
+    return metricsPath;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <TGlobal>
+#include <atomic>
+#include <functional>
+
+class THistogram;
+
+
+class T_CORE_EXPORT TMetricCounter {
+public:
+    TMetricCounter() { }
+
+    void add(qint64 value = 1) { _shards[shardIndex()].value.fetch_add(value, std::memory_order_relaxed); }
+    qint64 value() const;
+
+    enum {
+        ShardCount = 16,
+    };
+
+private:
+    struct Shard {
+        std::atomic<qint64> value {0};
+        char padding[56];  // one shard per cache line
+    };
+
+    static int shardIndex();
+    Shard _shards[ShardCount];
+
+    T_DISABLE_COPY(TMetricCounter)
+    T_DISABLE_MOVE(TMetricCounter)
+};
+
+
+class T_CORE_EXPORT TMetricGauge {
+public:
+    TMetricGauge() { }
+
+    void set(qint64 value) { _value.store(value, std::memory_order_relaxed); }
+    void add(qint64 value = 1) { _value.fetch_add(value, std::memory_order_relaxed); }
+    void sub(qint64 value = 1) { _value.fetch_sub(value, std::memory_order_relaxed); }
+    qint64 value() const { return _value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<qint64> _value {0};
+
+    T_DISABLE_COPY(TMetricGauge)
+    T_DISABLE_MOVE(TMetricGauge)
+};
+
+
+class T_CORE_EXPORT TMetrics {
+public:
+    static TMetricCounter &counter(const QByteArray &name, const QByteArray &labels = QByteArray(), const char *help = nullptr);
+    static TMetricGauge &gauge(const QByteArray &name, const QByteArray &labels = QByteArray(), const char *help = nullptr);
+    static THistogram &histogram(const QByteArray &name, const QByteArray &labels = QByteArray(), const char *help = nullptr);
+    static void registerGauge(const QByteArray &name, const QByteArray &labels, const std::function<qint64()> &function, const char *help = nullptr);
+    static void registerHistogram(const QByteArray &name, const QByteArray &labels, const THistogram *histogram, const char *help = nullptr);
+    static void registerDefaultMetrics();
+
+    static QByteArray label(const char *key, const QByteArray &value);
+    static QByteArray exposition();
+    static QByteArray merge(const QList<QByteArray> &expositions);
+    static bool writeSnapshot(const QString &filePath);
+    static QString snapshotPath(qint64 pid);
+
+    static bool isEnabled();
+    static void setEnabled(bool enable);
+    static QByteArray path();
+
+    static const char *const ContentType;
+};
@@ -8,6 +8,7 @@
 #include <TBson>
 #include <TMongoCursor>
 #include <TMongoDriver>
+#include <TQueryTracer>
 #include <TSystemGlobal>
 extern "C" {
 #include "mongoc.h"
@@ -97,6 +98,7 @@ bool TMongoDriver::find(const QString &collection, const QVariantMap &criteria,
 
     bson_error_t error;
     clearError();
+    TQueryTracer tracer(TQueryTracer::MongoDB);
 
     mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
     if (!col) {
@@ -139,6 +141,7 @@ bool TMongoDriver::find(const QString &collection, const QVariantMap &criteria,
     }
 
     mongoc_collection_destroy(col);
+    tracer.finish(QLatin1String("find ") + collection, (bool)cursor, -1, {criteria, orderBy});
     return (bool)cursor;
 }
 
@@ -164,6 +167,7 @@ bool TMongoDriver::insertOne(const QString &collection, const QVariantMap &objec
 
     bson_error_t error;
     clearError();
+    TQueryTracer tracer(TQueryTracer::MongoDB);
 
     mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
     bson_t rep;
@@ -179,6 +183,7 @@ bool TMongoDriver::insertOne(const QString &collection, const QVariantMap &objec
         tSystemError("MongoDB Insert Error: %s", error.message);
         setLastError(&error);
     }
+    tracer.finish(QLatin1String("insertOne ") + collection, res, -1, {object});
     return res;
 }
 
@@ -191,6 +196,7 @@ bool TMongoDriver::removeOne(const QString &collection, const QVariantMap &crite
 
     bson_error_t error;
     clearError();
+    TQueryTracer tracer(TQueryTracer::MongoDB);
 
     mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
     bson_t rep;
@@ -205,6 +211,7 @@ bool TMongoDriver::removeOne(const QString &collection, const QVariantMap &crite
         tSystemError("MongoDB Remove Error: %s", error.message);
         setLastError(&error);
     }
+    tracer.finish(QLatin1String("removeOne ") + collection, res, -1, {criteria});
     return res;
 }
 
@@ -217,6 +224,7 @@ bool TMongoDriver::removeMany(const QString &collection, const QVariantMap &crit
 
     bson_error_t error;
     clearError();
+    TQueryTracer tracer(TQueryTracer::MongoDB);
 
     mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
     bson_t rep;
@@ -231,6 +239,7 @@ bool TMongoDriver::removeMany(const QString &collection, const QVariantMap &crit
         tSystemError("MongoDB Remove Error: %s", error.message);
         setLastError(&error);
     }
+    tracer.finish(QLatin1String("removeMany ") + collection, res, -1, {criteria});
     return res;
 }
 
@@ -244,6 +253,7 @@ bool TMongoDriver::updateOne(const QString &collection, const QVariantMap &crite
 
     bson_error_t error;
     clearError();
+    TQueryTracer tracer(TQueryTracer::MongoDB);
 
     mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
     bson_t rep;
@@ -261,6 +271,7 @@ bool TMongoDriver::updateOne(const QString &collection, const QVariantMap &crite
         tSystemError("MongoDB Update Error: %s", error.message);
         setLastError(&error);
     }
+    tracer.finish(QLatin1String("updateOne ") + collection, res, -1, {criteria, object});
     return res;
 }
 
@@ -273,6 +284,7 @@ bool TMongoDriver::updateMany(const QString &collection, const QVariantMap &crit
 
     bson_error_t error;
     clearError();
+    TQueryTracer tracer(TQueryTracer::MongoDB);
 
     mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
     bson_t rep;
@@ -290,6 +302,7 @@ bool TMongoDriver::updateMany(const QString &collection, const QVariantMap &crit
         tSystemError("MongoDB UpdateMulti Error: %s", error.message);
         setLastError(&error);
     }
+    tracer.finish(QLatin1String("updateMany ") + collection, res, -1, {criteria, object});
     return res;
 }
 
@@ -304,6 +317,7 @@ qint64 TMongoDriver::count(const QString &collection, const QVariantMap &criteri
 
     bson_error_t error;
     clearError();
+    TQueryTracer tracer(TQueryTracer::MongoDB);
 
     mongoc_collection_t *col = mongoc_client_get_collection(mongoClient, qPrintable(dbName), qPrintable(collection));
 #if MONGOC_CHECK_VERSION(1, 11, 0)
@@ -317,6 +331,7 @@ qint64 TMongoDriver::count(const QString &collection, const QVariantMap &criteri
         tSystemError("MongoDB Count Error: %s", error.message);
         setLastError(&error);
     }
+    tracer.finish(QLatin1String("count ") + collection, count >= 0, count, {criteria});
     return count;
 }
 
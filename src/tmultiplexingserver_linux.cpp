@@ -18,6 +18,7 @@
 #include <TActionWorker>
 #include <TAppSettings>
 #include <TApplicationServerBase>
+#include <TIntrospector>
 #include <TMultiplexingServer>
 #include <TThreadApplicationServer>
 #include <TWebApplication>
@@ -95,6 +96,7 @@ TMultiplexingServer::TMultiplexingServer(int listeningSocket, QObject *parent) :
     reloadTimer()
 {
     Q_ASSERT(Tf::app()->multiProcessingModule() == TWebApplication::Epoll);
+    TIntrospector::registerSection(QStringLiteral("sockets"), &TEpollSocket::introspect);
 }
 
 
@@ -6,104 +6,30 @@
  */
 
 #include "tpublisher.h"
+#include "tabstractwebsocket.h"
+#include "tpublisherbackplane.h"
+#include "tredisbackplane.h"
 #include "tsystembus.h"
 #include "tsystemglobal.h"
-#include "twebsocket.h"
+#include "twebsocketframe.h"
+#include <QJsonObject>
+#include <TAppSettings>
+#include <TIntrospector>
+#include <TMetrics>
 #include <TWebApplication>
-#ifdef Q_OS_LINUX
-#include "tepollwebsocket.h"
-#endif
-#include <QMutex>
-#include <QSet>
-
-static QMutex mutex(QMutex::NonRecursive);
-
-
-class Pub : public QObject {
-    Q_OBJECT
-public:
-    Pub(const QString &t) :
-        topic(t), subscribers() { }
-    bool subscribe(const QObject *receiver, bool local);
-    bool unsubscribe(const QObject *receiver);
-    void publish(const QString &message, const QObject *sender);
-    void publish(const QByteArray &binary, const QObject *sender);
-    int subscriberCounter() const { return subscribers.count(); }
-signals:
-    void textPublished(const QString &, const QObject *sender);
-    void binaryPublished(const QByteArray &, const QObject *sender);
-
-private:
-    QString topic;
-    QMap<const QObject *, bool> subscribers;
-};
-#include "tpublisher.moc"
-
-
-bool Pub::subscribe(const QObject *receiver, bool local)
-{
-    tSystemDebug("Pub::subscribe");
-
-    if (!receiver) {
-        return false;
-    }
-
-    if (subscribers.contains(receiver)) {
-        subscribers[receiver] = local;
-        return true;
-    }
-
-    connect(this, SIGNAL(textPublished(const QString &, const QObject *)),
-        receiver, SLOT(sendTextForPublish(const QString &, const QObject *)), Qt::QueuedConnection);
-    connect(this, SIGNAL(binaryPublished(const QByteArray &, const QObject *)),
-        receiver, SLOT(sendBinaryForPublish(const QByteArray &, const QObject *)), Qt::QueuedConnection);
-
-    subscribers.insert(receiver, local);
-    tSystemDebug("subscriber counter: %d", subscriberCounter());
-    return true;
-}
-
-
-bool Pub::unsubscribe(const QObject *receiver)
-{
-    tSystemDebug("Pub::unsubscribe");
-
-    if (!receiver) {
-        return false;
-    }
-
-    disconnect(this, nullptr, receiver, nullptr);
-    subscribers.remove(receiver);
-    tSystemDebug("subscriber counter: %d", subscriberCounter());
-    return true;
-}
-
-
-void Pub::publish(const QString &message, const QObject *sender)
-{
-    const QObject *except = nullptr;
-    bool local = subscribers.value(sender, true);
-    if (!local) {
-        except = sender;
-    }
-    emit textPublished(message, except);
-}
-
-
-void Pub::publish(const QByteArray &binary, const QObject *sender)
-{
-    const QObject *except = nullptr;
-    bool local = subscribers.value(sender, true);
-    if (!local) {
-        except = sender;
-    }
-    emit binaryPublished(binary, except);
-}
-
 
 /*!
   \class TPublisher
   \brief The TPublisher class provides a means of publish subscribe messaging for websocket.
+
+  A published message is encoded into a WebSocket frame only once, and
+  the frame is shared by all the subscribers; each socket enqueues
+  a reference to the same buffer onto its send queue.
+
+  Messages reach the other server processes on the same host through
+  the system bus. If a backplane is specified by WebSocket.Backplane in
+  the application.ini, or set by setBackplane(), they are relayed through
+  it instead and reach the subscribers on every host.
 */
 
 TPublisher *TPublisher::instance()
@@ -111,116 +37,257 @@ TPublisher *TPublisher::instance()
     static TPublisher *globalInstance = []() {
         auto *pub = new TPublisher();
         connect(TSystemBus::instance(), SIGNAL(readyReceive()), pub, SLOT(receiveSystemBus()));
+
+        QString key = Tf::appSettings()->value(Tf::WebSocketBackplane).toString().trimmed().toLower();
+        if (!key.isEmpty()) {
+            if (key == QLatin1String("redis")) {
+                pub->setBackplane(new TRedisBackplane);
+            } else {
+                tSystemError("Not found backplane: %s", qPrintable(key));
+            }
+        }
         return pub;
     }();
     return globalInstance;
 }
 
 
-TPublisher::TPublisher()
+TPublisher::TPublisher() :
+    lock(QReadWriteLock::NonRecursive),
+    topics()
 {
+    TMetrics::registerGauge("tf_pubsub_topics", QByteArray(), [this]() { return (qint64)topicCount(); }, "Number of topics subscribed");
+    TIntrospector::registerSection(QStringLiteral("topics"), [this]() {
+        // Subscriber counts per topic
+        QJsonObject counts;
+        QReadLocker locker(&lock);
+        for (auto it = topics.cbegin(); it != topics.cend(); ++it) {
+            counts.insert(it.key(), it.value().count());
+        }
+        return QJsonValue(counts);
+    });
+}
+
+/*!
+  Sets the \a backplane relaying messages among hosts, and starts it.
+  The publisher takes ownership of the backplane. Call this function
+  before any socket subscribes. The old backplane is stopped and deleted
+  after the publishers through it have returned.
+*/
+void TPublisher::setBackplane(TPublisherBackplane *backplane)
+{
+    if (backplane && !backplane->start()) {
+        tSystemError("Failed to start backplane: %s", qPrintable(backplane->key()));
+        delete backplane;
+        return;
+    }
+
+    TPublisherBackplane *old;
+    {
+        QWriteLocker locker(&lock);
+        old = plane.exchange(backplane);
+        if (backplane) {
+            for (auto it = topics.cbegin(); it != topics.cend(); ++it) {
+                backplane->subscribe(it.key());
+            }
+            tSystemDebug("Backplane started: %s", qPrintable(backplane->key()));
+        }
+    }
+
+    if (old) {
+        old->stop();
+        delete old;
+    }
 }
 
 
 void TPublisher::subscribe(const QString &topic, bool local, TAbstractWebSocket *socket)
 {
     tSystemDebug("TPublisher::subscribe: %s", qPrintable(topic));
-    QMutexLocker locker(&mutex);
 
-    Pub *pub = get(topic);
-    if (!pub) {
-        pub = create(topic);
+    if (!socket) {
+        return;
+    }
+
+    QWriteLocker locker(&lock);
+    auto &subscribers = topics[topic];
+    for (auto &sub : subscribers) {
+        if (sub.socket == socket) {
+            sub.local = local;
+            return;
+        }
     }
 
-    pub->subscribe(castToObject(socket), local);
+    if (subscribers.isEmpty() && plane) {
+        plane.load()->subscribe(topic);  // once per topic
+    }
+    subscribers.append(Subscriber {socket, socket->socketId(), local});
+    tSystemDebug("subscriber counter: %d", subscribers.count());
 }
 
 
 void TPublisher::unsubscribe(const QString &topic, TAbstractWebSocket *socket)
 {
     tSystemDebug("TPublisher::unsubscribe: %s", qPrintable(topic));
-    QMutexLocker locker(&mutex);
 
-    Pub *pub = get(topic);
-    if (pub) {
-        pub->unsubscribe(castToObject(socket));
-        if (pub->subscriberCounter() == 0) {
-            release(topic);
+    if (!socket) {
+        return;
+    }
+
+    QWriteLocker locker(&lock);
+    auto it = topics.find(topic);
+    if (it == topics.end()) {
+        return;
+    }
+
+    auto &subscribers = it.value();
+    for (int i = 0; i < subscribers.count(); ++i) {
+        if (subscribers[i].socket == socket) {
+            subscribers.remove(i);
+            break;
         }
     }
+
+    if (subscribers.isEmpty()) {
+        if (plane) {
+            plane.load()->unsubscribe(topic);
+        }
+        topics.erase(it);
+        tSystemDebug("release topic: %s  (total topics:%d)", qPrintable(topic), topics.count());
+    }
 }
 
 
 void TPublisher::unsubscribeFromAll(TAbstractWebSocket *socket)
 {
     tSystemDebug("TPublisher::unsubscribeFromAll");
-    QMutexLocker locker(&mutex);
 
-    for (QMutableMapIterator<QString, Pub *> it(pubobj); it.hasNext();) {
-        it.next();
-        Pub *pub = it.value();
-        pub->unsubscribe(castToObject(socket));
+    if (!socket) {
+        return;
+    }
+
+    QWriteLocker locker(&lock);
+    for (auto it = topics.begin(); it != topics.end();) {
+        auto &subscribers = it.value();
+        for (int i = 0; i < subscribers.count(); ++i) {
+            if (subscribers[i].socket == socket) {
+                subscribers.remove(i);
+                break;
+            }
+        }
 
-        if (pub->subscriberCounter() == 0) {
+        if (subscribers.isEmpty()) {
             tSystemDebug("release topic: %s", qPrintable(it.key()));
-            it.remove();
-            delete pub;
+            if (plane) {
+                plane.load()->unsubscribe(it.key());
+            }
+            it = topics.erase(it);
+        } else {
+            ++it;
         }
     }
 
-    tSystemDebug("total topics: %d", pubobj.count());
+    tSystemDebug("total topics: %d", topics.count());
 }
 
 
-QObject *TPublisher::castToObject(TAbstractWebSocket *socket)
+/*!
+  Returns the number of topics which have subscribers.
+*/
+int TPublisher::topicCount() const
 {
-    QObject *obj = nullptr;
-
-    switch (Tf::app()->multiProcessingModule()) {
-    case TWebApplication::Thread:
-        obj = dynamic_cast<TWebSocket *>(socket);
-        break;
-
-    case TWebApplication::Epoll:
-#ifdef Q_OS_LINUX
-        obj = dynamic_cast<TEpollWebSocket *>(socket);
-#else
-        tFatal("Unsupported MPM: epoll");
-#endif
-        break;
-
-    default:
-        tFatal("Unsupported MPM: epoll");
-        break;
-    }
-    return obj;
+    QReadLocker locker(&lock);
+    return topics.count();
+}
+
+
+int TPublisher::subscriberCount(const QString &topic) const
+{
+    QReadLocker locker(&lock);
+    return topics.value(topic).count();
 }
 
 
 void TPublisher::publish(const QString &topic, const QString &text, TAbstractWebSocket *socket)
 {
-    if (Tf::app()->maxNumberOfAppServers() > 1) {
-        TSystemBus::instance()->send(Tf::WebSocketPublishText, topic, text.toUtf8());
+    QByteArray payload = text.toUtf8();
+    QReadLocker locker(&lock);  // keeps setBackplane() from deleting the backplane
+    auto *backplane = plane.load();
+
+    if (backplane) {
+        backplane->publish(topic, payload, false);
+    } else if (Tf::app()->maxNumberOfAppServers() > 1) {
+        TSystemBus::instance()->send(Tf::WebSocketPublishText, topic, payload);
     }
+    locker.unlock();
 
-    QMutexLocker locker(&mutex);
-    Pub *pub = get(topic);
-    if (pub) {
-        pub->publish(text, castToObject(socket));
-    }
+    publishFrame(topic, encodeFrame(TWebSocketFrame::TextFrame, payload), socket);
 }
 
 
 void TPublisher::publish(const QString &topic, const QByteArray &binary, TAbstractWebSocket *socket)
 {
-    if (Tf::app()->maxNumberOfAppServers() > 1) {
+    QReadLocker locker(&lock);  // keeps setBackplane() from deleting the backplane
+    auto *backplane = plane.load();
+
+    if (backplane) {
+        backplane->publish(topic, binary, true);
+    } else if (Tf::app()->maxNumberOfAppServers() > 1) {
         TSystemBus::instance()->send(Tf::WebSocketPublishBinary, topic, binary);
     }
+    locker.unlock();
+
+    publishFrame(topic, encodeFrame(TWebSocketFrame::BinaryFrame, binary), socket);
+}
+
+
+QByteArray TPublisher::encodeFrame(int opCode, const QByteArray &payload)
+{
+    TWebSocketFrame frame;
+    frame.setOpCode((TWebSocketFrame::OpCode)opCode);
+    frame.setPayload(payload);
+    return frame.toByteArray();
+}
+
+/*!
+  Writes the encoded \a frame to every subscriber of the \a topic.
+  The frame data is implicitly shared, so no copy is made per socket.
+*/
+void TPublisher::publishFrame(const QString &topic, const QByteArray &frame, const TAbstractWebSocket *sender)
+{
+    static TMetricCounter &published = TMetrics::counter("tf_pubsub_messages_published_total", QByteArray(), "Number of messages published to topics");
+    static TMetricCounter &delivered = TMetrics::counter("tf_pubsub_messages_delivered_total", QByteArray(), "Number of published messages written to subscribers");
+    published.add();
+
+    // Held while writing; a socket unsubscribes in its destructor, which
+    // waits for the writes to it to complete
+    QReadLocker locker(&lock);
+    auto it = topics.constFind(topic);
+    if (it == topics.constEnd()) {
+        return;
+    }
 
-    QMutexLocker locker(&mutex);
-    Pub *pub = get(topic);
-    if (pub) {
-        pub->publish(binary, castToObject(socket));
+    const auto &subscribers = it.value();
+    const TAbstractWebSocket *except = nullptr;
+    if (sender) {
+        for (const auto &sub : subscribers) {
+            if (sub.socket == sender) {
+                except = (sub.local) ? nullptr : sender;
+                break;
+            }
+        }
+    }
+
+    for (const auto &sub : subscribers) {
+        if (sub.socket == except) {
+            continue;
+        }
+
+        // Skips a socket being closed, whose ID may be reused already
+        if (Q_LIKELY(TAbstractWebSocket::searchWebSocket(sub.sid) == sub.socket)) {
+            sub.socket->sendPublishedFrame(frame, topic);
+            delivered.add();
+        }
     }
 }
 
@@ -237,21 +304,13 @@ void TPublisher::receiveSystemBus()
         case Tf::WebSocketSendBinary:
             break;
 
-        case Tf::WebSocketPublishText: {
-            Pub *pub = get(msg.target());
-            if (pub) {
-                pub->publish(QString::fromUtf8(msg.data()), nullptr);
-            }
+        case Tf::WebSocketPublishText:
+            publishFrame(msg.target(), encodeFrame(TWebSocketFrame::TextFrame, msg.data()), nullptr);
             break;
-        }
 
-        case Tf::WebSocketPublishBinary: {
-            Pub *pub = get(msg.target());
-            if (pub) {
-                pub->publish(msg.data(), nullptr);
-            }
+        case Tf::WebSocketPublishBinary:
+            publishFrame(msg.target(), encodeFrame(TWebSocketFrame::BinaryFrame, msg.data()), nullptr);
             break;
-        }
 
         default:
             tSystemError("Internal Error  [%s:%d]", __FILE__, __LINE__);
@@ -259,29 +318,3 @@ void TPublisher::receiveSystemBus()
         }
     }
 }
-
-
-Pub *TPublisher::create(const QString &topic)
-{
-    auto *pub = new Pub(topic);
-    pub->moveToThread(Tf::app()->thread());
-    pubobj.insert(topic, pub);
-    tSystemDebug("create topic: %s", qPrintable(topic));
-    return pub;
-}
-
-
-Pub *TPublisher::get(const QString &topic)
-{
-    return pubobj.value(topic);
-}
-
-
-void TPublisher::release(const QString &topic)
-{
-    Pub *pub = pubobj.take(topic);
-    if (pub) {
-        delete pub;
-        tSystemDebug("release topic: %s  (total topics:%d)", qPrintable(topic), pubobj.count());
-    }
-}
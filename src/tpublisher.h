@@ -1,11 +1,14 @@
 #pragma once
-#include <QMap>
+#include "tatomicptr.h"
+#include <QHash>
 #include <QObject>
+#include <QReadWriteLock>
 #include <QString>
+#include <QVector>
 #include <TGlobal>
 
 class TAbstractWebSocket;
-class Pub;
+class TPublisherBackplane;
 
 
 class T_CORE_EXPORT TPublisher : public QObject {
@@ -16,22 +19,36 @@ public:
     void unsubscribeFromAll(TAbstractWebSocket *socket);
     void publish(const QString &topic, const QString &text, TAbstractWebSocket *socket);
     void publish(const QString &topic, const QByteArray &binary, TAbstractWebSocket *socket);
+    int subscriberCount(const QString &topic) const;
+    int topicCount() const;
+    TPublisherBackplane *backplane() const { return plane.load(); }
+    void setBackplane(TPublisherBackplane *backplane);
     static TPublisher *instance();
 
+    struct Subscriber {
+        TAbstractWebSocket *socket {nullptr};
+        int sid {-1};  // socket ID, of which the socket is looked up again
+        bool local {true};
+    };
+
 protected:
-    Pub *create(const QString &topic);
-    Pub *get(const QString &topic);
-    void release(const QString &topic);
-    static QObject *castToObject(TAbstractWebSocket *socket);
+    void publishFrame(const QString &topic, const QByteArray &frame, const TAbstractWebSocket *sender);
+    static QByteArray encodeFrame(int opCode, const QByteArray &payload);
 
 protected slots:
     void receiveSystemBus();
 
 private:
     TPublisher();
-    QMap<QString, Pub *> pubobj;
+
+    mutable QReadWriteLock lock;
+    QHash<QString, QVector<Subscriber>> topics;  // flat subscriber list per topic
+    TAtomicPtr<TPublisherBackplane> plane;
+
+    friend class TPublisherBackplane;
 
     T_DISABLE_COPY(TPublisher)
     T_DISABLE_MOVE(TPublisher)
 };
 
+Q_DECLARE_TYPEINFO(TPublisher::Subscriber, Q_MOVABLE_TYPE);
@@ -0,0 +1,68 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tpublisherbackplane.h"
+#include "tpublisher.h"
+#include "twebsocketframe.h"
+
+/*!
+  \class TPublisherBackplane
+  \brief The TPublisherBackplane class is the interface of an external
+  pub/sub service that relays messages published by TPublisher to
+  the server processes on every host.
+
+  TPublisher calls subscribe() when the first socket of the process
+  subscribes a topic and unsubscribe() when the last one leaves it,
+  so a backplane receives one subscription per topic per process.
+  Messages published in the process are passed to publish(); they must
+  be delivered to the other processes only, since the local subscribers
+  have already received them. An implementation passes messages
+  received from the service to deliver(), which can be called from
+  any thread.
+
+  \sa TPublisher::setBackplane(), TRedisBackplane
+*/
+
+/*!
+  \fn virtual QString TPublisherBackplane::key() const
+  Returns the name of the backplane, such as "redis".
+*/
+
+/*!
+  \fn virtual bool TPublisherBackplane::start()
+  Starts relaying messages. Returns true if successful.
+*/
+
+/*!
+  \fn virtual void TPublisherBackplane::stop()
+  Stops relaying messages.
+*/
+
+/*!
+  \fn virtual void TPublisherBackplane::subscribe(const QString &topic)
+  Subscribes the \a topic on behalf of this process.
+*/
+
+/*!
+  \fn virtual void TPublisherBackplane::unsubscribe(const QString &topic)
+  Unsubscribes the \a topic on behalf of this process.
+*/
+
+/*!
+  \fn virtual void TPublisherBackplane::publish(const QString &topic, const QByteArray &payload, bool binary)
+  Publishes the \a payload to the \a topic in the other processes.
+*/
+
+/*!
+  Writes the \a payload received from the service to the local
+  subscribers of the \a topic.
+*/
+void TPublisherBackplane::deliver(const QString &topic, const QByteArray &payload, bool binary)
+{
+    auto opCode = (binary) ? TWebSocketFrame::BinaryFrame : TWebSocketFrame::TextFrame;
+    TPublisher::instance()->publishFrame(topic, TPublisher::encodeFrame(opCode, payload), nullptr);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <TGlobal>
+
+
+class T_CORE_EXPORT TPublisherBackplane {
+public:
+    virtual ~TPublisherBackplane() { }
+    virtual QString key() const = 0;
+    virtual bool start() = 0;
+    virtual void stop() = 0;
+    virtual void subscribe(const QString &topic) = 0;
+    virtual void unsubscribe(const QString &topic) = 0;
+    virtual void publish(const QString &topic, const QByteArray &payload, bool binary) = 0;
+
+protected:
+    void deliver(const QString &topic, const QByteArray &payload, bool binary);
+};
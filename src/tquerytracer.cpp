@@ -0,0 +1,432 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tquerytracer.h"
+#include "thistogram.h"
+#include "tsystemglobal.h"
+#include <QHash>
+#include <QJsonDocument>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QSqlResult>
+#include <TAppSettings>
+#include <TMetrics>
+#include <TTracer>
+
+/*!
+  \class TQueryTracer
+  \brief The TQueryTracer class measures the execution time of a query
+  to a database and traces slow ones.
+
+  A query taking longer than the setting SlowQueryLog.Threshold is written
+  to the slow query log with its bind values, the number of rows and the
+  request which issued it, and optionally with the execution plan. Also,
+  the queries issued by each request are counted up by their shapes, the
+  statements whose literals are replaced with '?'; the shapes repeated
+  more than SlowQueryLog.RepeatThreshold times in a request, typically
+  N+1 queries, are reported at the end of the request.
+*/
+
+namespace {
+constexpr int MAX_VALUE_LENGTH = 100;
+constexpr int MAX_REPORTED_SHAPES = 10;
+
+const char *const BACKEND_NAMES[] = {"sql", "mongodb", "redis"};
+
+struct TracerConfig {
+    qint64 slowQueryNsecs {0};  // 0 means disabled
+    qint64 slowRequestNsecs {0};
+    int repeatThreshold {0};
+    bool explain {false};
+    bool metrics {false};
+};
+
+const TracerConfig &config()
+{
+    static const TracerConfig conf = []() {
+        TracerConfig cnf;
+        auto *settings = Tf::appSettings();
+        if (settings) {
+            cnf.slowQueryNsecs = qMax(settings->value(Tf::SlowQueryLogThreshold, 0).toLongLong(), 0LL) * 1000000;
+            cnf.slowRequestNsecs = qMax(settings->value(Tf::SlowQueryLogRequestThreshold, 0).toLongLong(), 0LL) * 1000000;
+            cnf.repeatThreshold = qMax(settings->value(Tf::SlowQueryLogRepeatThreshold, 0).toInt(), 0);
+            cnf.explain = settings->value(Tf::SlowQueryLogExplain, false).toBool();
+        }
+        cnf.metrics = TMetrics::isEnabled();
+        return cnf;
+    }();
+    return conf;
+}
+
+// Queries issued by the request being processed in the current thread
+struct RequestTrace {
+    bool active {false};
+    QByteArray method;
+    QByteArray path;
+    qint64 startNsecs {0};
+    int queryCount {0};
+    qint64 queryNsecs {0};
+    QHash<QByteArray, int> shapes;  // counts by shape, if repeat detection enabled
+};
+
+thread_local RequestTrace requestTrace;
+
+
+inline QByteArray requestString()
+{
+    const RequestTrace &req = requestTrace;
+    return (req.active) ? '"' + req.method + ' ' + req.path + '"' : QByteArrayLiteral("-");
+}
+
+
+inline bool isIdentifierChar(QChar c)
+{
+    return c.isLetterOrNumber() || c == QLatin1Char('_') || c == QLatin1Char('$');
+}
+
+
+QString formatValue(const QVariant &value)
+{
+    if (value.isNull()) {
+        return QStringLiteral("NULL");
+    }
+
+    QString str;
+    switch ((int)value.type()) {
+    case QVariant::Bool:
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+    case QVariant::Double:
+        return value.toString();
+
+    case QVariant::ByteArray:
+        return QLatin1Char('<') + QString::number(value.toByteArray().length()) + QLatin1String(" bytes>");
+
+    case QVariant::Map:
+    case QVariant::List:
+    case QVariant::StringList:
+        str = QString::fromUtf8(QJsonDocument::fromVariant(value).toJson(QJsonDocument::Compact));
+        break;
+
+    default:
+        str = QLatin1Char('\'') + value.toString() + QLatin1Char('\'');
+        break;
+    }
+
+    if (str.length() > MAX_VALUE_LENGTH) {
+        str.truncate(MAX_VALUE_LENGTH);
+        str += QLatin1String("...");
+    }
+    return str;
+}
+
+/*
+  Returns the execution plan of the SELECT statement executed by the
+  \a query. It is queried on the same connection with a plain QSqlQuery
+  not to be traced itself.
+*/
+QString explain(const QSqlQuery &query)
+{
+    const QSqlDriver *driver = query.driver();
+    QString statement = query.lastQuery().trimmed();
+    if (!driver || !statement.startsWith(QLatin1String("SELECT"), Qt::CaseInsensitive)) {
+        return QString();
+    }
+
+    QString prefix;
+    switch (driver->dbmsType()) {
+    case QSqlDriver::SQLite:
+        prefix = QStringLiteral("EXPLAIN QUERY PLAN ");
+        break;
+    case QSqlDriver::MySqlServer:
+    case QSqlDriver::PostgreSQL:
+        prefix = QStringLiteral("EXPLAIN ");
+        break;
+    default:
+        return QString();
+    }
+
+    QSqlQuery plan(driver->createResult());
+    if (!plan.prepare(prefix + statement)) {
+        return QString();
+    }
+
+    const auto bound = query.boundValues();
+    int pos = 0;
+    for (const auto &value : bound) {
+        plan.bindValue(pos++, value);
+    }
+    if (!plan.exec()) {
+        return QString();
+    }
+
+    QString result;
+    while (plan.next()) {
+        QSqlRecord record = plan.record();
+        result += QLatin1String("\n    ");
+        for (int i = 0; i < record.count(); ++i) {
+            if (i > 0) {
+                result += QLatin1String(" | ");
+            }
+            result += record.value(i).toString();
+        }
+    }
+    return result;
+}
+
+
+THistogram &durationHistogram(int backend)
+{
+    static THistogram *histograms[TQueryTracer::BackendCount] = {
+        &TMetrics::histogram("tf_db_query_duration_seconds", TMetrics::label("backend", BACKEND_NAMES[0]), "Duration of database queries"),
+        &TMetrics::histogram("tf_db_query_duration_seconds", TMetrics::label("backend", BACKEND_NAMES[1])),
+        &TMetrics::histogram("tf_db_query_duration_seconds", TMetrics::label("backend", BACKEND_NAMES[2])),
+    };
+    return *histograms[backend];
+}
+}
+
+/*!
+  \fn TQueryTracer::TQueryTracer(Backend backend)
+  Constructs a TQueryTracer object and starts measuring the execution
+  time of a query to the \a backend.
+*/
+
+/*!
+  Finishes measuring the query \a statement with the \a bindValues, which
+  resulted in \a success and returned or affected \a rows rows.
+*/
+void TQueryTracer::finish(const QString &statement, bool success, qint64 rows, const QVariantList &bindValues)
+{
+    trace(statement, success, rows, bindValues, nullptr);
+}
+
+/*!
+  Finishes measuring the SQL \a query which resulted in \a success. If
+  \a rows is negative, the number of rows is taken from the \a query.
+*/
+void TQueryTracer::finish(const QSqlQuery &query, bool success, qint64 rows)
+{
+    if (rows < 0 && success) {
+        rows = (query.isSelect()) ? query.size() : query.numRowsAffected();
+    }
+    trace(query.lastQuery(), success, rows, QVariantList(), &query);
+}
+
+
+void TQueryTracer::trace(const QString &statement, bool success, qint64 rows, const QVariantList &bindValues, const QSqlQuery *query)
+{
+    const TracerConfig &conf = config();
+    const qint64 nsecs = elapsed();
+    RequestTrace &req = requestTrace;
+
+    if (req.active) {
+        req.queryCount++;
+        req.queryNsecs += nsecs;
+        if (conf.repeatThreshold > 0) {
+            QByteArray key = '[' + QByteArray(BACKEND_NAMES[_backend]) + "]  " + normalize(statement);
+            req.shapes[key]++;
+        }
+    }
+
+    if (conf.metrics) {
+        durationHistogram(_backend).record(nsecs);
+    }
+
+    if (TTracer::isSampled()) {
+        QVariantMap attributes;
+        attributes.insert(QStringLiteral("db.system"), QLatin1String(BACKEND_NAMES[_backend]));
+        attributes.insert(QStringLiteral("db.statement"), statement.simplified());
+        if (rows >= 0) {
+            attributes.insert(QStringLiteral("db.rows"), rows);
+        }
+        QByteArray name = QByteArray(BACKEND_NAMES[_backend]) + ' ' + statement.trimmed().section(QLatin1Char(' '), 0, 0).toUpper().toUtf8();
+        TTracer::recordSpan(name, TTracer::Client, _startNsecs, _startNsecs + nsecs, attributes, !success);
+    }
+
+    if (conf.slowQueryNsecs <= 0 || nsecs < conf.slowQueryNsecs) {
+        return;
+    }
+
+    // Slow query
+    if (conf.metrics) {
+        TMetrics::counter("tf_db_slow_queries_total", TMetrics::label("backend", BACKEND_NAMES[_backend]), "Number of slow database queries").add();
+    }
+
+    QVariantList values = bindValues;
+    if (query) {
+        const auto bound = query->boundValues();
+        for (const auto &value : bound) {
+            values << value;
+        }
+    }
+
+    // Multi-arg version not to substitute markers in the arguments
+    QString msg = QStringLiteral("Slow query: %1 ms  [%2]  rows:%3  request:%4%5\n  %6")
+                      .arg(QString::number(nsecs / 1000000), QLatin1String(BACKEND_NAMES[_backend]),
+                          (rows >= 0) ? QString::number(rows) : QStringLiteral("-"), QString::fromUtf8(requestString()),
+                          (success) ? QString() : QStringLiteral("  (failed)"), statement.simplified());
+
+    if (!values.isEmpty()) {
+        msg += QLatin1String("\n  bind: ") + formatValues(values);
+    }
+
+    if (conf.explain && success && query) {
+        QString plan = explain(*query);
+        if (!plan.isEmpty()) {
+            msg += QLatin1String("\n  explain:") + plan;
+        }
+    }
+    Tf::writeSlowQueryLog(msg);
+}
+
+/*!
+  Starts tracing the queries issued by the request with the \a method
+  and \a path in the current thread.
+*/
+void TQueryTracer::beginRequest(const QByteArray &method, const QByteArray &path)
+{
+    RequestTrace &req = requestTrace;
+    req.active = true;
+    req.method = method;
+    req.path = path;
+    req.startNsecs = Tf::getMonotonicNSecs();
+    req.queryCount = 0;
+    req.queryNsecs = 0;
+    req.shapes.clear();
+}
+
+/*!
+  Finishes tracing the request in the current thread, and reports it if
+  it was slow or repeated the same shape of queries too many times.
+*/
+void TQueryTracer::endRequest()
+{
+    RequestTrace &req = requestTrace;
+    if (!req.active) {
+        return;
+    }
+
+    const TracerConfig &conf = config();
+    const qint64 nsecs = Tf::getMonotonicNSecs() - req.startNsecs;
+
+    if (conf.slowRequestNsecs > 0 && nsecs >= conf.slowRequestNsecs) {
+        Tf::writeSlowQueryLog(QStringLiteral("Slow request: %1 ms  queries:%2 (%3 ms)  request:%4")
+                                  .arg(QString::number(nsecs / 1000000), QString::number(req.queryCount),
+                                      QString::number(req.queryNsecs / 1000000), QString::fromUtf8(requestString())));
+    }
+
+    if (conf.repeatThreshold > 0) {
+        int reported = 0;
+        for (auto it = req.shapes.cbegin(); it != req.shapes.cend() && reported < MAX_REPORTED_SHAPES; ++it) {
+            if (it.value() > conf.repeatThreshold) {
+                Tf::writeSlowQueryLog(QStringLiteral("Repeated query: %1 times  request:%2\n  %3")
+                                          .arg(QString::number(it.value()), QString::fromUtf8(requestString()), QString::fromUtf8(it.key())));
+                reported++;
+            }
+        }
+
+        if (reported > 0 && conf.metrics) {
+            TMetrics::counter("tf_http_requests_with_repeated_queries_total", QByteArray(), "Number of HTTP requests which repeated the same shape of queries").add();
+        }
+    }
+
+    req.active = false;
+    req.method.clear();
+    req.path.clear();
+    req.shapes.clear();
+}
+
+/*!
+  Returns the shape of the \a statement; the literal strings and numbers
+  are replaced with '?', a list of them is collapsed into one '?' and
+  whitespaces are simplified.
+*/
+QByteArray TQueryTracer::normalize(const QString &statement)
+{
+    const int len = statement.length();
+    QString shape;
+    shape.reserve(len);
+    int i = 0;
+
+    auto appendPlaceholder = [&shape]() {
+        // Collapses a list such as "?, ?, ?"
+        if (shape.endsWith(QLatin1String("?,"))) {
+            shape.chop(1);
+        } else if (shape.endsWith(QLatin1String("?, "))) {
+            shape.chop(2);
+        } else {
+            shape += QLatin1Char('?');
+        }
+    };
+
+    while (i < len) {
+        QChar c = statement[i];
+
+        if (c == QLatin1Char('\'')) {
+            // String literal
+            for (++i; i < len; ++i) {
+                if (statement[i] == QLatin1Char('\\')) {
+                    ++i;
+                } else if (statement[i] == QLatin1Char('\'')) {
+                    if (i + 1 < len && statement[i + 1] == QLatin1Char('\'')) {
+                        ++i;  // escaped quote
+                    } else {
+                        break;
+                    }
+                }
+            }
+            ++i;
+            appendPlaceholder();
+
+        } else if (c.isDigit() && (shape.isEmpty() || !isIdentifierChar(shape.at(shape.length() - 1)))) {
+            // Numeric literal
+            while (i < len && (statement[i].isLetterOrNumber() || statement[i] == QLatin1Char('.'))) {
+                ++i;
+            }
+            if (shape.endsWith(QLatin1Char('-')) && (shape.length() < 2 || !isIdentifierChar(shape[shape.length() - 2]))) {
+                shape.chop(1);  // negative number
+            }
+            appendPlaceholder();
+
+        } else if (c == QLatin1Char('?')) {
+            ++i;
+            appendPlaceholder();
+
+        } else if (c.isSpace()) {
+            while (i < len && statement[i].isSpace()) {
+                ++i;
+            }
+            if (!shape.isEmpty() && i < len) {
+                shape += QLatin1Char(' ');
+            }
+
+        } else {
+            shape += c;
+            ++i;
+        }
+    }
+    return shape.toUtf8();
+}
+
+/*!
+  Returns a string representation of the bind \a values for logging.
+*/
+QString TQueryTracer::formatValues(const QVariantList &values)
+{
+    QString str;
+    for (const auto &value : values) {
+        if (!str.isEmpty()) {
+            str += QLatin1String(", ");
+        }
+        str += formatValue(value);
+    }
+    return str;
+}
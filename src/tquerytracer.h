@@ -0,0 +1,39 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+#include <TGlobal>
+
+class QSqlQuery;
+
+
+class T_CORE_EXPORT TQueryTracer {
+public:
+    enum Backend {
+        Sql = 0,
+        MongoDB,
+        Redis,
+        BackendCount,
+    };
+
+    explicit TQueryTracer(Backend backend) :
+        _backend(backend), _startNsecs(Tf::getMonotonicNSecs()) { }
+
+    qint64 elapsed() const { return Tf::getMonotonicNSecs() - _startNsecs; }
+    void finish(const QString &statement, bool success, qint64 rows = -1, const QVariantList &bindValues = QVariantList());
+    void finish(const QSqlQuery &query, bool success, qint64 rows = -1);
+
+    static void beginRequest(const QByteArray &method, const QByteArray &path);
+    static void endRequest();
+    static QByteArray normalize(const QString &statement);
+    static QString formatValues(const QVariantList &values);
+
+private:
+    void trace(const QString &statement, bool success, qint64 rows, const QVariantList &bindValues, const QSqlQuery *query);
+
+    Backend _backend {Sql};
+    qint64 _startNsecs {0};
+
+    T_DISABLE_COPY(TQueryTracer)
+    T_DISABLE_MOVE(TQueryTracer)
+};
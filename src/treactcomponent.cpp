@@ -24,6 +24,12 @@ TReactComponent::TReactComponent(const QString &moduleName, const QStringList &s
 }
 
 
+TReactComponent::~TReactComponent()
+{
+    delete jsLoader;
+}
+
+
 void TReactComponent::import(const QString &moduleName)
 {
     jsLoader->import(moduleName);
@@ -36,27 +42,22 @@ void TReactComponent::import(const QString &defaultMember, const QString &module
 }
 
 
+/*!
+  Renders the JSX \a component to an HTML string on a JavaScript engine
+  taken from the pool, so that threads render concurrently. A module
+  modified since it was loaded is reloaded.
+*/
 QString TReactComponent::renderToString(const QString &component)
 {
-    auto *context = jsLoader->load();
-
-    if (loadedTime.isNull()) {
-        loadedTime = QDateTime::currentDateTime();
-    } else {
-        if (context) {
-            QFileInfo fi(context->modulePath());
-            if (context->modulePath().isEmpty() || (fi.exists() && fi.lastModified() > loadedTime)) {
-                context = jsLoader->load(true);
-                loadedTime = QDateTime::currentDateTime();
-            }
-        }
-    }
-
+    auto *context = jsLoader->acquire();
     if (!context) {
         return QString();
     }
+    loadedTime = context->loadedTime;
 
     QString func = QLatin1String("ReactDOMServer.renderToString(") + TJSLoader::compileJsx(component) + QLatin1String(");");
     tSystemDebug("TReactComponent func: %s", qPrintable(func));
-    return context->evaluate(func).toString();
+    QString html = context->evaluate(func).toString();
+    TJSLoader::release(context);
+    return html;
 }
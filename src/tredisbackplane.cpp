@@ -0,0 +1,278 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tredisbackplane.h"
+#include "tredisdriver.h"
+#include "tsystemglobal.h"
+#include <QDataStream>
+#include <QMutexLocker>
+#include <TWebApplication>
+
+/*!
+  \class TRedisBackplane
+  \brief The TRedisBackplane class relays WebSocket messages published
+  by TPublisher among server processes on every host through Redis
+  PUBLISH/SUBSCRIBE.
+
+  A dedicated thread owns two connections to the Redis server specified
+  in RedisSettingsFile; one stays in the subscribed state and the other
+  publishes. Subscription changes and publications made in the meantime
+  are written to Redis together as a pipeline, once per flush interval.
+  Messages published by this process itself are skipped on receipt.
+*/
+
+namespace {
+constexpr auto CHANNEL_PREFIX = "tf:publisher:";
+constexpr int FLUSH_INTERVAL = 5;  // msecs
+constexpr int RECONNECT_INTERVAL = 1000;  // msecs
+constexpr int MAX_RECEIVE_PER_FLUSH = 1024;
+constexpr int MAX_PENDING_PUBLICATIONS = 100000;
+
+inline QByteArray channelName(const QString &topic)
+{
+    return QByteArray(CHANNEL_PREFIX) + topic.toUtf8();
+}
+}
+
+
+TRedisBackplane::TRedisBackplane() :
+    QThread(),
+    TPublisherBackplane(),
+    originId(Tf::rand64_r())
+{
+}
+
+
+TRedisBackplane::~TRedisBackplane()
+{
+    stop();
+}
+
+
+bool TRedisBackplane::start()
+{
+    if (!Tf::app()->isKvsAvailable(Tf::KvsEngine::Redis)) {
+        tSystemError("Redis not available. Check the settings file.");
+        return false;
+    }
+
+    stopped = false;
+    QThread::start();
+    return true;
+}
+
+
+void TRedisBackplane::stop()
+{
+    {
+        QMutexLocker locker(&mutex);
+        stopped = true;
+        wakeup.wakeAll();
+    }
+    wait();
+}
+
+
+void TRedisBackplane::subscribe(const QString &topic)
+{
+    QMutexLocker locker(&mutex);
+    if (pendingUnsubscribe.remove(topic)) {
+        topics.insert(topic);  // still subscribed on Redis
+    } else if (!topics.contains(topic)) {
+        topics.insert(topic);
+        pendingSubscribe.insert(topic);
+    }
+    wakeup.wakeAll();
+}
+
+
+void TRedisBackplane::unsubscribe(const QString &topic)
+{
+    QMutexLocker locker(&mutex);
+    if (topics.remove(topic)) {
+        if (!pendingSubscribe.remove(topic)) {
+            pendingUnsubscribe.insert(topic);
+        }
+    }
+}
+
+
+void TRedisBackplane::publish(const QString &topic, const QByteArray &payload, bool binary)
+{
+    // Message: type(1 byte) + origin ID(8 bytes) + payload
+    QByteArray message;
+    message.reserve(payload.length() + 9);
+    QDataStream ds(&message, QIODevice::WriteOnly);
+    ds << (quint8)(binary ? 'b' : 't') << originId;
+    message += payload;
+
+    QMutexLocker locker(&mutex);
+    if (Q_UNLIKELY(pendingPublications.count() >= MAX_PENDING_PUBLICATIONS)) {
+        tSystemWarn("Redis backplane queue full, dropped a message  topic:%s", qPrintable(topic));
+        pendingPublications.removeFirst();
+    }
+    pendingPublications << QByteArrayList {QByteArrayLiteral("PUBLISH"), channelName(topic), message};
+    wakeup.wakeAll();
+}
+
+
+void TRedisBackplane::run()
+{
+    TRedisDriver subscriber;  // connection in the subscribed state
+    TRedisDriver publisher;
+
+    for (;;) {
+        {
+            QMutexLocker locker(&mutex);
+            if (stopped) {
+                break;
+            }
+
+            if (topics.isEmpty() && pendingUnsubscribe.isEmpty() && pendingPublications.isEmpty()) {
+                wakeup.wait(&mutex, RECONNECT_INTERVAL);
+                continue;
+            }
+        }
+
+        if (!subscriber.isOpen()) {
+            if (!openDriver(subscriber)) {
+                QMutexLocker locker(&mutex);
+                wakeup.wait(&mutex, RECONNECT_INTERVAL);
+                continue;
+            }
+
+            // Subscribes all the topics again
+            QMutexLocker locker(&mutex);
+            pendingSubscribe = topics;
+            pendingUnsubscribe.clear();
+        }
+
+        flushSubscriptions(subscriber);
+        flushPublications(publisher);
+
+        // Receives messages for the flush interval
+        QVariant reply;
+        int timeout = FLUSH_INTERVAL;
+        for (int i = 0; i < MAX_RECEIVE_PER_FLUSH; i++) {
+            if (!subscriber.waitForReply(reply, timeout)) {
+                break;
+            }
+            receiveMessage(reply);
+            timeout = 0;
+        }
+    }
+
+    subscriber.close();
+    publisher.close();
+}
+
+
+bool TRedisBackplane::openDriver(TRedisDriver &driver)
+{
+    const QVariantMap &settings = Tf::app()->kvsSettings(Tf::KvsEngine::Redis);
+    QString hostName = settings.value("HostName").toString().trimmed();
+    quint16 port = settings.value("Port").toUInt();
+
+    bool ret = driver.open(QString(), QString(), QString(), hostName, port);
+    if (!ret) {
+        tSystemError("Redis backplane failed to connect  host:%s", qPrintable(hostName));
+    }
+    return ret;
+}
+
+/*!
+  Writes the subscriptions changed since the last call as one SUBSCRIBE
+  and one UNSUBSCRIBE command.
+*/
+bool TRedisBackplane::flushSubscriptions(TRedisDriver &driver)
+{
+    QByteArrayList subscribeCommand {QByteArrayLiteral("SUBSCRIBE")};
+    QByteArrayList unsubscribeCommand {QByteArrayLiteral("UNSUBSCRIBE")};
+    {
+        QMutexLocker locker(&mutex);
+        for (const auto &topic : pendingSubscribe) {
+            subscribeCommand << channelName(topic);
+        }
+        for (const auto &topic : pendingUnsubscribe) {
+            unsubscribeCommand << channelName(topic);
+        }
+        pendingSubscribe.clear();
+        pendingUnsubscribe.clear();
+    }
+
+    QList<QByteArrayList> commands;
+    if (subscribeCommand.count() > 1) {
+        commands << subscribeCommand;
+    }
+    if (unsubscribeCommand.count() > 1) {
+        commands << unsubscribeCommand;
+    }
+
+    // The replies are received as messages in the subscribed state.
+    // If failed, all the topics are subscribed again after reconnecting.
+    return commands.isEmpty() || driver.writeCommands(commands);
+}
+
+/*!
+  Writes the messages published since the last call as a pipeline
+  and reads the replies.
+*/
+bool TRedisBackplane::flushPublications(TRedisDriver &driver)
+{
+    QList<QByteArrayList> commands;
+    {
+        QMutexLocker locker(&mutex);
+        commands.swap(pendingPublications);
+    }
+
+    if (commands.isEmpty()) {
+        return true;
+    }
+
+    if ((!driver.isOpen() && !openDriver(driver)) || !driver.writeCommands(commands)) {
+        tSystemWarn("Redis backplane dropped %d messages", commands.count());
+        return false;
+    }
+
+    QVariant reply;
+    for (int i = 0; i < commands.count(); i++) {
+        if (!driver.waitForReply(reply)) {
+            tSystemError("Redis backplane publish error");
+            driver.close();
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void TRedisBackplane::receiveMessage(const QVariant &reply)
+{
+    // Pushed message: ["message", channel, payload]
+    const QVariantList message = reply.toList();
+    if (message.count() != 3 || message[0].toByteArray() != "message") {
+        return;  // replies of (UN)SUBSCRIBE
+    }
+
+    const QByteArray channel = message[1].toByteArray();
+    const QByteArray data = message[2].toByteArray();
+    if (Q_UNLIKELY(!channel.startsWith(CHANNEL_PREFIX) || data.length() < 9)) {
+        tSystemWarn("Redis backplane received an invalid message  channel:%s", channel.data());
+        return;
+    }
+
+    quint8 type;
+    quint64 origin;
+    QDataStream ds(data);
+    ds >> type >> origin;
+    if (origin == originId) {
+        return;  // published by this process
+    }
+
+    QString topic = QString::fromUtf8(channel.mid(qstrlen(CHANNEL_PREFIX)));
+    deliver(topic, data.mid(9), (type == 'b'));
+}
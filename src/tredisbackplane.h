@@ -0,0 +1,45 @@
+#pragma once
+#include "tpublisherbackplane.h"
+#include <QByteArrayList>
+#include <QList>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+#include <QWaitCondition>
+#include <TGlobal>
+
+class TRedisDriver;
+
+
+class T_CORE_EXPORT TRedisBackplane : public QThread, public TPublisherBackplane {
+public:
+    TRedisBackplane();
+    ~TRedisBackplane();
+
+    QString key() const override { return QStringLiteral("redis"); }
+    bool start() override;
+    void stop() override;
+    void subscribe(const QString &topic) override;
+    void unsubscribe(const QString &topic) override;
+    void publish(const QString &topic, const QByteArray &payload, bool binary) override;
+
+protected:
+    void run() override;
+    bool openDriver(TRedisDriver &driver);
+    bool flushSubscriptions(TRedisDriver &driver);
+    bool flushPublications(TRedisDriver &driver);
+    void receiveMessage(const QVariant &reply);
+
+private:
+    mutable QMutex mutex;
+    QWaitCondition wakeup;
+    bool stopped {false};
+    QSet<QString> topics;  // topics subscribed by this process
+    QSet<QString> pendingSubscribe;
+    QSet<QString> pendingUnsubscribe;
+    QList<QByteArrayList> pendingPublications;  // PUBLISH commands
+    quint64 originId {0};
+
+    T_DISABLE_COPY(TRedisBackplane)
+    T_DISABLE_MOVE(TRedisBackplane)
+};
@@ -7,6 +7,7 @@
 
 #include "tredisdriver.h"
 #include "tsystemglobal.h"
+#include <TQueryTracer>
 using namespace Tf;
 
 
@@ -29,6 +30,7 @@ bool TRedisDriver::request(const QByteArrayList &command, QVariantList &response
     bool ret = true;
     bool ok = false;
     QByteArray str;
+    TQueryTracer tracer(TQueryTracer::Redis);
 
     QByteArray cmd = toMultiBulk(command);
     tSystemDebug("Redis command: %s", cmd.data());
@@ -103,10 +105,127 @@ bool TRedisDriver::request(const QByteArrayList &command, QVariantList &response
     }
 
 parse_done:
+    {
+        // Command and key as the statement, the rest as the bind values
+        QVariantList args;
+        for (int i = 2; i < command.count(); ++i) {
+            args << command[i];
+        }
+        tracer.finish(QString::fromUtf8(command.mid(0, 2).join(' ')), ret, response.count(), args);
+    }
     return ret;
 }
 
 
+/*!
+  Writes the \a commands to the Redis server at once without waiting for
+  their replies (pipelining). The replies are read by waitForReply()
+  in the same order as the commands.
+*/
+bool TRedisDriver::writeCommands(const QList<QByteArrayList> &commands)
+{
+    if (Q_UNLIKELY(!isOpen())) {
+        tSystemError("Not open Redis session  [%s:%d]", __FILE__, __LINE__);
+        return false;
+    }
+
+    QByteArray cmds;
+    for (auto &command : commands) {
+        cmds += toMultiBulk(command);
+    }
+
+    if (!writeCommand(cmds)) {
+        tSystemError("Redis write error  [%s:%d]", __FILE__, __LINE__);
+        close();
+        return false;
+    }
+    return true;
+}
+
+/*!
+  Waits until a reply, or a message pushed by the server in pub/sub mode,
+  is received, and sets it to \a reply. Any data following the reply is
+  kept for the next call. Returns false if no complete reply has been
+  received within \a msecs milliseconds or the session is closed.
+*/
+bool TRedisDriver::waitForReply(QVariant &reply, int msecs)
+{
+    for (;;) {
+        if (takeReply(reply)) {
+            return true;
+        }
+
+        if (!isOpen() || !readReply(msecs)) {
+            return false;
+        }
+    }
+}
+
+
+bool TRedisDriver::takeReply(QVariant &reply)
+{
+    if (_pos >= _buffer.length()) {
+        return false;
+    }
+
+    bool ok = false;
+    int startpos = _pos;
+
+    switch (_buffer.at(_pos)) {
+    case Error: {
+        _pos++;
+        QByteArray str = getLine(&ok);
+        if (ok) {
+            tSystemError("Redis error response: %s", str.data());
+            reply = QVariant();
+        }
+        break;
+    }
+
+    case SimpleString:
+        _pos++;
+        reply = getLine(&ok);
+        break;
+
+    case Integer: {
+        _pos++;
+        int num = getNumber(&ok);
+        if (ok) {
+            reply = num;
+        }
+        break;
+    }
+
+    case BulkString:
+        reply = parseBulkString(&ok);
+        break;
+
+    case Array: {
+        auto lst = parseArray(&ok);
+        if (ok) {
+            reply = QVariant(lst);
+        }
+        break;
+    }
+
+    default:
+        tSystemError("Invalid protocol: %c  [%s:%d]", _buffer.at(_pos), __FILE__, __LINE__);
+        clearBuffer();
+        close();
+        return false;
+    }
+
+    if (!ok) {
+        _pos = startpos;
+        return false;
+    }
+
+    _buffer.remove(0, _pos);
+    _pos = 0;
+    return true;
+}
+
+
 QByteArray TRedisDriver::getLine(bool *ok)
 {
     int idx = _buffer.indexOf(CRLF, _pos);
@@ -115,7 +234,7 @@ QByteArray TRedisDriver::getLine(bool *ok)
         return QByteArray();
     }
 
-    QByteArray ret = _buffer.mid(_pos, idx);
+    QByteArray ret = _buffer.mid(_pos, idx - _pos);
     _pos = idx + 2;
     *ok = true;
     return ret;
@@ -139,7 +258,7 @@ QByteArray TRedisDriver::parseBulkString(bool *ok)
             // null string
             tSystemDebug("Null string parsed");
         } else {
-            if (_pos + 2 <= _buffer.length()) {
+            if (_pos + len + 2 <= _buffer.length()) {
                 str = (len > 0) ? _buffer.mid(_pos, len) : QByteArray("");
                 _pos += len + 2;
             } else {
@@ -165,8 +284,32 @@ QVariantList TRedisDriver::parseArray(bool *ok)
     _pos++;
 
     int count = getNumber(ok);
-    while (*ok) {
+    while (*ok && lst.count() < count) {
+        if (_pos >= _buffer.length()) {
+            *ok = false;  // incomplete
+            break;
+        }
+
         switch (_buffer[_pos]) {
+        case SimpleString: {
+            _pos++;
+            auto str = getLine(ok);
+            if (*ok) {
+                lst << str;
+            }
+            break;
+        }
+
+        case Error: {
+            _pos++;
+            auto str = getLine(ok);
+            if (*ok) {
+                tSystemError("Redis error response: %s", str.data());
+                lst << QVariant();
+            }
+            break;
+        }
+
         case BulkString: {
             auto str = parseBulkString(ok);
             if (*ok) {
@@ -197,10 +340,6 @@ QVariantList TRedisDriver::parseArray(bool *ok)
             *ok = false;
             break;
         }
-
-        if (lst.count() >= count) {
-            break;
-        }
     }
 
     if (!*ok) {
@@ -20,6 +20,8 @@ public:
     bool isOpen() const override;
     void moveToThread(QThread *thread) override;
     bool request(const QByteArrayList &command, QVariantList &response);
+    bool writeCommands(const QList<QByteArrayList> &commands);
+    bool waitForReply(QVariant &reply, int msecs = 5000);
 
 protected:
     enum DataType {
@@ -31,11 +33,13 @@ protected:
     };
 
     bool writeCommand(const QByteArray &command);
-    bool readReply();
+    bool readReply(int msecs = 5000);
+    bool takeReply(QVariant &reply);
     QByteArray parseBulkString(bool *ok);
     QVariantList parseArray(bool *ok);
     QByteArray getLine(bool *ok);
     int getNumber(bool *ok);
+    void appendBuffer(const QByteArray &data) { _buffer += data; }
     void clearBuffer();
 
     static QByteArray toBulk(const QByteArray &data);
@@ -73,6 +73,7 @@ bool TRedisDriver::open(const QString &, const QString &, const QString &, const
         return false;
     }
 
+    clearBuffer();
     _socket = TApplicationServerBase::duplicateSocket(tcpSocket.socketDescriptor());
     return _socket > 0;
 }
@@ -96,7 +97,7 @@ bool TRedisDriver::writeCommand(const QByteArray &command)
 
     qint64 total = 0;
     while (total < command.length()) {
-        if (tf_poll_send(_socket, 5000) == 0) {
+        if (tf_poll_send(_socket, 5000) > 0) {
             qint64 len = tf_send(_socket, command.data() + total, command.length() - total);
             if (len < 0) {
                 break;
@@ -110,7 +111,7 @@ bool TRedisDriver::writeCommand(const QByteArray &command)
 }
 
 
-bool TRedisDriver::readReply()
+bool TRedisDriver::readReply(int msecs)
 {
     if (Q_UNLIKELY(!isOpen())) {
         tSystemError("Not open Redis session  [%s:%d]", __FILE__, __LINE__);
@@ -119,12 +120,14 @@ bool TRedisDriver::readReply()
 
     QByteArray buf;
     buf.reserve(RECV_BUF_SIZE);
-    int timeout = 5000;
+    int timeout = msecs;
     int len = 0;
 
-    while (tf_poll_recv(_socket, timeout) == 0) {
+    while (tf_poll_recv(_socket, timeout) > 0) {
         len = tf_recv(_socket, buf.data(), RECV_BUF_SIZE, 0);
         if (len <= 0) {
+            // Disconnected or error; a timeout leaves the session open
+            close();
             break;
         }
 
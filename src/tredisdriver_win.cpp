@@ -74,6 +74,7 @@ bool TRedisDriver::open(const QString &, const QString &, const QString &, const
     bool ret = _client->waitForConnected(5000);
     if (Q_LIKELY(ret)) {
         tSystemDebug("Redis open successfully");
+        clearBuffer();
     } else {
         tSystemError("Redis open failed");
         close();
@@ -96,18 +97,21 @@ void TRedisDriver::close()
 }
 
 
-bool TRedisDriver::readReply()
+bool TRedisDriver::readReply(int msecs)
 {
     if (Q_UNLIKELY(!isOpen())) {
         tSystemError("Not open Redis session  [%s:%d]", __FILE__, __LINE__);
         return false;
     }
 
-    bool ret = _client->waitForReadyRead(5000);
+    bool ret = _client->waitForReadyRead(msecs);
     if (ret) {
         _buffer += _client->readAll();
+    } else if (_client->error() == QAbstractSocket::SocketTimeoutError) {
+        tSystemDebug("Redis response timeout");
     } else {
-        tSystemWarn("Redis response timeout");
+        tSystemWarn("Redis read error: %s", qPrintable(_client->errorString()));
+        close();
     }
 
     //tSystemDebug("#Redis response length: %d", _buffer.length());
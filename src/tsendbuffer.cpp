@@ -6,33 +6,51 @@
  */
 
 #include "tsendbuffer.h"
+#include "thttpcompressor.h"
 #include "tsystemglobal.h"
 #include <QFile>
 #include <QFileInfo>
 #include <QHostAddress>
 #include <QLocale>
+#include <TAppSettings>
 #include <THttpResponseHeader>
 #include <THttpUtility>
 #include <TWebApplication>
 
+namespace {
+// The level of 'HttpCompression.Level', same as in-memory compression
+int compressionLevel()
+{
+    static const int level = Tf::appSettings()->value(Tf::HttpCompressionLevel, -1).toInt();
+    return level;
+}
+}
 
-TSendBuffer::TSendBuffer(const QByteArray &header, const QFileInfo &file, bool autoRemove, const TAccessLogger &logger) :
+
+TSendBuffer::TSendBuffer(const QByteArray &header, const QFileInfo &file, bool autoRemove, const TAccessLogger &logger, int contentEncoding, qint64 offset, qint64 length) :
     arrayBuffer(header),
     fileRemove(autoRemove),
-    accesslogger(logger)
+    accesslogger(logger),
+    bufferSize(header.size()),
+    contentEncoding(contentEncoding),
+    remainingBytes(length)
 {
     if (file.exists() && file.isFile()) {
         bodyFile = new QFile(file.absoluteFilePath());
         if (!bodyFile->open(QIODevice::ReadOnly)) {
             tSystemWarn("file open failed: %s", qPrintable(file.absoluteFilePath()));
             release();
+        } else if (offset > 0 && !bodyFile->seek(offset)) {
+            tSystemWarn("file seek failed: %s", qPrintable(file.absoluteFilePath()));
+            release();
         }
     }
 }
 
 
 TSendBuffer::TSendBuffer(const QByteArray &header) :
-    arrayBuffer(header)
+    arrayBuffer(header),
+    bufferSize(header.size())
 {
 }
 
@@ -51,6 +69,7 @@ TSendBuffer::TSendBuffer(int statusCode, const QHostAddress &address, const QByt
     header.setCurrentDate();
 
     arrayBuffer += header.toByteArray();
+    bufferSize = arrayBuffer.size();
 }
 
 
@@ -69,6 +88,11 @@ void TSendBuffer::release()
         delete bodyFile;
         bodyFile = nullptr;
     }
+
+    if (encoder) {
+        THttpCompressor::release(encoder);
+        encoder = nullptr;
+    }
 }
 
 
@@ -81,14 +105,23 @@ void *TSendBuffer::getData(int &size)
 
     if (startPos < arrayBuffer.length()) {
         size = qMin(arrayBuffer.length() - startPos, size);
-        return arrayBuffer.data() + startPos;
+        // Not to detach; the data may be shared with other send-buffers
+        return const_cast<char *>(arrayBuffer.constData()) + startPos;
     }
 
-    if (!bodyFile || bodyFile->atEnd()) {
+    if (bodyAtEnd()) {
         size = 0;
         return nullptr;
     }
 
+    if (contentEncoding) {
+        return getEncodedData(size);
+    }
+
+    if (remainingBytes >= 0) {
+        size = qMin((qint64)size, remainingBytes);
+    }
+
     arrayBuffer.reserve(size);
     size = bodyFile->read(arrayBuffer.data(), size);
     if (Q_UNLIKELY(size < 0)) {
@@ -98,12 +131,69 @@ void *TSendBuffer::getData(int &size)
         return nullptr;
     }
 
+    if (remainingBytes >= 0) {
+        remainingBytes -= size;
+    }
+
     arrayBuffer.resize(size);
     startPos = 0;
     return arrayBuffer.data();
 }
 
 
+/*!
+  Reads the file, compresses it and returns the data framed as a chunk
+  of the chunked transfer coding. The last call returns the remainder of
+  the compressed stream followed by the last chunk.
+*/
+void *TSendBuffer::getEncodedData(int &size)
+{
+    if (!encoder) {
+        encoder = THttpCompressor::acquire((THttpCompressor::Encoding)contentEncoding, compressionLevel());
+        if (Q_UNLIKELY(!encoder)) {
+            tSystemError("Content coding not supported: %d", contentEncoding);
+            size = 0;
+            release();
+            return nullptr;
+        }
+    }
+
+    QByteArray encoded;
+    while (encoded.isEmpty() && !encodingFinished) {
+        if (bodyFile->atEnd()) {
+            encoder->finish(encoded);
+            encodingFinished = true;
+        } else {
+            readBuffer.resize(size);
+            int len = bodyFile->read(readBuffer.data(), size);
+            if (Q_UNLIKELY(len < 0 || !encoder->compress(readBuffer.constData(), len, encoded))) {
+                tSystemError("file read or compression error: %s", qPrintable(bodyFile->fileName()));
+                size = 0;
+                release();
+                return nullptr;
+            }
+        }
+    }
+
+    arrayBuffer.truncate(0);
+    if (!encoded.isEmpty()) {
+        arrayBuffer += QByteArray::number(encoded.length(), 16);
+        arrayBuffer += "\r\n";
+        arrayBuffer += encoded;
+        arrayBuffer += "\r\n";
+    }
+    if (encodingFinished) {
+        arrayBuffer += "0\r\n\r\n";  // last-chunk
+        THttpCompressor::release(encoder);
+        encoder = nullptr;
+    }
+
+    startPos = 0;
+    size = qMin(arrayBuffer.length(), size);
+    return arrayBuffer.data();
+}
+
+
 bool TSendBuffer::seekData(int pos)
 {
     if (Q_UNLIKELY(pos < 0)) {
@@ -133,5 +223,11 @@ int TSendBuffer::prepend(const char *data, int maxSize)
 
 bool TSendBuffer::atEnd() const
 {
-    return startPos >= arrayBuffer.length() && (!bodyFile || bodyFile->atEnd());
+    return startPos >= arrayBuffer.length() && bodyAtEnd();
+}
+
+
+bool TSendBuffer::bodyAtEnd() const
+{
+    return !bodyFile || remainingBytes == 0 || (bodyFile->atEnd() && (!contentEncoding || encodingFinished));
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include <QByteArray>
+#include <QString>
 #include <TAccessLog>
 #include <TGlobal>
 
@@ -7,6 +8,7 @@ class QFile;
 class QFileInfo;
 class QHostAddress;
 class THttpHeader;
+class THttpCompressor;
 
 
 class T_CORE_EXPORT TSendBuffer {
@@ -20,6 +22,9 @@ public:
     TAccessLogger &accessLogger() { return accesslogger; }
     const TAccessLogger &accessLogger() const { return accesslogger; }
     void release();
+    qint64 size() const { return bufferSize; }
+    const QString &topic() const { return topicName; }
+    void setTopic(const QString &topic) { topicName = topic; }
 
 private:
     QByteArray arrayBuffer;
@@ -27,8 +32,17 @@ private:
     bool fileRemove {false};
     TAccessLogger accesslogger;
     int startPos {0};
-
-    TSendBuffer(const QByteArray &header, const QFileInfo &file, bool autoRemove, const TAccessLogger &logger);
+    qint64 bufferSize {0};  // bytes held in memory when queued
+    QString topicName;
+    int contentEncoding {0};  // THttpCompressor::Encoding to compress the file with
+    THttpCompressor *encoder {nullptr};
+    QByteArray readBuffer;
+    bool encodingFinished {false};
+    qint64 remainingBytes {-1};  // of the file to send; -1 means up to the end
+
+    TSendBuffer(const QByteArray &header, const QFileInfo &file, bool autoRemove, const TAccessLogger &logger, int contentEncoding = 0, qint64 offset = 0, qint64 length = -1);
+    void *getEncodedData(int &size);
+    bool bodyAtEnd() const;
     TSendBuffer(const QByteArray &header);
     TSendBuffer(int statusCode, const QHostAddress &address, const QByteArray &method);
     TSendBuffer();
@@ -14,9 +14,16 @@
 #include <QThread>
 #include <TAppSettings>
 #include <TAtomic>
+#include <TMetrics>
 #include <TSessionStore>
 
 
+static TMetricCounter &sessionOperations(const char *operation)
+{
+    return TMetrics::counter("tf_session_operations_total", TMetrics::label("operation", operation), "Number of operations on the session store");
+}
+
+
 static QByteArray createHash()
 {
     static TAtomic<quint32> seq(0);
@@ -49,6 +56,8 @@ TSession TSessionManager::findSession(const QByteArray &id)
     TSession session;
 
     if (!id.isEmpty()) {
+        static TMetricCounter &finds = sessionOperations("find");
+        finds.add();
         TSessionStore *store = TSessionStoreFactory::create(storeType());
         if (Q_LIKELY(store)) {
             session = store->find(id);
@@ -68,10 +77,17 @@ bool TSessionManager::store(TSession &session)
         return false;
     }
 
+    static TMetricCounter &stores = sessionOperations("store");
+    static TMetricCounter &failures = sessionOperations("store_failure");
+    stores.add();
+
     bool res = false;
     TSessionStore *store = TSessionStoreFactory::create(storeType());
     if (Q_LIKELY(store)) {
         res = store->store(session);
+        if (Q_UNLIKELY(!res)) {
+            failures.add();
+        }
         TSessionStoreFactory::destroy(storeType(), store);
     } else {
         tSystemError("Session store not found: %s", qPrintable(storeType()));
@@ -83,6 +99,8 @@ bool TSessionManager::store(TSession &session)
 bool TSessionManager::remove(const QByteArray &id)
 {
     if (!id.isEmpty()) {
+        static TMetricCounter &removes = sessionOperations("remove");
+        removes.add();
         TSessionStore *store = TSessionStoreFactory::create(storeType());
         if (Q_LIKELY(store)) {
             bool ret = store->remove(id);
@@ -13,6 +13,7 @@
 #include <QSslSocket>
 #include <TCryptMac>
 #include <TPopMailer>
+#include <TTracer>
 using namespace Tf;
 
 //#define tSystemError(fmt, ...)  printf(fmt "\n", ## __VA_ARGS__)
@@ -87,9 +88,12 @@ QString TSmtpMailer::lastServerResponse() const
 
 bool TSmtpMailer::send(const TMailMessage &message)
 {
+    TTraceSpan span("SMTP send", TTracer::Client);
+    span.setAttribute("net.peer.name", _smtpHostName);
     _mailMessage = message;
     bool res = send();
     _mailMessage.clear();
+    span.setError(!res);
     return res;
 }
 
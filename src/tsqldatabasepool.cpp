@@ -9,10 +9,15 @@
 #include "tsqldatabase.h"
 #include "tsqldriverextensionfactory.h"
 #include "tsystemglobal.h"
+#include "thistogram.h"
 #include <QDir>
 #include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonObject>
 #include <QMutexLocker>
 #include <TAppSettings>
+#include <TIntrospector>
+#include <TMetrics>
 #include <TSqlQuery>
 #include <TWebApplication>
 #include <ctime>
@@ -86,6 +91,8 @@ void TSqlDatabasePool::init()
     cachedDatabase = new TStack<QString>[Tf::app()->sqlDatabaseSettingsCount()];
     lastCachedTime = new TAtomic<uint>[Tf::app()->sqlDatabaseSettingsCount()];
     availableNames = new TStack<QString>[Tf::app()->sqlDatabaseSettingsCount()];
+    checkedOut.resize(Tf::app()->sqlDatabaseSettingsCount());
+    waitTime.resize(Tf::app()->sqlDatabaseSettingsCount());
     bool aval = false;
     tSystemDebug("SQL database available");
 
@@ -97,6 +104,16 @@ void TSqlDatabasePool::init()
         }
         aval = true;
 
+        // Metrics
+        QByteArray label = TMetrics::label("db", QByteArray::number(j));
+        // Counted even if the metrics are disabled, for the introspector
+        TMetricGauge *gauge = checkedOut[j] = new TMetricGauge;
+        TMetrics::registerGauge("tf_sql_pool_checked_out_connections", label, [gauge]() { return gauge->value(); },
+            "Number of SQL connections checked out of the pool");
+        waitTime[j] = &TMetrics::histogram("tf_sql_pool_wait_seconds", label, "Time to check out a SQL connection, including opening it");
+        TMetrics::registerGauge("tf_sql_pool_idle_connections", label, [this, j]() { return (qint64)cachedDatabase[j].count(); },
+            "Number of open SQL connections idle in the pool");
+
         auto &stack = availableNames[j];
         for (int i = 0; i < maxConnects; ++i) {
             TSqlDatabase &db = TSqlDatabase::addDatabase(type, QString().sprintf(CONN_NAME_FORMAT, j, i));
@@ -114,6 +131,21 @@ void TSqlDatabasePool::init()
     if (aval) {
         // Starts the timer to close extra-connection
         timer.start(10000, this);
+
+        TIntrospector::registerSection(QStringLiteral("sql_pools"), [this]() {
+            QJsonArray pools;
+            for (int j = 0; j < checkedOut.count(); ++j) {
+                if (checkedOut[j]) {
+                    QJsonObject pool;
+                    pool.insert(QStringLiteral("db"), j);
+                    pool.insert(QStringLiteral("checked_out"), (double)checkedOut[j]->value());
+                    pool.insert(QStringLiteral("idle"), cachedDatabase[j].count());
+                    pool.insert(QStringLiteral("max"), maxConnects);
+                    pools.append(pool);
+                }
+            }
+            return QJsonValue(pools);
+        });
     }
 }
 
@@ -125,6 +157,13 @@ QSqlDatabase TSqlDatabasePool::database(int databaseId)
     if (Q_LIKELY(databaseId >= 0 && databaseId < Tf::app()->sqlDatabaseSettingsCount())) {
         auto &cache = cachedDatabase[databaseId];
         auto &stack = availableNames[databaseId];
+        const qint64 startTicks = Tf::getMonotonicNSecs();
+
+        auto checkOut = [&](const QSqlDatabase &database) {
+            checkedOut[databaseId]->add();
+            waitTime[databaseId]->record(Tf::getMonotonicNSecs() - startTicks);
+            return database;
+        };
 
         for (;;) {
             QString name;
@@ -132,7 +171,7 @@ QSqlDatabase TSqlDatabasePool::database(int databaseId)
                 tdb = TSqlDatabase::database(name);
                 if (Q_LIKELY(tdb.sqlDatabase().isOpen())) {
                     tSystemDebug("Gets cached database: %s", qPrintable(tdb.connectionName()));
-                    return tdb.sqlDatabase();
+                    return checkOut(tdb.sqlDatabase());
                 } else {
                     tSystemError("Pooled database is not open: %s  [%s:%d]", qPrintable(tdb.connectionName()), __FILE__, __LINE__);
                     stack.push(name);
@@ -144,7 +183,7 @@ QSqlDatabase TSqlDatabasePool::database(int databaseId)
                 auto tdb = TSqlDatabase::database(name);
                 if (Q_UNLIKELY(tdb.sqlDatabase().isOpen())) {
                     tSystemWarn("Gets a opend database: %s", qPrintable(tdb.connectionName()));
-                    return tdb.sqlDatabase();
+                    return checkOut(tdb.sqlDatabase());
                 } else {
                     if (Q_UNLIKELY(!tdb.sqlDatabase().open())) {
                         tError("Database open error. Invalid database settings, or maximum number of SQL connection exceeded.");
@@ -164,7 +203,7 @@ QSqlDatabase TSqlDatabasePool::database(int databaseId)
                             query.exec(st);
                         }
                     }
-                    return tdb.sqlDatabase();
+                    return checkOut(tdb.sqlDatabase());
                 }
             }
         }
@@ -248,6 +287,8 @@ void TSqlDatabasePool::pool(QSqlDatabase &database, bool forceClose)
         int databaseId = getDatabaseId(database);
 
         if (databaseId >= 0 && databaseId < Tf::app()->sqlDatabaseSettingsCount()) {
+            checkedOut[databaseId]->sub();
+
             if (forceClose) {
                 tSystemWarn("Force close database: %s", qPrintable(database.connectionName()));
                 closeDatabase(database);
@@ -11,6 +11,8 @@
 #include <TGlobal>
 
 class TSqlDatabase;
+class TMetricGauge;
+class THistogram;
 
 
 class T_CORE_EXPORT TSqlDatabasePool : public QObject {
@@ -36,6 +38,8 @@ private:
     TAtomic<uint> *lastCachedTime {nullptr};
     TStack<QString> *availableNames {nullptr};
     int maxConnects {0};
+    QVector<TMetricGauge *> checkedOut;
+    QVector<THistogram *> waitTime;
     QBasicTimer timer;
 
     T_DISABLE_COPY(TSqlDatabasePool)
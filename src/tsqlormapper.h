@@ -6,6 +6,7 @@
 #include <TCriteria>
 #include <TCriteriaConverter>
 #include <TGlobal>
+#include <TQueryTracer>
 #include <TSqlJoin>
 #include <TSqlObject>
 #include <TSqlQuery>
@@ -166,7 +167,9 @@ inline T TSqlORMapper<T>::findFirst(const TCriteria &cri)
 
     int oldLimit = queryLimit;
     queryLimit = 1;
+    TQueryTracer tracer(TQueryTracer::Sql);
     bool ret = select();
+    tracer.finish(query(), ret, (ret) ? rowCount() : -1);
     Tf::writeQueryLog(query().lastQuery(), ret, lastError());
     queryLimit = oldLimit;
 
@@ -216,10 +219,12 @@ inline int TSqlORMapper<T>::find(const TCriteria &cri)
         setFilter(QString());
     }
 
+    TQueryTracer tracer(TQueryTracer::Sql);
     bool ret = select();
     while (canFetchMore()) {  // For SQLite, not report back the size of a query
         fetchMore();
     }
+    tracer.finish(query(), ret, (ret) ? rowCount() : -1);
     Tf::writeQueryLog(query().lastQuery(), ret, lastError());
     //tSystemDebug("find() rowCount: %d", rowCount());
     return ret ? rowCount() : -1;
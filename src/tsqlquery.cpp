@@ -9,7 +9,9 @@
 #include <QMap>
 #include <QMutex>
 #include <QMutexLocker>
+#include <TAccessLog>
 #include <TAppSettings>
+#include <TQueryTracer>
 #include <TSqlQuery>
 #include <TWebApplication>
 
@@ -165,7 +167,13 @@ TSqlQuery &TSqlQuery::prepare(const QString &query)
 */
 bool TSqlQuery::exec(const QString &query)
 {
-    bool ret = QSqlQuery::exec(query);
+    bool ret;
+    {
+        TAccessLogger::PhaseTimer timer(TAccessLog::Database);
+        TQueryTracer tracer(TQueryTracer::Sql);
+        ret = QSqlQuery::exec(query);
+        tracer.finish(*this, ret);
+    }
     Tf::writeQueryLog(query, ret, lastError());
     return ret;
 }
@@ -176,7 +184,13 @@ bool TSqlQuery::exec(const QString &query)
 */
 bool TSqlQuery::exec()
 {
-    bool ret = QSqlQuery::exec();
+    bool ret;
+    {
+        TAccessLogger::PhaseTimer timer(TAccessLog::Database);
+        TQueryTracer tracer(TQueryTracer::Sql);
+        ret = QSqlQuery::exec();
+        tracer.finish(*this, ret);
+    }
     Tf::writeQueryLog(executedQuery(), ret, lastError());
     return ret;
 }
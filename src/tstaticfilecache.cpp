@@ -0,0 +1,435 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tstaticfilecache.h"
+#include "tsystemglobal.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <TAppSettings>
+#include <THttpUtility>
+#ifdef Q_OS_LINUX
+#include "tfcore_unix.h"
+#include <sys/inotify.h>
+#endif
+
+/*!
+  \class TStaticFileCache
+  \brief The TStaticFileCache class caches the metadata of the static files
+  under the public directory, and the contents of small ones.
+
+  A static GET is served from the cache without stat(), open() and read()
+  of the file. On Linux, entries are invalidated by inotify events of the
+  directories holding them; on other platforms, an entry is revalidated
+  with stat() once it's older than a second.
+*/
+
+namespace {
+constexpr int MAX_ENTRIES = 10000;
+constexpr qint64 REVALIDATION_MSECS = 1000;
+
+// Reads the metadata of the file, and its content if not larger than maxContentSize
+TStaticFileCache::EntryPtr loadEntry(const QString &filePath, qint64 maxContentSize)
+{
+    QFileInfo fi(filePath);
+    if (!fi.isFile() || !fi.isReadable()) {
+        return TStaticFileCache::EntryPtr();
+    }
+
+    auto *entry = new TStaticFileCache::Entry;
+    entry->filePath = filePath;
+    entry->size = fi.size();
+    entry->lastModified = fi.lastModified();
+
+    if (entry->size <= maxContentSize) {
+        QFile file(filePath);
+        if (file.open(QIODevice::ReadOnly)) {
+            entry->content = file.readAll();
+            entry->size = entry->content.size();
+            entry->hasContent = true;
+        }
+    }
+
+    entry->lastModifiedString = THttpUtility::toHttpDateTimeString(entry->lastModified);
+    entry->etag = '"' + QByteArray::number(entry->lastModified.toMSecsSinceEpoch(), 16) + '-' + QByteArray::number(entry->size, 16) + '"';
+    return TStaticFileCache::EntryPtr(entry);
+}
+
+
+class StaticFileCache {
+public:
+    StaticFileCache();
+    ~StaticFileCache();
+
+    TStaticFileCache::EntryPtr lookup(const QString &filePath);
+    void clear();
+    qint64 memoryUsage() const { return contentBytes; }
+
+private:
+    struct Slot {
+        TStaticFileCache::EntryPtr entry;  // null if the file does not exist
+        qint64 checkedAt {0};
+    };
+
+    bool watchDirectory(const QString &filePath);
+    void processEvents();
+    void remove(const QString &filePath);
+    void removeAll();
+
+    QMutex mutex;
+    QHash<QString, Slot> entries;
+    quint64 invalidations {0};  // counts the changes noticed
+    qint64 contentBytes {0};
+    qint64 maxFileSize {0};
+    qint64 maxMemory {0};
+#ifdef Q_OS_LINUX
+    int inotifyFd {-1};
+    QHash<int, QString> watchedDirs;  // directory by watch descriptor
+    QHash<QString, int> watchDescriptors;
+#endif
+};
+
+
+StaticFileCache::StaticFileCache()
+{
+    maxFileSize = Tf::appSettings()->value(Tf::StaticFileCacheMaxFileSize, 65536).toLongLong();
+    maxMemory = Tf::appSettings()->value(Tf::StaticFileCacheMaxMemory, 67108864).toLongLong();
+#ifdef Q_OS_LINUX
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) {
+        tSystemWarn("inotify_init1 failed; static files are revalidated with stat  errno:%d", errno);
+    }
+#endif
+}
+
+
+StaticFileCache::~StaticFileCache()
+{
+#ifdef Q_OS_LINUX
+    if (inotifyFd >= 0) {
+        tf_close(inotifyFd);
+    }
+#endif
+}
+
+
+TStaticFileCache::EntryPtr StaticFileCache::lookup(const QString &filePath)
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    qint64 maxContentSize = -1;
+    quint64 generation = 0;
+    bool watched = false;
+
+    {
+        QMutexLocker locker(&mutex);
+        processEvents();
+
+        auto it = entries.find(filePath);
+        if (it != entries.end()) {
+#ifdef Q_OS_LINUX
+            if (inotifyFd >= 0) {
+                return it->entry;
+            }
+#endif
+            if (now - it->checkedAt < REVALIDATION_MSECS) {
+                return it->entry;
+            }
+
+            QFileInfo fi(filePath);
+            bool exists = fi.isFile() && fi.isReadable();
+            if (it->entry ? (exists && fi.size() == it->entry->size && fi.lastModified() == it->entry->lastModified) : !exists) {
+                it->checkedAt = now;
+                return it->entry;
+            }
+            remove(filePath);
+        }
+
+        if (entries.count() >= MAX_ENTRIES) {
+            removeAll();
+        }
+
+        // Watches before reading, so that a change while reading is noticed
+        watched = watchDirectory(filePath);
+        maxContentSize = (watched && contentBytes < maxMemory) ? maxFileSize : -1;
+        generation = invalidations;
+    }
+
+    // Reads the file without the lock, not to block the other lookups
+    auto entry = loadEntry(filePath, maxContentSize);
+    if (!watched) {
+        return entry;
+    }
+
+    QMutexLocker locker(&mutex);
+    processEvents();
+    if (invalidations != generation) {
+        return entry;  // may have been changed while reading; not cached
+    }
+
+    auto it = entries.find(filePath);
+    if (it != entries.end()) {
+        return it->entry;  // cached by another thread meanwhile
+    }
+
+    Slot &slot = entries[filePath];
+    slot.entry = entry;
+    slot.checkedAt = now;
+    if (entry && entry->hasContent) {
+        contentBytes += entry->content.size();
+    }
+    return entry;
+}
+
+
+void StaticFileCache::remove(const QString &filePath)
+{
+    invalidations++;
+    auto it = entries.find(filePath);
+    if (it != entries.end()) {
+        if (it->entry && it->entry->hasContent) {
+            contentBytes -= it->entry->content.size();
+        }
+        entries.erase(it);
+    }
+}
+
+
+void StaticFileCache::clear()
+{
+    QMutexLocker locker(&mutex);
+    removeAll();
+}
+
+
+void StaticFileCache::removeAll()
+{
+    invalidations++;
+    entries.clear();
+    contentBytes = 0;
+#ifdef Q_OS_LINUX
+    for (auto it = watchedDirs.constBegin(); it != watchedDirs.constEnd(); ++it) {
+        inotify_rm_watch(inotifyFd, it.key());
+    }
+    watchedDirs.clear();
+    watchDescriptors.clear();
+#endif
+}
+
+// Returns true if changes of the file are going to be noticed
+bool StaticFileCache::watchDirectory(const QString &filePath)
+{
+#ifdef Q_OS_LINUX
+    if (inotifyFd < 0) {
+        return true;  // revalidated with stat
+    }
+
+    QString dir = filePath.left(filePath.lastIndexOf(QLatin1Char('/')));
+    if (watchDescriptors.contains(dir)) {
+        return true;
+    }
+
+    const uint32_t mask = IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF;
+    int wd = inotify_add_watch(inotifyFd, QFile::encodeName(dir).constData(), mask);
+    if (wd < 0) {
+        return false;  // no such directory or too many watches
+    }
+    watchedDirs.insert(wd, dir);
+    watchDescriptors.insert(dir, wd);
+    return true;
+#else
+    Q_UNUSED(filePath);
+    return true;
+#endif
+}
+
+// Drops the entries of the files changed
+void StaticFileCache::processEvents()
+{
+#ifdef Q_OS_LINUX
+    if (inotifyFd < 0) {
+        return;
+    }
+
+    alignas(struct inotify_event) char buf[4096];
+    int len;
+    while ((len = tf_read(inotifyFd, buf, sizeof(buf))) > 0) {
+        for (int pos = 0; pos < len;) {
+            auto *event = reinterpret_cast<struct inotify_event *>(buf + pos);
+            pos += sizeof(struct inotify_event) + event->len;
+
+            if (event->mask & IN_Q_OVERFLOW) {
+                removeAll();
+                return;
+            }
+
+            QString dir = watchedDirs.value(event->wd);
+            if (dir.isEmpty()) {
+                continue;
+            }
+
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+                // Drops all the files in the directory
+                invalidations++;
+                QString prefix = dir + QLatin1Char('/');
+                for (auto it = entries.begin(); it != entries.end();) {
+                    if (it.key().startsWith(prefix)) {
+                        if (it->entry && it->entry->hasContent) {
+                            contentBytes -= it->entry->content.size();
+                        }
+                        it = entries.erase(it);
+                    } else {
+                        ++it;
+                    }
+                }
+                if (!(event->mask & IN_IGNORED)) {
+                    inotify_rm_watch(inotifyFd, event->wd);
+                }
+                watchedDirs.remove(event->wd);
+                watchDescriptors.remove(dir);
+            } else if (event->len > 0) {
+                remove(dir + QLatin1Char('/') + QFile::decodeName(event->name));
+            }
+        }
+    }
+#endif
+}
+
+
+StaticFileCache *staticFileCache()
+{
+    static StaticFileCache cache;
+    return &cache;
+}
+
+}
+
+/*!
+  Returns the entry of the file \a filePath, or a null pointer if it is not
+  a readable regular file. If the cache is disabled, the entry is read
+  from the file system every time.
+*/
+TStaticFileCache::EntryPtr TStaticFileCache::lookup(const QString &filePath)
+{
+    return (isEnabled()) ? staticFileCache()->lookup(filePath) : loadEntry(filePath, -1);
+}
+
+/*!
+  Drops all the entries.
+*/
+void TStaticFileCache::clear()
+{
+    if (isEnabled()) {
+        staticFileCache()->clear();
+    }
+}
+
+/*!
+  Returns true if the static file cache is enabled by the
+  'StaticFileCache.Enable' setting.
+*/
+bool TStaticFileCache::isEnabled()
+{
+    static const bool enabled = Tf::appSettings()->value(Tf::StaticFileCacheEnable, true).toBool();
+    return enabled;
+}
+
+/*!
+  Returns the number of bytes of the file contents held in the cache.
+*/
+qint64 TStaticFileCache::memoryUsage()
+{
+    return (isEnabled()) ? staticFileCache()->memoryUsage() : 0;
+}
+
+/*!
+  Returns true if the If-None-Match header \a condition matches the entity
+  tag \a etag by the weak comparison; "*" matches any tag.
+*/
+bool TStaticFileCache::matchesEntityTag(const QByteArray &condition, const QByteArray &etag)
+{
+    if (condition.trimmed() == "*") {
+        return true;
+    }
+
+    for (auto &tag : condition.split(',')) {
+        QByteArray t = tag.trimmed();
+        if (t.startsWith("W/")) {
+            t = t.mid(2);
+        }
+        if (t == etag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*!
+  Returns true if the Range header is to be applied for the If-Range header
+  \a ifRange; it is empty, or equals the entity tag \a etag by the strong
+  comparison or the HTTP-date \a lastModified. Otherwise the whole file is
+  sent.
+*/
+bool TStaticFileCache::matchesIfRange(const QByteArray &ifRange, const QByteArray &etag, const QByteArray &lastModified)
+{
+    QByteArray condition = ifRange.trimmed();
+    return condition.isEmpty() || condition == etag || condition == lastModified;
+}
+
+/*!
+  Parses the Range header \a range for a single byte range of a file of
+  \a size bytes. Returns 1 and sets \a offset and \a length if the range is
+  satisfiable, -1 if not, or 0 if the header is to be ignored and the whole
+  file is sent.
+*/
+int TStaticFileCache::parseByteRange(const QByteArray &range, qint64 size, qint64 &offset, qint64 &length)
+{
+    if (!range.startsWith("bytes=")) {
+        return 0;
+    }
+
+    QByteArray spec = range.mid(6).trimmed();
+    int dash = spec.indexOf('-');
+    if (dash < 0 || spec.contains(',')) {
+        return 0;  // multiple ranges not supported
+    }
+
+    bool ok = true;
+    QByteArray firstPos = spec.left(dash).trimmed();
+    QByteArray lastPos = spec.mid(dash + 1).trimmed();
+
+    if (firstPos.isEmpty()) {
+        // Suffix range; the last N bytes
+        qint64 suffixLength = lastPos.toLongLong(&ok);
+        if (!ok || suffixLength < 0) {
+            return 0;
+        }
+        if (suffixLength == 0 || size == 0) {
+            return -1;
+        }
+        offset = qMax(size - suffixLength, (qint64)0);
+        length = size - offset;
+        return 1;
+    }
+
+    qint64 first = firstPos.toLongLong(&ok);
+    if (!ok || first < 0) {
+        return 0;
+    }
+    qint64 last = (lastPos.isEmpty()) ? size - 1 : lastPos.toLongLong(&ok);
+    if (!ok || (!lastPos.isEmpty() && last < first)) {
+        return 0;
+    }
+    if (first >= size) {
+        return -1;
+    }
+
+    offset = first;
+    length = qMin(last, size - 1) - first + 1;
+    return 1;
+}
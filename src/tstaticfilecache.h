@@ -0,0 +1,31 @@
+#pragma once
+#include <QByteArray>
+#include <QDateTime>
+#include <QSharedPointer>
+#include <QString>
+#include <TGlobal>
+
+
+class T_CORE_EXPORT TStaticFileCache {
+public:
+    class Entry {
+    public:
+        QString filePath;
+        qint64 size {0};
+        QDateTime lastModified;
+        QByteArray lastModifiedString;  // HTTP-date
+        QByteArray etag;  // strong validator, quoted
+        QByteArray content;  // whole data of a small file
+        bool hasContent {false};
+    };
+    using EntryPtr = QSharedPointer<const Entry>;
+
+    static EntryPtr lookup(const QString &filePath);
+    static void clear();
+    static bool isEnabled();
+    static qint64 memoryUsage();
+
+    static bool matchesEntityTag(const QByteArray &condition, const QByteArray &etag);
+    static bool matchesIfRange(const QByteArray &ifRange, const QByteArray &etag, const QByteArray &lastModified);
+    static int parseByteRange(const QByteArray &range, qint64 size, qint64 &offset, qint64 &length);
+};
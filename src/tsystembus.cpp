@@ -6,6 +6,7 @@
  */
 
 #include "tsystembus.h"
+#include "tatomic.h"
 #include "tfcore.h"
 #include "tprocessinfo.h"
 #include "tsystemglobal.h"
@@ -13,12 +14,47 @@
 #include <QLocalSocket>
 #include <QMutex>
 #include <QStringList>
+#include <QThread>
 #include <TApplicationServerBase>
 #include <TWebApplication>
+#ifdef Q_OS_LINUX
+#include "tsystembusring.h"
+#endif
 
 constexpr int HEADER_LEN = 5;
 constexpr auto SYSTEMBUS_DOMAIN_PREFIX = "treefrog_systembus_";
 
+#ifdef Q_OS_LINUX
+namespace {
+
+// Waits for records of the system bus ring and notifies the bus
+class TSystemBusWaiter : public QThread {
+public:
+    TSystemBusWaiter(TSystemBusRing *ring, TSystemBus *bus) :
+        QThread(), _ring(ring), _bus(bus) { }
+    void stop() { _stopped = true; }
+
+protected:
+    void run() override
+    {
+        quint32 sequence = _ring->sequence();
+        while (!_stopped.load()) {
+            // Retries a stalled read so that an abandoned record is skipped
+            if (_ring->wait(sequence, 1000) || _ring->isStalled()) {
+                emit _bus->readyReceive();
+            }
+        }
+    }
+
+private:
+    TSystemBusRing *_ring {nullptr};
+    TSystemBus *_bus {nullptr};
+    TAtomic<bool> _stopped {false};
+};
+
+}
+#endif
+
 
 TSystemBus *TSystemBus::instance()
 {
@@ -42,6 +78,14 @@ TSystemBus::TSystemBus() :
 
 TSystemBus::~TSystemBus()
 {
+#ifdef Q_OS_LINUX
+    if (busWaiter) {
+        static_cast<TSystemBusWaiter *>(busWaiter)->stop();
+        busWaiter->wait();
+        delete busWaiter;
+    }
+    delete busRing;
+#endif
     busSocket->close();
     delete busSocket;
 }
@@ -49,6 +93,13 @@ TSystemBus::~TSystemBus()
 
 bool TSystemBus::send(const TSystemBusMessage &message)
 {
+#ifdef Q_OS_LINUX
+    if (busRing) {
+        // Copies to the shared memory directly
+        return busRing->write(message._firstByte, message._target.toUtf8(), message._data);
+    }
+#endif
+
     QMutexLocker locker(&mutexWrite);
     sendBuffer += message.toByteArray();
     QMetaObject::invokeMethod(this, "writeBus", Qt::QueuedConnection);  // Writes in main thread
@@ -69,6 +120,22 @@ QList<TSystemBusMessage> TSystemBus::recvAll()
     quint32 length;
     QMutexLocker locker(&mutexRead);
 
+#ifdef Q_OS_LINUX
+    if (busRing) {
+        QByteArray target, data;
+        while (busRing->read(opcode, target, data)) {
+            TSystemBusMessage message;
+            message._firstByte = opcode;
+            message._target = QString::fromUtf8(target);
+            message._data = data;
+            if (message.validate()) {
+                ret << message;
+            }
+        }
+        return ret;
+    }
+#endif
+
     for (;;) {
         QDataStream ds(readBuffer);
         ds.setByteOrder(QDataStream::BigEndian);
@@ -141,6 +208,19 @@ void TSystemBus::writeBus()
 
 void TSystemBus::connect()
 {
+#ifdef Q_OS_LINUX
+    if (!busRing) {
+        auto *ring = new TSystemBusRing(connectionName());
+        if (ring->attach()) {
+            busRing = ring;
+            busWaiter = new TSystemBusWaiter(busRing, this);
+            busWaiter->start();
+            return;
+        }
+        delete ring;
+        tSystemWarn("System bus ring not available, uses the local socket");
+    }
+#endif
     busSocket->connectToServer(connectionName());
 }
 
@@ -190,42 +270,19 @@ TSystemBusMessage::TSystemBusMessage()
 }
 
 
-TSystemBusMessage::TSystemBusMessage(quint8 op, const QByteArray &d)
-{
-    _firstByte = 0x80 | (op & 0x3F);
-    QDataStream ds(&_payload, QIODevice::WriteOnly);
-    ds.setByteOrder(QDataStream::BigEndian);
-    ds << QByteArray() << d;
-}
-
-
-TSystemBusMessage::TSystemBusMessage(quint8 op, const QString &t, const QByteArray &d)
-{
-    _firstByte = 0x80 | (op & 0x3F);
-    QDataStream ds(&_payload, QIODevice::WriteOnly);
-    ds.setByteOrder(QDataStream::BigEndian);
-    ds << t << d;
-}
-
-
-QString TSystemBusMessage::target() const
+TSystemBusMessage::TSystemBusMessage(quint8 op, const QByteArray &d) :
+    _firstByte(0x80 | (op & 0x3F)),
+    _target(),
+    _data(d)
 {
-    QString ret;
-    QDataStream ds(_payload);
-    ds.setByteOrder(QDataStream::BigEndian);
-    ds >> ret;
-    return ret;
 }
 
 
-QByteArray TSystemBusMessage::data() const
+TSystemBusMessage::TSystemBusMessage(quint8 op, const QString &t, const QByteArray &d) :
+    _firstByte(0x80 | (op & 0x3F)),
+    _target(t),
+    _data(d)
 {
-    QByteArray ret;
-    QString target;
-    QDataStream ds(_payload);
-    ds.setByteOrder(QDataStream::BigEndian);
-    ds >> target >> ret;
-    return ret;
 }
 
 
@@ -248,13 +305,18 @@ bool TSystemBusMessage::validate()
 
 QByteArray TSystemBusMessage::toByteArray() const
 {
+    QByteArray payload;
+    QDataStream dspay(&payload, QIODevice::WriteOnly);
+    dspay.setByteOrder(QDataStream::BigEndian);
+    dspay << _target << _data;
+
     QByteArray buf;
-    buf.reserve(HEADER_LEN + _payload.length());
+    buf.reserve(HEADER_LEN + payload.length());
 
     QDataStream ds(&buf, QIODevice::WriteOnly);
     ds.setByteOrder(QDataStream::BigEndian);
-    ds << _firstByte << (quint32)_payload.length();
-    ds.writeRawData(_payload.data(), _payload.length());
+    ds << _firstByte << (quint32)payload.length();
+    ds.writeRawData(payload.data(), payload.length());
     return buf;
 }
 
@@ -276,7 +338,9 @@ TSystemBusMessage TSystemBusMessage::parse(QByteArray &bytes)
 
     TSystemBusMessage message;
     message._firstByte = opcode;
-    message._payload = bytes.mid(HEADER_LEN, length);
+    QDataStream dspay(bytes.mid(HEADER_LEN, length));
+    dspay.setByteOrder(QDataStream::BigEndian);
+    dspay >> message._target >> message._data;
     message.validate();
     bytes.remove(0, HEADER_LEN + length);
     return message;
@@ -297,4 +361,7 @@ TSystemBusMessage TSystemBusMessage::parse(QByteArray &bytes)
  |            Payload data : QByteArray format                   |
  |                     (y)                                       |
  +---------------+-----------------------------------------------+
+
+ On Linux, messages go through TSystemBusRing in the shared memory
+ instead, with the compact record header described there.
 */
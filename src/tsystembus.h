@@ -7,6 +7,8 @@
 #include <TGlobal>
 
 class TSystemBusMessage;
+class TSystemBusRing;
+class QThread;
 
 
 class T_CORE_EXPORT TSystemBus : public QObject {
@@ -34,6 +36,8 @@ protected slots:
 
 private:
     QLocalSocket *busSocket {nullptr};
+    TSystemBusRing *busRing {nullptr};  // Linux only
+    QThread *busWaiter {nullptr};
     QByteArray readBuffer;
     QByteArray sendBuffer;
     QMutex mutexRead {QMutex::NonRecursive};
@@ -54,21 +58,20 @@ public:
     bool firstBit() const { return _firstByte & 0x80; }
     bool rsvBit() const { return _firstByte & 0x40; }
     Tf::SystemOpCode opCode() const { return (Tf::SystemOpCode)(_firstByte & 0x3F); }
-    QString target() const;
-    QByteArray data() const;
+    QString target() const { return _target; }
+    QByteArray data() const { return _data; }
 
-    int payloadLength() const { return _payload.length(); }
     QByteArray toByteArray() const;
     bool isValid() const { return _valid; }
 
     static TSystemBusMessage parse(QByteArray &bytes);
 
 private:
-    const QByteArray &payload() const { return _payload; }
     bool validate();
 
     quint8 _firstByte {0};
-    QByteArray _payload;
+    QString _target;
+    QByteArray _data;
     bool _valid {false};
 
     friend class TSystemBus;
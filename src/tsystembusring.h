@@ -0,0 +1,58 @@
+#pragma once
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+#include <TAtomic>
+#include <TGlobal>
+
+
+class T_CORE_EXPORT TSystemBusRing {
+public:
+    TSystemBusRing(const QString &name);
+    ~TSystemBusRing();
+
+    bool create(quint64 capacity = DefaultCapacity);
+    bool attach();
+    void detach();
+    bool isAttached() const { return header; }
+    QString name() const { return ringName; }
+
+    bool write(quint8 firstByte, const QByteArray &target, const QByteArray &data);
+    bool read(quint8 &firstByte, QByteArray &target, QByteArray &data);
+    quint32 sequence() const;
+    bool wait(quint32 &sequence, int msecs);
+    bool isStalled() const { return stalled.load(); }
+    quint64 lostCount() const { return lostRecords; }
+
+    static bool remove(const QString &name);
+
+    enum {
+        DefaultCapacity = 4 * 1024 * 1024,
+        AbandonedRecordMsecs = 1000,
+    };
+
+private:
+    struct Header;
+    struct RecordMeta;
+
+    void copyIn(quint64 pos, const void *src, quint64 len);
+    void copyOut(quint64 pos, void *dst, quint64 len) const;
+    void resync(quint64 writePos);
+    bool skipAbandoned(quint64 writePos);
+    static QByteArray shmName(const QString &name);
+
+    QString ringName;
+    Header *header {nullptr};
+    char *ringData {nullptr};
+    quint64 mappedSize {0};
+    quint64 readPos {0};  // local to this process
+    quint64 lostRecords {0};
+    qint64 myPid {0};
+    quint64 stallPos {~0ULL};  // uncommitted record blocking the read
+    QElapsedTimer stallTimer;
+    TAtomic<bool> stalled {false};
+
+    T_DISABLE_COPY(TSystemBusRing)
+    T_DISABLE_MOVE(TSystemBusRing)
+};
+
@@ -0,0 +1,434 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "tsystembusring.h"
+#include "tfcore_unix.h"
+#include "tsystemglobal.h"
+#include <QCoreApplication>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "lock-free atomics required for shared memory");
+
+constexpr quint32 RING_MAGIC = 0x54465242;  // "TFRB"
+constexpr quint32 RING_VERSION = 1;
+
+/*!
+  \class TSystemBusRing
+  \brief The TSystemBusRing class provides a lock-free ring buffer on POSIX
+  shared memory through which the application server processes broadcast
+  system bus messages to each other.
+
+  Any number of processes write to the ring concurrently; a writer claims
+  its space by an atomic add on the write position and commits the record
+  after copying it. Every process reads all the records with its own read
+  position, so a message is delivered to all the other processes. A reader
+  falling behind by more than the capacity loses the overwritten records.
+  A record left uncommitted for AbandonedRecordMsecs, as by a writer killed
+  between claiming and committing it, is skipped so that it does not block
+  the records after it.
+*/
+
+struct TSystemBusRing::Header {
+    quint32 magic;
+    quint32 version;
+    quint64 capacity;  // power of two
+    alignas(64) std::atomic<quint64> writePos;
+    alignas(64) std::atomic<quint32> sequence;  // futex word
+    std::atomic<quint32> waiters;
+};
+
+/* Record format in the ring; 8-byte aligned
+ +---------------------------------------------------------------+
+ |              Commit word : position + 1  (64)                 |
+ +-------------------------------+-------------------------------+
+ |        Sender PID (32)        |       Data length (32)        |
+ +---------------+---------------+---------------+---------------+
+ | Target length (16)            |F|R|opcode (8) |  Reserved     |
+ +---------------+---------------+---------------+---------------+
+ |     Target (UTF-8)  +  Data  +  Padding                       |
+ +---------------------------------------------------------------+
+*/
+struct TSystemBusRing::RecordMeta {
+    quint32 senderPid;
+    quint32 dataLength;
+    quint16 targetLength;
+    quint8 firstByte;
+    quint8 reserved[5];
+};
+
+namespace {
+constexpr quint64 COMMIT_WORD_LEN = sizeof(quint64);
+
+inline quint64 align8(quint64 len)
+{
+    return (len + 7) & ~7ULL;
+}
+
+inline int futexWait(std::atomic<quint32> *word, quint32 value, int msecs)
+{
+    struct timespec ts = {msecs / 1000, (msecs % 1000) * 1000000L};
+    return syscall(SYS_futex, reinterpret_cast<int *>(word), FUTEX_WAIT, (int)value, &ts, nullptr, 0);
+}
+
+inline int futexWake(std::atomic<quint32> *word)
+{
+    return syscall(SYS_futex, reinterpret_cast<int *>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+}
+
+
+TSystemBusRing::TSystemBusRing(const QString &name) :
+    ringName(name),
+    myPid(QCoreApplication::applicationPid())
+{
+}
+
+
+TSystemBusRing::~TSystemBusRing()
+{
+    detach();
+}
+
+/*!
+  Creates the shared memory of the ring with the \a capacity bytes.
+  It is called by the manager process.
+*/
+bool TSystemBusRing::create(quint64 capacity)
+{
+    if (Q_UNLIKELY(capacity == 0 || (capacity & (capacity - 1)) != 0)) {
+        tSystemError("Invalid capacity of system bus ring: %llu", capacity);
+        return false;
+    }
+
+    detach();
+    QByteArray shm = shmName(ringName);
+    ::shm_unlink(shm.data());  // removes old one
+
+    int fd = ::shm_open(shm.data(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        tSystemError("shm_open error: %s  errno:%d", shm.data(), errno);
+        return false;
+    }
+
+    quint64 size = sizeof(Header) + capacity;
+    if (::ftruncate(fd, size) < 0) {
+        tSystemError("ftruncate error: %s  errno:%d", shm.data(), errno);
+        tf_close(fd);
+        ::shm_unlink(shm.data());
+        return false;
+    }
+
+    void *ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    tf_close(fd);
+    if (ptr == MAP_FAILED) {
+        tSystemError("mmap error: %s  errno:%d", shm.data(), errno);
+        ::shm_unlink(shm.data());
+        return false;
+    }
+
+    header = new (ptr) Header;
+    header->version = RING_VERSION;
+    header->capacity = capacity;
+    header->writePos.store(0);
+    header->sequence.store(0);
+    header->waiters.store(0);
+    ringData = (char *)ptr + sizeof(Header);
+    mappedSize = size;
+    readPos = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = RING_MAGIC;
+    tSystemDebug("system bus ring created: %s  capacity:%llu", shm.data(), capacity);
+    return true;
+}
+
+/*!
+  Attaches this process to the ring created by the manager process.
+*/
+bool TSystemBusRing::attach()
+{
+    if (header) {
+        return true;
+    }
+
+    QByteArray shm = shmName(ringName);
+    int fd = ::shm_open(shm.data(), O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        tSystemDebug("shm_open error: %s  errno:%d", shm.data(), errno);
+        return false;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) < 0 || (quint64)st.st_size <= sizeof(Header)) {
+        tSystemError("Invalid shared memory: %s", shm.data());
+        tf_close(fd);
+        return false;
+    }
+
+    void *ptr = ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    tf_close(fd);
+    if (ptr == MAP_FAILED) {
+        tSystemError("mmap error: %s  errno:%d", shm.data(), errno);
+        return false;
+    }
+
+    auto *hdr = (Header *)ptr;
+    if (hdr->magic != RING_MAGIC || hdr->version != RING_VERSION
+        || sizeof(Header) + hdr->capacity != (quint64)st.st_size) {
+        tSystemError("Invalid system bus ring: %s", shm.data());
+        ::munmap(ptr, st.st_size);
+        return false;
+    }
+
+    header = hdr;
+    ringData = (char *)ptr + sizeof(Header);
+    mappedSize = st.st_size;
+    readPos = header->writePos.load(std::memory_order_acquire);  // reads new records only
+    return true;
+}
+
+
+void TSystemBusRing::detach()
+{
+    if (header) {
+        ::munmap(header, mappedSize);
+        header = nullptr;
+        ringData = nullptr;
+        mappedSize = 0;
+    }
+}
+
+/*!
+  Removes the shared memory of the ring with the \a name.
+*/
+bool TSystemBusRing::remove(const QString &name)
+{
+    return ::shm_unlink(shmName(name).data()) == 0;
+}
+
+/*!
+  Writes a record to the ring. It never blocks and takes no lock.
+*/
+bool TSystemBusRing::write(quint8 firstByte, const QByteArray &target, const QByteArray &data)
+{
+    if (Q_UNLIKELY(!header)) {
+        return false;
+    }
+
+    const quint64 capacity = header->capacity;
+    const quint64 len = align8(COMMIT_WORD_LEN + sizeof(RecordMeta) + target.length() + data.length());
+    if (Q_UNLIKELY(target.length() > 0xFFFF || len > capacity / 4)) {
+        tSystemError("Too long message for system bus: %llu bytes", len);
+        return false;
+    }
+
+    quint64 pos = header->writePos.fetch_add(len, std::memory_order_acq_rel);
+    auto *commit = (std::atomic<quint64> *)(ringData + (pos & (capacity - 1)));
+    commit->store(0, std::memory_order_relaxed);  // invalidates the old record
+
+    RecordMeta meta;
+    std::memset(&meta, 0, sizeof(meta));
+    meta.senderPid = (quint32)myPid;
+    meta.dataLength = data.length();
+    meta.targetLength = target.length();
+    meta.firstByte = firstByte;
+
+    quint64 p = pos + COMMIT_WORD_LEN;
+    copyIn(p, &meta, sizeof(meta));
+    p += sizeof(meta);
+    copyIn(p, target.constData(), target.length());
+    p += target.length();
+    copyIn(p, data.constData(), data.length());
+
+    commit->store(pos + 1, std::memory_order_release);
+
+    header->sequence.fetch_add(1, std::memory_order_release);
+    if (header->waiters.load(std::memory_order_acquire) > 0) {
+        futexWake(&header->sequence);
+    }
+    return true;
+}
+
+/*!
+  Reads the next record written by other processes. Returns false if no
+  committed record is available.
+*/
+bool TSystemBusRing::read(quint8 &firstByte, QByteArray &target, QByteArray &data)
+{
+    if (Q_UNLIKELY(!header)) {
+        return false;
+    }
+
+    const quint64 capacity = header->capacity;
+
+    for (;;) {
+        quint64 wpos = header->writePos.load(std::memory_order_acquire);
+        if (readPos >= wpos) {
+            stalled = false;
+            return false;
+        }
+
+        if (Q_UNLIKELY(wpos - readPos > capacity)) {
+            resync(wpos);
+            continue;
+        }
+
+        auto *commit = (std::atomic<quint64> *)(ringData + (readPos & (capacity - 1)));
+        if (commit->load(std::memory_order_acquire) != readPos + 1) {
+            // Not committed yet
+            if (skipAbandoned(wpos)) {
+                continue;
+            }
+            return false;
+        }
+        stalled = false;
+
+        RecordMeta meta;
+        copyOut(readPos + COMMIT_WORD_LEN, &meta, sizeof(meta));
+        const quint64 len = align8(COMMIT_WORD_LEN + sizeof(RecordMeta) + meta.targetLength + meta.dataLength);
+        if (Q_UNLIKELY(len > capacity / 4)) {
+            resync(header->writePos.load(std::memory_order_acquire));
+            continue;
+        }
+
+        bool self = (meta.senderPid == (quint32)myPid);
+        if (!self) {
+            quint64 p = readPos + COMMIT_WORD_LEN + sizeof(RecordMeta);
+            target.resize(meta.targetLength);
+            copyOut(p, target.data(), meta.targetLength);
+            data.resize(meta.dataLength);
+            copyOut(p + meta.targetLength, data.data(), meta.dataLength);
+            firstByte = meta.firstByte;
+        }
+
+        // Checks that no writer has overwritten the record while copying
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (Q_UNLIKELY(header->writePos.load(std::memory_order_acquire) - readPos > capacity)) {
+            resync(header->writePos.load(std::memory_order_acquire));
+            continue;
+        }
+
+        readPos += len;
+        if (!self) {
+            return true;
+        }
+    }
+}
+
+
+quint32 TSystemBusRing::sequence() const
+{
+    return (header) ? header->sequence.load(std::memory_order_acquire) : 0;
+}
+
+/*!
+  Waits until a record is written to the ring after the \a sequence, or
+  \a msecs milliseconds have passed. Returns true if a record was written;
+  the \a sequence is updated then.
+*/
+bool TSystemBusRing::wait(quint32 &sequence, int msecs)
+{
+    if (Q_UNLIKELY(!header)) {
+        return false;
+    }
+
+    quint32 seq = header->sequence.load(std::memory_order_acquire);
+    if (seq == sequence) {
+        header->waiters.fetch_add(1, std::memory_order_acq_rel);
+        futexWait(&header->sequence, sequence, msecs);
+        header->waiters.fetch_sub(1, std::memory_order_acq_rel);
+        seq = header->sequence.load(std::memory_order_acquire);
+    }
+
+    bool ret = (seq != sequence);
+    sequence = seq;
+    return ret;
+}
+
+
+void TSystemBusRing::copyIn(quint64 pos, const void *src, quint64 len)
+{
+    const quint64 capacity = header->capacity;
+    quint64 offset = pos & (capacity - 1);
+    quint64 first = qMin(len, capacity - offset);
+    std::memcpy(ringData + offset, src, first);
+    if (first < len) {
+        std::memcpy(ringData, (const char *)src + first, len - first);
+    }
+}
+
+
+void TSystemBusRing::copyOut(quint64 pos, void *dst, quint64 len) const
+{
+    const quint64 capacity = header->capacity;
+    quint64 offset = pos & (capacity - 1);
+    quint64 first = qMin(len, capacity - offset);
+    std::memcpy(dst, ringData + offset, first);
+    if (first < len) {
+        std::memcpy((char *)dst + first, ringData, len - first);
+    }
+}
+
+
+void TSystemBusRing::resync(quint64 writePos)
+{
+    tSystemWarn("System bus ring overrun; skipped %llu bytes", writePos - readPos);
+    lostRecords++;
+    readPos = writePos;
+}
+
+
+/*
+  Called while the record at the read position is not committed. Once it
+  stays so for AbandonedRecordMsecs, moves the read position to the next
+  committed record, found by its commit word holding its own position + 1.
+  Returns true if the read position has moved.
+*/
+bool TSystemBusRing::skipAbandoned(quint64 writePos)
+{
+    if (stallPos != readPos) {
+        stallPos = readPos;
+        stallTimer.start();
+        stalled = true;
+        return false;
+    }
+
+    if (stallTimer.elapsed() < AbandonedRecordMsecs) {
+        return false;
+    }
+
+    const quint64 capacity = header->capacity;
+    for (quint64 pos = readPos + COMMIT_WORD_LEN; pos < writePos; pos += COMMIT_WORD_LEN) {
+        auto *commit = (std::atomic<quint64> *)(ringData + (pos & (capacity - 1)));
+        if (commit->load(std::memory_order_acquire) != pos + 1) {
+            continue;
+        }
+
+        RecordMeta meta;
+        copyOut(pos + COMMIT_WORD_LEN, &meta, sizeof(meta));
+        const quint64 len = align8(COMMIT_WORD_LEN + sizeof(RecordMeta) + meta.targetLength + meta.dataLength);
+        if (len <= capacity / 4 && pos + len <= writePos) {
+            tSystemWarn("System bus ring record abandoned; skipped %llu bytes", pos - readPos);
+            lostRecords++;
+            readPos = pos;
+            stalled = false;
+            return true;
+        }
+    }
+    return false;  // waits for a record committed after it
+}
+
+
+QByteArray TSystemBusRing::shmName(const QString &name)
+{
+    return QByteArray("/") + name.toLatin1();
+}
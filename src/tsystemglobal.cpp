@@ -6,8 +6,14 @@
  */
 
 #include "tsystemglobal.h"
+#include "taccesslogsampler.h"
 #include "taccesslogstream.h"
 #include "tfileaiowriter.h"
+#include "thistogram.h"
+#include "tloglayout.h"
+#ifdef Q_OS_UNIX
+#include "tlogwriter.h"
+#endif
 #include <QByteArray>
 #include <QDateTime>
 #include <QDir>
@@ -20,6 +26,14 @@
 #include <TLog>
 #include <TLogger>
 #include <TWebApplication>
+#include <atomic>
+#include <cstdio>
+
+#undef tSystemError
+#undef tSystemWarn
+#undef tSystemInfo
+#undef tSystemDebug
+#undef tSystemTrace
 
 constexpr auto DEFAULT_SYSTEMLOG_LAYOUT = "%d %5P %m%n";
 constexpr auto DEFAULT_SYSTEMLOG_DATETIME_FORMAT = "yyyy-MM-ddThh:mm:ss";
@@ -29,17 +43,30 @@ constexpr auto DEFAULT_ACCESSLOG_DATETIME_FORMAT = "yyyy-MM-ddThh:mm:ss";
 namespace {
 TAccessLogStream *accesslogstrm = nullptr;
 TAccessLogStream *sqllogstrm = nullptr;
+TAccessLogStream *slowlogstrm = nullptr;
 TFileAioWriter systemLog;
-QByteArray syslogLayout = DEFAULT_SYSTEMLOG_LAYOUT;
-QByteArray syslogDateTimeFormat = DEFAULT_SYSTEMLOG_DATETIME_FORMAT;
-QByteArray accessLogLayout = DEFAULT_ACCESSLOG_LAYOUT;
-QByteArray accessLogDateTimeFormat;
+TLogLayout syslogLayout {DEFAULT_SYSTEMLOG_LAYOUT, DEFAULT_SYSTEMLOG_DATETIME_FORMAT};
+TLogLayout accessLogLayout {DEFAULT_ACCESSLOG_LAYOUT, QByteArray()};
+TAccessLogSampler accessLogSampler;
+std::atomic<int> systemLogLevel {Tf::TraceLevel};
+
+
+int logLevelFromString(const QString &str)
+{
+    static const QStringList levels = {"fatal", "error", "warn", "info", "debug", "trace"};
+    int level = levels.indexOf(str.trimmed().toLower());
+    return (level >= 0) ? level : (int)Tf::TraceLevel;
+}
 
 
 void tSystemMessage(int priority, const char *msg, va_list ap)
 {
-    TLog log(priority, QString().vsprintf(msg, ap).toLocal8Bit());
-    QByteArray buf = TLogger::logToByteArray(log, syslogLayout, syslogDateTimeFormat);
+    if (!Tf::isSystemLogEnabled(priority)) {
+        return;
+    }
+
+    TLog log(priority, Tf::formatLogMessage(msg, ap));
+    QByteArray buf = syslogLayout.format(log);
     systemLog.write(buf.data(), buf.length());
 }
 }
@@ -47,8 +74,8 @@ void tSystemMessage(int priority, const char *msg, va_list ap)
 
 void Tf::writeAccessLog(const TAccessLog &log)
 {
-    if (accesslogstrm) {
-        accesslogstrm->writeLog(log.toByteArray(accessLogLayout, accessLogDateTimeFormat));
+    if (accesslogstrm && accessLogSampler.sample(log.statusCode)) {
+        accesslogstrm->writeLog(accessLogLayout.format(log));
     }
 }
 
@@ -61,12 +88,66 @@ void Tf::setupSystemLogger()
         logdir.mkpath(".");
     }
 
+#ifdef Q_OS_UNIX
+    // Buffers for the log writer thread
+    auto *logWriter = TLogWriter::instance();
+    logWriter->setBufferSize(Tf::appSettings()->value(Tf::LogWriterBufferSize, (int)TLogWriter::DefaultBufferSize).toInt());
+    logWriter->setOverflowPolicy(TLogWriter::overflowPolicyFromString(Tf::appSettings()->value(Tf::LogWriterOverflowPolicy).toString()));
+#endif
+
     // system log
     systemLog.setFileName(Tf::app()->systemLogFilePath());
     systemLog.open();
 
-    syslogLayout = Tf::appSettings()->value(Tf::SystemLogLayout, DEFAULT_SYSTEMLOG_LAYOUT).toByteArray();
-    syslogDateTimeFormat = Tf::appSettings()->value(Tf::SystemLogDateTimeFormat, DEFAULT_SYSTEMLOG_DATETIME_FORMAT).toByteArray();
+    auto layout = Tf::appSettings()->value(Tf::SystemLogLayout, DEFAULT_SYSTEMLOG_LAYOUT).toByteArray();
+    auto dateTimeFormat = Tf::appSettings()->value(Tf::SystemLogDateTimeFormat, DEFAULT_SYSTEMLOG_DATETIME_FORMAT).toByteArray();
+    syslogLayout.compile(layout, dateTimeFormat);
+    syslogLayout.setOutputFormat(TLogLayout::outputFormatFromString(Tf::appSettings()->value(Tf::SystemLogFormat).toString()));
+    Tf::setSystemLogLevel(logLevelFromString(Tf::appSettings()->value(Tf::SystemLogLevel).toString()));
+}
+
+
+/*!
+  Returns true if the system log messages of the \a priority are written;
+  the arguments of tSystemDebug() and so on are not evaluated otherwise.
+*/
+bool Tf::isSystemLogEnabled(int priority) noexcept
+{
+    return priority <= systemLogLevel.load(std::memory_order_relaxed);
+}
+
+/*!
+  Sets the lowest priority of the system log messages to be written
+  to \a priority.
+*/
+void Tf::setSystemLogLevel(int priority)
+{
+    systemLogLevel.store(priority, std::memory_order_relaxed);
+}
+
+/*!
+  Formats the log message \a format with the arguments \a ap. Short
+  messages are formatted in a buffer on the stack.
+  This function is for internal use only.
+*/
+QByteArray Tf::formatLogMessage(const char *format, va_list ap)
+{
+    char buf[1024];
+    va_list aq;
+    va_copy(aq, ap);
+    int len = std::vsnprintf(buf, sizeof(buf), format, aq);
+    va_end(aq);
+
+    if (len < 0) {
+        return QByteArray();
+    }
+    if (len < (int)sizeof(buf)) {
+        return QByteArray(buf, len);
+    }
+
+    QByteArray message(len, Qt::Uninitialized);
+    std::vsnprintf(message.data(), len + 1, format, ap);
+    return message;
 }
 
 
@@ -75,6 +156,17 @@ void Tf::releaseSystemLogger()
     systemLog.close();
 }
 
+/*!
+  Writes out the log records buffered by all the threads. This function
+  is for internal use only; it is called in a signal handler.
+*/
+void Tf::flushLogWriter()
+{
+#ifdef Q_OS_UNIX
+    TLogWriter::instance()->flushUnsafe();
+#endif
+}
+
 
 void Tf::setupAccessLogger()
 {
@@ -84,13 +176,25 @@ void Tf::setupAccessLogger()
         accesslogstrm = new TAccessLogStream(accesslogpath);
     }
 
-    accessLogLayout = Tf::appSettings()->value(Tf::AccessLogLayout, DEFAULT_ACCESSLOG_LAYOUT).toByteArray();
-    accessLogDateTimeFormat = Tf::appSettings()->value(Tf::AccessLogDateTimeFormat, DEFAULT_ACCESSLOG_DATETIME_FORMAT).toByteArray();
+    auto layout = Tf::appSettings()->value(Tf::AccessLogLayout, DEFAULT_ACCESSLOG_LAYOUT).toByteArray();
+    auto dateTimeFormat = Tf::appSettings()->value(Tf::AccessLogDateTimeFormat, DEFAULT_ACCESSLOG_DATETIME_FORMAT).toByteArray();
+    accessLogLayout.compile(layout, dateTimeFormat);
+    accessLogLayout.setOutputFormat(TLogLayout::outputFormatFromString(Tf::appSettings()->value(Tf::AccessLogFormat).toString()));
+    accessLogSampler.setRules(Tf::appSettings()->value(Tf::AccessLogSamplingRules).toString());
 }
 
 
 void Tf::releaseAccessLogger()
 {
+    // Summary of the latency breakdown
+    for (int i = 0; i <= TAccessLog::PhaseCount; ++i) {
+        const THistogram &hist = TAccessLog::histogram(i);
+        if (hist.count() > 0) {
+            tSystemInfo("Latency %-8s count:%llu  p50:%lldus  p99:%lldus  max:%lldus", TAccessLog::phaseName(i),
+                (unsigned long long)hist.count(), hist.percentile(50) / 1000, hist.percentile(99) / 1000, hist.max() / 1000);
+        }
+    }
+
     delete accesslogstrm;
     accesslogstrm = nullptr;
 }
@@ -109,6 +213,12 @@ void Tf::setupQueryLogger()
     if (!sqllogstrm && !querylogpath.isEmpty()) {
         sqllogstrm = new TAccessLogStream(querylogpath);
     }
+
+    // slow query log
+    QString slowlogpath = Tf::app()->slowQueryLogFilePath();
+    if (!slowlogstrm && !slowlogpath.isEmpty()) {
+        slowlogstrm = new TAccessLogStream(slowlogpath);
+    }
 }
 
 
@@ -116,6 +226,8 @@ void Tf::releaseQueryLogger()
 {
     delete sqllogstrm;
     sqllogstrm = nullptr;
+    delete slowlogstrm;
+    slowlogstrm = nullptr;
 }
 
 
@@ -179,8 +291,8 @@ void Tf::traceQueryLog(const char *msg, ...)
     if (sqllogstrm) {
         va_list ap;
         va_start(ap, msg);
-        TLog log(-1, QString().vsprintf(msg, ap).toLocal8Bit());
-        QByteArray buf = TLogger::logToByteArray(log, syslogLayout, syslogDateTimeFormat);
+        TLog log(-1, Tf::formatLogMessage(msg, ap));
+        QByteArray buf = syslogLayout.format(log);
         sqllogstrm->writeLog(buf);
         va_end(ap);
     }
@@ -204,6 +316,15 @@ void Tf::writeQueryLog(const QString &query, bool success, const QSqlError &erro
 }
 
 
+void Tf::writeSlowQueryLog(const QString &message)
+{
+    if (slowlogstrm) {
+        TLog log(-1, message.toUtf8());
+        slowlogstrm->writeLog(syslogLayout.format(log));
+    }
+}
+
+
 QMap<QString, QVariant> Tf::settingsToMap(QSettings &settings, const QString &env)
 {
     // QSettings not thread-safe
@@ -1,8 +1,10 @@
 #pragma once
+#include <QByteArray>
 #include <QMap>
 #include <QSettings>
 #include <QVariant>
 #include <TGlobal>
+#include <cstdarg>
 
 class TAccessLog;
 class QSqlError;
@@ -10,6 +12,10 @@ class QSqlError;
 namespace Tf {
 T_CORE_EXPORT void setupSystemLogger();  // internal use
 T_CORE_EXPORT void releaseSystemLogger();  // internal use
+T_CORE_EXPORT void flushLogWriter();  // internal use, callable in a signal handler
+T_CORE_EXPORT bool isSystemLogEnabled(int priority) noexcept;
+T_CORE_EXPORT void setSystemLogLevel(int priority);
+T_CORE_EXPORT QByteArray formatLogMessage(const char *format, va_list ap);  // internal use
 T_CORE_EXPORT void setupAccessLogger();  // internal use
 T_CORE_EXPORT void releaseAccessLogger();  // internal use
 T_CORE_EXPORT bool isAccessLoggerAvailable();  // internal use
@@ -17,6 +23,7 @@ T_CORE_EXPORT void setupQueryLogger();  // internal use
 T_CORE_EXPORT void releaseQueryLogger();  // internal use
 T_CORE_EXPORT void writeAccessLog(const TAccessLog &log);  // write access log
 T_CORE_EXPORT void writeQueryLog(const QString &query, bool success, const QSqlError &error);
+T_CORE_EXPORT void writeSlowQueryLog(const QString &message);  // slow query log
 T_CORE_EXPORT void traceQueryLog(const char *, ...)  // SQL query log
 #if defined(Q_CC_GNU) && !defined(__INSURE__)
     __attribute__((format(printf, 1, 2)))
@@ -65,3 +72,9 @@ T_CORE_EXPORT void tSystemTrace(const char *, ...)  // system trace message
 #endif
     ;
 
+// Checks the level before formatting the message
+#define tSystemError(...) T_LOG_IF(Tf::ErrorLevel, Tf::isSystemLogEnabled(Tf::ErrorLevel)) tSystemError(__VA_ARGS__)
+#define tSystemWarn(...) T_LOG_IF(Tf::WarnLevel, Tf::isSystemLogEnabled(Tf::WarnLevel)) tSystemWarn(__VA_ARGS__)
+#define tSystemInfo(...) T_LOG_IF(Tf::InfoLevel, Tf::isSystemLogEnabled(Tf::InfoLevel)) tSystemInfo(__VA_ARGS__)
+#define tSystemDebug(...) T_LOG_IF(Tf::DebugLevel, Tf::isSystemLogEnabled(Tf::DebugLevel)) tSystemDebug(__VA_ARGS__)
+#define tSystemTrace(...) T_LOG_IF(Tf::TraceLevel, Tf::isSystemLogEnabled(Tf::TraceLevel)) tSystemTrace(__VA_ARGS__)
@@ -0,0 +1,648 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "ttracer.h"
+#include "tsystemglobal.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHostAddress>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QUdpSocket>
+#include <QUrl>
+#include <QVector>
+#include <QWaitCondition>
+#include <TAppSettings>
+#include <TWebApplication>
+#include <atomic>
+#include <chrono>
+
+/*!
+  \class TTraceContext
+  \brief The TTraceContext class represents the trace context of W3C
+  Trace Context, which is propagated in the traceparent header.
+*/
+
+/*!
+  \class TTracer
+  \brief The TTracer class records the spans of the requests for the
+  distributed tracing, and exports them in the OTLP/JSON format.
+
+  A request continues the trace given by its traceparent header, or starts
+  a new trace. The sampling decision of the parent is respected; a new
+  trace is sampled at the rate of the setting Tracing.SampleRate.
+  The spans of a sampled request, such as the action, the queries to the
+  databases and the outgoing HTTP requests, are exported in batches on a
+  dedicated thread to a file as JSON lines, or to a UDP collector.
+  \sa TTraceSpan
+*/
+
+/*!
+  \class TTraceSpan
+  \brief The TTraceSpan class records a span from its construction to
+  its destruction as a child of the current span of the thread.
+*/
+
+namespace {
+constexpr int FLUSH_INTERVAL_MSECS = 1000;
+constexpr int BATCH_SIZE = 256;
+constexpr int MAX_QUEUED_SPANS = 10000;
+constexpr int MAX_DATAGRAM_SIZE = 60000;
+constexpr int MAX_LINE_SIZE = 1024 * 1024;
+constexpr auto UDP_SCHEME = "udp://";
+
+struct SpanData {
+    QByteArray traceId;
+    QByteArray spanId;
+    QByteArray parentSpanId;
+    QByteArray traceState;
+    QByteArray name;
+    int kind {TTracer::Internal};
+    qint64 startNsecs {0};  // monotonic
+    qint64 endNsecs {0};
+    QVariantMap attributes;
+    bool error {false};
+};
+
+// Trace of the request being processed in the current thread
+struct ActiveTrace {
+    bool active {false};
+    bool sampled {false};
+    QByteArray traceId;
+    QByteArray traceState;
+    QByteArray remoteParentId;
+    QByteArray method;
+    QByteArray path;
+    qint64 startNsecs {0};
+    QVector<QByteArray> spanStack;  // the server span first
+};
+
+thread_local ActiveTrace activeTrace;
+std::atomic<bool> tracingEnabled {false};
+std::atomic<double> samplingRate {1.0};
+
+
+qint64 unixNsecs(qint64 monotonicNsecs)
+{
+    static const qint64 offset = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count()
+        - Tf::getMonotonicNSecs();
+    return monotonicNsecs + offset;
+}
+
+
+inline QByteArray toHex(quint64 value)
+{
+    return QByteArray::number(value, 16).rightJustified(16, '0');
+}
+
+
+bool isLowerHex(const QByteArray &str)
+{
+    bool nonzero = false;
+    for (char c : str) {
+        if (c >= 'a' && c <= 'f') {
+            nonzero = true;
+        } else if (c >= '1' && c <= '9') {
+            nonzero = true;
+        } else if (c != '0') {
+            return false;
+        }
+    }
+    return nonzero;  // all zeros is invalid
+}
+
+
+QJsonObject attributeValue(const QVariant &value)
+{
+    switch ((int)value.type()) {
+    case QVariant::Bool:
+        return QJsonObject {{QStringLiteral("boolValue"), value.toBool()}};
+    case QVariant::Int:
+    case QVariant::UInt:
+    case QVariant::LongLong:
+    case QVariant::ULongLong:
+        return QJsonObject {{QStringLiteral("intValue"), value.toString()}};  // int64 as string
+    case QVariant::Double:
+        return QJsonObject {{QStringLiteral("doubleValue"), value.toDouble()}};
+    default:
+        return QJsonObject {{QStringLiteral("stringValue"), value.toString()}};
+    }
+}
+
+
+QByteArray spanToJson(const SpanData &span)
+{
+    QJsonObject obj;
+    obj.insert(QStringLiteral("traceId"), QString::fromLatin1(span.traceId));
+    obj.insert(QStringLiteral("spanId"), QString::fromLatin1(span.spanId));
+    if (!span.parentSpanId.isEmpty()) {
+        obj.insert(QStringLiteral("parentSpanId"), QString::fromLatin1(span.parentSpanId));
+    }
+    if (!span.traceState.isEmpty()) {
+        obj.insert(QStringLiteral("traceState"), QString::fromLatin1(span.traceState));
+    }
+    obj.insert(QStringLiteral("name"), QString::fromUtf8(span.name));
+    obj.insert(QStringLiteral("kind"), span.kind);
+    obj.insert(QStringLiteral("startTimeUnixNano"), QString::number(unixNsecs(span.startNsecs)));
+    obj.insert(QStringLiteral("endTimeUnixNano"), QString::number(unixNsecs(span.endNsecs)));
+
+    if (!span.attributes.isEmpty()) {
+        QJsonArray attrs;
+        for (auto it = span.attributes.cbegin(); it != span.attributes.cend(); ++it) {
+            attrs.append(QJsonObject {{QStringLiteral("key"), it.key()}, {QStringLiteral("value"), attributeValue(it.value())}});
+        }
+        obj.insert(QStringLiteral("attributes"), attrs);
+    }
+
+    if (span.error) {
+        obj.insert(QStringLiteral("status"), QJsonObject {{QStringLiteral("code"), 2}});  // STATUS_CODE_ERROR
+    }
+    return QJsonDocument(obj).toJson(QJsonDocument::Compact);
+}
+
+
+class TraceExporter : public QThread {
+public:
+    TraceExporter(const QString &destination, const QByteArray &serviceName);
+
+    bool isValid() const { return udp || file.isOpen(); }
+    void enqueue(SpanData &&span);
+    void exportSpans();
+    quint64 droppedCount() const { return dropped; }
+
+protected:
+    void run() override;
+
+private:
+    void write(const QByteArray &data);
+
+    QFile file;
+    bool udp {false};
+    QHostAddress host;
+    quint16 port {0};
+    QByteArray header;
+    QMutex mutex;
+    QWaitCondition condition;
+    QVector<SpanData> queue;
+    quint64 dropped {0};
+    QMutex exportMutex;
+};
+
+TraceExporter *exporter = nullptr;
+
+
+TraceExporter::TraceExporter(const QString &destination, const QByteArray &serviceName) :
+    QThread()
+{
+    if (destination.startsWith(QLatin1String(UDP_SCHEME))) {
+        QUrl url(destination);
+        host = QHostAddress(url.host());
+        port = (quint16)qMax(url.port(), 0);
+        udp = !host.isNull() && port > 0;
+        if (!udp) {
+            tSystemError("Invalid trace collector: %s", qPrintable(destination));
+        }
+    } else {
+        QDir().mkpath(QFileInfo(destination).absolutePath());
+        file.setFileName(destination);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+            tSystemError("Failed to open trace file: %s", qPrintable(destination));
+        }
+    }
+
+    // Head of ExportTraceServiceRequest
+    QJsonObject resource {{QStringLiteral("attributes"),
+        QJsonArray {QJsonObject {{QStringLiteral("key"), QStringLiteral("service.name")},
+            {QStringLiteral("value"), QJsonObject {{QStringLiteral("stringValue"), QString::fromUtf8(serviceName)}}}}}}};
+    header = "{\"resourceSpans\":[{\"resource\":" + QJsonDocument(resource).toJson(QJsonDocument::Compact)
+        + ",\"scopeSpans\":[{\"scope\":{\"name\":\"treefrog\",\"version\":\"" + TF_VERSION_STR + "\"},\"spans\":[";
+}
+
+
+void TraceExporter::enqueue(SpanData &&span)
+{
+    QMutexLocker locker(&mutex);
+    if (queue.count() >= MAX_QUEUED_SPANS) {
+        dropped++;
+        return;
+    }
+    queue.append(std::move(span));
+    if (queue.count() == BATCH_SIZE) {
+        condition.wakeOne();
+    }
+}
+
+
+void TraceExporter::run()
+{
+    while (!isInterruptionRequested()) {
+        {
+            QMutexLocker locker(&mutex);
+            condition.wait(&mutex, FLUSH_INTERVAL_MSECS);
+        }
+        exportSpans();
+    }
+}
+
+
+void TraceExporter::exportSpans()
+{
+    static const QByteArray footer = "]}]}]}";
+    QVector<SpanData> spans;
+    {
+        QMutexLocker locker(&mutex);
+        spans.swap(queue);
+    }
+
+    if (spans.isEmpty()) {
+        return;
+    }
+
+    QMutexLocker locker(&exportMutex);
+    const int maxSize = (udp) ? MAX_DATAGRAM_SIZE : MAX_LINE_SIZE;
+    QByteArray batch = header;
+    int count = 0;
+
+    for (const auto &span : spans) {
+        QByteArray json = spanToJson(span);
+        if (count > 0 && batch.length() + json.length() + footer.length() >= maxSize) {
+            write(batch + footer);
+            batch = header;
+            count = 0;
+        }
+        if (count++ > 0) {
+            batch += ',';
+        }
+        batch += json;
+    }
+    write(batch + footer);
+}
+
+
+void TraceExporter::write(const QByteArray &data)
+{
+    if (udp) {
+        // Created for each write as called on several threads
+        QUdpSocket socket;
+        socket.writeDatagram(data, host, port);
+    } else if (file.isOpen()) {
+        file.write(data + '\n');
+        file.flush();
+    }
+}
+}
+
+/*!
+  Constructs a trace context with the \a traceId, the \a spanId and the
+  \a sampled flag.
+*/
+TTraceContext::TTraceContext(const QByteArray &traceId, const QByteArray &spanId, bool sampled) :
+    _traceId(traceId), _spanId(spanId), _sampled(sampled)
+{
+}
+
+/*!
+  Returns the value of the traceparent header for this context.
+*/
+QByteArray TTraceContext::toTraceparent() const
+{
+    if (!isValid()) {
+        return QByteArray();
+    }
+    return "00-" + _traceId + '-' + _spanId + ((_sampled) ? "-01" : "-00");
+}
+
+/*!
+  Parses the value of the \a traceparent header, and returns an invalid
+  context if it is malformed.
+*/
+TTraceContext TTraceContext::fromTraceparent(const QByteArray &traceparent)
+{
+    QByteArray value = traceparent.trimmed();
+    // version "-" trace-id "-" parent-id "-" trace-flags
+    if (value.length() < 55 || value[2] != '-' || value[35] != '-' || value[52] != '-') {
+        return TTraceContext();
+    }
+
+    QByteArray version = value.mid(0, 2);
+    QByteArray traceId = value.mid(3, 32);
+    QByteArray spanId = value.mid(36, 16);
+    QByteArray flags = value.mid(53, 2);
+
+    if (version == "ff" || (version == "00" && value.length() != 55) || (value.length() > 55 && value[55] != '-')) {
+        return TTraceContext();
+    }
+    if (!isLowerHex(traceId) || !isLowerHex(spanId) || (!isLowerHex(flags) && flags != "00")) {
+        return TTraceContext();
+    }
+    if (!(isLowerHex(version) || version == "00")) {
+        return TTraceContext();
+    }
+    return TTraceContext(traceId, spanId, flags.toInt(nullptr, 16) & 0x01);
+}
+
+/*!
+  Returns a random trace ID.
+*/
+QByteArray TTraceContext::generateTraceId()
+{
+    quint64 high = Tf::rand64_r();
+    quint64 low = Tf::rand64_r();
+    return toHex(high) + toHex((high | low) ? low : 1);
+}
+
+/*!
+  Returns a random span ID.
+*/
+QByteArray TTraceContext::generateSpanId()
+{
+    quint64 id = Tf::rand64_r();
+    return toHex((id) ? id : 1);
+}
+
+/*!
+  Sets up the tracer with the settings Tracing.* in the application.ini.
+*/
+void TTracer::setup()
+{
+    auto *settings = Tf::appSettings();
+    QString destination = settings->value(Tf::TracingExport).toString().trimmed();
+    if (destination.isEmpty()) {
+        return;
+    }
+
+    if (!destination.startsWith(QLatin1String(UDP_SCHEME))) {
+        QFileInfo fi(destination);
+        destination = (fi.isAbsolute()) ? fi.absoluteFilePath() : Tf::app()->webRootPath() + fi.filePath();
+    }
+
+    QByteArray serviceName = settings->value(Tf::TracingServiceName).toByteArray().trimmed();
+    if (serviceName.isEmpty()) {
+        serviceName = QDir(Tf::app()->webRootPath()).dirName().toUtf8();
+    }
+    setup(destination, settings->value(Tf::TracingSampleRate, 1.0).toDouble(), serviceName);
+}
+
+/*!
+  Sets up the tracer to export the spans to the \a destination, a file
+  path or a UDP collector such as 'udp://127.0.0.1:4319'. New traces are
+  sampled at the \a sampleRate.
+*/
+void TTracer::setup(const QString &destination, double sampleRate, const QByteArray &serviceName)
+{
+    release();
+
+    auto *exp = new TraceExporter(destination, serviceName);
+    if (!exp->isValid()) {
+        delete exp;
+        return;
+    }
+
+    exporter = exp;
+    samplingRate.store(qBound(0.0, sampleRate, 1.0));
+    exporter->start();
+    tracingEnabled.store(true);
+}
+
+/*!
+  Exports the remaining spans and stops the tracer.
+*/
+void TTracer::release()
+{
+    tracingEnabled.store(false);
+    if (exporter) {
+        exporter->requestInterruption();
+        exporter->wait();
+        exporter->exportSpans();
+        if (exporter->droppedCount() > 0) {
+            tSystemWarn("Tracer dropped %llu spans, queue full", (unsigned long long)exporter->droppedCount());
+        }
+        delete exporter;
+        exporter = nullptr;
+    }
+}
+
+/*!
+  Exports the spans recorded so far.
+*/
+void TTracer::flush()
+{
+    if (exporter) {
+        exporter->exportSpans();
+    }
+}
+
+
+bool TTracer::isEnabled()
+{
+    return tracingEnabled.load(std::memory_order_relaxed);
+}
+
+/*!
+  Starts the trace of the request with the \a method and the \a path in
+  the current thread, continuing the trace of the \a traceparent and
+  \a tracestate headers if valid.
+*/
+void TTracer::beginRequest(const QByteArray &method, const QByteArray &path, const QByteArray &traceparent, const QByteArray &tracestate)
+{
+    ActiveTrace &trace = activeTrace;
+    if (!isEnabled()) {
+        trace.active = false;
+        return;
+    }
+
+    TTraceContext parent = (traceparent.isEmpty()) ? TTraceContext() : TTraceContext::fromTraceparent(traceparent);
+    if (parent.isValid()) {
+        trace.traceId = parent.traceId();
+        trace.remoteParentId = parent.spanId();
+        trace.traceState = tracestate.trimmed();
+        trace.sampled = parent.isSampled();
+    } else {
+        trace.traceId = TTraceContext::generateTraceId();
+        trace.remoteParentId.clear();
+        trace.traceState.clear();
+        trace.sampled = (Tf::rand32_r() / 4294967296.0) < samplingRate.load(std::memory_order_relaxed);
+    }
+
+    trace.active = true;
+    trace.method = method;
+    trace.path = path.mid(0, path.indexOf('?'));
+    trace.startNsecs = Tf::getMonotonicNSecs();
+    trace.spanStack.clear();
+    trace.spanStack << TTraceContext::generateSpanId();
+}
+
+/*!
+  Finishes the trace of the request in the current thread, which resulted
+  in the \a statusCode and was routed to the \a route.
+*/
+void TTracer::endRequest(int statusCode, const QByteArray &route)
+{
+    ActiveTrace &trace = activeTrace;
+    if (!trace.active) {
+        return;
+    }
+
+    if (trace.sampled && exporter) {
+        SpanData span;
+        span.traceId = trace.traceId;
+        span.spanId = trace.spanStack.value(0);
+        span.parentSpanId = trace.remoteParentId;
+        span.traceState = trace.traceState;
+        span.name = trace.method + ' ' + ((route.isEmpty()) ? trace.path : route);
+        span.kind = Server;
+        span.startNsecs = trace.startNsecs;
+        span.endNsecs = Tf::getMonotonicNSecs();
+        span.attributes.insert(QStringLiteral("http.method"), QString::fromLatin1(trace.method));
+        span.attributes.insert(QStringLiteral("http.target"), QString::fromUtf8(trace.path));
+        span.attributes.insert(QStringLiteral("http.status_code"), statusCode);
+        span.error = (statusCode >= 500);
+        exporter->enqueue(std::move(span));
+    }
+
+    trace.active = false;
+    trace.spanStack.clear();
+}
+
+/*!
+  Returns true if the current thread is processing a request with a trace
+  context.
+*/
+bool TTracer::isActive()
+{
+    return activeTrace.active;
+}
+
+/*!
+  Returns true if the spans of the request in the current thread are
+  recorded.
+*/
+bool TTracer::isSampled()
+{
+    const ActiveTrace &trace = activeTrace;
+    return trace.active && trace.sampled;
+}
+
+/*!
+  Returns the context of the current span of the thread, which is passed
+  to other services in the traceparent header.
+*/
+TTraceContext TTracer::currentContext()
+{
+    const ActiveTrace &trace = activeTrace;
+    if (!trace.active || trace.spanStack.isEmpty()) {
+        return TTraceContext();
+    }
+    return TTraceContext(trace.traceId, trace.spanStack.last(), trace.sampled);
+}
+
+
+QByteArray TTracer::currentTracestate()
+{
+    const ActiveTrace &trace = activeTrace;
+    return (trace.active) ? trace.traceState : QByteArray();
+}
+
+/*!
+  Records the span finished already named \a name as a child of the current
+  span. The \a startNsecs and \a endNsecs are the values of
+  Tf::getMonotonicNSecs().
+*/
+void TTracer::recordSpan(const QByteArray &name, SpanKind kind, qint64 startNsecs, qint64 endNsecs, const QVariantMap &attributes, bool error)
+{
+    const ActiveTrace &trace = activeTrace;
+    if (!trace.active || !trace.sampled || !exporter) {
+        return;
+    }
+
+    SpanData span;
+    span.traceId = trace.traceId;
+    span.spanId = TTraceContext::generateSpanId();
+    span.parentSpanId = trace.spanStack.value(trace.spanStack.count() - 1);
+    span.traceState = trace.traceState;
+    span.name = name;
+    span.kind = kind;
+    span.startNsecs = startNsecs;
+    span.endNsecs = endNsecs;
+    span.attributes = attributes;
+    span.error = error;
+    exporter->enqueue(std::move(span));
+}
+
+/*!
+  Constructs a TTraceSpan object named \a name of \a kind, and makes it
+  the current span of the thread.
+*/
+TTraceSpan::TTraceSpan(const QByteArray &name, TTracer::SpanKind kind)
+{
+    ActiveTrace &trace = activeTrace;
+    if (!trace.active) {
+        return;
+    }
+
+    _active = true;
+    _recording = trace.sampled;
+    _name = name;
+    _kind = kind;
+    _spanId = TTraceContext::generateSpanId();
+    _parentSpanId = trace.spanStack.value(trace.spanStack.count() - 1);
+    _startNsecs = Tf::getMonotonicNSecs();
+    trace.spanStack << _spanId;
+}
+
+
+TTraceSpan::~TTraceSpan()
+{
+    if (!_active) {
+        return;
+    }
+
+    ActiveTrace &trace = activeTrace;
+    if (!trace.spanStack.isEmpty() && trace.spanStack.last() == _spanId) {
+        trace.spanStack.removeLast();
+    }
+
+    if (_recording && trace.active && exporter) {
+        SpanData span;
+        span.traceId = trace.traceId;
+        span.spanId = _spanId;
+        span.parentSpanId = _parentSpanId;
+        span.traceState = trace.traceState;
+        span.name = _name;
+        span.kind = _kind;
+        span.startNsecs = _startNsecs;
+        span.endNsecs = Tf::getMonotonicNSecs();
+        span.attributes = _attributes;
+        span.error = _error;
+        exporter->enqueue(std::move(span));
+    }
+}
+
+/*!
+  Sets the attribute \a key of the span to \a value.
+*/
+void TTraceSpan::setAttribute(const QByteArray &key, const QVariant &value)
+{
+    if (_recording) {
+        _attributes.insert(QString::fromLatin1(key), value);
+    }
+}
+
+/*!
+  Returns the value of the traceparent header to pass this span to
+  another service as the parent, or an empty byte array if no trace
+  is active.
+*/
+QByteArray TTraceSpan::traceparent() const
+{
+    return (_active) ? TTraceContext(activeTrace.traceId, _spanId, _recording).toTraceparent() : QByteArray();
+}
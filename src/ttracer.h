@@ -0,0 +1,77 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+#include <TGlobal>
+
+
+class T_CORE_EXPORT TTraceContext {
+public:
+    TTraceContext() { }
+    TTraceContext(const QByteArray &traceId, const QByteArray &spanId, bool sampled);
+
+    bool isValid() const { return !_traceId.isEmpty() && !_spanId.isEmpty(); }
+    QByteArray traceId() const { return _traceId; }
+    QByteArray spanId() const { return _spanId; }
+    bool isSampled() const { return _sampled; }
+    QByteArray toTraceparent() const;
+
+    static TTraceContext fromTraceparent(const QByteArray &traceparent);
+    static QByteArray generateTraceId();
+    static QByteArray generateSpanId();
+
+private:
+    QByteArray _traceId;  // 32 lowercase hex digits
+    QByteArray _spanId;  // 16 lowercase hex digits
+    bool _sampled {false};
+};
+
+
+class T_CORE_EXPORT TTracer {
+public:
+    enum SpanKind {
+        Internal = 1,  // values of OTLP
+        Server = 2,
+        Client = 3,
+    };
+
+    static void setup();
+    static void setup(const QString &destination, double sampleRate, const QByteArray &serviceName);
+    static void release();
+    static void flush();
+    static bool isEnabled();
+
+    static void beginRequest(const QByteArray &method, const QByteArray &path, const QByteArray &traceparent, const QByteArray &tracestate);
+    static void endRequest(int statusCode, const QByteArray &route = QByteArray());
+    static bool isActive();
+    static bool isSampled();
+    static TTraceContext currentContext();
+    static QByteArray currentTracestate();
+    static void recordSpan(const QByteArray &name, SpanKind kind, qint64 startNsecs, qint64 endNsecs, const QVariantMap &attributes = QVariantMap(), bool error = false);
+};
+
+
+class T_CORE_EXPORT TTraceSpan {
+public:
+    TTraceSpan(const QByteArray &name, TTracer::SpanKind kind = TTracer::Internal);
+    ~TTraceSpan();
+
+    bool isRecording() const { return _recording; }
+    void setAttribute(const QByteArray &key, const QVariant &value);
+    void setError(bool error = true) { _error = error; }
+    QByteArray traceparent() const;
+
+private:
+    QByteArray _name;
+    TTracer::SpanKind _kind {TTracer::Internal};
+    QByteArray _spanId;
+    QByteArray _parentSpanId;
+    qint64 _startNsecs {0};
+    QVariantMap _attributes;
+    bool _active {false};
+    bool _recording {false};
+    bool _error {false};
+
+    T_DISABLE_COPY(TTraceSpan)
+    T_DISABLE_MOVE(TTraceSpan)
+};
@@ -10,9 +10,48 @@
 #include <QMap>
 #include <QRegExp>
 #include <QTextStream>
+#include <QVarLengthArray>
 #include <THttpUtility>
 #include <TSystemGlobal>
 #include <TWebApplication>
+#include <algorithm>
+#include <cstring>
+
+/*!
+  \class TUrlRoute
+  \brief The TUrlRoute class routes a request path to an action according
+  to the routes.cfg file.
+
+  The routes are compiled into a tree of path components at startup, so
+  that a lookup costs time proportional to the length of the path, not to
+  the number of routes. Each literal component is an edge sorted by its
+  UTF-8 bytes; ':param' and ':params' are edges of their own. When several
+  routes match a path, the first one in the file wins.
+*/
+
+namespace {
+constexpr int MAX_STACK_PATH_LENGTH = 1024;
+constexpr int MAX_STACK_SEGMENTS = 32;
+
+inline int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+inline int compareSegment(const QByteArray &segment, const char *data, int length)
+{
+    int len = std::min(segment.length(), length);
+    int cmp = (len > 0) ? std::memcmp(segment.constData(), data, len) : 0;
+    return (cmp != 0) ? cmp : segment.length() - length;
+}
+}
 
 
 class RouteDirectiveHash : public QMap<QString, int> {
@@ -128,6 +167,7 @@ bool TUrlRoute::addRouteFromString(const QString &line)
     }
 
     _routes << rt;
+    addToTree(_routes.count() - 1);
     tSystemDebug("route: method:%d path:%s  ctrl:%s action:%s params:%d",
         rt.method, qPrintable(QLatin1String("/") + rt.componentList.join("/")), rt.controller.data(),
         rt.action.data(), rt.hasVariableParams);
@@ -135,55 +175,219 @@ bool TUrlRoute::addRouteFromString(const QString &line)
 }
 
 
+/*!
+  Returns the routing for the path \a components split by splitPath()
+  with the HTTP method \a method.
+*/
 TRouting TUrlRoute::findRouting(Tf::HttpMethod method, const QStringList &components) const
 {
     if (_routes.isEmpty()) {
         return TRouting();
     }
 
-    for (const auto &rt : _routes) {
-        // Too long or short?
-        if (rt.hasVariableParams) {
-            if (components.length() < rt.componentList.length() - 1) {
-                continue;
+    QByteArray utf8;
+    QVarLengthArray<Segment, MAX_STACK_SEGMENTS> segments;
+    for (const auto &c : components) {
+        int offset = utf8.length();
+        utf8 += c.toUtf8();
+        segments.append(Segment {offset, utf8.length() - offset});
+    }
+    return lookup(method, utf8.constData(), segments.constData(), segments.count());
+}
+
+/*!
+  Returns the routing for the URL-encoded request path \a path with the
+  HTTP method \a method; the query string, if any, is ignored. The path
+  is decoded and split on the stack, and parameters are converted into
+  strings only for the route found.
+*/
+TRouting TUrlRoute::findRouting(Tf::HttpMethod method, const QByteArray &path) const
+{
+    if (_routes.isEmpty()) {
+        return TRouting();
+    }
+
+    int len = path.indexOf('?');
+    if (len < 0) {
+        len = path.length();
+    }
+
+    // Decodes into the buffer only if the path is percent-encoded
+    QVarLengthArray<char, MAX_STACK_PATH_LENGTH> decoded;
+    const char *base = path.constData();
+    for (int i = 0; i < len; ++i) {
+        if (base[i] == '%' || base[i] == '+') {
+            decoded.reserve(len);
+            decoded.append(base, i);
+            while (i < len) {
+                char c = base[i];
+                int hi, lo;
+                if (c == '+') {
+                    c = ' ';
+                } else if (c == '%' && i + 2 < len && (hi = hexValue(base[i + 1])) >= 0 && (lo = hexValue(base[i + 2])) >= 0) {
+                    c = (char)((hi << 4) | lo);
+                    i += 2;
+                }
+                decoded.append(c);
+                ++i;
             }
+            base = decoded.constData();
+            len = decoded.count();
+            break;
+        }
+    }
+
+    // Splits as splitPath() does
+    int start = (len > 0 && base[0] == '/') ? 1 : 0;
+    int end = (len > 1 && base[len - 1] == '/') ? len - 1 : len;
+
+    QVarLengthArray<Segment, MAX_STACK_SEGMENTS> segments;
+    int offset = start;
+    for (int i = start; i < end; ++i) {
+        if (base[i] == '/') {
+            segments.append(Segment {offset, i - offset});
+            offset = i + 1;
+        }
+    }
+    segments.append(Segment {offset, end - offset});
+    return lookup(method, base, segments.constData(), segments.count());
+}
+
+
+TRouting TUrlRoute::lookup(Tf::HttpMethod method, const char *base, const Segment *segments, int count) const
+{
+    int index = _nodes.isEmpty() ? -1 : matchRoute(0, method, base, segments, count, 0, -1);
+    if (index < 0) {
+        return TRouting() /* Not found routing info */;
+    }
+
+    const TRoute &rt = _routes[index];
+    TRouting routing(rt.controller, rt.action);
+    routing.exists = true;
+
+    if (count == 1 && segments[0].length == 0) {  // means path="/"
+        return routing;
+    }
+
+    // Generates parameters for action, skipping non-parameters
+    int k = 0;
+    for (int i = 0; i < count; ++i) {
+        if (k < rt.keywordIndexes.count() && rt.keywordIndexes[k] == i) {
+            ++k;
         } else {
-            if (components.length() != rt.componentList.length()) {
-                continue;
-            }
+            routing.params << QString::fromUtf8(base + segments[i].offset, segments[i].length);
         }
+    }
+    return routing;
+}
 
-        for (int idx : (const QList<int> &)rt.keywordIndexes) {
-            if (components.value(idx) != rt.componentList[idx]) {
-                goto continue_next;
+/*!
+  Returns the smallest index of the routes below the node \a node which
+  match the segments from \a depth, or \a best if none is smaller.
+*/
+int TUrlRoute::matchRoute(int node, Tf::HttpMethod method, const char *base, const Segment *segments, int count, int depth, int best) const
+{
+    const Node &n = _nodes[node];
+    if (best >= 0 && n.minRoute >= best) {
+        return best;
+    }
+
+    auto matchMethod = [&](const QVector<int> &routes) {
+        for (int idx : routes) {
+            if (best >= 0 && idx >= best) {
+                break;
+            }
+            int m = _routes[idx].method;
+            if (m == TRoute::Match || m == method) {
+                best = idx;
+                break;
             }
         }
+    };
 
-        if (rt.method == TRoute::Match || rt.method == method) {
-            // Generates parameters for action
-            QStringList params = components;
-
-            if (params.count() == 1 && params[0].isEmpty()) {  // means path="/"
-                params.clear();
-            } else {
-                // Erases non-parameters
-                QListIterator<int> it(rt.keywordIndexes);
-                it.toBack();
-                while (it.hasPrevious()) {
-                    int idx = it.previous();
-                    params.removeAt(idx);
-                }
-            }
+    // ':params' takes all the rest, even if nothing
+    matchMethod(n.variableRoutes);
+
+    if (depth == count) {
+        matchMethod(n.routes);
+        return best;
+    }
+
+    const Segment &seg = segments[depth];
+    int child = findChild(n, base + seg.offset, seg.length);
+    if (child >= 0) {
+        best = matchRoute(child, method, base, segments, count, depth + 1, best);
+    }
+    if (n.paramChild >= 0) {
+        best = matchRoute(n.paramChild, method, base, segments, count, depth + 1, best);
+    }
+    return best;
+}
+
+
+int TUrlRoute::findChild(const Node &node, const char *data, int length) const
+{
+    auto it = std::lower_bound(node.children.cbegin(), node.children.cend(), 0, [&](int child, int) {
+        return compareSegment(_nodes[child].segment, data, length) < 0;
+    });
+    if (it != node.children.cend() && compareSegment(_nodes[*it].segment, data, length) == 0) {
+        return *it;
+    }
+    return -1;
+}
 
-            TRouting routing(rt.controller, rt.action, params);
-            routing.exists = true;
-            return routing;
+
+int TUrlRoute::addChild(int node, const QString &component)
+{
+    if (component == QLatin1String(":param")) {
+        if (_nodes[node].paramChild < 0) {
+            _nodes.append(Node());
+            _nodes[node].paramChild = _nodes.count() - 1;
         }
-    continue_next:
-        continue;
+        return _nodes[node].paramChild;
     }
 
-    return TRouting() /* Not found routing info */;
+    const QByteArray segment = component.toUtf8();
+    int child = findChild(_nodes[node], segment.constData(), segment.length());
+    if (child < 0) {
+        Node newNode;
+        newNode.segment = segment;
+        _nodes.append(newNode);
+        child = _nodes.count() - 1;
+
+        QVector<int> &children = _nodes[node].children;
+        auto it = std::lower_bound(children.begin(), children.end(), 0, [&](int c, int) {
+            return compareSegment(_nodes[c].segment, segment.constData(), segment.length()) < 0;
+        });
+        children.insert(it, child);
+    }
+    return child;
+}
+
+
+void TUrlRoute::addToTree(int routeIndex)
+{
+    if (_nodes.isEmpty()) {
+        _nodes.append(Node());  // root
+    }
+
+    const TRoute &rt = _routes[routeIndex];
+    int node = 0;
+    for (const auto &c : rt.componentList) {
+        if (_nodes[node].minRoute < 0) {
+            _nodes[node].minRoute = routeIndex;
+        }
+        if (c == QLatin1String(":params")) {
+            _nodes[node].variableRoutes << routeIndex;
+            return;
+        }
+        node = addChild(node, c);
+    }
+
+    if (_nodes[node].minRoute < 0) {
+        _nodes[node].minRoute = routeIndex;
+    }
+    _nodes[node].routes << routeIndex;
 }
 
 
@@ -235,6 +439,7 @@ QString TUrlRoute::findUrl(const QString &controller, const QString &action, con
 void TUrlRoute::clear()
 {
     _routes.clear();
+    _nodes.clear();
 }
 
 
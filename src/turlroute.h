@@ -1,6 +1,7 @@
 #pragma once
 #include <QByteArray>
 #include <QStringList>
+#include <QVector>
 #include <TGlobal>
 
 
@@ -65,6 +66,7 @@ public:
     static const TUrlRoute &instance();
     static QStringList splitPath(const QString &path);
     TRouting findRouting(Tf::HttpMethod method, const QStringList &components) const;
+    TRouting findRouting(Tf::HttpMethod method, const QByteArray &path) const;
     QString findUrl(const QString &controller, const QString &action, const QStringList &params = QStringList()) const;
     QList<TRoute> allRoutes() const { return _routes; }
 
@@ -75,5 +77,26 @@ protected:
     void clear();
 
 private:
+    struct Segment {
+        int offset;
+        int length;
+    };
+
+    struct Node {
+        QByteArray segment;  // literal path component in UTF-8
+        QVector<int> children;  // literal children sorted by segment
+        int paramChild {-1};  // child for ':param'
+        int minRoute {-1};  // smallest route index in the subtree
+        QVector<int> routes;  // routes ending at this node, in file order
+        QVector<int> variableRoutes;  // routes ending with ':params' here
+    };
+
+    int findChild(const Node &node, const char *data, int length) const;
+    int addChild(int node, const QString &component);
+    void addToTree(int routeIndex);
+    int matchRoute(int node, Tf::HttpMethod method, const char *base, const Segment *segments, int count, int depth, int best) const;
+    TRouting lookup(Tf::HttpMethod method, const char *base, const Segment *segments, int count) const;
+
     QList<TRoute> _routes;
+    QVector<Node> _nodes;  // compiled tree, root first
 };
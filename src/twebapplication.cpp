@@ -475,6 +475,20 @@ QString TWebApplication::sqlQueryLogFilePath() const
     return path;
 }
 
+/*!
+  Returns the absolute file path of the slow query log, which is set by the
+  setting \a SlowQueryLog.FilePath in the application.ini.
+*/
+QString TWebApplication::slowQueryLogFilePath() const
+{
+    QString path = Tf::appSettings()->value(Tf::SlowQueryLogFilePath).toString().trimmed();
+    if (!path.isEmpty()) {
+        QFileInfo fi(path);
+        path = (fi.isAbsolute()) ? fi.absoluteFilePath() : webRootPath() + fi.filePath();
+    }
+    return path;
+}
+
 
 void TWebApplication::timerEvent(QTimerEvent *event)
 {
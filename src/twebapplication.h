@@ -64,6 +64,7 @@ public:
     QString systemLogFilePath() const;
     QString accessLogFilePath() const;
     QString sqlQueryLogFilePath() const;
+    QString slowQueryLogFilePath() const;
     QTextCodec *codecForInternal() const { return _codecInternal; }
     QTextCodec *codecForHttpOutput() const { return _codecHttp; }
     int applicationServerId() const { return _appServerId; }
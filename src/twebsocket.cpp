@@ -8,6 +8,7 @@
 #include "twebsocket.h"
 #include "tatomicptr.h"
 #include "tdispatcher.h"
+#include "tpublisher.h"
 #include "turlroute.h"
 #include "twebsocketworker.h"
 #include <TWebApplication>
@@ -34,6 +35,9 @@ TWebSocket::TWebSocket(int socketDescriptor, const QHostAddress &address, const
         sid = point.fetch_add(1);
     } while (!socketManager[sid].compareExchange(nullptr, this));  // store a socket
 
+    worker = new TWebSocketWorker(this, header.path(), this);
+    connect(worker, SIGNAL(finished()), this, SLOT(releaseWorker()));
+
     connect(this, SIGNAL(readyRead()), this, SLOT(readRequest()));
     connect(this, SIGNAL(sendByWorker(const QByteArray &)), this, SLOT(sendRawData(const QByteArray &)));
     connect(this, SIGNAL(disconnectByWorker()), this, SLOT(close()));
@@ -43,6 +47,9 @@ TWebSocket::TWebSocket(int socketDescriptor, const QHostAddress &address, const
 TWebSocket::~TWebSocket()
 {
     tSystemDebug("~TWebSocket");
+    // Waits for the publishers writing to this socket, and stops them
+    // delivering to a new socket reusing the ID
+    TPublisher::instance()->unsubscribeFromAll(this);
     socketManager[sid].compareExchangeStrong(this, nullptr);  // clear
 }
 
@@ -53,24 +60,6 @@ void TWebSocket::close()
 }
 
 
-void TWebSocket::sendTextForPublish(const QString &text, const QObject *except)
-{
-    tSystemDebug("sendText  text len:%d  (pid:%d)", text.length(), (int)QCoreApplication::applicationPid());
-    if (except != this) {
-        TAbstractWebSocket::sendText(text);
-    }
-}
-
-
-void TWebSocket::sendBinaryForPublish(const QByteArray &binary, const QObject *except)
-{
-    tSystemDebug("sendBinary  binary len:%d  (pid:%d)", binary.length(), (int)QCoreApplication::applicationPid());
-    if (except != this) {
-        TAbstractWebSocket::sendBinary(binary);
-    }
-}
-
-
 void TWebSocket::sendPong(const QByteArray &data)
 {
     tSystemDebug("sendPong  data len:%d  (pid:%d)", data.length(), (int)QCoreApplication::applicationPid());
@@ -91,8 +80,7 @@ bool TWebSocket::canReadRequest() const
 
 void TWebSocket::readRequest()
 {
-    if (myWorkerCounter > 0) {
-        tSystemWarn("Worker already running  (sd:%lld)", (quint64)socketDescriptor());
+    if (deleting.load()) {
         return;
     }
 
@@ -133,54 +121,41 @@ void TWebSocket::readRequest()
     }
 
     if (!payloads.isEmpty()) {
-        // Starts worker thread
-        TWebSocketWorker *worker = new TWebSocketWorker(TWebSocketWorker::Receiving, this, reqHeader.path());
-        worker->setPayloads(payloads);
-        startWorker(worker);
+        // Messages are processed in order, even while the worker is running
+        startWorker(TWebSocketWorker::Receiving, payloads);
     }
 }
 
 
 void TWebSocket::startWorkerForOpening(const TSession &session)
 {
-    TWebSocketWorker *worker = new TWebSocketWorker(TWebSocketWorker::Opening, this, reqHeader.path());
-    worker->setSession(session);
-    startWorker(worker);
+    startWorker(TWebSocketWorker::Opening, QList<QPair<int, QByteArray>>(), session);
 }
 
 
 void TWebSocket::startWorkerForClosing()
 {
     if (!closing.load()) {
-        TWebSocketWorker *worker = new TWebSocketWorker(TWebSocketWorker::Closing, this, reqHeader.path());
-        startWorker(worker);
+        startWorker(TWebSocketWorker::Closing);
     }
 }
 
 
-void TWebSocket::startWorker(TWebSocketWorker *worker)
+void TWebSocket::startWorker(int mode, const QList<QPair<int, QByteArray>> &payloads, const TSession &session)
 {
-    worker->moveToThread(Tf::app()->thread());
-    connect(worker, SIGNAL(finished()), this, SLOT(releaseWorker()));
-    ++myWorkerCounter;  // count-up
-    worker->start();
+    if (worker->enqueue((TWebSocketWorker::RunMode)mode, payloads, session)) {
+        ++myWorkerCounter;  // count-up
+        TWebSocketWorker::threadPool()->start(worker);
+    }
 }
 
 
 void TWebSocket::releaseWorker()
 {
-    TWebSocketWorker *worker = qobject_cast<TWebSocketWorker *>(sender());
-    if (worker) {
-        worker->deleteLater();
-        --myWorkerCounter;  // count-down
+    --myWorkerCounter;  // count-down
 
-        if (deleting.load()) {
-            deleteLater();
-        } else {
-            if (bytesAvailable() > 0) {
-                readRequest();
-            }
-        }
+    if (deleting.load()) {
+        deleteLater();
     }
 }
 
@@ -191,7 +166,6 @@ void TWebSocket::deleteLater()
 
     if (!deleting.exchange(true)) {
         startWorkerForClosing();
-        return;
     }
 
     if ((int)myWorkerCounter == 0) {
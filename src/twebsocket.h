@@ -3,12 +3,13 @@
 #include "tatomic.h"
 #include <QByteArray>
 #include <QList>
+#include <QPair>
 #include <QTcpSocket>
 #include <TGlobal>
+#include <TSession>
 
 class TWebSocketFrame;
 class TWebSocketWorker;
-class TSession;
 class THttpRequestHeader;
 
 
@@ -25,8 +26,6 @@ public:
     static TAbstractWebSocket *searchSocket(int sid);
 
 public slots:
-    void sendTextForPublish(const QString &text, const QObject *except);
-    void sendBinaryForPublish(const QByteArray &binary, const QObject *except);
     void sendPong(const QByteArray &data = QByteArray());
     void readRequest();
     void releaseWorker();
@@ -48,10 +47,11 @@ signals:
     void disconnectByWorker();
 
 private:
-    void startWorker(TWebSocketWorker *worker);
+    void startWorker(int mode, const QList<QPair<int, QByteArray>> &payloads = QList<QPair<int, QByteArray>>(), const TSession &session = TSession());
 
     int sid {0};
     QByteArray recvBuffer;
+    TWebSocketWorker *worker {nullptr};
     TAtomic<int> myWorkerCounter {0};
     TAtomic<bool> deleting {false};
 
@@ -297,3 +297,26 @@ void TWebSocketEndpoint::sendHttp(int id, const QByteArray &data)
   The function must return false to disable the mechanism. This function
   returns true.
 */
+
+/*!
+  \fn qint64 TWebSocketEndpoint::sendQueueLimitBytes() const
+  Must be overridden by subclasses to limit the bytes buffered in the send
+  queue of each connection. The zero value means unlimited. Effective on
+  the epoll MPM. This function returns 0.
+  \sa sendQueuePolicy()
+*/
+
+/*!
+  \fn int TWebSocketEndpoint::sendQueueLimitMessages() const
+  Must be overridden by subclasses to limit the number of messages buffered
+  in the send queue of each connection. The zero value means unlimited.
+  Effective on the epoll MPM. This function returns 0.
+  \sa sendQueuePolicy()
+*/
+
+/*!
+  \fn Tf::SendQueuePolicy TWebSocketEndpoint::sendQueuePolicy() const
+  Must be overridden by subclasses to change the policy applied when the
+  send queue of a slow consumer exceeds its limits. This function returns
+  Tf::DropOldest.
+*/
@@ -50,6 +50,9 @@ protected:
     virtual void onPing(const QByteArray &payload);
     virtual void onPong(const QByteArray &payload);
     virtual int keepAliveInterval() const { return 0; }
+    virtual qint64 sendQueueLimitBytes() const { return 0; }
+    virtual int sendQueueLimitMessages() const { return 0; }
+    virtual Tf::SendQueuePolicy sendQueuePolicy() const { return Tf::DropOldest; }
     virtual bool transactionEnabled() const;
     void sendPong(const QByteArray &payload = QByteArray());
 
@@ -73,5 +73,6 @@ private:
     friend class TWebSocket;
     friend class TEpollWebSocket;
     friend class TWebSocketController;
+    friend class TPublisher;
 };
 
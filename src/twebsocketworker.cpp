@@ -11,23 +11,41 @@
 #include "tpublisher.h"
 #include "tsystemglobal.h"
 #include "turlroute.h"
+#include <QMutexLocker>
+#include <QThread>
+#include <QThreadPool>
+#include <TAppSettings>
 #include <TApplicationServerBase>
-#include <TDispatcher>
 #include <THttpRequestHeader>
 #include <TWebApplication>
-#include <TWebSocketEndpoint>
 #ifdef Q_OS_LINUX
 #include "tepollhttpsocket.h"
 #endif
 #include <QDataStream>
 
-
-TWebSocketWorker::TWebSocketWorker(TWebSocketWorker::RunMode m, TAbstractWebSocket *s, const QByteArray &path, QObject *parent) :
-    TDatabaseContextThread(parent),
-    _mode(m),
+/*!
+  \class TWebSocketWorker
+  \brief The TWebSocketWorker class processes the messages received by
+  a WebSocket connection in order.
+
+  Each connection owns one worker and the worker owns one endpoint
+  object, which is created at the first message and reused until the
+  connection is closed. Messages are enqueued by enqueue() and processed
+  by run(); the epoll MPM calls run() in the multiplexing thread and
+  the thread MPM starts it on threadPool(). Only one thread runs the
+  worker of a connection at a time; in the thread MPM the endpoint is
+  moved to the thread running the worker, and left without thread
+  affinity between the runs.
+*/
+
+TWebSocketWorker::TWebSocketWorker(TAbstractWebSocket *s, const QByteArray &path, QObject *parent) :
+    QObject(parent),
+    QRunnable(),
+    TDatabaseContext(),
     _socket(s),
-    _requestPath(path)
+    _dispatcher(TUrlRoute::splitPath(path).value(0).toLower() + "endpoint")
 {
+    setAutoDelete(false);
 }
 
 
@@ -36,51 +54,105 @@ TWebSocketWorker::~TWebSocketWorker()
     tSystemDebug("TWebSocketWorker::~TWebSocketWorker");
 }
 
-
-void TWebSocketWorker::setPayload(TWebSocketFrame::OpCode opCode, const QByteArray &payload)
+/*!
+  Enqueues a job in the \a mode; the \a payloads are the messages
+  received at once, and the \a session is the HTTP session for opening.
+  Returns true if the worker was idle, and then the caller must run it.
+*/
+bool TWebSocketWorker::enqueue(RunMode mode, const QList<QPair<int, QByteArray>> &payloads, const TSession &session)
 {
-    _payloads << qMakePair((int)opCode, payload);
+    QMutexLocker locker(&_mutex);
+    _jobs.enqueue(Job {mode, payloads, session});
+    if (_scheduled) {
+        return false;
+    }
+    _scheduled = true;
+    return true;
 }
 
-
-void TWebSocketWorker::setPayloads(QList<QPair<int, QByteArray>> payloads)
+/*!
+  Processes the enqueued jobs until the queue is empty, and emits
+  the finished() signal.
+*/
+void TWebSocketWorker::run()
 {
-    _payloads = payloads;
-}
+    // In the thread MPM, each run can be on another thread of the pool
+    const bool pooled = (Tf::app()->multiProcessingModule() == TWebApplication::Thread);
 
+    for (;;) {
+        TWebSocketEndpoint *endpoint = _dispatcher.object();
+        if (pooled && endpoint) {
+            endpoint->moveToThread(QThread::currentThread());  // pulls it from no thread
+        }
+        TDatabaseContext::setCurrentDatabaseContext(this);
 
-void TWebSocketWorker::setSession(const TSession &session)
-{
-    _httpSession = session;
-}
+        for (;;) {
+            Job job;
+            {
+                QMutexLocker locker(&_mutex);
+                if (_jobs.isEmpty()) {
+                    break;
+                }
+                job = _jobs.dequeue();
+            }
 
+            if (job.mode == Receiving) {
+                for (auto &p : (const QList<QPair<int, QByteArray>> &)job.payloads) {
+                    execute(Receiving, p.first, p.second);
+                }
+            } else {
+                execute(job.mode, 0, QByteArray(), job.session);
+            }
+        }
 
-void TWebSocketWorker::run()
-{
-    if (_mode == Receiving) {
-        for (auto &p : (const QList<QPair<int, QByteArray>> &)_payloads) {
-            execute(p.first, p.second);
+        TDatabaseContext::release();
+        TDatabaseContext::setCurrentDatabaseContext(nullptr);
+        if (pooled && endpoint) {
+            endpoint->moveToThread(nullptr);  // lets the next run pull it
+        }
+
+        // Idle only after the cleanup; jobs enqueued meanwhile are run here
+        QMutexLocker locker(&_mutex);
+        if (_jobs.isEmpty()) {
+            _scheduled = false;
+            break;
         }
-        _payloads.clear();
-    } else {
-        execute();
     }
+    emit finished();
 }
 
+/*!
+  Returns the thread pool running workers in the thread MPM.
+*/
+QThreadPool *TWebSocketWorker::threadPool()
+{
+    static QThreadPool *pool = []() {
+        auto *p = new QThreadPool;
+        int max = Tf::appSettings()->value(Tf::MPMThreadMaxThreadsPerAppServer).toInt();
+        if (max > 0) {
+            p->setMaxThreadCount(max);
+        }
+        return p;
+    }();
+    return pool;
+}
 
-void TWebSocketWorker::execute(int opcode, const QByteArray &payload)
+
+void TWebSocketWorker::execute(RunMode mode, int opcode, const QByteArray &payload, const TSession &session)
 {
     bool sendTask = false;
-    QString es = TUrlRoute::splitPath(_requestPath).value(0).toLower() + "endpoint";
-    TDispatcher<TWebSocketEndpoint> dispatcher(es);
-    TWebSocketEndpoint *endpoint = dispatcher.object();
+    TWebSocketEndpoint *endpoint = _dispatcher.object();
 
     if (!endpoint) {
         return;
     }
 
+    // Clears the state of the last message
+    endpoint->taskList.clear();
+    endpoint->rollback = false;
+
     try {
-        tSystemDebug("Found endpoint: %s", qPrintable(es));
+        tSystemDebug("Found endpoint: %s", qPrintable(_dispatcher.typeName()));
         tSystemDebug("TWebSocketWorker opcode: %d", opcode);
 
         endpoint->sessionStore = _socket->session();  // Sets websocket session
@@ -93,13 +165,15 @@ void TWebSocketWorker::execute(int opcode, const QByteArray &payload)
             setTransactionEnabled(endpoint->transactionEnabled(), databaseId);
         }
 
-        switch (_mode) {
+        switch (mode) {
         case Opening: {
-            bool res = endpoint->onOpen(_httpSession);
+            bool res = endpoint->onOpen(session);
             if (res) {
                 // For switch response
                 endpoint->taskList.prepend(qMakePair((int)TWebSocketEndpoint::OpenSuccess, QVariant()));
 
+                _socket->setSendQueueLimits(endpoint->sendQueueLimitBytes(), endpoint->sendQueueLimitMessages(), endpoint->sendQueuePolicy());
+
                 if (endpoint->keepAliveInterval() > 0) {
                     endpoint->startKeepAlive(endpoint->keepAliveInterval());
                 }
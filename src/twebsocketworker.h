@@ -1,16 +1,22 @@
 #pragma once
-#include "tdatabasecontextthread.h"
 #include "twebsocketframe.h"
 #include <QList>
+#include <QMutex>
+#include <QObject>
 #include <QPair>
-#include <QThread>
+#include <QQueue>
+#include <QRunnable>
+#include <TDatabaseContext>
+#include <TDispatcher>
 #include <TGlobal>
 #include <TSession>
+#include <TWebSocketEndpoint>
 
+class QThreadPool;
 class TAbstractWebSocket;
 
 
-class T_CORE_EXPORT TWebSocketWorker : public TDatabaseContextThread {
+class T_CORE_EXPORT TWebSocketWorker : public QObject, public QRunnable, public TDatabaseContext {
     Q_OBJECT
 public:
     enum RunMode {
@@ -19,22 +25,33 @@ public:
         Closing,
     };
 
-    TWebSocketWorker(RunMode mode, TAbstractWebSocket *socket, const QByteArray &path, QObject *parent = 0);
+    TWebSocketWorker(TAbstractWebSocket *socket, const QByteArray &path, QObject *parent = 0);
     virtual ~TWebSocketWorker();
 
-    void setPayload(TWebSocketFrame::OpCode opCode, const QByteArray &data);
-    void setPayloads(QList<QPair<int, QByteArray>> payloads);
-    void setSession(const TSession &session);
+    bool enqueue(RunMode mode, const QList<QPair<int, QByteArray>> &payloads = QList<QPair<int, QByteArray>>(), const TSession &session = TSession());
+    void run() override;
+
+    static QThreadPool *threadPool();
+
+signals:
+    void finished();
 
 protected:
-    void run() override;
-    void execute(int opcode = 0, const QByteArray &payload = QByteArray());
+    void execute(RunMode mode, int opcode = 0, const QByteArray &payload = QByteArray(), const TSession &session = TSession());
 
 private:
-    RunMode _mode {Opening};
+    struct Job {
+        RunMode mode {Opening};
+        QList<QPair<int, QByteArray>> payloads;
+        TSession session;
+    };
+
     TAbstractWebSocket *_socket {nullptr};
-    TSession _httpSession;
-    QByteArray _requestPath;
-    QList<QPair<int, QByteArray>> _payloads;
-};
+    TDispatcher<TWebSocketEndpoint> _dispatcher;  // creates the endpoint once
+    QMutex _mutex;
+    QQueue<Job> _jobs;
+    bool _scheduled {false};
 
+    T_DISABLE_COPY(TWebSocketWorker)
+    T_DISABLE_MOVE(TWebSocketWorker)
+};
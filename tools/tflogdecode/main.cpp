@@ -0,0 +1,99 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QStringList>
+#include <TLogLayout>
+#include <cstdio>
+
+namespace {
+
+constexpr int READ_SIZE = 64 * 1024;
+
+
+void usage()
+{
+    std::fprintf(stderr, "Usage: tflogdecode [file ...]\n"
+                         "Converts binary logs of TreeFrog into JSON lines.\n"
+                         "If no file is given, reads the standard input.\n");
+}
+
+
+bool decode(QFile &file)
+{
+    QByteArray buffer;
+    int pos = 0;
+
+    for (;;) {
+        QByteArray data = file.read(READ_SIZE);
+        if (data.isEmpty()) {
+            break;
+        }
+        buffer.remove(0, pos);
+        buffer += data;
+        pos = 0;
+
+        for (;;) {
+            QByteArray json;
+            int len = TLogLayout::decodeBinary(buffer.constData() + pos, buffer.length() - pos, json);
+            if (len == 0) {
+                break;  // needs more data
+            }
+            if (len < 0) {
+                std::fprintf(stderr, "Invalid record at offset %lld: %s\n", (long long)(file.pos() - buffer.length() + pos), qPrintable(file.fileName()));
+                return false;
+            }
+            std::fwrite(json.constData(), 1, json.length(), stdout);
+            pos += len;
+        }
+    }
+
+    if (pos < buffer.length()) {
+        std::fprintf(stderr, "Truncated record at the end: %s\n", qPrintable(file.fileName()));
+        return false;
+    }
+    return true;
+}
+
+}
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    args.removeFirst();
+    int ret = 0;
+
+    if (args.contains("-h") || args.contains("--help")) {
+        usage();
+        return 0;
+    }
+
+    if (args.isEmpty()) {
+        QFile in;
+        if (!in.open(stdin, QIODevice::ReadOnly)) {
+            std::fprintf(stderr, "Failed to read the standard input\n");
+            return 1;
+        }
+        return decode(in) ? 0 : 1;
+    }
+
+    for (auto &path : args) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            std::fprintf(stderr, "Failed to open file: %s\n", qPrintable(path));
+            ret = 1;
+            continue;
+        }
+        if (!decode(file)) {
+            ret = 1;
+        }
+    }
+    return ret;
+}
@@ -0,0 +1,35 @@
+TARGET   = tflogdecode
+TEMPLATE = app
+VERSION  = 1.0.0
+CONFIG  += console c++14
+CONFIG  -= app_bundle
+QT      -= gui
+DEFINES += TF_DLL
+INCLUDEPATH += $$header.path
+
+include(../../tfbase.pri)
+
+isEmpty( target.path ) {
+  windows {
+    target.path = C:/TreeFrog/$${TF_VERSION}/bin
+  } else {
+    target.path = /usr/bin
+  }
+}
+
+windows {
+  CONFIG(debug, debug|release) {
+    TARGET = $$join(TARGET,,,d)
+    LIBS += -ltreefrogd$${TF_VER_MAJ}
+  } else {
+    LIBS += -ltreefrog$${TF_VER_MAJ}
+  }
+  LIBS += -L"$$target.path"
+} else:unix {
+  LIBS += -Wl,-rpath,$$lib.path -L$$lib.path -ltreefrog
+  linux-*:LIBS += -lrt
+}
+
+INSTALLS += target
+
+SOURCES += main.cpp
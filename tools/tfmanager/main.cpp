@@ -5,6 +5,7 @@
  * the New BSD License, which is incorporated herein by reference.
  */
 
+#include "metricsserver.h"
 #include "servermanager.h"
 #include "systembusdaemon.h"
 #include <QHostInfo>
@@ -658,8 +659,17 @@ int managerMain(int argc, char *argv[])
             tSystemError("File open failed: %s", qPrintable(pidfile.fileName()));
         }
 
+        // Metrics of all the application servers
+        MetricsServer *metricsServer = nullptr;
+        int metricsPort = Tf::appSettings()->value(Tf::MetricsPort).toInt();
+        if (metricsPort > 0) {
+            metricsServer = new MetricsServer(manager, &app);
+            metricsServer->listen(QHostAddress(listenAddress), metricsPort);
+        }
+
         ret = app.exec();
         tSystemDebug("TreeFrog manager process caught a signal [code:%d]", ret);
+        delete metricsServer;
         manager->stop();
 
         if (ret == 1) {  // means SIGHUP
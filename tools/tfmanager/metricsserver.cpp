@@ -0,0 +1,368 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "metricsserver.h"
+#include "servermanager.h"
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPointer>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <TIntrospector>
+#include <TMetrics>
+#include <TSystemGlobal>
+#include <TWebApplication>
+#include <algorithm>
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <sys/types.h>
+#endif
+
+namespace TreeFrog {
+
+constexpr int MAX_REQUEST_LENGTH = 8192;
+constexpr auto PROFILE_PATH = "/profile";
+constexpr int DEFAULT_PROFILE_SECONDS = 10;
+constexpr int DEFAULT_PROFILE_FREQUENCY = 99;  // Hz
+constexpr int MAX_PROFILE_SECONDS = 60;
+constexpr int MAX_PROFILE_FREQUENCY = 1000;
+constexpr int PROFILE_GRACE_SECONDS = 10;  // for symbolization
+constexpr int PROFILE_POLL_INTERVAL = 500;  // msecs
+constexpr auto INTROSPECT_PATH = "/introspect";
+constexpr int INTROSPECT_TIMEOUT = 3000;  // msecs
+constexpr int INTROSPECT_POLL_INTERVAL = 50;  // msecs
+
+/*!
+  \class MetricsServer
+  \brief The MetricsServer class serves the metrics of all the application
+  servers, summed up from the snapshots they write periodically.
+
+  It also serves the CPU profile of the application servers on the path
+  '/profile' in the folded format for flame graphs; the query parameters
+  'seconds' and 'hz' specify the duration and the sampling frequency.
+
+  On the path '/introspect', it serves the snapshots of the application
+  servers in JSON; the open sockets, the requests in flight, the checkouts
+  of the connection pools and the subscribers of the WebSocket topics.
+  \sa TIntrospector
+*/
+
+MetricsServer::MetricsServer(const ServerManager *manager, QObject *parent) :
+    QObject(parent),
+    serverManager(manager),
+    tcpServer(new QTcpServer(this))
+{
+    connect(tcpServer, SIGNAL(newConnection()), this, SLOT(acceptConnection()));
+}
+
+
+MetricsServer::~MetricsServer()
+{
+    close();
+}
+
+
+bool MetricsServer::listen(const QHostAddress &address, quint16 port)
+{
+    if (!tcpServer->listen(address, port)) {
+        tSystemError("Failed to listen on the metrics port: %d  (%s)", port, qPrintable(tcpServer->errorString()));
+        return false;
+    }
+    tSystemInfo("Metrics server listening on port %d", port);
+    return true;
+}
+
+
+void MetricsServer::close()
+{
+    tcpServer->close();
+}
+
+/*!
+  Returns the metrics summed up over the running application servers, and
+  removes the snapshots of the servers which have exited.
+*/
+QByteArray MetricsServer::collect() const
+{
+    QList<qint64> pids = serverManager->serverPids();
+    QList<QByteArray> snapshots;
+
+    for (qint64 pid : pids) {
+        QFile file(TMetrics::snapshotPath(pid));
+        if (file.open(QIODevice::ReadOnly)) {
+            snapshots << file.readAll();
+        }
+    }
+
+    // Cleanup
+    QDir dir(QFileInfo(TMetrics::snapshotPath(0)).absolutePath());
+    for (const auto &fi : dir.entryInfoList(QStringList("*.prom"), QDir::Files)) {
+        if (!pids.contains(fi.completeBaseName().toLongLong())) {
+            QFile::remove(fi.absoluteFilePath());
+        }
+    }
+
+    QByteArray metrics = TMetrics::merge(snapshots);
+    metrics += "# HELP tf_app_servers Number of running application servers\n";
+    metrics += "# TYPE tf_app_servers gauge\n";
+    metrics += "tf_app_servers " + QByteArray::number(pids.count()) + '\n';
+    return metrics;
+}
+
+
+void MetricsServer::acceptConnection()
+{
+    while (tcpServer->hasPendingConnections()) {
+        QTcpSocket *socket = tcpServer->nextPendingConnection();
+        connect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+        connect(socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()));
+    }
+}
+
+
+void MetricsServer::readRequest()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!socket || !socket->canReadLine()) {
+        if (socket && socket->bytesAvailable() > MAX_REQUEST_LENGTH) {
+            socket->abort();
+        }
+        return;
+    }
+
+    // Request line, such as "GET /metrics HTTP/1.1"
+    QList<QByteArray> request = socket->readLine().trimmed().split(' ');
+    QByteArray target = request.value(1);
+    int idx = target.indexOf('?');
+    QByteArray path = target.left(idx);
+    QByteArray query = (idx < 0) ? QByteArray() : target.mid(idx + 1);
+
+    disconnect(socket, SIGNAL(readyRead()), this, SLOT(readRequest()));
+
+    if (request.value(0) != "GET") {
+        sendResponse(socket, "405 Method Not Allowed", "text/plain", QByteArray());
+    } else if (path == PROFILE_PATH) {
+        QByteArray error = startProfiling(socket, query);
+        if (!error.isEmpty()) {
+            sendResponse(socket, error, "text/plain", QByteArray());
+        }
+    } else if (path == INTROSPECT_PATH) {
+        QByteArray error = startIntrospection(socket);
+        if (!error.isEmpty()) {
+            sendResponse(socket, error, "text/plain", QByteArray());
+        }
+    } else {
+        sendResponse(socket, "200 OK", TMetrics::ContentType, collect());
+    }
+}
+
+/*!
+  Makes the application servers start the sampling profiler, and returns
+  an error status if failed. The response is sent after the profiling
+  by finishProfiling().
+*/
+QByteArray MetricsServer::startProfiling(QTcpSocket *socket, const QByteArray &query)
+{
+#if defined(Q_OS_LINUX)
+    if (profiling) {
+        return "409 Conflict";
+    }
+
+    int seconds = DEFAULT_PROFILE_SECONDS;
+    int frequency = DEFAULT_PROFILE_FREQUENCY;
+    for (const auto &param : query.split('&')) {
+        int eq = param.indexOf('=');
+        if (param.left(eq) == "seconds") {
+            seconds = param.mid(eq + 1).toInt();
+        } else if (param.left(eq) == "hz") {
+            frequency = param.mid(eq + 1).toInt();
+        }
+    }
+    seconds = qBound(1, seconds, MAX_PROFILE_SECONDS);
+    frequency = qBound(1, frequency, MAX_PROFILE_FREQUENCY);
+
+    const QList<qint64> pids = serverManager->serverPids();
+    if (pids.isEmpty()) {
+        return "503 Service Unavailable";
+    }
+
+    // Request file read by the profiler of tfserver
+    QString dir = Tf::app()->tmpPath() + QLatin1String("profile/");
+    QDir().mkpath(dir);
+    QFile request(dir + QLatin1String("request"));
+    if (!request.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return "500 Internal Server Error";
+    }
+    request.write(QByteArray::number(seconds) + ' ' + QByteArray::number(frequency) + '\n');
+    request.close();
+
+    for (qint64 pid : pids) {
+        QFile::remove(dir + QString::number(pid) + QLatin1String(".folded"));
+        ::kill((pid_t)pid, SIGUSR2);
+    }
+
+    tSystemInfo("Profiling application servers  duration:%ds  frequency:%dHz", seconds, frequency);
+    profiling = true;
+    QPointer<QTcpSocket> sock(socket);
+    qint64 deadline = QDateTime::currentMSecsSinceEpoch() + (seconds + PROFILE_GRACE_SECONDS) * 1000LL;
+    QTimer::singleShot(seconds * 1000, this, [=]() { finishProfiling(sock, pids, deadline); });
+    return QByteArray();
+#else
+    Q_UNUSED(socket);
+    Q_UNUSED(query);
+    return "501 Not Implemented";
+#endif
+}
+
+/*!
+  Sends the profiles written by the application servers once all of
+  them are written or the \a deadline is passed.
+*/
+void MetricsServer::finishProfiling(QTcpSocket *socket, const QList<qint64> &pids, qint64 deadline)
+{
+    QString dir = Tf::app()->tmpPath() + QLatin1String("profile/");
+    QList<QByteArray> profiles;
+
+    for (qint64 pid : pids) {
+        QFile file(dir + QString::number(pid) + QLatin1String(".folded"));
+        if (file.open(QIODevice::ReadOnly)) {
+            profiles << file.readAll();
+        }
+    }
+
+    if (profiles.count() < pids.count() && QDateTime::currentMSecsSinceEpoch() < deadline) {
+        QPointer<QTcpSocket> sock(socket);
+        QTimer::singleShot(PROFILE_POLL_INTERVAL, this, [=]() { finishProfiling(sock, pids, deadline); });
+        return;
+    }
+
+    profiling = false;
+    if (socket) {
+        sendResponse(socket, "200 OK", "text/plain; charset=utf-8", mergeProfiles(profiles));
+    }
+}
+
+/*!
+  Makes the application servers write their snapshots, and returns an
+  error status if failed. The response is sent by finishIntrospection().
+*/
+QByteArray MetricsServer::startIntrospection(QTcpSocket *socket)
+{
+#if defined(Q_OS_UNIX)
+    const QList<qint64> pids = serverManager->serverPids();
+    if (pids.isEmpty()) {
+        return "503 Service Unavailable";
+    }
+
+    for (qint64 pid : pids) {
+        QFile::remove(TIntrospector::snapshotPath(pid));
+        ::kill((pid_t)pid, SIGUSR1);
+    }
+
+    QPointer<QTcpSocket> sock(socket);
+    qint64 deadline = QDateTime::currentMSecsSinceEpoch() + INTROSPECT_TIMEOUT;
+    QTimer::singleShot(INTROSPECT_POLL_INTERVAL, this, [=]() { finishIntrospection(sock, pids, deadline); });
+    return QByteArray();
+#else
+    Q_UNUSED(socket);
+    return "501 Not Implemented";
+#endif
+}
+
+/*!
+  Sends the snapshots written by the application servers once all of
+  them are written or the \a deadline is passed. A server which has not
+  responded is listed with the error.
+*/
+void MetricsServer::finishIntrospection(QTcpSocket *socket, const QList<qint64> &pids, qint64 deadline)
+{
+    QJsonArray servers;
+
+    for (qint64 pid : pids) {
+        QFile file(TIntrospector::snapshotPath(pid));
+        if (file.open(QIODevice::ReadOnly)) {
+            servers.append(QJsonDocument::fromJson(file.readAll()).object());
+        }
+    }
+
+    if (servers.count() < pids.count()) {
+        if (QDateTime::currentMSecsSinceEpoch() < deadline) {
+            QPointer<QTcpSocket> sock(socket);
+            QTimer::singleShot(INTROSPECT_POLL_INTERVAL, this, [=]() { finishIntrospection(sock, pids, deadline); });
+            return;
+        }
+
+        for (qint64 pid : pids) {
+            if (!QFileInfo(TIntrospector::snapshotPath(pid)).exists()) {
+                servers.append(QJsonObject {{QStringLiteral("pid"), (double)pid}, {QStringLiteral("error"), QStringLiteral("no response")}});
+            }
+        }
+    }
+
+    if (socket) {
+        QJsonObject body {{QStringLiteral("servers"), servers}};
+        sendResponse(socket, "200 OK", "application/json", QJsonDocument(body).toJson(QJsonDocument::Indented));
+    }
+}
+
+/*!
+  Merges the \a profiles in the folded format by summing up the numbers
+  of the samples of the same stacks.
+*/
+QByteArray MetricsServer::mergeProfiles(const QList<QByteArray> &profiles)
+{
+    QHash<QByteArray, qint64> stacks;
+
+    for (const auto &profile : profiles) {
+        for (const auto &line : profile.split('\n')) {
+            int sp = line.lastIndexOf(' ');
+            if (sp > 0) {
+                stacks[line.left(sp)] += line.mid(sp + 1).toLongLong();
+            }
+        }
+    }
+
+    QList<QByteArray> keys = stacks.keys();
+    std::sort(keys.begin(), keys.end(), [&stacks](const QByteArray &a, const QByteArray &b) {
+        qint64 na = stacks.value(a);
+        qint64 nb = stacks.value(b);
+        return (na != nb) ? na > nb : a < b;
+    });
+
+    QByteArray merged;
+    for (const auto &key : keys) {
+        merged += key;
+        merged += ' ';
+        merged += QByteArray::number(stacks.value(key));
+        merged += '\n';
+    }
+    return merged;
+}
+
+
+void MetricsServer::sendResponse(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, const QByteArray &body)
+{
+    QByteArray response;
+    response.reserve(body.length() + 160);
+    response += "HTTP/1.1 " + status + "\r\n";
+    response += "Content-Type: " + contentType + "\r\n";
+    response += "Content-Length: " + QByteArray::number(body.length()) + "\r\n";
+    response += "Connection: close\r\n\r\n";
+    response += body;
+
+    socket->write(response);
+    socket->disconnectFromHost();
+}
+
+}  // namespace TreeFrog
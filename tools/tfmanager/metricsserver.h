@@ -0,0 +1,44 @@
+#pragma once
+#include <QHostAddress>
+#include <QObject>
+#include <TGlobal>
+
+class QTcpServer;
+class QTcpSocket;
+
+namespace TreeFrog {
+
+class ServerManager;
+
+
+class MetricsServer : public QObject {
+    Q_OBJECT
+public:
+    MetricsServer(const ServerManager *manager, QObject *parent = nullptr);
+    ~MetricsServer();
+
+    bool listen(const QHostAddress &address, quint16 port);
+    void close();
+    QByteArray collect() const;
+    static QByteArray mergeProfiles(const QList<QByteArray> &profiles);
+
+protected slots:
+    void acceptConnection();
+    void readRequest();
+
+private:
+    QByteArray startProfiling(QTcpSocket *socket, const QByteArray &query);
+    void finishProfiling(QTcpSocket *socket, const QList<qint64> &pids, qint64 deadline);
+    QByteArray startIntrospection(QTcpSocket *socket);
+    void finishIntrospection(QTcpSocket *socket, const QList<qint64> &pids, qint64 deadline);
+    static void sendResponse(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, const QByteArray &body);
+
+    const ServerManager *serverManager {nullptr};
+    QTcpServer *tcpServer {nullptr};
+    bool profiling {false};
+
+    T_DISABLE_COPY(MetricsServer)
+    T_DISABLE_MOVE(MetricsServer)
+};
+
+}  // namespace TreeFrog
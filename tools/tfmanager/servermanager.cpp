@@ -159,6 +159,21 @@ int ServerManager::serverCount() const
 }
 
 
+/*!
+  Returns the process IDs of the running application servers.
+*/
+QList<qint64> ServerManager::serverPids() const
+{
+    QList<qint64> pids;
+    for (auto *server : serversStatus.keys()) {
+        if (server->state() == QProcess::Running) {
+            pids << server->processId();
+        }
+    }
+    return pids;
+}
+
+
 void ServerManager::ajustServers()
 {
     if (isRunning()) {
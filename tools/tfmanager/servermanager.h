@@ -27,6 +27,7 @@ public:
     ManagerState state() const { return managerState; }
     int serverCount() const;
     int spareServerCount() const;
+    QList<qint64> serverPids() const;
     static QString tfserverProgramPath();
     static void setupEnvironment(QProcess *process);
 
@@ -11,12 +11,70 @@
 #include <QFile>
 #include <QLocalServer>
 #include <QLocalSocket>
+#include <QThread>
+#include <TAtomic>
 #include <TWebApplication>
 #include <tsystembus.h>
+#ifdef Q_OS_LINUX
+#include <tsystembusring.h>
+#endif
 
 static SystemBusDaemon *systemBusDaemon = nullptr;
 static int maxServers = 0;
 
+namespace {
+
+void writeSocket(QLocalSocket *socket, const char *data, uint length)
+{
+    uint wrotelen = 0;
+    for (;;) {
+        int len = socket->write(data + wrotelen, length - wrotelen);
+        if (len <= 0) {
+            tSystemError("PIPE write error  len:%d [%s:%d]", len, __FILE__, __LINE__);
+            break;
+        }
+
+        wrotelen += len;
+        if (wrotelen == length) {
+            break;
+        }
+
+        if (!socket->waitForBytesWritten(1000)) {
+            tSystemError("PIPE wait error  [%s:%d]", __FILE__, __LINE__);
+            break;
+        }
+    }
+}
+
+#ifdef Q_OS_LINUX
+// Waits for records of the system bus ring to relay them to the servers
+// connected through the local socket
+class RingWaiter : public QThread {
+public:
+    RingWaiter(TSystemBusRing *ring, QObject *daemon) :
+        QThread(), _ring(ring), _daemon(daemon) { }
+    void stop() { _stopped = true; }
+
+protected:
+    void run() override
+    {
+        quint32 sequence = _ring->sequence();
+        while (!_stopped.load()) {
+            if (_ring->wait(sequence, 1000) || _ring->isStalled()) {
+                QMetaObject::invokeMethod(_daemon, "readRing", Qt::QueuedConnection);
+            }
+        }
+    }
+
+private:
+    TSystemBusRing *_ring {nullptr};
+    QObject *_daemon {nullptr};
+    TAtomic<bool> _stopped {false};
+};
+#endif
+
+}
+
 
 #ifdef Q_OS_UNIX
 static QString unixDomainServerDir()
@@ -34,7 +92,11 @@ SystemBusDaemon::SystemBusDaemon() :
 
 SystemBusDaemon::~SystemBusDaemon()
 {
+    stopRingWaiter();
     delete localServer;
+#ifdef Q_OS_LINUX
+    delete busRing;
+#endif
 }
 
 
@@ -49,6 +111,24 @@ bool SystemBusDaemon::open()
     }
 #endif
 
+#ifdef Q_OS_LINUX
+    // Shared memory ring; tfservers exchange messages through it directly
+    if (!busRing) {
+        busRing = new TSystemBusRing(TSystemBus::connectionName());
+    }
+    if (busRing->create()) {
+        tSystemDebug("system bus ring open : %s", qPrintable(busRing->name()));
+        if (!ringWaiter) {
+            ringWaiter = new RingWaiter(busRing, this);
+            ringWaiter->start();
+        }
+    } else {
+        tSystemWarn("system bus ring open error, uses the local socket  [%s:%d]", __FILE__, __LINE__);
+    }
+#endif
+
+    // Local socket for the servers failing to attach the ring; the daemon
+    // bridges their messages and the ones in the ring
     bool ret = localServer->listen(TSystemBus::connectionName());
     if (ret) {
         tSystemDebug("system bus open : %s", qPrintable(localServer->fullServerName()));
@@ -70,6 +150,14 @@ void SystemBusDaemon::close()
         delete socket;
     }
 
+#ifdef Q_OS_LINUX
+    stopRingWaiter();
+    if (busRing) {
+        busRing->detach();
+        TSystemBusRing::remove(busRing->name());
+    }
+#endif
+
     tSystemDebug("close system bus daemon : %s", qPrintable(localServer->fullServerName()));
 }
 
@@ -125,26 +213,20 @@ void SystemBusDaemon::readSocket()
         // Writes to other tfservers
         for (auto *tfserver : socketSet) {
             if (tfserver != socket) {
-                uint wrotelen = 0;
-                for (;;) {
-                    int len = tfserver->write(buf.data() + wrotelen, length - wrotelen);
-                    if (len <= 0) {
-                        tSystemError("PIPE write error  len:%d [%s:%d]", len, __FILE__, __LINE__);
-                        break;
-                    }
-
-                    wrotelen += len;
-                    if (wrotelen == length) {
-                        break;
-                    }
-
-                    if (!tfserver->waitForBytesWritten(1000)) {
-                        tSystemError("PIPE wait error  [%s:%d]", __FILE__, __LINE__);
-                        break;
-                    }
-                }
+                writeSocket(tfserver, buf.data(), length);
+            }
+        }
+
+#ifdef Q_OS_LINUX
+        // Writes to the tfservers attached to the ring
+        if (busRing && busRing->isAttached()) {
+            QByteArray frame = buf.left(length);
+            auto message = TSystemBusMessage::parse(frame);
+            if (message.isValid()) {
+                busRing->write(0x80 | message.opCode(), message.target().toUtf8(), message.data());
             }
         }
+#endif
 
         buf.remove(0, length);
         if (buf.isEmpty()) {
@@ -154,6 +236,43 @@ void SystemBusDaemon::readSocket()
 }
 
 
+/*
+  Relays the records written to the ring by the tfservers attached to it
+  to the ones connected through the local socket.
+*/
+void SystemBusDaemon::readRing()
+{
+#ifdef Q_OS_LINUX
+    quint8 firstByte;
+    QByteArray target, data;
+
+    while (busRing && busRing->read(firstByte, target, data)) {
+        if (socketSet.isEmpty()) {
+            continue;  // discards
+        }
+
+        QByteArray frame = TSystemBusMessage(firstByte, QString::fromUtf8(target), data).toByteArray();
+        for (auto *tfserver : socketSet) {
+            writeSocket(tfserver, frame.data(), frame.length());
+        }
+    }
+#endif
+}
+
+
+void SystemBusDaemon::stopRingWaiter()
+{
+#ifdef Q_OS_LINUX
+    if (ringWaiter) {
+        static_cast<RingWaiter *>(ringWaiter)->stop();
+        ringWaiter->wait();
+        delete ringWaiter;
+        ringWaiter = nullptr;
+    }
+#endif
+}
+
+
 void SystemBusDaemon::handleDisconnect()
 {
     QLocalSocket *socket = qobject_cast<QLocalSocket *>(sender());
@@ -192,6 +311,11 @@ void SystemBusDaemon::releaseResource(qint64 pid)
         file.remove();
         tSystemWarn("File removed for UNIX domain socket : %s", qPrintable(file.fileName()));
     }
+#ifdef Q_OS_LINUX
+    if (TSystemBusRing::remove(TSystemBus::connectionName(pid))) {
+        tSystemWarn("Shared memory removed for system bus : %s", qPrintable(TSystemBus::connectionName(pid)));
+    }
+#endif
 #else
     Q_UNUSED(pid);
 #endif
@@ -5,6 +5,8 @@
 
 class QLocalServer;
 class QLocalSocket;
+class QThread;
+class TSystemBusRing;
 
 
 class SystemBusDaemon : QObject {
@@ -21,13 +23,17 @@ public:
 protected slots:
     void acceptConnection();
     void readSocket();
+    void readRing();
     void handleDisconnect();
 
 private:
     QLocalServer *localServer;
     QSet<QLocalSocket *> socketSet;
+    TSystemBusRing *busRing {nullptr};  // Linux only
+    QThread *ringWaiter {nullptr};
 
     SystemBusDaemon();
+    void stopRingWaiter();
 
     T_DISABLE_COPY(SystemBusDaemon)
     T_DISABLE_MOVE(SystemBusDaemon)
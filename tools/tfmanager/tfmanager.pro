@@ -43,10 +43,12 @@ DEFINES += INSTALL_PATH=\\\"$$target.path\\\"
 }
 
 SOURCES += main.cpp \
+           metricsserver.cpp \
            servermanager.cpp \
            systembusdaemon.cpp
 
-HEADERS += servermanager.h \
+HEADERS += metricsserver.h \
+           servermanager.h \
            systembusdaemon.h
 
 windows {
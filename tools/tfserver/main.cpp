@@ -6,20 +6,28 @@
  */
 
 #include "signalhandler.h"
+#if defined(Q_OS_LINUX)
+#include "profiler.h"
+#endif
 #include "tdispatcher.h"
 #include "thazardptrmanager.h"
 #include "tsystemglobal.h"
 #include <QMap>
 #include <QStringList>
 #include <QTextCodec>
+#include <QTimer>
 #include <TActionController>
 #include <TAppSettings>
+#include <TIntrospector>
 #include <TJSLoader>
+#include <TMetrics>
 #include <TMultiplexingServer>
 #include <TSystemGlobal>
 #include <TThreadApplicationServer>
+#include <TTracer>
 #include <TUrlRoute>
 #include <TWebApplication>
+#include <csignal>
 #include <cstdlib>
 #include <cstdio>
 using namespace TreeFrog;
@@ -29,6 +37,7 @@ constexpr auto SOCKET_OPTION = "-s";
 constexpr auto AUTO_RELOAD_OPTION = "-r";
 constexpr auto PORT_OPTION = "-p";
 constexpr auto SHOW_ROUTES_OPTION = "--show-routes";
+constexpr int METRICS_SNAPSHOT_INTERVAL = 5000;  // msecs
 
 namespace {
 
@@ -58,6 +67,7 @@ void messageOutput(QtMsgType type, const QMessageLogContext &context, const QStr
 void writeFailure(const void *data, int size)
 {
     tSystemError("%s", QByteArray((const char *)data, size).data());
+    Tf::flushLogWriter();
 }
 #endif
 
@@ -182,6 +192,16 @@ void showRoutes()
 
 int main(int argc, char *argv[])
 {
+#if defined(Q_OS_UNIX)
+    // The manager process may request a snapshot or a profile as soon as
+    // this process is forked; ignores them until the triggers are set up
+    // rather than being terminated by the default action of the signals.
+    std::signal(SIGUSR1, SIG_IGN);
+#if defined(Q_OS_LINUX)
+    std::signal(SIGUSR2, SIG_IGN);
+#endif
+#endif
+
     TWebApplication webapp(argc, argv);
     TApplicationServerBase *server = nullptr;
     int ret = -1;
@@ -195,6 +215,9 @@ int main(int argc, char *argv[])
     Tf::setupQueryLogger();
     Tf::setupAppLoggers();
 
+    // Setup tracer
+    TTracer::setup();
+
     // Setup hazard pointer
     THazardPtrManager::instance().setGarbageCollectionBufferSize(Tf::app()->maxNumberOfThreadsPerAppServer());
 
@@ -312,6 +335,26 @@ int main(int argc, char *argv[])
         goto finish;
     }
 
+    if (TMetrics::isEnabled()) {
+        TMetrics::registerDefaultMetrics();
+
+        if (Tf::appSettings()->value(Tf::MetricsPort).toInt() > 0) {
+            // Writes the metrics for the manager process to sum up
+            QString snapshot = TMetrics::snapshotPath(QCoreApplication::applicationPid());
+            auto *timer = new QTimer(&webapp);
+            QObject::connect(timer, &QTimer::timeout, [=]() { TMetrics::writeSnapshot(snapshot); });
+            timer->start(METRICS_SNAPSHOT_INTERVAL);
+        }
+    }
+
+#if defined(Q_OS_LINUX)
+    // Sampling profiler started by the manager process
+    Profiler::setupTrigger();
+#endif
+
+    // Snapshot of the server state requested by the manager process
+    TIntrospector::setupTrigger();
+
     QObject::connect(&webapp, &QCoreApplication::aboutToQuit, [=]() { server->stop(); });
     ret = webapp.exec();
 
@@ -328,6 +371,8 @@ finish:
         break;
     }
 
+    TTracer::release();
+
     // Release loggers
     Tf::releaseAppLoggers();
     Tf::releaseQueryLogger();
@@ -0,0 +1,370 @@
+/* Copyright (c) 2019, AOYAMA Kazuharu
+ * All rights reserved.
+ *
+ * This software may be used and distributed according to the terms of
+ * the New BSD License, which is incorporated herein by reference.
+ */
+
+#include "profiler.h"
+#include "symbolize.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QSaveFile>
+#include <QSocketNotifier>
+#include <QVector>
+#include <TSystemGlobal>
+#include <TWebApplication>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <tfcore_unix.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+using namespace GOOGLE_NAMESPACE;
+
+/*!
+  \class TreeFrog::Profiler
+  \brief The Profiler class is a sampling CPU profiler of the application
+  server, started on demand by the manager process.
+
+  Every thread is given a timer on its own CPU-time clock which sends
+  SIGPROF to the thread, and the signal handler records the stack of the
+  thread by walking its frame pointers. After the duration,
+  the stacks are symbolized and written in the folded format, which
+  flamegraph.pl takes as it is. The duration, the frequency and the
+  number of samples are bounded.
+
+  The unwinder for the crash reports is not async-signal-safe, so the
+  handler follows the frame pointer chain of the interrupted context
+  instead; code built without -fno-omit-frame-pointer yields truncated
+  stacks.
+*/
+
+namespace {
+constexpr int TRIGGER_SIGNAL = SIGUSR2;
+constexpr int SCAN_INTERVAL_MSECS = 100;  // to find threads started later
+constexpr uintptr_t MAX_FRAME_SIZE = 100000;
+
+struct Sample {
+    int depth;
+    void *frames[TreeFrog::Profiler::MaxDepth];
+};
+
+Sample *samples = nullptr;
+std::atomic<int> sampleCount {0};
+std::atomic<int> activeHandlers {0};
+std::atomic<bool> sampling {false};
+int triggerPipe[2] = {-1, -1};
+
+
+/*
+  Stores the return addresses of the frame pointer chain of the context
+  interrupted by the signal. Reads nothing but the stack above the stack
+  pointer, where every frame record must lie above the previous one, so
+  that a register not used as the frame pointer stops the walk.
+*/
+int walkStack(void *context, void **frames, int maxDepth)
+{
+    const auto *uc = static_cast<const ucontext_t *>(context);
+#if defined(__x86_64__)
+    uintptr_t pc = uc->uc_mcontext.gregs[REG_RIP];
+    uintptr_t fp = uc->uc_mcontext.gregs[REG_RBP];
+    uintptr_t sp = uc->uc_mcontext.gregs[REG_RSP];
+#elif defined(__aarch64__)
+    uintptr_t pc = uc->uc_mcontext.pc;
+    uintptr_t fp = uc->uc_mcontext.regs[29];
+    uintptr_t sp = uc->uc_mcontext.sp;
+#else
+    Q_UNUSED(uc);
+    Q_UNUSED(frames);
+    Q_UNUSED(maxDepth);
+    return 0;
+#endif
+
+#if defined(__x86_64__) || defined(__aarch64__)
+    int depth = 0;
+    frames[depth++] = reinterpret_cast<void *>(pc);
+
+    uintptr_t lower = sp;
+    while (depth < maxDepth) {
+        if (fp < lower || fp - lower > MAX_FRAME_SIZE || (fp & (sizeof(void *) - 1))) {
+            break;
+        }
+        // A frame record is the saved frame pointer and the return address
+        const uintptr_t *record = reinterpret_cast<const uintptr_t *>(fp);
+        if (!record[1]) {
+            break;
+        }
+        frames[depth++] = reinterpret_cast<void *>(record[1]);
+        lower = fp + 2 * sizeof(void *);
+        fp = record[0];
+    }
+    return depth;
+#endif
+}
+
+
+void profileSignalHandler(int, siginfo_t *, void *context)
+{
+    activeHandlers++;
+    if (sampling.load()) {
+        int savedErrno = errno;
+        int idx = sampleCount.fetch_add(1);
+        if (idx < TreeFrog::Profiler::MaxSamples) {
+            Sample &sample = samples[idx];
+            sample.depth = walkStack(context, sample.frames, TreeFrog::Profiler::MaxDepth);
+        }
+        errno = savedErrno;
+    }
+    activeHandlers--;
+}
+
+
+void triggerSignalHandler(int)
+{
+    int savedErrno = errno;
+    char c = 1;
+    tf_write(triggerPipe[1], &c, 1);
+    errno = savedErrno;
+}
+
+
+inline clockid_t threadCpuClock(pid_t tid)
+{
+    // MAKE_THREAD_CPUCLOCK(tid, CPUCLOCK_SCHED) of the Linux kernel
+    return ((~(clockid_t)tid) << 3) | 6;
+}
+
+
+QByteArray symbolName(void *pc)
+{
+    char symbol[1024];
+    // Symbolizes the previous address of pc because pc may be in the
+    // next function.
+    if (Symbolize(reinterpret_cast<char *>(pc) - 1, symbol, sizeof(symbol))) {
+        QByteArray name(symbol);
+        return name.replace(';', ':');  // separator of the folded format
+    }
+    return QByteArrayLiteral("0x") + QByteArray::number((quintptr)pc, 16);
+}
+}
+
+namespace TreeFrog {
+
+Profiler *Profiler::instance()
+{
+    static Profiler *profiler = new Profiler;
+    return profiler;
+}
+
+/*!
+  Starts profiling for \a seconds seconds at \a frequency samples per
+  second of CPU time of each thread. Returns false if it is already
+  profiling.
+*/
+bool Profiler::start(int seconds, int frequency)
+{
+    if (isRunning()) {
+        tSystemWarn("Profiler already running");
+        return false;
+    }
+
+    _seconds = qBound(1, seconds, (int)MaxSeconds);
+    _frequency = qBound(1, frequency, (int)MaxFrequency);
+    QThread::start();
+    return true;
+}
+
+/*!
+  Makes the profiler start when the process receives SIGUSR2, reading the
+  duration and the frequency from the request file written by the manager
+  process.
+*/
+void Profiler::setupTrigger()
+{
+    if (triggerPipe[0] >= 0 || pipe2(triggerPipe, O_CLOEXEC | O_NONBLOCK) < 0) {
+        return;
+    }
+
+    auto *notifier = new QSocketNotifier(triggerPipe[0], QSocketNotifier::Read, Tf::app());
+    QObject::connect(notifier, &QSocketNotifier::activated, []() {
+        char buf[16];
+        while (tf_read(triggerPipe[0], buf, sizeof(buf)) > 0) { }
+
+        int seconds = DefaultSeconds;
+        int frequency = DefaultFrequency;
+        QFile request(requestFilePath());
+        if (request.open(QIODevice::ReadOnly)) {
+            QList<QByteArray> params = request.readAll().simplified().split(' ');
+            seconds = params.value(0).toInt();
+            frequency = params.value(1).toInt();
+        }
+        instance()->start(seconds, frequency);
+    });
+
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    action.sa_handler = triggerSignalHandler;
+    sigaction(TRIGGER_SIGNAL, &action, nullptr);
+}
+
+
+QString Profiler::requestFilePath()
+{
+    return Tf::app()->tmpPath() + QLatin1String("profile/request");
+}
+
+
+QString Profiler::outputFilePath(qint64 pid)
+{
+    return Tf::app()->tmpPath() + QLatin1String("profile/") + QString::number(pid) + QLatin1String(".folded");
+}
+
+
+void Profiler::run()
+{
+    const pid_t selfTid = tf_gettid();
+    QHash<pid_t, timer_t> timers;
+    QElapsedTimer elapsed;
+
+    samples = new Sample[MaxSamples];
+    sampleCount.store(0);
+
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    action.sa_sigaction = profileSignalHandler;
+    sigaction(SIGPROF, &action, nullptr);
+
+    tSystemInfo("Profiler started  duration:%ds  frequency:%dHz", _seconds, _frequency);
+    sampling.store(true);
+    elapsed.start();
+
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = 0;
+    spec.it_interval.tv_nsec = 1000000000L / _frequency;
+    spec.it_value = spec.it_interval;
+
+    while (elapsed.elapsed() < _seconds * 1000LL && sampleCount.load() < MaxSamples) {
+        // Arms a timer for each thread
+        const QStringList tids = QDir(QStringLiteral("/proc/self/task")).entryList(QDir::Dirs | QDir::NoDotAndDotDot);
+        for (const auto &str : tids) {
+            pid_t tid = str.toInt();
+            if (tid <= 0 || tid == selfTid || timers.contains(tid)) {
+                continue;
+            }
+
+            struct sigevent event;
+            std::memset(&event, 0, sizeof(event));
+            event.sigev_notify = SIGEV_THREAD_ID;
+            event.sigev_signo = SIGPROF;
+            event.sigev_notify_thread_id = tid;
+
+            timer_t timer;
+            if (timer_create(threadCpuClock(tid), &event, &timer) == 0) {
+                timer_settime(timer, 0, &spec, nullptr);
+                timers.insert(tid, timer);
+            } else {
+                timers.insert(tid, timer_t());  // the thread has exited
+            }
+        }
+        QThread::msleep(SCAN_INTERVAL_MSECS);
+    }
+
+    for (auto it = timers.cbegin(); it != timers.cend(); ++it) {
+        if (it.value()) {
+            timer_delete(it.value());
+        }
+    }
+
+    // Waits for the handlers running yet
+    sampling.store(false);
+    while (activeHandlers.load() > 0) {
+        QThread::yieldCurrentThread();
+    }
+
+    int count = sampleCount.load();
+    if (count > MaxSamples) {
+        tSystemWarn("Profiler dropped %d samples", count - MaxSamples);
+        count = MaxSamples;
+    }
+
+    QString path = outputFilePath(QCoreApplication::applicationPid());
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(foldStacks(count));
+        file.commit();
+    } else {
+        tSystemError("Failed to write profile: %s", qPrintable(path));
+    }
+
+    delete[] samples;
+    samples = nullptr;
+    tSystemInfo("Profiler finished  samples:%d  threads:%d", count, timers.count());
+}
+
+/*
+  Returns the stacks of the first \a count samples in the folded format;
+  a line for each stack, from the root to the leaf separated by ';',
+  followed by the number of the samples.
+*/
+QByteArray Profiler::foldStacks(int count) const
+{
+    QHash<void *, QByteArray> symbols;
+    QHash<QByteArray, int> stacks;
+
+    for (int i = 0; i < count; ++i) {
+        const Sample &sample = samples[i];
+        QByteArray stack;
+        for (int j = sample.depth - 1; j >= 0; --j) {
+            void *pc = sample.frames[j];
+            auto it = symbols.find(pc);
+            if (it == symbols.end()) {
+                it = symbols.insert(pc, symbolName(pc));
+            }
+            stack += it.value();
+            if (j > 0) {
+                stack += ';';
+            }
+        }
+        if (!stack.isEmpty()) {
+            stacks[stack]++;
+        }
+    }
+
+    QVector<QPair<int, QByteArray>> sorted;
+    sorted.reserve(stacks.count());
+    for (auto it = stacks.cbegin(); it != stacks.cend(); ++it) {
+        sorted << qMakePair(it.value(), it.key());
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const QPair<int, QByteArray> &a, const QPair<int, QByteArray> &b) {
+        return a.first > b.first;
+    });
+
+    QByteArray folded;
+    for (const auto &stack : sorted) {
+        folded += stack.second;
+        folded += ' ';
+        folded += QByteArray::number(stack.first);
+        folded += '\n';
+    }
+    return folded;
+}
+
+}  // namespace TreeFrog
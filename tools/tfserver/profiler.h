@@ -0,0 +1,40 @@
+#pragma once
+#include <QString>
+#include <QThread>
+#include <TGlobal>
+
+namespace TreeFrog {
+
+class Profiler : public QThread {
+public:
+    bool start(int seconds, int frequency);
+
+    static Profiler *instance();
+    static void setupTrigger();
+    static QString requestFilePath();
+    static QString outputFilePath(qint64 pid);
+
+    enum {
+        MaxDepth = 48,
+        MaxSamples = 32768,  // about 12MB
+        MaxSeconds = 60,
+        MaxFrequency = 1000,
+        DefaultSeconds = 10,
+        DefaultFrequency = 99,
+    };
+
+protected:
+    void run() override;
+
+private:
+    Profiler() { }
+    QByteArray foldStacks(int count) const;
+
+    int _seconds {DefaultSeconds};
+    int _frequency {DefaultFrequency};
+
+    T_DISABLE_COPY(Profiler)
+    T_DISABLE_MOVE(Profiler)
+};
+
+}  // namespace TreeFrog
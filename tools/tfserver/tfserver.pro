@@ -57,3 +57,8 @@ unix {
              stacktrace_x86-inl.h \
              stacktrace_x86_64-inl.h
 }
+
+linux {
+  HEADERS += profiler.h
+  SOURCES += profiler.cpp
+}
@@ -22,14 +22,15 @@
     "  Q_OBJECT\n"                                  \
     "public:\n"                                     \
     "  %1() : TActionView() { }\n"                  \
-    "  QString toString();\n"                       \
+    "\n"                                            \
+    "protected:\n"                                  \
+    "  void render();\n"                            \
     "};\n"                                          \
     "\n"                                            \
-    "QString %1::toString()\n"                      \
+    "void %1::render()\n"                           \
     "{\n"                                           \
-    "  responsebody.reserve(%3);\n"                 \
+    "  reserveOutput(%3);\n"                        \
     "%2\n"                                          \
-    "  return responsebody;\n"                      \
     "}\n"                                           \
     "\n"                                            \
     "T_DEFINE_VIEW(%1)\n"                           \
@@ -38,6 +39,7 @@
 
 
 const QRegExp RxPartialTag("<%#partial[ \t]+\"([^\"]+)\"[ \t]*%>");
+const QRegExp RxRenderPartial("<%==[ \t]*renderPartial\\([ \t]*\"([^\"]+)\"[ \t]*\\)[ \t;]*([-+]?)%>");
 
 
 ErbConverter::ErbConverter(const QDir &output, const QDir &helpers, const QDir &partial) :
@@ -144,6 +146,34 @@ QString ErbConverter::escapeNewline(const QString &string)
 }
 
 
+QString ErbConverter::escapeUtf8Literal(const QString &string)
+{
+    const QByteArray utf8 = string.toUtf8();
+    QString str;
+    str.reserve(utf8.length() * 1.1);
+
+    for (char c : utf8) {
+        uchar u = (uchar)c;
+        if (u == '\\') {
+            str += QLatin1String("\\\\");
+        } else if (u == '\n') {
+            str += QLatin1String("\\n");
+        } else if (u == '\r') {
+            str += QLatin1String("\\r");
+        } else if (u == '"') {
+            str += QLatin1String("\\\"");
+        } else if (u >= 0x80) {
+            // Always three digits, not to absorb the following digit
+            str += QLatin1Char('\\');
+            str += QString::number(u, 8);
+        } else {
+            str += QLatin1Char(c);
+        }
+    }
+    return str;
+}
+
+
 QString ErbConverter::generateIncludeCode(const ErbParser &parser) const
 {
     QString code = parser.includeCode();
@@ -168,16 +198,33 @@ QStringList ErbConverter::replacePartialTag(QString &erbSrc, int depth) const
     int pos = 0;
 
     while (pos < erbSrc.length()) {
-        int idx;
-        if ((idx = RxPartialTag.indexIn(erbSrc, pos)) < 0) {
+        int idx = RxPartialTag.indexIn(erbSrc, pos);
+        int rdx = RxRenderPartial.indexIn(erbSrc, pos);
+        if (idx < 0 && rdx < 0) {
             erbReplaced += erbSrc.mid(pos);
             break;
         }
 
-        QString partialFile = RxPartialTag.cap(1);
+        // renderPartial() without variables is inlined in a block
+        // scope, if the partial is an ERB template
+        bool render = (idx < 0 || (rdx >= 0 && rdx < idx));
+        const QRegExp &rx = (render) ? RxRenderPartial : RxPartialTag;
+        if (render) {
+            idx = rdx;
+        }
+
+        const QString tag = rx.cap(0);
+        const QString trim = rx.cap(2);
+        QString partialFile = rx.cap(1);
+        if (render && !partialFile.contains('/')) {
+            partialFile.prepend(QLatin1String("partial/"));
+        }
         if (QFileInfo(partialFile).suffix().toLower() != "erb") {
             partialFile += ".erb";
         }
+        if (render) {
+            partialFile.prepend(QLatin1String("../"));  // relative to the partial directory
+        }
 
         if (depth > 10) {
             // no more replace
@@ -186,7 +233,7 @@ QStringList ErbConverter::replacePartialTag(QString &erbSrc, int depth) const
         }
 
         erbReplaced += erbSrc.mid(pos, idx - pos);
-        pos = idx + RxPartialTag.matchedLength();
+        pos = idx + tag.length();
 
         // Includes the partial
         QFile partErb(partialDirectory.filePath(partialFile));
@@ -194,7 +241,16 @@ QStringList ErbConverter::replacePartialTag(QString &erbSrc, int depth) const
             ret << partialFile;
             QString part = QTextStream(&partErb).readAll();
             ret << replacePartialTag(part, depth + 1);
-            erbReplaced += part;
+            if (render) {
+                // '+' keeps the whitespaces around as renderPartial() does
+                erbReplaced += QLatin1String("<% { +%>");
+                erbReplaced += part;
+                erbReplaced += (trim == QLatin1String("-")) ? QLatin1String("<% } -%>") : QLatin1String("<% } +%>");
+            } else {
+                erbReplaced += part;
+            }
+        } else if (render) {
+            erbReplaced += tag;  // renders at runtime
         }
     }
 
@@ -14,6 +14,7 @@ public:
     QDir outputDir() const { return outputDirectory; }
     static QString fileSuffix() { return "erb"; }
     static QString escapeNewline(const QString &string);
+    static QString escapeUtf8Literal(const QString &string);
 
 protected:
     QString generateIncludeCode(const ErbParser &parser) const;
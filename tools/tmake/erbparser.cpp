@@ -24,19 +24,40 @@ static QString semicolonTrim(const QString &str)
 }
 
 
-static bool isAsciiString(const QString &str)
+// Returns the index of the comma before the last argument, skipping
+// the ones in quotes, parentheses and brackets
+static int lastArgumentIndex(const QString &args)
 {
-    for (auto &c : str) {
-        if (c.unicode() >= 128)
-            return false;
+    int depth = 0;
+    int index = -1;
+    QChar quote;
+
+    for (int i = 0; i < args.length(); ++i) {
+        QChar c = args[i];
+        if (!quote.isNull()) {
+            if (c == QLatin1Char('\\')) {
+                ++i;
+            } else if (c == quote) {
+                quote = QChar();
+            }
+        } else if (c == QLatin1Char('"') || c == QLatin1Char('\'')) {
+            quote = c;
+        } else if (c == QLatin1Char('(') || c == QLatin1Char('[') || c == QLatin1Char('{')) {
+            ++depth;
+        } else if (c == QLatin1Char(')') || c == QLatin1Char(']') || c == QLatin1Char('}')) {
+            --depth;
+        } else if (c == QLatin1Char(',') && depth == 0) {
+            index = i;
+        }
     }
-    return true;
+    return index;
 }
 
 
 void ErbParser::parse(const QString &erb)
 {
     srcCode.clear();
+    cacheDepth = 0;
     srcCode.reserve(erb.length() * 2);
 
     // trimming strongly
@@ -59,14 +80,10 @@ void ErbParser::parse(const QString &erb)
         int i = erbData.indexOf("<%", pos);
         QString text = erbData.mid(pos, i - pos);
         if (!text.isEmpty()) {
-            // HTML output
-            if (isAsciiString(text)) {
-                srcCode += QLatin1String("  responsebody += QStringLiteral(\"");
-            } else {
-                srcCode += QLatin1String("  responsebody += tr(\"");
-            }
-            srcCode += ErbConverter::escapeNewline(text);
-            srcCode += QLatin1String("\");\n");
+            // HTML output as UTF-8 bytes
+            srcCode += QLatin1String("  echo(QByteArrayLiteral(\"");
+            srcCode += ErbConverter::escapeUtf8Literal(text);
+            srcCode += QLatin1String("\"));\n");
         }
 
         if (i >= 0) {
@@ -76,6 +93,13 @@ void ErbParser::parse(const QString &erb)
             break;
         }
     }
+
+    if (cacheDepth > 0) {
+        qCritical("Missing endcache directive");
+        for (; cacheDepth > 0; --cacheDepth) {
+            srcCode += QLatin1String("  endCache(); }\n");
+        }
+    }
 }
 
 
@@ -99,6 +123,11 @@ void ErbParser::parsePercentTag()
     QChar c = erbData[pos++];
     if (c == QLatin1Char('#')) {  // <%#
         startTag += c;
+        int sp = 0;
+        while (posMatchWith(" ", sp) || posMatchWith("\t", sp)) {
+            ++sp;
+        }
+
         if (posMatchWith("include ") || posMatchWith("include\t")) {
             startTag += QLatin1String("include");
             // Outputs include-macro
@@ -106,6 +135,37 @@ void ErbParser::parsePercentTag()
             QPair<QString, QString> p = parseEndPercentTag();
             incCode += p.first;
             incCode += QLatin1Char('\n');
+        } else if (posMatchWith("cache ", sp) || posMatchWith("cache\t", sp) || posMatchWith("cache\"", sp)) {
+            startTag += QLatin1String("cache");
+            pos += sp + 5;
+            // Outputs fragment caching: <%# cache "key", seconds %>
+            QPair<QString, QString> p = parseEndPercentTag();
+            QString args = semicolonTrim(p.first);
+            int comma = lastArgumentIndex(args);
+            if (comma < 0) {
+                qCritical("Invalid cache directive, requires a key and seconds: %s", qPrintable(args));
+                srcCode += QLatin1String("if (true) {\n");
+            } else {
+                srcCode += QLatin1String("if (beginCache(");
+                srcCode += args.left(comma).trimmed();
+                srcCode += QLatin1String(", (");
+                srcCode += args.mid(comma + 1).trimmed();
+                srcCode += QLatin1String("))) {\n");
+            }
+            ++cacheDepth;
+
+        } else if (posMatchWith("endcache", sp)) {
+            startTag += QLatin1String("endcache");
+            pos += sp + 8;
+            parseEndPercentTag();
+            if (cacheDepth > 0) {
+                srcCode += QLatin1String("endCache(); }\n");
+                --cacheDepth;
+            } else {
+                qCritical("Unbalanced endcache directive");
+                srcCode += QLatin1Char('\n');
+            }
+
         } else {
             // Outputs comments
             srcCode += QLatin1String("/*");
@@ -161,15 +221,15 @@ void ErbParser::parsePercentTag()
             QPair<QString, QString> p = parseEndPercentTag();
             if (!p.first.isEmpty()) {
                 if (p.second.isEmpty()) {
-                    srcCode += QLatin1String("responsebody += QVariant(");
+                    srcCode += QLatin1String("echo(QVariant(");
                     srcCode += semicolonTrim(p.first);
-                    srcCode += QLatin1String(").toString();\n");
+                    srcCode += QLatin1String(").toString());\n");
                 } else {
                     srcCode += QLatin1String("{ QString ___s = QVariant(");
                     srcCode += semicolonTrim(p.first);
-                    srcCode += QLatin1String(").toString(); responsebody += (___s.isEmpty()) ? QVariant(");
+                    srcCode += QLatin1String(").toString(); echo((___s.isEmpty()) ? QVariant(");
                     srcCode += semicolonTrim(p.second);
-                    srcCode += QLatin1String(").toString() : ___s; }\n");
+                    srcCode += QLatin1String(").toString() : ___s); }\n");
                 }
             }
 
@@ -178,15 +238,15 @@ void ErbParser::parsePercentTag()
             QPair<QString, QString> p = parseEndPercentTag();
             if (!p.first.isEmpty()) {
                 if (p.second.isEmpty()) {
-                    srcCode += QLatin1String("responsebody += THttpUtility::htmlEscape(");
+                    srcCode += QLatin1String("eh(");
                     srcCode += semicolonTrim(p.first);
                     srcCode += QLatin1String(");\n");
                 } else {
                     srcCode += QLatin1String("{ QString ___s = QVariant(");
                     srcCode += semicolonTrim(p.first);
-                    srcCode += QLatin1String(").toString(); responsebody += (___s.isEmpty()) ? THttpUtility::htmlEscape(");
+                    srcCode += QLatin1String(").toString(); if (___s.isEmpty()) eh(");
                     srcCode += semicolonTrim(p.second);
-                    srcCode += QLatin1String(") : THttpUtility::htmlEscape(___s); }\n");
+                    srcCode += QLatin1String("); else eh(___s); }\n");
                 }
             }
         }
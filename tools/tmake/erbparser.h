@@ -30,5 +30,6 @@ private:
     QString incCode;
     int pos;
     QString startTag;
+    int cacheDepth {0};
 };
 
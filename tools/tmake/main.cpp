@@ -6,7 +6,9 @@
  */
 
 #include "viewconverter.h"
+#include "../../src/thttpcompressor.h"
 #include <QCoreApplication>
+#include <QDirIterator>
 #include <QFileInfo>
 #include <QMap>
 #include <QSettings>
@@ -14,6 +16,7 @@
 #include <QTextCodec>
 
 constexpr auto DEFAULT_OUTPUT_DIR = "viewcodes";
+constexpr int PRECOMPRESSION_LEVEL = 9;
 
 extern QString devIni;
 extern int defaultTrimMode;
@@ -22,10 +25,78 @@ extern int defaultTrimMode;
 static int usage()
 {
     std::printf("usage: tmake [-f config-file] [-v view-dir] [-d output-dir] [-p|-P]\n");
+    std::printf("       tmake [-f config-file] -z public-dir\n");
     return 0;
 }
 
 
+static QList<THttpCompressor::Encoding> precompressionEncodings(const QSettings &appSetting)
+{
+    QList<THttpCompressor::Encoding> encodings;
+    QStringList names;
+    for (auto &s : appSetting.value("HttpCompression.Encodings").toStringList()) {
+        names << s.simplified().split(' ', QString::SkipEmptyParts);
+    }
+
+    for (auto &name : names) {
+        auto encoding = THttpCompressor::fromName(name.toLatin1().toLower());
+        if (!THttpCompressor::fileSuffix(encoding).isEmpty() && THttpCompressor::isSupported(encoding) && !encodings.contains(encoding)) {
+            encodings << encoding;
+        }
+    }
+
+    if (!encodings.contains(THttpCompressor::Gzip)) {
+        encodings << THttpCompressor::Gzip;  // understood by any client
+    }
+    return encodings;
+}
+
+// Creates the compressed siblings of the static files, such as 'app.js.gz'
+static int precompress(const QDir &publicDir, const QList<THttpCompressor::Encoding> &encodings)
+{
+    const QStringList filters = {"*.html", "*.htm", "*.css", "*.js", "*.mjs", "*.json", "*.map", "*.svg", "*.txt", "*.xml"};
+    int res = 0;
+
+    QDirIterator it(publicDir.path(), filters, QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QFileInfo fi(it.next());
+        QByteArray data;
+
+        for (auto encoding : encodings) {
+            QFileInfo dst(fi.filePath() + QLatin1String(THttpCompressor::fileSuffix(encoding)));
+            if (dst.exists() && dst.lastModified() >= fi.lastModified()) {
+                continue;  // up to date
+            }
+
+            if (data.isNull()) {
+                QFile src(fi.filePath());
+                if (!src.open(QIODevice::ReadOnly)) {
+                    std::fprintf(stderr, "failed to open file: %s\n", qPrintable(src.fileName()));
+                    res = 1;
+                    break;
+                }
+                data = src.readAll();
+            }
+
+            QByteArray compressed = THttpCompressor::compress(encoding, data.constData(), data.length(), PRECOMPRESSION_LEVEL);
+            if (compressed.isEmpty() || compressed.length() >= data.length()) {
+                QFile::remove(dst.filePath());  // not worth sending
+                continue;
+            }
+
+            QFile out(dst.filePath());
+            if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate) || out.write(compressed) != compressed.length()) {
+                std::fprintf(stderr, "failed to write file: %s\n", qPrintable(out.fileName()));
+                res = 1;
+                continue;
+            }
+            std::printf("  created  %s\n", qPrintable(out.fileName()));
+        }
+    }
+    return res;
+}
+
+
 static QMap<QString, QString> convertArgs(const QStringList &args)
 {
     QMap<QString, QString> hash;
@@ -78,6 +149,15 @@ int main(int argc, char *argv[])
     }
     QTextCodec::setCodecForLocale(codec);
 
+    if (args.contains("-z")) {
+        QDir publicDir(args.value("-z"));
+        if (args.value("-z").isEmpty() || !publicDir.exists()) {
+            usage();
+            return 1;
+        }
+        return precompress(publicDir, precompressionEncodings(appSetting));
+    }
+
     defaultTrimMode = devSetting.value("Erb.DefaultTrimMode", "1").toInt();
     std::printf("Erb.DefaultTrimMode: %d\n", defaultTrimMode);
 
@@ -23,11 +23,27 @@ HEADERS = viewconverter.h \
           erbparser.h \
           otmparser.h \
           otamaconverter.h \
-          ../../src/thtmlparser.h
+          ../../src/thtmlparser.h \
+          ../../src/thttpcompressor.h
 SOURCES = main.cpp \
           viewconverter.cpp \
           erbconverter.cpp \
           erbparser.cpp \
           otmparser.cpp \
           otamaconverter.cpp \
-          ../../src/thtmlparser.cpp
+          ../../src/thtmlparser.cpp \
+          ../../src/thttpcompressor.cpp
+
+windows {
+  QT += zlib-private
+} else {
+  LIBS += -lz
+}
+!isEmpty( use_brotli ) {
+  DEFINES += TF_HAVE_BROTLI
+  LIBS += -lbrotlienc
+}
+!isEmpty( use_zstd ) {
+  DEFINES += TF_HAVE_ZSTD
+  LIBS += -lzstd
+}